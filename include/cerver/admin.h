@@ -14,6 +14,7 @@
 #include "cerver/cerver.h"
 #include "cerver/handler.h"
 #include "cerver/packets.h"
+#include "cerver/pollfds.h"
 
 struct _Cerver;
 struct _Client;
@@ -135,8 +136,8 @@ struct _AdminCerver {
 	// number of bad packets before ending connection
 	u32 n_bad_packets_limit;
 
-	struct pollfd *fds;
-	u32 max_n_fds;                      // current max n fds in pollfd
+	struct _PollFds *poll_fds;
+	u32 max_n_fds;                      // n of slots in the pollfd array
 	u16 current_n_fds;                  // n of active fds in the pollfd array
 	u32 poll_timeout;
 	pthread_mutex_t *poll_lock;
@@ -5,6 +5,8 @@
 
 #include <poll.h>
 
+#include <sys/epoll.h>
+
 #include "cerver/types/types.h"
 #include "cerver/types/string.h"
 
@@ -18,13 +20,24 @@
 #include "cerver/errors.h"
 #include "cerver/handler.h"
 #include "cerver/network.h"
+#include "cerver/outbound.h"
 #include "cerver/packets.h"
+#include "cerver/pollfds.h"
 
+#include "cerver/threads/thread.h"
 #include "cerver/threads/thpool.h"
 
 #include "cerver/game/game.h"
 
 #define DEFAULT_CONNECTION_QUEUE            7
+#define DEFAULT_MAX_ACCEPTS                 64          // max n of connections accepted every time the socket is ready
+#define DEFAULT_RECEIVE_BUDGET              16          // max n of reads from a connection every time it is ready
+
+#define DEFAULT_OUTBOUND_LOW_WATERMARK      65536       // reads are resumed when an outbound queue drains to this size
+#define DEFAULT_OUTBOUND_HIGH_WATERMARK     1048576     // the outbound policy is applied when an outbound queue reaches this size
+#define DEFAULT_OUTBOUND_POLICY             OUTBOUND_POLICY_PAUSE
+
+#define DEFAULT_ZERO_COPY_SEND_THRESHOLD    65536       // smaller sends are cheaper to copy than to pin & notify
 
 #define DEFAULT_TH_POOL_INIT                4
 
@@ -34,6 +47,11 @@
 #define DEFAULT_POLL_TIMEOUT                2000
 #define poll_n_fds                          100         // n of fds for the pollfd array
 
+#define DEFAULT_EPOLL_MAX_EVENTS            256         // max n of ready events handled every epoll_wait ()
+
+#define DEFAULT_UDP_MAX_PEERS               4096        // max n of udp peers registered at the same time
+#define DEFAULT_UDP_PEER_TIMEOUT            60          // secs without datagrams after which a udp peer is dropped
+
 #define DEFAULT_SOCKETS_INIT                10
 
 #define DEFAULT_MAX_INACTIVE_TIME           60
@@ -49,6 +67,8 @@ struct _Connection;
 struct _Packet;
 struct _PacketsPerType;
 struct _Handler;
+struct _CerverUring;
+struct _CerverReactor;
 
 #pragma region global
 
@@ -84,7 +104,10 @@ CERVER_EXPORT const char *cerver_type_to_string (CerverType type);
 #define CERVER_HANDLER_TYPE_MAP(XX)																\
 	XX(0,	NONE, 		None, 		None)														\
 	XX(1,	POLL, 		Poll, 		Handle connections using a single thread & poll ())			\
-	XX(2,	THREADS, 	Threads, 	Handle each new connection in a dedicated thread)
+	XX(2,	THREADS, 	Threads, 	Handle each new connection in a dedicated thread)			\
+	XX(3,	EPOLL, 		Epoll, 		Handle connections using a single thread & edge triggered epoll ())		\
+	XX(4,	URING, 		Uring, 		Handle connections using a single thread & io_uring - fallbacks to epoll ())	\
+	XX(5,	REACTORS, 	Reactors, 	Handle connections using multiple threads each one with its own SO_REUSEPORT socket & epoll ())
 
 typedef enum CerverHandlerType {
 
@@ -98,6 +121,27 @@ CERVER_EXPORT const char *cerver_handler_type_to_string (CerverHandlerType type)
 
 CERVER_EXPORT const char *cerver_handler_type_description (CerverHandlerType type);
 
+#define CERVER_THREAD_ROLE_MAP(XX)																	\
+	XX(0,	THPOOL, 	Thpool, 	The threads of the cerver thpool)								\
+	XX(1,	HANDLER, 	Handler, 	The threads of the app & custom packet handlers)				\
+	XX(2,	REACTOR, 	Reactor, 	The threads of the reactors)									\
+	XX(3,	UPDATE, 	Update, 	The update & update interval & inactive clients threads)		\
+	XX(4,	ON_HOLD, 	OnHold, 	The thread that polls the on hold connections)
+
+typedef enum CerverThreadRole {
+
+	#define XX(num, name, string, description) CERVER_THREAD_ROLE_##name = num,
+	CERVER_THREAD_ROLE_MAP (XX)
+	#undef XX
+
+} CerverThreadRole;
+
+#define CERVER_THREAD_ROLE_COUNT			5
+
+CERVER_EXPORT const char *cerver_thread_role_to_string (CerverThreadRole role);
+
+CERVER_EXPORT const char *cerver_thread_role_description (CerverThreadRole role);
+
 #pragma endregion
 
 #pragma region info
@@ -180,7 +224,21 @@ struct _Cerver {
 	Protocol protocol;                  // we only support either tcp or udp
 	bool use_ipv6;
 	u16 connection_queue;               // each server can handle connection differently
+	u32 max_accepts;                    // max n of connections accepted & registered in a single batch
 	u32 receive_buffer_size;
+	u32 receive_budget;                 // max n of reads from a connection before serving the others
+
+	bool outbound_queues;               // connections queue what can't be sent right away
+	size_t outbound_low_watermark;
+	size_t outbound_high_watermark;
+	OutboundPolicy outbound_policy;
+	bool coalesce_sends;                // packets sent while handling a received buffer are sent together
+	bool zero_copy_sends;               // big packets are sent with MSG_ZEROCOPY
+	size_t zero_copy_send_threshold;
+	bool header_v2;                     // offer the compact v2 packet header to the clients that support it
+	bool packet_checksums;              // offer a crc32c of the data after every v2 header
+	const struct _PacketCompressor *compressor;     // offer to compress the data of big packets
+	size_t compression_threshold;
 
 	bool isRunning;                     // the server is recieving and/or sending packetss
 	bool blocking;                      // sokcet fd is blocking?
@@ -190,6 +248,10 @@ struct _Cerver {
 
 	u16 n_thpool_threads;
 	Thpool *thpool;
+	bool ordered_dispatch;              // each connection's received buffers are handled in order
+
+	// where each kind of the cerver's threads runs & where their memory comes from
+	ThreadAffinity thread_affinities[CERVER_THREAD_ROLE_COUNT];
 
 	// 29/05/2020
 	// using this pool to avoid completely destroying connection's sockets
@@ -216,12 +278,30 @@ struct _Cerver {
 	// a detachable thread will be created anyway
 	bool handle_detachable_threads;
 
-	struct pollfd *fds;
-	u32 max_n_fds;                      // current max n fds in pollfd
+	struct _PollFds *poll_fds;          // used only with CERVER_HANDLER_TYPE_POLL
 	u16 current_n_fds;                  // n of active fds in the pollfd array
 	u32 poll_timeout;
 	pthread_mutex_t *poll_lock;
 
+	// used only with CERVER_HANDLER_TYPE_EPOLL
+	i32 epoll_fd;
+	struct epoll_event *epoll_events;
+	u32 epoll_max_events;               // max n of ready events to get from every epoll_wait ()
+
+	// used only with CERVER_HANDLER_TYPE_URING
+	struct _CerverUring *uring;
+
+	// used only with CERVER_HANDLER_TYPE_REACTORS
+	u16 n_reactors;                     // n of listening sockets & threads, defaults to the n of online cpus
+	struct _CerverReactor **reactors;
+	u16 *reactors_sock_fds;             // the id + 1 of the reactor that handles each sock fd
+	u32 n_reactors_sock_fds;
+
+	// used only with PROTOCOL_UDP
+	struct _CerverUdp *udp;
+	u32 udp_max_peers;
+	u32 udp_peer_timeout;
+
 	/*** auth ***/
 	bool auth_required;                 // does the server requires authentication?
 	struct _Packet *auth_packet;        // requests client authentication
@@ -230,9 +310,9 @@ struct _Cerver {
 
 	AVLTree *on_hold_connections;       // hold on the connections until they authenticate
 	Htab *on_hold_connection_sock_fd_map;
-	struct pollfd *hold_fds;
+	struct _PollFds *hold_poll_fds;
 	u32 on_hold_poll_timeout;
-	u32 max_on_hold_connections;
+	u32 max_on_hold_connections;        // n of slots in the on hold pollfd array
 	u16 current_on_hold_nfds;
 	pthread_t on_hold_poll_id;
 	pthread_mutex_t *on_hold_poll_lock;
@@ -270,6 +350,8 @@ struct _Cerver {
 	// pthread_cond_t *handlers_wait;
 
 	bool check_packets;                     // enable / disbale packet checking
+	bool zero_copy_packets;                 // received packets reference the receive buffer
+	size_t max_packet_size;                 // max size that a received packet can claim in its header
 
 	pthread_t update_thread_id;
 	Action update;                          // method to be executed every tick
@@ -311,9 +393,87 @@ CERVER_EXPORT void cerver_set_network_values (
 // sets the cerver connection queue (how many connections to queue for accept)
 CERVER_EXPORT void cerver_set_connection_queue (Cerver *cerver, const u16 connection_queue);
 
+// sets the max n of pending connections that will be accepted every time the cerver's socket is ready
+// the rest will be accepted in the next wakeup, so a flood of new connections can't starve receives
+// only used with CERVER_HANDLER_TYPE_POLL, CERVER_HANDLER_TYPE_EPOLL & CERVER_HANDLER_TYPE_REACTORS
+CERVER_EXPORT void cerver_set_max_accepts (Cerver *cerver, const u32 max_accepts);
+
 // sets the cerver's receive buffer size used in recv method
 CERVER_EXPORT void cerver_set_receive_buffer_size (Cerver *cerver, const u32 size);
 
+// sets the max n of reads from a connection's socket every time it is ready
+// the connection is read until there is no more data or the budget is reached,
+// so a single busy connection can't starve the others
+// not used with CERVER_HANDLER_TYPE_THREADS & CERVER_HANDLER_TYPE_URING
+CERVER_EXPORT void cerver_set_receive_budget (Cerver *cerver, const u32 receive_budget);
+
+// set whether every connection will have its own outbound queue
+// packets are sent without blocking & what can't be sent right away is queued
+// and flushed by the cerver when the connection's socket becomes writable again,
+// so a slow reader can't stall the thread that is sending to it
+// only used with CERVER_HANDLER_TYPE_EPOLL & CERVER_HANDLER_TYPE_REACTORS,
+// CERVER_HANDLER_TYPE_URING connections always queue their packets to send them with the
+// cerver's io_uring, but the watermarks & the outbound policy are only applied if this is turned on
+// CERVER_HANDLER_TYPE_POLL & CERVER_HANDLER_TYPE_THREADS connections use blocking sockets
+// that are not watched for writes, so this option is ignored & their sends block instead
+// by default, this option is turned off
+CERVER_EXPORT void cerver_set_outbound_queues (Cerver *cerver, bool outbound_queues);
+
+// sets the outbound queues watermarks, when a queue reaches the high watermark
+// the cerver's outbound policy is applied, if its reads were paused,
+// they are resumed when the queue drains to the low watermark
+// ignored with CERVER_HANDLER_TYPE_POLL & CERVER_HANDLER_TYPE_THREADS as they have no outbound queues
+// the default values are DEFAULT_OUTBOUND_LOW_WATERMARK & DEFAULT_OUTBOUND_HIGH_WATERMARK
+CERVER_EXPORT void cerver_set_outbound_watermarks (
+	Cerver *cerver, const size_t low_watermark, const size_t high_watermark
+);
+
+// sets what to do with a connection whose outbound queue reached the high watermark
+// ignored with CERVER_HANDLER_TYPE_POLL & CERVER_HANDLER_TYPE_THREADS as they have no outbound queues
+// the default value is DEFAULT_OUTBOUND_POLICY
+CERVER_EXPORT void cerver_set_outbound_policy (Cerver *cerver, OutboundPolicy policy);
+
+// set whether the packets that are sent to a connection while its received buffer is being handled
+// are coalesced & sent together with a single call once all the received packets have been handled,
+// useful when handlers reply with many small packets, only packets sent by direct handlers
+// & by the cerver itself are coalesced, use connection_cork () to coalesce other sends
+// by default, this option is turned off
+CERVER_EXPORT void cerver_set_coalesce_sends (Cerver *cerver, bool coalesce_sends);
+
+// set whether the packets that are at least the zero copy threshold in size are sent with MSG_ZEROCOPY,
+// the kernel sends them directly from the packet's buffers instead of copying them,
+// so the buffers are held until the kernel reports that it is done with them
+// only used with tcp connections & if the kernel supports it
+// by default, this option is turned off
+CERVER_EXPORT void cerver_set_zero_copy_sends (Cerver *cerver, bool zero_copy_sends);
+
+// sets the min size in bytes of the sends that are done with MSG_ZEROCOPY
+// the default value is DEFAULT_ZERO_COPY_SEND_THRESHOLD
+CERVER_EXPORT void cerver_set_zero_copy_send_threshold (Cerver *cerver, const size_t threshold);
+
+// set whether the cerver offers the v2 packet header in its info packet,
+// clients that support it ask to use it & both ends switch to it in the middle of the stream,
+// clients that don't keep using the v1 header
+// only used with tcp connections
+// by default, this option is turned off
+CERVER_EXPORT void cerver_set_header_v2 (Cerver *cerver, bool header_v2);
+
+// set whether the cerver offers to follow every v2 header with the crc32c of its packet's data,
+// so packets that are corrupted on their way are dropped when they are received
+// the connections that ask for them switch right after agreeing to use the v2 header
+// it implies the v2 header, by default, this option is turned off
+CERVER_EXPORT void cerver_set_packet_checksums (Cerver *cerver, bool packet_checksums);
+
+// sets the compressor that the cerver offers for the data of the packets in its connections,
+// the clients that have the same one ask to use it after agreeing to use the v2 header
+// & then both ends compress the data that reaches the compression threshold
+// it implies the v2 header, by default, there is no compression
+CERVER_EXPORT void cerver_set_compression (Cerver *cerver, const struct _PacketCompressor *compressor);
+
+// sets the min data size that is compressed
+// the default is PACKET_COMPRESSION_THRESHOLD
+CERVER_EXPORT void cerver_set_compression_threshold (Cerver *cerver, const size_t threshold);
+
 // sets the cerver's data and a way to free it
 CERVER_EXPORT void cerver_set_cerver_data (Cerver *cerver, void *data, Action delete_data);
 
@@ -325,6 +485,41 @@ CERVER_EXPORT void cerver_set_cerver_data (Cerver *cerver, void *data, Action de
 // by default, all received packets will be handle only in one thread
 CERVER_EXPORT void cerver_set_thpool_n_threads (Cerver *cerver, u16 n_threads);
 
+// set whether the buffers that are received from a connection are handled by the thpool in order,
+// one after the other, instead of by any free thread that has to wait for the socket's read mutex,
+// the buffers of different connections are still handled at the same time
+// only used if the cerver has a thpool
+// by default, this option is turned off
+CERVER_EXPORT void cerver_set_ordered_dispatch (Cerver *cerver, bool ordered_dispatch);
+
+// sets the cpus that the cerver's threads with the role can run on,
+// an empty set lets them run on the ones they inherited, which is the default
+// must be called before the cerver is started
+CERVER_EXPORT void cerver_set_thread_affinity (
+	Cerver *cerver, CerverThreadRole role, const ThreadCpuSet *cpus
+);
+
+// sets the cerver's threads with the role to run on the cpus of the numa node
+// must be called before the cerver is started
+// returns 0 on success, 1 on error
+CERVER_EXPORT u8 cerver_set_thread_affinity_numa_node (
+	Cerver *cerver, CerverThreadRole role, unsigned int node
+);
+
+// set whether the memory that the cerver's threads with the role allocate comes from their numa node,
+// the buffers that belong to a single thread, like a thpool thread's deque or a reactor's events,
+// are then allocated from inside the thread after it has been placed
+// must be called before the cerver is started
+// by default, this option is turned off
+CERVER_EXPORT void cerver_set_numa_local_buffers (
+	Cerver *cerver, CerverThreadRole role, bool numa_local
+);
+
+// names the calling thread & places it using the affinity of its role
+CERVER_PRIVATE void cerver_thread_setup (
+	const Cerver *cerver, CerverThreadRole role, const char *name
+);
+
 // sets the initial number of sockets to be created in the cerver's sockets pool
 // the defauult value is 10
 CERVER_EXPORT void cerver_set_sockets_pool_init (Cerver *cerver, unsigned int n_sockets);
@@ -353,6 +548,28 @@ CERVER_EXPORT void cerver_set_handle_detachable_threads (Cerver *cerver, bool ac
 // sets the cerver poll timeout in ms
 CERVER_EXPORT void cerver_set_poll_time_out (Cerver *cerver, const u32 poll_timeout);
 
+// sets the max number of ready events that will be handled in every epoll_wait ()
+// only has effect if cerver handler type is CERVER_HANDLER_TYPE_EPOLL or CERVER_HANDLER_TYPE_REACTORS
+// the default value is DEFAULT_EPOLL_MAX_EVENTS
+CERVER_EXPORT void cerver_set_epoll_max_events (Cerver *cerver, const u32 max_events);
+
+// sets the number of reactors to use if cerver handler type is CERVER_HANDLER_TYPE_REACTORS
+// each reactor has its own listening socket bound with SO_REUSEPORT to the cerver's port
+// and handles the connections that it accepts in its own thread
+// the default value (0) is to use one reactor for each online cpu
+CERVER_EXPORT void cerver_set_reactors (Cerver *cerver, const u16 n_reactors);
+
+// sets the max n of udp peers that can be registered at the same time,
+// datagrams from new peers are ignored while the limit is reached
+// only has effect if the cerver protocol is PROTOCOL_UDP
+// 0 to disable the limit, the default value is DEFAULT_UDP_MAX_PEERS
+CERVER_EXPORT void cerver_set_udp_max_peers (Cerver *cerver, const u32 max_peers);
+
+// sets the secs after which a udp peer that has not sent any datagram is dropped
+// only has effect if the cerver protocol is PROTOCOL_UDP
+// 0 to never drop idle peers, the default value is DEFAULT_UDP_PEER_TIMEOUT
+CERVER_EXPORT void cerver_set_udp_peer_timeout (Cerver *cerver, const u32 peer_timeout);
+
 // enables cerver's built in authentication methods
 // cerver requires client authentication upon new client connections
 // max_auth_tries is the number of failed auth allowed for each new client connection
@@ -391,6 +608,8 @@ CERVER_EXPORT void cerver_set_on_hold_check_packets (Cerver *cerver, bool check)
 CERVER_EXPORT u8 cerver_set_sessions (Cerver *cerver, void *(*session_id_generator) (const void *));
 
 // sets a custom method to handle the raw received buffer from the socket
+// the method owns the buffer, it can be released with socket_receive_buffer_release ()
+// so the socket can use it again, or it can be deleted with free ()
 CERVER_EXPORT void cerver_set_handle_recieved_buffer (Cerver *cerver, Action handle_received_buffer);
 
 // 27/05/2020 - changed form Action to Handler
@@ -430,6 +649,20 @@ CERVER_EXPORT int cerver_set_multiple_handlers (Cerver *cerver, unsigned int n_h
 // by default, this option is turned off
 CERVER_EXPORT void cerver_set_check_packets (Cerver *cerver, bool check_packets);
 
+// set whether received packets should reference the received buffer
+// instead of copying their header & data into their own allocated memory
+// the buffer is deleted when the last packet that references it gets deleted,
+// so packets that are kept by the application also keep the whole buffer alive
+// packets data can NOT be appended and this option is ignored with CERVER_HANDLER_TYPE_THREADS
+// by default, this option is turned off
+CERVER_EXPORT void cerver_set_zero_copy_packets (Cerver *cerver, bool zero_copy_packets);
+
+// sets the max size (header included) of the packets that the cerver can receive,
+// the space for a packet is allocated using the size in its header before its data arrives,
+// so a header that claims a bigger size is counted as a bad packet & its connection is dropped
+// 0 to disable the limit, the default value is DEFAULT_MAX_PACKET_SIZE
+CERVER_EXPORT void cerver_set_max_packet_size (Cerver *cerver, size_t max_packet_size);
+
 // sets a custom cerver update function to be executed every n ticks
 // a new thread will be created that will call your method each tick
 // the update args will be passed to your method as a CerverUpdate &
@@ -553,6 +786,10 @@ struct _CerverReport {
 	bool auth_required;
 	bool uses_sessions;
 
+	u8 header_version;                  // the max PacketHeaderVersion that the cerver supports
+	bool checksums;                     // the cerver can send checksums after v2 headers
+	u8 compressor;                      // the id of the cerver's compressor, 0 if it has none
+
 };
 
 typedef struct _CerverReport CerverReport;
@@ -580,6 +817,13 @@ typedef struct SCerver {
 	char welcome[S_CERVER_WELCOME_LENGTH];
 
 	bool use_ipv6;
+
+	// these take the padding after use_ipv6, so the layout does not change,
+	// older cervers zero the structure, so a 0 means the v1 header without checksums nor compression
+	u8 header_version;
+	bool checksums;
+	u8 compressor;
+
 	Protocol protocol;
 	u16 port;
 
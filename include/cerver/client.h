@@ -270,6 +270,7 @@ CERVER_PRIVATE u8 client_register_to_cerver (struct _Cerver *cerver, Client *cli
 CERVER_PRIVATE Client *client_unregister_from_cerver (struct _Cerver *cerver, Client *client);
 
 // gets the client associated with a sock fd using the client-sock fd map
+// if the cerver uses reactors, each reactor's client map will be searched
 CERVER_PUBLIC Client *client_get_by_sock_fd (struct _Cerver *cerver, i32 sock_fd);
 
 // searches the avl tree to get the client associated with the session id
@@ -277,6 +278,7 @@ CERVER_PUBLIC Client *client_get_by_sock_fd (struct _Cerver *cerver, i32 sock_fd
 CERVER_PUBLIC Client *client_get_by_session_id (struct _Cerver *cerver, const char *session_id);
 
 // broadcast a packet to all clients inside an avl structure
+// the packet is serialized only once & shared by all the sends
 CERVER_PUBLIC void client_broadcast_to_all_avl (
 	AVLNode *node,
 	struct _Cerver *cerver,
@@ -626,7 +628,7 @@ CERVER_PRIVATE unsigned int client_receive_internal (
 	char *buffer, const size_t buffer_size
 );
 
-// allocates a new packet buffer to receive incoming data from the connection's socket
+// uses the connection's socket packet buffer to receive incoming data from the connection's socket
 // returns 0 on success handle, 1 if any error ocurred and must likely the connection was ended
 CERVER_PUBLIC unsigned int client_receive (Client *client, struct _Connection *connection);
 
@@ -27,8 +27,10 @@ struct _CerverReport;
 struct _Client;
 struct _Connection;
 struct _PacketsPerType;
+struct _PacketCompressor;
 struct _SockReceive;
 struct _AdminCerver;
+struct _CerverReactor;
 
 struct _ConnectionStats {
 
@@ -45,12 +47,28 @@ struct _ConnectionStats {
 	struct _PacketsPerType *received_packets;
 	struct _PacketsPerType *sent_packets;
 
+	u64 n_packets_compressed;               // packets that were sent with their data compressed
+	u64 compression_bytes_in;               // their data's original size
+	u64 compression_bytes_out;              // what was sent instead
+	u64 compression_time;                   // thread cpu time spent compressing (ns)
+
+	u64 n_packets_decompressed;             // packets that were received with their data compressed
+	u64 decompression_bytes_in;
+	u64 decompression_bytes_out;
+	u64 decompression_time;                 // thread cpu time spent decompressing (ns)
+
 };
 
 typedef struct _ConnectionStats ConnectionStats;
 
 CERVER_PUBLIC ConnectionStats *connection_stats_new (void);
 
+// returns how many times smaller the data that was sent compressed got, 0 if none was
+CERVER_EXPORT double connection_stats_get_compression_ratio (const ConnectionStats *stats);
+
+// returns how many times bigger the data that was received compressed got, 0 if none was
+CERVER_EXPORT double connection_stats_get_decompression_ratio (const ConnectionStats *stats);
+
 CERVER_PUBLIC void connection_stats_print (struct _Connection *connection);
 
 // a connection from a client
@@ -79,6 +97,10 @@ struct _Connection {
 
 	u32 receive_packet_buffer_size;         // 01/01/2020 - read packets into a buffer of this size in client_receive ()
 	struct _SockReceive *sock_receive;      // 01/01/2020 - used for inter-cerver communications
+	bool header_v2;                         // ask the cerver to use the v2 packet header if it supports it
+	bool packet_checksums;                  // ask the cerver to send a checksum with every v2 header
+	const struct _PacketCompressor *compressor;     // compress the data of big packets if the cerver has the same one
+	size_t compression_threshold;                   // min data size that is compressed
 
 	pthread_t update_thread_id;
 	u32 update_timeout;
@@ -105,6 +127,9 @@ struct _Connection {
 
 	ConnectionStats *stats;
 
+	struct _CerverReactor *reactor;         // the cerver reactor that handles the connection (if any)
+	struct _CerverUdp *udp;                 // the cerver's udp socket that the peer sends to (if any)
+
 	pthread_cond_t *cond;
 	pthread_mutex_t *mutex;
 
@@ -159,6 +184,29 @@ CERVER_EXPORT void connection_set_received_data (Connection *connection, void *d
 // note that this only has effect in connection_update ()
 CERVER_EXPORT void connection_set_update_timeout (Connection *connection, u32 timeout);
 
+// sets if the connection will ask the cerver to use the compact v2 packet header
+// it is only used if the cerver offers it in its info packet (default false)
+CERVER_EXPORT void connection_set_header_v2 (Connection *connection, bool header_v2);
+
+// sets if the connection will ask the cerver to follow every v2 header with
+// the crc32c of its packet's data, it implies the v2 header (default false)
+CERVER_EXPORT void connection_set_packet_checksums (Connection *connection, bool packet_checksums);
+
+// sets the compressor that the connection uses for the data of the packets that it sends
+// if the cerver offers the same one, both ends compress the data that reaches the threshold
+// it implies the v2 header (default NULL, no compression)
+CERVER_EXPORT void connection_set_compression (
+	Connection *connection, const struct _PacketCompressor *compressor
+);
+
+// sets the min data size that is compressed (default PACKET_COMPRESSION_THRESHOLD)
+CERVER_EXPORT void connection_set_compression_threshold (Connection *connection, size_t threshold);
+
+// sets the max size (header included) of the packets that the connection can receive,
+// a header that claims a bigger size is counted as a bad packet & the connection is ended
+// 0 to disable the limit (default DEFAULT_MAX_PACKET_SIZE)
+CERVER_EXPORT void connection_set_max_packet_size (Connection *connection, size_t max_packet_size);
+
 typedef struct ConnectionCustomReceiveData {
 
 	struct _Client *client;
@@ -196,6 +244,47 @@ CERVER_PUBLIC void connection_remove_auth_data (Connection *connection);
 // returns 0 on success, 1 on error
 CERVER_PUBLIC u8 connection_generate_auth_packet (Connection *connection);
 
+// starts coalescing the packets that are sent to the connection, they are kept
+// in the connection's socket & sent together with a single call when connection_uncork ()
+// is called the same n of times, so a tick that sends many small packets only makes one syscall
+CERVER_EXPORT void connection_cork (Connection *connection);
+
+// ends a connection_cork () call & sends the coalesced packets if it was the last one
+// returns 0 on success, 1 on error
+CERVER_EXPORT u8 connection_uncork (Connection *connection);
+
+// asks the cerver to switch the connection to the v2 header if it offered it
+// the request is the last packet that is sent with the v1 header, packets are received
+// with the v1 header until the cerver's confirmation arrives
+// checksums are requested the same way right after it if both ends want them,
+// followed by compression if both ends have the same compressor
+// returns 0 on success, 1 if the v1 header is still used
+CERVER_PRIVATE u8 connection_header_v2_request (struct _Client *client, Connection *connection);
+
+// switches the connection to the v2 header after the client asked for it
+// the confirmation is the last packet that is sent with the v1 header,
+// & the client's request was the last one that it sent with it
+// returns 0 on success, 1 on error
+CERVER_PRIVATE u8 connection_header_v2_accept (
+	struct _Cerver *cerver, struct _Client *client, Connection *connection
+);
+
+// starts sending & receiving checksums after the v2 header in the connection
+// the confirmation is the last packet that is sent without a checksum,
+// & the client's request was the last one that it sent without it
+// returns 0 on success, 1 on error
+CERVER_PRIVATE u8 connection_checksums_accept (
+	struct _Cerver *cerver, struct _Client *client, Connection *connection
+);
+
+// starts compressing the data of the packets that are sent to the connection
+// with the cerver's compressor after the client asked for it, as every packet says
+// if its data is compressed, there is no need to confirm it
+// returns 0 on success, 1 on error
+CERVER_PRIVATE u8 connection_compression_accept (
+	struct _Cerver *cerver, struct _Client *client, Connection *connection
+);
+
 // sets up the new connection values
 CERVER_PRIVATE u8 connection_init (Connection *connection);
 
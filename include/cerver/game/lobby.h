@@ -12,6 +12,7 @@
 
 #include "cerver/cerver.h"
 #include "cerver/client.h"
+#include "cerver/pollfds.h"
 
 #include "cerver/threads/thread.h"
 
@@ -75,8 +76,7 @@ struct _Lobby {
 	time_t creation_time_stamp;
 
 	Htab *sock_fd_player_map;           // maps a socket fd to a player
-	struct pollfd *players_fds;     			
-	u16 max_players_fds;
+	struct _PollFds *players_poll_fds;
 	u16 current_players_fds;            // n of active fds in the pollfd array
 	u32 poll_timeout;    
 
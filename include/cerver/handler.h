@@ -16,6 +16,10 @@
 #include "cerver/game/lobby.h"
 
 #define RECEIVE_PACKET_BUFFER_SIZE      8192
+#define RECEIVE_SPARE_BUFFER_SIZE       65536       // stack buffer for reads that don't fit in the packet buffer
+
+#define HANDLER_DEFAULT_BATCH_SIZE      32          // max n of packets a handler pulls from its queue every time it wakes up
+#define HANDLER_QUEUE_WAIT_TIMEOUT      100         // max ms a packet waits for room in a full queue before checking the handler again
 
 struct _Socket;
 struct _Cerver;
@@ -23,10 +27,28 @@ struct _Client;
 struct _Connection;
 struct _Lobby;
 struct _Packet;
+struct _PacketBuffer;
 struct _Admin;
 
 #pragma region handler
 
+#define HANDLER_QUEUE_POLICY_MAP(XX)																		\
+	XX(0,	WAIT, 		Wait, 		Wait until the handler makes room in its queue for the packet)			\
+	XX(1,	DROP, 		Drop, 		Delete the packet & count it as dropped)
+
+// what to do with a packet that arrives while the handler's queue is full
+typedef enum HandlerQueuePolicy {
+
+	#define XX(num, name, string, description) HANDLER_QUEUE_POLICY_##name = num,
+	HANDLER_QUEUE_POLICY_MAP (XX)
+	#undef XX
+
+} HandlerQueuePolicy;
+
+CERVER_EXPORT const char *handler_queue_policy_to_string (HandlerQueuePolicy policy);
+
+CERVER_EXPORT const char *handler_queue_policy_description (HandlerQueuePolicy policy);
+
 typedef enum HandlerType {
 
 	HANDLER_TYPE_NONE         = 0,
@@ -47,6 +69,18 @@ typedef struct HandlerData {
 
 } HandlerData;
 
+// the strcuture that will be passed to the handler's batch method
+typedef struct HandlerBatch {
+
+	int handler_id;
+
+	void *data;                     // handler's own data
+
+	struct _Packet **packets;       // the packets to handle in the order they were received
+	unsigned int n_packets;
+
+} HandlerBatch;
+
 struct _Handler {
 
 	HandlerType type;
@@ -71,6 +105,13 @@ struct _Handler {
 	// the method that this handler will execute to handle packets
 	Action handler;
 
+	// if set, it is executed with a HandlerBatch instead of
+	// executing the handler method with each packet that was pulled from the queue
+	Action batch_handler;
+
+	// max n of packets that are pulled from the queue & handled every time the handler wakes up
+	unsigned int batch_size;
+
 	// 27/05/2020 - used to avoid pushing job to the queue and instead handle
 	// the packet directly in the same thread
 	// this option is set to false as default
@@ -82,6 +123,10 @@ struct _Handler {
 
 	// the jobs (packets) that are waiting to be handled - passed as args to the handler method
 	JobQueue *job_queue;
+	HandlerQueuePolicy queue_policy;
+
+	// packets that were dropped because the job queue was full
+	u64 n_dropped_packets;
 
 	struct _Cerver *cerver;     // the cerver this handler belongs to
 	struct _Client *client;     // the client this handler belongs to
@@ -125,6 +170,47 @@ CERVER_EXPORT void handler_set_data_delete (Handler *handler, Action data_delete
 // cons     - calling thread will be busy until handler method is done
 CERVER_EXPORT void handler_set_direct_handle (Handler *handler, bool direct_handle);
 
+// sets how many packets can wait in the handler's queue, JOB_QUEUE_DEFAULT_CAPACITY by default,
+// what happens with the packets that arrive while the queue is full depends on its queue policy
+// must be called before the handler starts
+// returns 0 on success, 1 on error
+CERVER_EXPORT u8 handler_set_queue_capacity (Handler *handler, size_t capacity);
+
+// sets what to do with the packets that arrive while the handler's queue is full
+// HANDLER_QUEUE_POLICY_WAIT (default) - the thread that received the packet sleeps until the handler
+// makes room for it, so no more data is read from the connections until the handler catches up,
+// packets pushed from the handlers' own threads are never waited for & are dropped instead
+// HANDLER_QUEUE_POLICY_DROP - the packet is deleted & counted as dropped, which is only
+// safe if the app can handle losing packets from connections that are otherwise reliable
+CERVER_EXPORT void handler_set_queue_policy (Handler *handler, HandlerQueuePolicy policy);
+
+// returns the n of packets that the handler has dropped because its queue was full
+CERVER_EXPORT u64 handler_get_n_dropped_packets (const Handler *handler);
+
+// pushes the packet to the handler's job queue, the handler takes ownership of it,
+// if the queue is full, the packet is handled based on the handler's queue policy,
+// packets are always dropped if the handler is no longer running
+// or if they are pushed from a handler's thread, as it could end up waiting for itself
+// returns 0 on success, 1 if the packet was dropped
+CERVER_PRIVATE u8 handler_queue_packet (Handler *handler, struct _Packet *packet);
+
+// sets the max n of packets that the handler pulls from its queue & handles
+// every time it wakes up, HANDLER_DEFAULT_BATCH_SIZE by default
+// must be called before the handler starts
+CERVER_EXPORT void handler_set_batch_size (Handler *handler, unsigned int batch_size);
+
+// sets a method that handles all the packets that were pulled from the queue at once,
+// it takes a HandlerBatch instead of a HandlerData & the handler method is then
+// only used to handle packets directly
+// must be called before the handler starts
+CERVER_EXPORT void handler_set_batch_handler (Handler *handler, Action batch_handler);
+
+// adds a new reference to the packet & pushes it to the handler's job queue,
+// so the same packet can be handed to many handlers without being copied,
+// the reference is handled after the handler is done just as with any other packet
+// returns 0 on success, 1 on error
+CERVER_EXPORT u8 handler_push_packet (Handler *handler, struct _Packet *packet);
+
 // starts the new handler by creating a dedicated thread for it
 // called by internal cerver methods
 CERVER_PRIVATE int handler_start (Handler *handler);
@@ -146,16 +232,40 @@ CERVER_PRIVATE void cerver_test_packet_handler (struct _Packet *packet);
 
 #pragma region sock receive
 
+// the default max size of a packet (header included) that can be received,
+// the connection of a peer that claims a bigger one is dropped
+#define DEFAULT_MAX_PACKET_SIZE             16777216
+
 struct _SockReceive {
 
+	// a packet that was cut between reads, its data is allocated
+	// using its header's packet size & the next fragments are copied in place
 	struct _Packet *spare_packet;
 	size_t missing_packet;
 
-	void *header;
-	char *header_end;
-	// unsigned int curr_header_pos;
-	unsigned int remaining_header;
-	bool complete_header;
+	// a header that was cut between reads, it is stored right after
+	// the sock receive in the same allocation
+	struct _PacketHeader *header;
+	unsigned int header_size;
+
+	// the PacketHeaderVersion of the next headers, v2 headers are always decoded into the header,
+	// their wire bytes that were cut between reads are kept after it in the same allocation
+	u8 header_version;
+	char *wire_header;
+
+	// v2 headers are followed by the crc32c of their packet's data
+	bool header_checksum;
+	u32 checksum;
+
+	// the last v2 header had the compressed flag, it is not kept in its packet type
+	bool compressed;
+
+	// headers that claim a bigger packet size are not allocated (0 for no limit)
+	size_t max_packet_size;
+
+	// got a header with an invalid packet size, the rest of the stream can't be parsed
+	// & its connection must be dropped
+	bool failed;
 
 };
 
@@ -165,6 +275,15 @@ CERVER_PRIVATE SockReceive *sock_receive_new (void);
 
 CERVER_PRIVATE void sock_receive_delete (void *sock_receive_ptr);
 
+// gets the next complete packet from the buffer starting at buffer_pos
+// the pieces of packets & headers that are cut between reads are kept in the sock receive
+// if a packet buffer is provided, complete packets will reference it instead of copying their data
+// returns NULL when the rest of the buffer has been consumed or if the sock receive has failed
+CERVER_PRIVATE struct _Packet *sock_receive_next_packet (
+	SockReceive *sock_receive, struct _PacketBuffer *packet_buffer,
+	char *buffer, const size_t buffer_size, size_t *buffer_pos
+);
+
 #pragma endregion
 
 #pragma region receive
@@ -188,6 +307,10 @@ typedef struct ReceiveHandle {
 	char *buffer;
 	size_t buffer_size;
 
+	// set if the buffer belongs to someone else, like the cerver's io_uring,
+	// it is released when its last packet is deleted
+	struct _PacketBuffer *packet_buffer;
+
 } ReceiveHandle;
 
 CERVER_PRIVATE void receive_handle_delete (void *receive_ptr);
@@ -222,22 +345,51 @@ CERVER_PRIVATE CerverReceive *cerver_receive_create_full (
 
 CERVER_PRIVATE void cerver_switch_receive_handle_failed (CerverReceive *cr);
 
-// receive all incoming data from the socket
+// receive all incoming data from the socket, up to the cerver's receive budget
 CERVER_PRIVATE void cerver_receive (void *ptr);
 
 #pragma endregion
 
-#pragma region poll
+#pragma region accept
 
-// reallocs main cerver poll fds
-// returns 0 on success, 1 on error
-CERVER_PRIVATE u8 cerver_realloc_main_poll_fds (struct _Cerver *cerver);
+struct _CerverReactor;
+
+// a connection that was accepted but has not been registered to the cerver yet
+typedef struct CerverAccepted {
+
+	i32 sock_fd;
+	struct sockaddr_storage address;
+
+} CerverAccepted;
+
+// connections that were accepted in a single wakeup of the listening socket,
+// they are registered together in the same thread or in the cerver's thpool
+typedef struct CerverAcceptBatch {
+
+	struct _Cerver *cerver;
+	struct _CerverReactor *reactor;     // only used with CERVER_HANDLER_TYPE_REACTORS
+
+	u32 n_accepted;
+	CerverAccepted *accepted;           // up to cerver->max_accepts connections
+
+} CerverAcceptBatch;
+
+CERVER_PRIVATE CerverAcceptBatch *cerver_accept_batch_create (
+	struct _Cerver *cerver, struct _CerverReactor *reactor
+);
+
+CERVER_PRIVATE void cerver_accept_batch_delete (void *batch_ptr);
 
-// get a free index in the main cerver poll strcuture
-CERVER_PRIVATE i32 cerver_poll_get_free_idx (struct _Cerver *cerver);
+// accepts pending connections from the sock until there are no more or the batch is full
+// returns the n of connections that were accepted
+CERVER_PRIVATE u32 cerver_accept_batch (CerverAcceptBatch *batch, const i32 sock);
 
-// get the idx of the connection sock fd in the cerver poll fds
-CERVER_PRIVATE i32 cerver_poll_get_idx_by_sock_fd (struct _Cerver *cerver, i32 sock_fd);
+// registers every connection in the batch to the cerver & deletes the batch
+CERVER_PRIVATE void cerver_accept_batch_register (void *batch_ptr);
+
+#pragma endregion
+
+#pragma region poll
 
 // regsiters a client connection to the cerver's mains poll structure
 // and maps the sock fd to the client
@@ -257,6 +409,86 @@ CERVER_PRIVATE u8 cerver_poll (struct _Cerver *cerver);
 
 #pragma endregion
 
+#pragma region epoll
+
+// registers the cerver's listening socket to the cerver's epoll
+// returns 0 on success, 1 on error
+CERVER_PRIVATE u8 cerver_epoll_register_sock_fd (struct _Cerver *cerver, const i32 sock_fd);
+
+// registers a client connection to the cerver's epoll
+// connections are edge triggered, so they must be read until EAGAIN
+// returns 0 on success, 1 on error
+CERVER_PRIVATE u8 cerver_epoll_register_connection (struct _Cerver *cerver, struct _Connection *connection);
+
+// removes a sock fd from the cerver's epoll
+// returns 0 on success, 1 on error
+CERVER_PRIVATE u8 cerver_epoll_unregister_sock_fd (struct _Cerver *cerver, const i32 sock_fd);
+
+// unregisters a client connection from the cerver's epoll
+// returns 0 on success, 1 on error
+CERVER_PRIVATE u8 cerver_epoll_unregister_connection (struct _Cerver *cerver, struct _Connection *connection);
+
+// cerver epoll loop that only handles the sockets that are ready
+CERVER_PRIVATE u8 cerver_epoll (struct _Cerver *cerver);
+
+#pragma endregion
+
+#pragma region udp
+
+// cerver udp loop, datagrams are received in batches with recvmmsg ()
+// & mapped to their clients by the peer's address, the packets that are sent
+// while handling a batch are sent together with sendmmsg ()
+CERVER_PRIVATE u8 cerver_udp (struct _Cerver *cerver);
+
+#pragma endregion
+
+#pragma region uring
+
+// registers a client connection to the cerver's io_uring
+// by arming a multishot recv in the connection's sock fd
+// returns 0 on success, 1 on error
+CERVER_PRIVATE u8 cerver_uring_register_connection (struct _Cerver *cerver, struct _Connection *connection);
+
+// cancels the sock fd's pending recv in the cerver's io_uring
+// returns 0 on success, 1 on error
+CERVER_PRIVATE u8 cerver_uring_unregister_sock_fd (struct _Cerver *cerver, const i32 sock_fd);
+
+// unregisters a client connection from the cerver's io_uring
+// returns 0 on success, 1 on error
+CERVER_PRIVATE u8 cerver_uring_unregister_connection (struct _Cerver *cerver, struct _Connection *connection);
+
+// cerver io_uring loop, accept & recv requests are multishot, so the kernel
+// keeps posting completions for them, and every re-armed request is submitted
+// all at once every time we wait for new completions
+CERVER_PRIVATE u8 cerver_uring (struct _Cerver *cerver);
+
+#pragma endregion
+
+#pragma region reactors
+
+struct _CerverReactor;
+
+// registers a client connection to the epoll of the reactor that accepted it
+// returns 0 on success, 1 on error
+CERVER_PRIVATE u8 cerver_reactor_register_connection (struct _Cerver *cerver, struct _Connection *connection);
+
+// removes a sock fd from the reactor's epoll
+// returns 0 on success, 1 on error
+CERVER_PRIVATE u8 cerver_reactor_unregister_sock_fd (struct _CerverReactor *reactor, const i32 sock_fd);
+
+// unregisters a client connection from its reactor's epoll
+// returns 0 on success, 1 on error
+CERVER_PRIVATE u8 cerver_reactor_unregister_connection (struct _Cerver *cerver, struct _Connection *connection);
+
+// starts a thread for every reactor, so all of them are set up with the reactors' affinity,
+// & waits in the calling thread until all of them have stopped
+CERVER_PRIVATE u8 cerver_reactors (struct _Cerver *cerver);
+
+// stops the reactors threads & waits for them to finish
+CERVER_PRIVATE void cerver_reactors_stop (struct _Cerver *cerver);
+
+#pragma endregion
+
 #pragma region threads
 
 // handle new connections in dedicated threads
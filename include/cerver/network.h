@@ -4,17 +4,23 @@
 #include <stdbool.h>
 
 #include <unistd.h>
+#include <poll.h>
 
 #include <sys/socket.h>
+#include <sys/uio.h>
 #include <netinet/in.h>
 #include <fcntl.h>
 #include <arpa/inet.h>
 
+#include "cerver/types/types.h"
+
 #include "cerver/config.h"
 
 #define IP_TO_STR_LEN       16
 #define IPV6_TO_STR_LEN     46
 
+#define SOCK_WAIT_TIMEOUT           2000        // max time in ms to wait for a non blocking socket to be ready again
+
 typedef enum Protocol {
 
 	PROTOCOL_TCP = IPPROTO_TCP,
@@ -40,4 +46,20 @@ CERVER_PUBLIC in_port_t sock_ip_port (const struct sockaddr *address);
 // returns 0 on success, 1 on error
 CERVER_PUBLIC int sock_set_timeout (int sock_fd, time_t timeout);
 
+// checks why a send () or recv () like call has failed, if the socket is non blocking
+// and it was not ready, waits until it is ready for the events (up to SOCK_WAIT_TIMEOUT)
+// returns true if the call should be retried, false on any other error
+CERVER_PUBLIC bool sock_can_retry (int sock_fd, short events);
+
+// sends all the iovec buffers using as few sendmsg () calls as possible
+// the iovec is modified to keep track of what has been sent,
+// the buffers that were completely sent are set to a zero length
+// if wait is false, it returns as soon as the socket is not ready,
+// so total_sent might be less than the total size of the buffers
+// returns 0 on success, 1 on error
+CERVER_PUBLIC u8 sock_send_iov (
+	int sock_fd, struct iovec *iov, int iovcnt,
+	int flags, bool wait, size_t *total_sent
+);
+
 #endif
\ No newline at end of file
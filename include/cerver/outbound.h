@@ -0,0 +1,23 @@
+#ifndef _CERVER_OUTBOUND_H_
+#define _CERVER_OUTBOUND_H_
+
+#include "cerver/config.h"
+
+#define OUTBOUND_POLICY_MAP(XX)																			\
+	XX(0,	PAUSE, 		Pause, 		Stop reading from the connection until its outbound queue has been drained)		\
+	XX(1,	DROP, 		Drop, 		Drop the connection as it is not reading what is sent to it)
+
+// what to do with a connection whose outbound queue reached its high watermark
+typedef enum OutboundPolicy {
+
+	#define XX(num, name, string, description) OUTBOUND_POLICY_##name = num,
+	OUTBOUND_POLICY_MAP (XX)
+	#undef XX
+
+} OutboundPolicy;
+
+CERVER_EXPORT const char *outbound_policy_to_string (OutboundPolicy policy);
+
+CERVER_EXPORT const char *outbound_policy_description (OutboundPolicy policy);
+
+#endif
@@ -4,6 +4,8 @@
 #include <stdlib.h>
 #include <stdbool.h>
 
+#include <sys/uio.h>
+
 #include "cerver/types/types.h"
 #include "cerver/types/string.h"
 
@@ -18,6 +20,7 @@ struct _Socket;
 struct _Cerver;
 struct _Client;
 struct _Connection;
+struct _ConnectionStats;
 struct _Lobby;
 
 #pragma region protocol
@@ -51,6 +54,53 @@ CERVER_EXPORT void packets_set_protocol_version (ProtocolVersion version);
 
 #pragma endregion
 
+#pragma region cache
+
+#define PACKETS_CACHE_SIZE				256			// max n of free objects of each type that every thread keeps
+#define PACKETS_CACHE_STATS_FLUSH		64			// n of events a thread counts before adding them to the global stats
+
+// the fixed size objects that are reused by each thread instead of being freed
+#define PACKETS_CACHE_TYPE_MAP(XX)					\
+	XX(0, 	PACKET, 	Packet)						\
+	XX(1, 	HEADER, 	Packet Header)				\
+	XX(2, 	VERSION, 	Packet Version)
+
+typedef enum PacketsCacheType {
+
+	#define XX(num, name, string) PACKETS_CACHE_TYPE_##name = num,
+	PACKETS_CACHE_TYPE_MAP (XX)
+	#undef XX
+
+} PacketsCacheType;
+
+#define PACKETS_CACHE_N_TYPES			3
+
+CERVER_PUBLIC const char *packets_cache_type_to_string (PacketsCacheType type);
+
+struct _PacketsCacheStats {
+
+	u64 n_hits;					// objects that were taken from a thread's cache
+	u64 n_misses;				// objects that had to be allocated
+
+};
+
+typedef struct _PacketsCacheStats PacketsCacheStats;
+
+// gets the stats of the objects of the requested type
+// every thread adds its events in batches of PACKETS_CACHE_STATS_FLUSH
+CERVER_EXPORT void packets_cache_get_stats (PacketsCacheType type, PacketsCacheStats *stats);
+
+// returns the percentage of the objects of the requested type that were taken from a cache
+CERVER_EXPORT double packets_cache_get_hit_rate (PacketsCacheType type);
+
+CERVER_EXPORT void packets_cache_stats_print (void);
+
+// frees every object in the calling thread's caches
+// it is done automatically when a thread that has cached objects exits
+CERVER_EXPORT void packets_cache_clear (void);
+
+#pragma endregion
+
 #pragma region version
 
 struct _PacketVersion {
@@ -122,6 +172,11 @@ CERVER_PUBLIC void packets_per_type_delete (void *ptr);
 
 CERVER_PUBLIC void packets_per_type_print (PacketsPerType *packets_per_type);
 
+// atomically adds n packets to the packet type's counter
+CERVER_PUBLIC void packets_per_type_add (
+	PacketsPerType *packets_per_type, PacketType packet_type, u64 n
+);
+
 #pragma endregion
 
 #pragma region header
@@ -154,6 +209,137 @@ CERVER_PUBLIC void packet_header_print (PacketHeader *header);
 // returns 0 on success, 1 on error
 CERVER_PUBLIC u8 packet_header_copy (PacketHeader **dest, PacketHeader *source);
 
+#define PACKET_HEADER_VERSION_MAP(XX)		\
+	XX(1, 	V1)							\
+	XX(2, 	V2)
+
+// how the header is laid out on the wire
+// the version is agreed by both ends when connecting, v1 is used until then
+typedef enum PacketHeaderVersion {
+
+	#define XX(num, name) PACKET_HEADER_VERSION_##name = num,
+	PACKET_HEADER_VERSION_MAP (XX)
+	#undef XX
+
+} PacketHeaderVersion;
+
+// v1 sends the PacketHeader as it is in memory, so it depends on the compiler's padding
+// v2 is packed & little endian, every field is at a fixed offset:
+// packet_type (u8) | handler_id (u8) | sock_fd (u16) | request_type (u32) | packet_size (u32)
+// the packet size on the wire counts the v2 header instead of the PacketHeader
+#define PACKET_HEADER_V2_SIZE				12
+
+// when both ends agreed to use checksums, the v2 header is followed by
+// the crc32c of the packet's data (u32, little endian) & it is counted in the packet size
+#define PACKET_HEADER_CHECKSUM_SIZE			4
+
+// writes the header into the buffer using the v2 layout
+// returns 0 on success, 1 if the header does not fit in it
+CERVER_PUBLIC u8 packet_header_v2_encode (const PacketHeader *header, char *buffer);
+
+// writes the header using the v2 layout followed by the checksum
+// returns 0 on success, 1 if the header does not fit in it
+CERVER_PUBLIC u8 packet_header_v2_encode_checksum (
+	const PacketHeader *header, u32 checksum, char *buffer
+);
+
+// reads a v2 header from the buffer into the header
+// its packet size is converted back to count the PacketHeader
+// returns 0 on success, 1 if the packet size is invalid (it is set to 0)
+CERVER_PUBLIC u8 packet_header_v2_decode (const char *buffer, PacketHeader *header);
+
+// reads a v2 header that is followed by a checksum
+// returns 0 on success, 1 if the packet size is invalid (it is set to 0)
+CERVER_PUBLIC u8 packet_header_v2_decode_checksum (
+	const char *buffer, PacketHeader *header, u32 *checksum
+);
+
+#pragma endregion
+
+#pragma region compression
+
+// set in the packet type of a v2 header when the packet's data is compressed,
+// the data starts with its original size (u32, little endian) followed by the compressor's output
+// the packet size counts the compressed data & the checksum is still the one of the original data
+#define PACKET_HEADER_V2_COMPRESSED			0x80
+
+// data smaller than this is not worth compressing
+#define PACKET_COMPRESSION_THRESHOLD		1024
+
+// compressed data that claims to be bigger than this ratio is handled as corrupted
+#define PACKET_COMPRESSION_MAX_RATIO		256
+
+// a compression algorithm that can be used in connections that use the v2 header
+// both ends must use a compressor with the same id
+struct _PacketCompressor {
+
+	u8 id;                          // sent in the cerver's info, 0 is reserved for none
+	const char *name;
+
+	// returns the max size of the compressed data
+	size_t (*bound) (size_t data_size);
+
+	// returns the size of the compressed data, 0 if it did not fit in the output
+	size_t (*compress) (const void *data, size_t data_size, void *output, size_t output_capacity);
+
+	// returns 0 on success, 1 if the data is corrupted or it does not match the output size
+	u8 (*decompress) (const void *data, size_t data_size, void *output, size_t output_size);
+
+};
+
+typedef struct _PacketCompressor PacketCompressor;
+
+#define PACKET_COMPRESSOR_LZ_ID				1
+
+// the built in compressor, a fast lz77 codec (utils/lz.h)
+CERVER_EXPORT const PacketCompressor packet_compressor_lz;
+
+#pragma endregion
+
+#pragma region buffer
+
+// a received buffer that is shared by all the packets that reference it
+// it is deleted when its last reference is removed
+struct _PacketBuffer {
+
+	char *buffer;
+	size_t buffer_size;
+
+	unsigned int ref_count;
+
+	// if set, the buffer is returned to its owner with release (owner, buffer)
+	// instead of being freed, like the cerver's io_uring provided buffers
+	void (*release) (void *owner, char *buffer);
+	void *owner;
+
+};
+
+typedef struct _PacketBuffer PacketBuffer;
+
+// creates a new packet buffer that takes ownership of the buffer
+// the packet buffer starts with one reference
+CERVER_PUBLIC PacketBuffer *packet_buffer_create (char *buffer, const size_t buffer_size);
+
+// creates a new packet buffer whose buffer belongs to owner,
+// release (owner, buffer) is called when its last reference is removed
+// the packet buffer starts with one reference
+CERVER_PUBLIC PacketBuffer *packet_buffer_create_with_release (
+	char *buffer, const size_t buffer_size,
+	void (*release) (void *owner, char *buffer), void *owner
+);
+
+// adds a new reference to the packet buffer
+CERVER_PUBLIC void packet_buffer_ref (PacketBuffer *packet_buffer);
+
+// removes a reference from the packet buffer
+// if it was the last one, the buffer is freed
+CERVER_PUBLIC void packet_buffer_unref (PacketBuffer *packet_buffer);
+
+// removes a reference from the packet buffer
+// if it was the last one, returns the buffer so it can be reused, otherwise returns NULL
+// a buffer that belongs to an owner is always released to it & NULL is returned
+CERVER_PUBLIC char *packet_buffer_unref_take (PacketBuffer *packet_buffer);
+
 #pragma endregion
 
 #pragma region packets
@@ -161,7 +347,9 @@ CERVER_PUBLIC u8 packet_header_copy (PacketHeader **dest, PacketHeader *source);
 #define CERVER_PACKET_TYPE_MAP(XX)			\
 	XX(0, 	NONE)							\
 	XX(1, 	INFO)							\
-	XX(2, 	TEARDOWN)
+	XX(2, 	TEARDOWN)						\
+	XX(3, 	HEADER_V2)						\
+	XX(4, 	CHECKSUMS)
 
 typedef enum CerverPacketType {
 
@@ -174,7 +362,10 @@ typedef enum CerverPacketType {
 #define CLIENT_PACKET_TYPE_MAP(XX)			\
 	XX(0, 	NONE)							\
 	XX(1, 	CLOSE_CONNECTION)				\
-	XX(2, 	DISCONNECT)
+	XX(2, 	DISCONNECT)						\
+	XX(3, 	HEADER_V2)						\
+	XX(4, 	CHECKSUMS)						\
+	XX(5, 	COMPRESSION)
 
 typedef enum ClientPacketType {
 
@@ -248,23 +439,61 @@ struct _Packet {
 	char *data_end;
 	bool data_ref;
 
+	// set when the packet's data points inside a received buffer
+	PacketBuffer *data_buffer;
+
 	// the actual packet to be sent
 	PacketHeader *header;
+	PacketHeader own_header;			// used as the header unless another one was allocated
 	PacketVersion *version;
+	bool version_ref;
 	size_t packet_size;
 	void *packet;
 	bool packet_ref;
 
+	// the crc32c of the data that came in the packet's header
+	bool has_checksum;
+	u32 checksum;
+
+	// the data is still as it was received compressed
+	bool compressed;
+
+	// the packet is deleted when its last reference is removed
+	unsigned int ref_count;
+
 };
 
 typedef struct _Packet Packet;
 
-// allocates a new empty packet
+// allocates a new empty packet that starts with one reference
 CERVER_PUBLIC Packet *packet_new (void);
 
-// correctly deletes a packet and all of its data
+// removes a reference from the packet
+// if it was the last one, the packet and all of its data are deleted
 CERVER_PUBLIC void packet_delete (void *ptr);
 
+// adds a new reference to the packet, so it can be kept or handed to other consumers
+// without being copied, each reference must be removed with packet_unref ()
+// the consumers that share a packet should not move its data_ptr
+// returns the same packet
+CERVER_EXPORT Packet *packet_ref (Packet *packet);
+
+// removes a reference from the packet, it works just as packet_delete ()
+CERVER_EXPORT void packet_unref (Packet *packet);
+
+// checks the packet's data against the checksum that it was received with
+// returns 0 if it matches or if the packet came without one, 1 if the data was corrupted
+CERVER_EXPORT u8 packet_check_checksum (const Packet *packet);
+
+// replaces the data of a packet that was received compressed with the original one,
+// that is owned by the packet, the cpu time that it took is added to the stats (if set)
+// the original size is claimed by the peer, so it is limited to max_packet_size (header included, 0 for no limit)
+// returns 0 on success or if the data was not compressed, 1 if it is corrupted or too big
+CERVER_EXPORT u8 packet_decompress (
+	Packet *packet, const PacketCompressor *compressor,
+	const size_t max_packet_size, struct _ConnectionStats *stats
+);
+
 // creates a new packet with the option to pass values directly
 // data is copied into packet buffer and can be safely freed
 CERVER_EXPORT Packet *packet_create (PacketType type, void *data, size_t data_size);
@@ -293,13 +522,27 @@ CERVER_EXPORT void packet_set_header_values (
 // returns 0 on success, 1 on error
 CERVER_EXPORT u8 packet_set_data (Packet *packet, void *data, size_t data_size);
 
+// allocates the packet's data buffer without initializing it
+// if the packet had data before it is deleted
+// returns 0 on success, 1 on error
+CERVER_PUBLIC u8 packet_allocate_data (Packet *packet, size_t data_size);
+
 // appends the data to the end if the packet already has data
 // if the packet is empty, creates a new buffer
 // it creates a new copy of the data and the original can be safely freed
-// this does not work if the data has been set using a reference
+// this does not work if the data has been set using packet_set_data_ref ()
 // returns 0 on success, 1 on error
 CERVER_EXPORT u8 packet_append_data (Packet *packet, void *data, size_t data_size);
 
+// sets the packet's data as a reference to a received packet buffer, the header is not referenced
+// as it can be at any offset of the buffer, so it must be copied with packet_set_header ()
+// a new reference is added to the packet buffer & removed when the packet gets deleted
+// returns 0 on success, 1 on error
+CERVER_PUBLIC u8 packet_set_buffer_ref (
+	Packet *packet, PacketBuffer *packet_buffer,
+	void *data, size_t data_size
+);
+
 // sets a reference to a data buffer to send
 // data will not be copied into the packet and will not be freed after use
 // this method is usefull for example if you just want to send a raw json packet to a non-cerver
@@ -320,6 +563,7 @@ CERVER_EXPORT u8 packet_set_packet (Packet *packet, void *data, size_t data_size
 CERVER_EXPORT u8 packet_set_packet_ref (Packet *packet, void *data, size_t packet_size);
 
 // prepares the packet to be ready to be sent
+// the header & the data are copied into the packet buffer (packet->packet & packet->packet_size)
 // WARNING: dont call this method if you have set the packet directly
 // returns 0 on success, 1 on error
 CERVER_EXPORT u8 packet_generate (Packet *packet);
@@ -354,6 +598,7 @@ CERVER_EXPORT u8 packet_send_to (
 );
 
 // sends a packet to the socket in two parts, first the header & then the data
+// both parts are sent using a single sendmsg () call
 // this method can be useful when trying to forward a big received packet without the overhead of
 // performing and additional copy to create a continuos data (packet) buffer
 // the socket's write mutex will be locked to ensure that the packet
@@ -381,6 +626,21 @@ CERVER_EXPORT u8 packet_send_pieces (
 	size_t *total_sent
 );
 
+// n of iovec entries that are kept in the stack when sending pieces
+#define PACKET_SEND_IOV_LOCAL			16
+
+// sends the packet's header followed by the iovec buffers
+// everything is sent using a single sendmsg () call when possible
+// the header's packet size should already match the total size of the buffers
+// socket mutex will be locked for the entire operation
+// returns 0 on success, 1 on error
+CERVER_EXPORT u8 packet_send_iov (
+	const Packet *packet,
+	const struct iovec *iov, int iovcnt,
+	int flags,
+	size_t *total_sent
+);
+
 // sends a packet directly to the socket
 // raw flag to send a raw packet (only the data that was set to the packet, without any header)
 // returns 0 on success, 1 on error
@@ -395,4 +655,35 @@ CERVER_EXPORT bool packet_check (Packet *packet);
 
 #pragma endregion
 
+#pragma region broadcast
+
+#define PACKET_BROADCAST_CHUNK_SIZE				64			// n of connections that are claimed by a thread at a time
+#define PACKET_BROADCAST_MIN_PARALLEL			256			// min n of connections to split the sends between the cerver's thpool
+
+// a connection to send a broadcast packet to
+typedef struct PacketBroadcastTarget {
+
+	struct _Client *client;
+	struct _Connection *connection;
+
+} PacketBroadcastTarget;
+
+// sends the packet to every target, the packet's header & data are copied only once
+// into an immutable buffer that is shared by all the sends & the packet is never modified
+// if the cerver has a thpool & there are at least PACKET_BROADCAST_MIN_PARALLEL targets,
+// the sends are split between its threads & the calling thread, which waits for all of them
+// the cerver & lobby stats are updated only once with the totals & the stats of the targets
+// are updated by the calling thread after every send has been done
+// n_sent & total_sent (if set) get the n of connections the packet was sent to & the n of bytes sent
+// returns 0 if the packet was sent to every target, 1 on any error
+CERVER_EXPORT u8 packet_broadcast (
+	const Packet *packet,
+	struct _Cerver *cerver, struct _Lobby *lobby,
+	const PacketBroadcastTarget *targets, size_t n_targets,
+	int flags,
+	size_t *n_sent, size_t *total_sent
+);
+
+#pragma endregion
+
 #endif
\ No newline at end of file
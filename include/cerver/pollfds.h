@@ -0,0 +1,57 @@
+#ifndef _CERVER_POLL_FDS_H_
+#define _CERVER_POLL_FDS_H_
+
+#include <poll.h>
+
+#include "cerver/types/types.h"
+
+#include "cerver/config.h"
+
+// a pollfd array that keeps its used slots in a dense prefix
+// so poll () only needs to check n_fds slots,
+// free slots & sock fds indexes are tracked to avoid linear scans
+struct _PollFds {
+
+	struct pollfd *fds;             // the actual array that is passed to poll ()
+	u32 max_n_fds;                  // n of allocated slots
+	u32 n_fds;                      // n of slots that poll () needs to check
+	u32 current_n_fds;              // n of slots that have a sock fd
+
+	// slots that were released inside the n_fds prefix
+	// they are reused by new sock fds or removed by poll_fds_compact ()
+	u32 *free_idxs;
+	u32 n_free_idxs;
+
+	i32 *sock_fd_idxs;              // maps a sock fd to its slot idx, -1 if it is not in the array
+	u32 max_sock_fd;                // n of entries in sock_fd_idxs
+
+};
+
+typedef struct _PollFds PollFds;
+
+// creates a new pollfd array with max_n_fds slots
+CERVER_PRIVATE PollFds *poll_fds_create (const u32 max_n_fds);
+
+CERVER_PRIVATE void poll_fds_delete (void *poll_fds_ptr);
+
+// doubles the n of slots in the pollfd array
+// returns 0 on success, 1 on error
+CERVER_PRIVATE u8 poll_fds_realloc (PollFds *poll_fds);
+
+// puts the sock fd in a free slot
+// returns the slot idx, or -1 if the array is full or the sock fd is already in it
+CERVER_PRIVATE i32 poll_fds_add (PollFds *poll_fds, const i32 sock_fd, const short events);
+
+// releases the sock fd slot, the array is NOT compacted
+// so this can be called while looping through the slots
+// returns the slot idx that was released, or -1 if the sock fd was not found
+CERVER_PRIVATE i32 poll_fds_remove (PollFds *poll_fds, const i32 sock_fd);
+
+// returns the idx of the sock fd in the array, -1 if it was not found
+CERVER_PRIVATE i32 poll_fds_get_idx (const PollFds *poll_fds, const i32 sock_fd);
+
+// moves the last used slots into the released ones
+// so all the sock fds are in the first n_fds slots
+CERVER_PRIVATE void poll_fds_compact (PollFds *poll_fds);
+
+#endif
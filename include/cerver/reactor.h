@@ -0,0 +1,108 @@
+#ifndef _CERVER_REACTOR_H_
+#define _CERVER_REACTOR_H_
+
+#include <stdbool.h>
+
+#include <pthread.h>
+
+#include <sys/epoll.h>
+
+#include "cerver/types/types.h"
+
+#include "cerver/collections/htab.h"
+
+#include "cerver/config.h"
+
+#define CERVER_REACTOR_MAX_N_REACTORS			64
+
+// max n of sock fds whose reactor is mapped directly,
+// connections with bigger sock fds are searched in every reactor
+#define CERVER_REACTOR_MAX_SOCK_FDS				1048576
+
+struct _Cerver;
+struct _Client;
+
+// stats that are only updated by the reactor that owns them
+// they are added to the cerver's ones when printing the cerver stats
+typedef struct CerverReactorStats {
+
+	u64 n_accepted;                                 // connections accepted from the reactor's listening socket
+
+	u64 client_receives_done;                       // receives done to clients
+	u64 client_bytes_received;                      // bytes received from clients
+
+	u64 total_n_receives_done;                      // total amount of actual calls to recv ()
+	u64 total_bytes_received;                       // total amount of bytes received in the reactor
+
+	u64 current_active_client_connections;          // client connections currently registered in the reactor's epoll
+
+} CerverReactorStats;
+
+struct _CerverReactor {
+
+	struct _Cerver *cerver;
+
+	u16 id;
+	pthread_t thread_id;
+	bool running;
+
+	i32 sock;                           // listening socket bound with SO_REUSEPORT
+	i32 epoll_fd;
+	struct epoll_event *epoll_events;
+	u32 current_n_fds;                  // n of connections in the reactor's epoll
+
+	Htab *client_sock_fd_map;           // clients that have a connection handled by the reactor
+
+	pthread_mutex_t *lock;
+	CerverReactorStats *stats;
+
+};
+
+typedef struct _CerverReactor CerverReactor;
+
+// creates a new reactor for the cerver with its own epoll instance, client map & stats
+// if sock is -1, a new listening socket will be created & bound with SO_REUSEPORT
+// to the cerver's address, otherwise the reactor will use the provided one
+// returns NULL on error
+CERVER_PRIVATE CerverReactor *cerver_reactor_create (
+	struct _Cerver *cerver, const u16 id, const i32 sock
+);
+
+CERVER_PRIVATE void cerver_reactor_delete (void *reactor_ptr);
+
+// creates the cerver's reactors, reactor 0 uses the cerver's socket
+// and the others create their own listening sockets
+// if cerver->n_reactors is 0, one reactor will be created for each online cpu
+// returns 0 on success, 1 on error
+CERVER_PRIVATE u8 cerver_reactors_create (struct _Cerver *cerver);
+
+// deletes all the cerver's reactors
+// their threads should have been stopped before calling this method
+CERVER_PRIVATE void cerver_reactors_delete (struct _Cerver *cerver);
+
+// gets the client associated with a sock fd from the reactor's client map
+CERVER_PRIVATE struct _Client *cerver_reactor_client_get_by_sock_fd (
+	CerverReactor *reactor, const i32 sock_fd
+);
+
+// maps the sock fd to the reactor that handles it
+CERVER_PRIVATE void cerver_reactors_sock_fd_set (
+	struct _Cerver *cerver, const i32 sock_fd, const CerverReactor *reactor
+);
+
+// removes the sock fd from the map if it still belongs to the reactor
+CERVER_PRIVATE void cerver_reactors_sock_fd_remove (
+	struct _Cerver *cerver, const i32 sock_fd, const CerverReactor *reactor
+);
+
+// gets the client associated with a sock fd from the map of the reactor that handles it
+CERVER_PRIVATE struct _Client *cerver_reactors_client_get_by_sock_fd (
+	struct _Cerver *cerver, const i32 sock_fd
+);
+
+// adds the stats from all the cerver's reactors into the provided stats
+CERVER_PRIVATE void cerver_reactors_stats_get (
+	struct _Cerver *cerver, CerverReactorStats *stats
+);
+
+#endif
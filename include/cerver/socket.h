@@ -1,21 +1,144 @@
 #ifndef _CERVER_SOCKET_H_
 #define _CERVER_SOCKET_H_
 
+#include <stdbool.h>
 #include <pthread.h>
 
+#include <sys/socket.h>
+#include <sys/uio.h>
+
+#include "cerver/types/types.h"
+
 #include "cerver/cerver.h"
 #include "cerver/config.h"
+#include "cerver/outbound.h"
 #include "cerver/receive.h"
 
+#include "cerver/threads/thpool.h"
+
+#if defined(__linux__) && defined(__has_include)
+	#if __has_include(<linux/errqueue.h>)
+		// the kernel can send directly from the user's buffers
+		// & reports on the socket's error queue when it is done with them
+		#if defined(SO_ZEROCOPY) && defined(MSG_ZEROCOPY)
+			#define CERVER_ZERO_COPY_SUPPORTED
+		#endif
+	#endif
+#endif
+
+#define SOCKET_OUTBOUND_BUFFER_SIZE     16384
+#define SOCKET_CORK_BUFFER_SIZE         65536       // corked bytes are sent when they don't fit
+
 struct _Cerver;
+struct _CerverUring;
+struct _PacketCompressor;
+struct _Socket;
+
+// the bytes that could not be sent right away to a non blocking socket,
+// they are flushed by the cerver when the socket becomes writable again
+struct _SocketOutbound {
+
+    char *buffer;
+    size_t buffer_size;                 // allocated size
+    size_t start;                       // the first queued byte that has not been sent
+    size_t end;                         // the end of the queued bytes
+
+    size_t low_watermark;
+    size_t high_watermark;
+    OutboundPolicy policy;
+
+    bool paused;                        // reads are paused until the queue drains to the low watermark
+
+    // if set, nothing is sent directly, the queued bytes are sent with the cerver's io_uring,
+    // one send at a time, while it is in flight, its bytes are kept in the sending buffer
+    // & new ones are queued in the other one, then both buffers are swapped
+    struct _CerverUring *uring;
+    struct _Socket *socket;
+    bool uring_stopped;                 // the io_uring recv was canceled while the reads are paused
+
+    char *sending;
+    size_t sending_size;                // allocated size
+    size_t sending_start;
+    size_t sending_end;
+    bool in_flight;
+
+};
+
+typedef struct _SocketOutbound SocketOutbound;
+
+// a zero copy send whose buffers are still referenced by the kernel
+// every sendmsg () call that was needed to send them gets its own id
+struct _SocketZeroCopy {
+
+    u32 first_id;
+    u32 last_id;
+    u32 remaining;                      // n of ids the kernel has not completed yet
+
+    void *hold;                         // the buffers are released with release (hold) when completed
+    Action release;
+
+    struct _SocketZeroCopy *next;
+
+};
+
+typedef struct _SocketZeroCopy SocketZeroCopy;
+
+CERVER_PRIVATE SocketOutbound *socket_outbound_create (
+    const size_t low_watermark, const size_t high_watermark,
+    OutboundPolicy policy
+);
+
+CERVER_PRIVATE void socket_outbound_delete (void *outbound_ptr);
+
+// creates an outbound queue whose bytes are sent with the cerver's io_uring
+CERVER_PRIVATE SocketOutbound *socket_outbound_create_uring (
+    struct _CerverUring *uring,
+    const size_t low_watermark, const size_t high_watermark,
+    OutboundPolicy policy
+);
 
 struct _Socket {
 
     int sock_fd;
 
+	// receive buffer that is reused between recv () calls
+	// it is taken by the reader & released back when its data has been handled
 	char *packet_buffer;
 	size_t packet_buffer_size;
 
+	// the pending bytes are protected by the write mutex, they are kept in the socket
+	// as it outlives its connection when it is moved to the cerver's sockets pool
+	SocketOutbound *outbound;           // only set if the cerver uses outbound queues
+
+	// tags the requests of the socket's connection in the cerver's io_uring,
+	// a new one is set every time the socket is registered with a connection
+	u32 uring_generation;
+
+	char *cork_buffer;                  // packets that are coalesced while the socket is corked
+	size_t cork_buffer_size;
+	size_t cork_size;
+	unsigned int corked;
+
+	// big sends are done with MSG_ZEROCOPY, the sends are kept in order
+	// until the kernel completes them on the socket's error queue
+	size_t zero_copy_threshold;         // 0 if zero copy sends are not enabled
+	bool zero_copy_copied;              // the kernel had to copy a send, so it is not worth it for this socket
+	u32 zero_copy_next_id;
+	u32 zero_copy_n_completed;          // n of ids that the kernel has completed
+	SocketZeroCopy *zero_copy_pending;
+	SocketZeroCopy *zero_copy_last;
+
+	u8 header_version;                  // the PacketHeaderVersion that packets are sent with
+	bool header_checksum;               // v2 headers are followed by the crc32c of the packet's data
+
+	// set when both ends agreed to compress the data of the packets that are sent with the v2 header
+	const struct _PacketCompressor *compressor;
+	size_t compression_threshold;       // min data size that is compressed
+
+	// the received buffers are handled in order by the cerver's thpool
+	// without the read mutex when the cerver uses ordered dispatch
+	ThpoolSerial *dispatch;
+
 	pthread_mutex_t *read_mutex;
 	pthread_mutex_t *write_mutex;
 
@@ -31,4 +154,86 @@ CERVER_PUBLIC void *socket_create_empty (void);
 
 CERVER_PUBLIC Socket *socket_create (int fd);
 
+// takes the socket's receive buffer, if the socket does not have one or if it is in use,
+// a new one is allocated, the buffer is NOT zeroed
+CERVER_PUBLIC char *socket_receive_buffer_get (Socket *socket, const size_t size);
+
+// returns a buffer taken with socket_receive_buffer_get () to the socket
+// so it can be used by the next recv (), if the socket already has one, it is freed
+CERVER_PUBLIC void socket_receive_buffer_release (Socket *socket, char *buffer, const size_t size);
+
+// sets the socket's outbound queue, if it already had one, it is deleted
+CERVER_PRIVATE void socket_set_outbound (Socket *socket, SocketOutbound *outbound);
+
+// sends the iovec buffers to the socket, if it is corked, they are copied into its cork buffer,
+// if it has an outbound queue, they are sent without blocking & what can't be sent right away
+// is queued, otherwise the socket is waited until everything has been sent
+// the socket's write mutex must be locked by the caller
+// returns 0 on success, 1 on error
+CERVER_PUBLIC u8 socket_send_iov (
+    Socket *socket,
+    struct iovec *iov, int iovcnt, int flags,
+    size_t *total_sent
+);
+
+// enables MSG_ZEROCOPY for the sends to the socket that are at least threshold bytes
+// returns 0 on success, 1 on error or if the kernel does not support it
+CERVER_PRIVATE u8 socket_set_zero_copy (Socket *socket, const size_t threshold);
+
+// returns true if a send of size bytes to the socket would be done with MSG_ZEROCOPY
+// the socket's write mutex must be locked by the caller
+CERVER_PRIVATE bool socket_zero_copy_use (const Socket *socket, const size_t size);
+
+// works like socket_send_iov () but the buffers are sent with MSG_ZEROCOPY if it is possible,
+// release (hold) is called once the kernel is done with them, which might be after this returns,
+// if release is NULL, this waits for the kernel to complete the send before returning
+// the socket's write mutex must be locked by the caller
+// returns 0 on success, 1 on error
+CERVER_PRIVATE u8 socket_send_iov_zero_copy (
+    Socket *socket,
+    struct iovec *iov, int iovcnt, int flags,
+    void *hold, Action release,
+    size_t *total_sent
+);
+
+// reaps the completions of the socket's zero copy sends that the kernel reports as socket errors
+// returns true if the socket does not have an actual error
+CERVER_PRIVATE bool socket_zero_copy_handle_error (Socket *socket);
+
+// sends as much of the socket's outbound queue as possible without blocking
+// resumed is set to true if the reads were paused & the queue drained to its low watermark
+// returns 0 on success, 1 on error
+CERVER_PRIVATE u8 socket_outbound_flush (Socket *socket, bool *resumed);
+
+// returns true if the socket's reads are paused until its outbound queue drains
+CERVER_PRIVATE bool socket_outbound_paused (const Socket *socket);
+
+// handles the completion of an io_uring send of the outbound queue with the send's result,
+// the next queued bytes are sent right away, if the queue is no longer used by its socket, it is deleted
+// resumed is set to true if the reads were paused & the queue drained to its low watermark
+// returns 0 on success, 1 on error or if the queue was deleted
+CERVER_PRIVATE u8 socket_outbound_sent (SocketOutbound *outbound, const int res, bool *resumed);
+
+// starts coalescing what is sent to the socket, it will be sent with a single call
+// when socket_uncork () is called the same n of times
+CERVER_PUBLIC void socket_cork (Socket *socket);
+
+// ends a socket_cork () call & sends the coalesced bytes if it was the last one
+// returns 0 on success, 1 on error
+CERVER_PUBLIC u8 socket_uncork (Socket *socket);
+
+// discards the socket's pending bytes & its outbound queue,
+// releases the buffers of its zero copy sends & cancels the jobs of its serial executor
+// used when its connection has ended & the socket is going to be reused
+CERVER_PRIVATE void socket_send_reset (Socket *socket);
+
+// gets the serial executor that handles the socket's received buffers in order,
+// it is created by the first call & it is kept until socket_dispatch_reset () is called
+// returns NULL on error
+CERVER_PRIVATE ThpoolSerial *socket_dispatch_get (Socket *socket);
+
+// releases the socket's serial executor, so the next connection that uses the socket
+// does not wait for nor shares the cancelled jobs of the one before
+CERVER_PRIVATE void socket_dispatch_reset (Socket *socket);
+
 #endif
\ No newline at end of file
@@ -1,13 +1,16 @@
 #ifndef _CERVER_THREADS_JOBS_H_
 #define _CERVER_THREADS_JOBS_H_
 
-#include <pthread.h>
+#include <stdbool.h>
+#include <stddef.h>
 
-#include "cerver/collections/dlist.h"
+#include "cerver/types/types.h"
 
 #include "cerver/config.h"
 
-#include "cerver/threads/bsem.h"
+#define JOB_QUEUE_DEFAULT_CAPACITY			4096
+
+#define JOB_QUEUE_CACHE_LINE				64
 
 typedef struct Job {
 
@@ -23,17 +26,39 @@ CERVER_PUBLIC void job_delete (void *job_ptr);
 
 CERVER_PUBLIC Job *job_create (void (*method) (void *args), void *args);
 
+// a slot in the job queue's ring
+// its sequence tells whether it is ready to be written or to be read
+typedef struct JobQueueSlot {
+
+	volatile size_t sequence;
+
+	void (*method) (void *args);
+	void *args;
+
+} JobQueueSlot;
+
+// a bounded lock-free multi producer & multi consumer queue of jobs
+// the jobs are stored inline in the ring, so pushing & pulling does not allocate
 typedef struct JobQueue {
 
-	// Job *front;
-	// Job *rear;
+	// each position is written by different threads, so they live in their own cache lines
+	volatile size_t push_pos __attribute__ ((aligned (JOB_QUEUE_CACHE_LINE)));
+	volatile size_t pull_pos __attribute__ ((aligned (JOB_QUEUE_CACHE_LINE)));
 
-	// size_t size;
+	size_t capacity __attribute__ ((aligned (JOB_QUEUE_CACHE_LINE)));
+	size_t mask;
+	JobQueueSlot *slots;
 
-	DoubleList *queue;
+	// futex word that consumers sleep on while the queue is empty
+	volatile unsigned int signal;
+	volatile unsigned int n_waiters;
 
-	pthread_mutex_t *rwmutex;             // used for queue r/w access
-	bsem *has_jobs;
+	// set by job_queue_wake_all () so a consumer that was not waiting yet still returns
+	volatile unsigned int woken;
+
+	// futex word that producers sleep on while the queue is full
+	volatile unsigned int not_full;
+	volatile unsigned int n_producers_waiting;
 
 } JobQueue;
 
@@ -41,16 +66,42 @@ CERVER_PUBLIC JobQueue *job_queue_new (void);
 
 CERVER_PUBLIC void job_queue_delete (void *job_queue_ptr);
 
+// creates a job queue with the default capacity
 CERVER_PUBLIC JobQueue *job_queue_create (void);
 
+// creates a job queue that can hold up to capacity jobs
+// the capacity is rounded up to the next power of 2
+CERVER_PUBLIC JobQueue *job_queue_create_with_capacity (size_t capacity);
+
+// returns true if there are jobs ready to be pulled from the queue
+CERVER_PUBLIC bool job_queue_has_jobs (JobQueue *job_queue);
+
 // add a new job to the queue
-// returns 0 on success, 1 on error
-CERVER_PUBLIC int job_queue_push (JobQueue *job_queue, Job *job);
+// wakes up one consumer if any is waiting
+// returns 0 on success, 1 on error or if the queue is full
+CERVER_PUBLIC int job_queue_push (
+	JobQueue *job_queue, void (*method) (void *args), void *args
+);
 
 // get the job at the start of the queue
-CERVER_PUBLIC Job *job_queue_pull (JobQueue *job_queue);
+// returns 0 if a job was copied into job, 1 if the queue was empty
+CERVER_PUBLIC u8 job_queue_pull (JobQueue *job_queue, Job *job);
+
+// blocks until there are jobs in the queue or job_queue_wake_all () is called,
+// even if it was called before this method
+// it can return without any job, so the caller must check again
+CERVER_PUBLIC void job_queue_wait (JobQueue *job_queue);
+
+// blocks until a job is pulled from a full queue, until job_queue_wake_all () is called
+// or until the timeout (in ms) expires, it returns right away if the queue is not full
+// it can return while the queue is still full, so the caller must try to push again
+CERVER_PUBLIC void job_queue_wait_not_full (JobQueue *job_queue, const u32 timeout);
+
+// wakes up every thread that is waiting on the queue
+// including the producers that are waiting for it to have room
+CERVER_PUBLIC void job_queue_wake_all (JobQueue *job_queue);
 
-// clears the job queue -> destroys all jobs
+// clears the job queue -> discards all jobs
 CERVER_PUBLIC void job_queue_clear (JobQueue *job_queue);
 
-#endif
\ No newline at end of file
+#endif
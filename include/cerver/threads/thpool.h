@@ -6,9 +6,23 @@
 
 #include "cerver/config.h"
 #include "cerver/threads/jobs.h"
+#include "cerver/threads/thread.h"
+
+// every thread has its own deque of jobs, it starts with this many slots & grows as needed
+#define THPOOL_DEQUE_INITIAL_SIZE			256
+
+// how many jobs an idle thread can move from the global queue to its own deque at once
+#define THPOOL_QUEUE_BATCH_MAX				32
+
+// how many times an idle thread looks for jobs to steal before it goes to sleep
+#define THPOOL_IDLE_SPINS					64
 
 struct _PoolThread;
+struct _ThpoolQueue;
 
+// a work stealing thread pool
+// each thread pushes & pops jobs from its own deque while the idle ones steal from others,
+// jobs added from outside the pool go to a global queue that the threads take from in batches
 typedef struct Thpool {
 
 	const char *name;
@@ -19,11 +33,19 @@ typedef struct Thpool {
 	volatile bool keep_alive;
 	volatile unsigned int num_threads_alive;
 	volatile unsigned int num_threads_working;
+	volatile unsigned int num_threads_sleeping;
+
+	// jobs that have been added but that no thread has taken yet
+	volatile long num_jobs_queued;
 
 	pthread_mutex_t *mutex;
 	pthread_cond_t *threads_all_idle;
+	pthread_cond_t *has_jobs;
+
+	struct _ThpoolQueue *queue;
 
-	JobQueue *job_queue;
+	// applied by each thread when it starts
+	ThreadAffinity affinity;
 
 } Thpool;
 
@@ -38,6 +60,11 @@ CERVER_EXPORT unsigned int thpool_init (Thpool *thpool);
 // sets the name for the thpool
 CERVER_EXPORT void thpool_set_name (Thpool *thpool, const char *name);
 
+// sets where the thpool's threads run & where their memory comes from
+// if numa_local is set, each thread allocates its own deque after it has been placed
+// must be called before thpool_init ()
+CERVER_EXPORT void thpool_set_affinity (Thpool *thpool, const ThreadAffinity *affinity);
+
 // gets the current number of threads that are alive (running) in the thpool
 CERVER_EXPORT unsigned int thpool_get_num_threads_alive (Thpool *thpool);
 
@@ -50,13 +77,54 @@ CERVER_EXPORT bool thpool_is_empty (Thpool *thpool);
 // returns true if the thpool has ALL its threads working
 CERVER_EXPORT bool thpool_is_full (Thpool *thpool);
 
-// adds a work to the thpool's job queue
-// it will be executed once it is the next in line and a thread is free
+// adds a work to the thpool
+// if it is called from one of the thpool's threads, the job goes to the thread's own deque,
+// else it goes to the global queue, it will be executed once a thread is free
 CERVER_EXPORT int thpool_add_work (Thpool *thpool, void (*work) (void *), void *args);
 
 // wait until all jobs have finished
 CERVER_EXPORT void thpool_wait (Thpool *thpool);
 
+struct _ThpoolSerialJob;
+
+// a serial executor, the jobs that are added to it run in the thpool one after the other
+// in the order they were added, without any thread blocking while another one runs
+// it is kept alive by its references & by the thpool job that runs it,
+// so it can be released while its jobs are still pending
+typedef struct ThpoolSerial {
+
+	// the added jobs, the last one first
+	struct _ThpoolSerialJob *volatile jobs;
+
+	// jobs that have been added & have not finished yet,
+	// the thread that takes it from 0 schedules a thpool job that runs them all
+	volatile unsigned int pending;
+
+	volatile unsigned int ref_count;
+
+	// set when the jobs are no longer wanted, the pending ones are discarded
+	volatile bool cancelled;
+
+} ThpoolSerial;
+
+// creates a new serial executor with a single reference
+CERVER_EXPORT ThpoolSerial *thpool_serial_new (void);
+
+// removes a reference from the serial executor,
+// it is deleted once its last reference is gone & none of its jobs is running
+CERVER_EXPORT void thpool_serial_delete (void *serial_ptr);
+
+// the jobs that have not started yet & any job that is added later are discarded
+CERVER_EXPORT void thpool_serial_cancel (ThpoolSerial *serial);
+
+// adds a work to the serial executor, it will run in the thpool after the works that were added before
+// if the executor is cancelled before it runs, discard (if any) is called with its args instead
+// returns 0 on success, 1 on error
+CERVER_EXPORT int thpool_add_serial_work (
+	Thpool *thpool, ThpoolSerial *serial,
+	void (*work) (void *), void (*discard) (void *), void *args
+);
+
 // destroys the thpool and deletes all of its data
 CERVER_EXPORT void thpool_destroy (Thpool *thpool);
 
@@ -1,6 +1,7 @@
 #ifndef _CERVER_THREADS_H_
 #define _CERVER_THREADS_H_
 
+#include <stdbool.h>
 #include <pthread.h>
 
 #include "cerver/types/types.h"
@@ -20,6 +21,55 @@ CERVER_PUBLIC int thread_set_name (const char *name);
 
 #pragma endregion
 
+#pragma region affinity
+
+#define THREAD_CPU_SET_MAX_CPUS			1024
+
+// a set of cpus that does not need _GNU_SOURCE to be used
+typedef struct ThreadCpuSet {
+
+	u64 bits[THREAD_CPU_SET_MAX_CPUS / 64];
+
+} ThreadCpuSet;
+
+// removes every cpu from the set
+CERVER_PUBLIC void thread_cpu_set_zero (ThreadCpuSet *cpus);
+
+// adds the cpu to the set
+CERVER_PUBLIC void thread_cpu_set_add (ThreadCpuSet *cpus, unsigned int cpu);
+
+// returns true if the cpu is in the set
+CERVER_PUBLIC bool thread_cpu_set_has (const ThreadCpuSet *cpus, unsigned int cpu);
+
+// returns the number of cpus in the set
+CERVER_PUBLIC unsigned int thread_cpu_set_count (const ThreadCpuSet *cpus);
+
+// parses a cpu list like "0-7,16-23" into the set, as the ones used by the kernel & taskset
+// returns 0 on success, 1 on error
+CERVER_PUBLIC u8 thread_cpu_set_parse (ThreadCpuSet *cpus, const char *list);
+
+// sets the cpus of the numa node from /sys/devices/system/node
+// returns 0 on success, 1 on error
+CERVER_PUBLIC u8 thread_cpu_set_numa_node (ThreadCpuSet *cpus, unsigned int node);
+
+// where a thread runs & where its memory comes from
+typedef struct ThreadAffinity {
+
+	// the cpus that the thread can run on, if it is empty, the thread keeps the ones it inherited
+	ThreadCpuSet cpus;
+
+	// the memory that the thread allocates comes from the numa node it is running on,
+	// so the thread's own buffers should be allocated from inside it after it has been placed
+	bool numa_local;
+
+} ThreadAffinity;
+
+// applies the affinity to the calling thread
+// returns 0 on success, 1 on error
+CERVER_PUBLIC u8 thread_set_affinity (const ThreadAffinity *affinity);
+
+#pragma endregion
+
 #pragma region mutex
 
 // allocates & initializes a new mutex that should be deleted after use
@@ -0,0 +1,146 @@
+#ifndef _CERVER_UDP_H_
+#define _CERVER_UDP_H_
+
+#include <stdbool.h>
+
+#include <pthread.h>
+#include <time.h>
+
+#include <sys/socket.h>
+#include <sys/uio.h>
+
+#include "cerver/types/types.h"
+
+#include "cerver/collections/htab.h"
+
+#include "cerver/config.h"
+
+#if defined(__linux__) && defined(__has_include)
+	#if __has_include(<linux/udp.h>)
+		#include <linux/udp.h>
+
+		// the kernel can split a single send into many datagrams
+		#ifdef UDP_SEGMENT
+			#define CERVER_UDP_GSO_SUPPORTED
+		#endif
+	#endif
+#endif
+
+#define CERVER_UDP_BATCH_SIZE					32			// max n of datagrams received or sent with a single call
+#define CERVER_UDP_CLIENTS_MAP_SIZE				1024		// n of buckets in the address to client map
+#define CERVER_UDP_SEND_BUFFER_SIZE				131072		// bytes of datagrams that can be pending while corked
+#define CERVER_UDP_MAX_SEGMENTS					64			// max n of datagrams in a single gso send
+#define CERVER_UDP_MAX_SEGMENT_SIZE				1400		// bigger datagrams may not fit the path's mtu, so they are sent alone
+#define CERVER_UDP_IDLE_CHECK_INTERVAL			1			// secs between checks for idle peers
+
+struct _Cerver;
+struct _Client;
+
+// the key that is used to map a peer's address to its client
+// any unused bytes are zeroed, so it can be hashed & compared directly
+typedef struct CerverUdpAddress {
+
+	u16 family;
+	u16 port;
+	u8 addr[16];
+
+} CerverUdpAddress;
+
+// a datagram that is waiting to be sent with the next sendmmsg ()
+typedef struct CerverUdpPending {
+
+	struct sockaddr_storage address;
+	socklen_t address_len;
+
+	size_t offset;                      // where the datagram starts in the send buffer
+	size_t size;
+
+} CerverUdpPending;
+
+struct _CerverUdp {
+
+	struct _Cerver *cerver;
+
+	i32 sock;                           // the cerver's socket, every peer shares it
+	bool gso;                           // runs of datagrams to the same peer are sent with a single segmented send
+
+	Htab *clients_map;                  // peer address to client
+	time_t last_idle_check;             // when the peers were last checked for inactivity
+
+	// datagrams are received in batches into consecutive slots of the buffer
+	size_t max_datagram_size;
+	char *recv_buffer;
+	struct iovec recv_iovs[CERVER_UDP_BATCH_SIZE];
+	struct sockaddr_storage recv_addresses[CERVER_UDP_BATCH_SIZE];
+	struct mmsghdr recv_msgs[CERVER_UDP_BATCH_SIZE];
+
+	// while corked, datagrams are copied into the send buffer
+	// & sent together when the udp gets uncorked or when the batch is full
+	pthread_mutex_t *send_mutex;
+	unsigned int corked;
+	char *send_buffer;
+	size_t send_buffer_used;
+	unsigned int n_pending;
+	CerverUdpPending pending[CERVER_UDP_BATCH_SIZE];
+
+};
+
+typedef struct _CerverUdp CerverUdp;
+
+// fills the key for the peer's address
+CERVER_PRIVATE void cerver_udp_address_get (
+	const struct sockaddr_storage *address, CerverUdpAddress *key
+);
+
+// returns the actual length of the address
+CERVER_PRIVATE socklen_t cerver_udp_address_len (const struct sockaddr_storage *address);
+
+// sets up the udp structures for the cerver's socket
+// returns NULL on error
+CERVER_PRIVATE CerverUdp *cerver_udp_create (struct _Cerver *cerver);
+
+CERVER_PRIVATE void cerver_udp_delete (void *udp_ptr);
+
+// gets the client that is mapped to the peer's address
+// returns NULL if the address is unknown
+CERVER_PRIVATE struct _Client *cerver_udp_client_get (
+	CerverUdp *udp, const struct sockaddr_storage *address
+);
+
+// maps the peer's address to the client
+// returns 0 on success, 1 on error
+CERVER_PRIVATE u8 cerver_udp_client_register (
+	CerverUdp *udp, struct _Client *client, const struct sockaddr_storage *address
+);
+
+// removes the peer's address from the clients map
+// returns 0 on success, 1 on error
+CERVER_PRIVATE u8 cerver_udp_client_unregister (
+	CerverUdp *udp, const struct sockaddr_storage *address
+);
+
+// gets up to max_clients clients that have not been active since the threshold time
+// returns the n of clients that were placed in the clients array
+CERVER_PRIVATE size_t cerver_udp_clients_get_idle (
+	CerverUdp *udp, const time_t threshold,
+	struct _Client **clients, const size_t max_clients
+);
+
+// sends the iovec buffers as a single datagram to the address
+// if the udp is corked, the datagram is copied & sent with the other pending ones
+// returns 0 on success, 1 on error
+CERVER_PRIVATE u8 cerver_udp_send (
+	CerverUdp *udp, const struct sockaddr_storage *address,
+	const struct iovec *iov, int iovcnt,
+	size_t *total_sent
+);
+
+// starts keeping the datagrams that are sent to be sent together with sendmmsg ()
+// nested calls are allowed, they are sent after the last cerver_udp_uncork ()
+CERVER_PRIVATE void cerver_udp_cork (CerverUdp *udp);
+
+// sends every pending datagram with as few sendmmsg () calls as possible
+// returns 0 on success, 1 if any datagram failed to be sent
+CERVER_PRIVATE u8 cerver_udp_uncork (CerverUdp *udp);
+
+#endif
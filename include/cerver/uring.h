@@ -0,0 +1,147 @@
+#ifndef _CERVER_URING_H_
+#define _CERVER_URING_H_
+
+#include <stdbool.h>
+
+#include <pthread.h>
+
+#include "cerver/types/types.h"
+
+#include "cerver/config.h"
+
+#if defined(__linux__) && defined(__has_include)
+	#if __has_include(<linux/io_uring.h>)
+		#include <linux/io_uring.h>
+		// multishot accept & recv and provided buffer rings are required
+		#if defined(IORING_RECV_MULTISHOT) && defined(IORING_ACCEPT_MULTISHOT) && defined(IORING_ASYNC_CANCEL_FD)
+			#define CERVER_URING_SUPPORTED
+		#endif
+	#endif
+#endif
+
+#define CERVER_URING_DEFAULT_ENTRIES			1024		// n of sqes in the ring
+#define CERVER_URING_DEFAULT_BUFFERS			1024		// n of provided receive buffers (power of 2)
+#define CERVER_URING_DEFAULT_COMPLETIONS		256			// max n of completions handled every wait
+
+#define CERVER_URING_BUFFER_GROUP				0
+
+// used to tag each sqe to know which operation completed
+#define CERVER_URING_OP_MAP(XX)			\
+	XX(0,	NONE)						\
+	XX(1,	ACCEPT)						\
+	XX(2,	RECV)						\
+	XX(3,	CANCEL)						\
+	XX(4,	SEND)
+
+typedef enum CerverUringOp {
+
+	#define XX(num, name) CERVER_URING_OP_##name = num,
+	CERVER_URING_OP_MAP (XX)
+	#undef XX
+
+} CerverUringOp;
+
+#define CERVER_URING_GENERATION_MASK			0xffffff
+
+// the op is stored in the upper 8 bits of the user data, followed by the generation
+// of the connection that the request belongs to & the sock fd in the lower 32 bits,
+// sends store the id of the slot that keeps their data instead of the sock fd
+#define cerver_uring_user_data(op, generation, sock_fd)	\
+	((((u64) (op)) << 56) | (((u64) ((generation) & CERVER_URING_GENERATION_MASK)) << 32) | ((u32) (sock_fd)))
+#define cerver_uring_user_data_op(user_data)			((CerverUringOp) ((user_data) >> 56))
+#define cerver_uring_user_data_generation(user_data)	((u32) (((user_data) >> 32) & CERVER_URING_GENERATION_MASK))
+#define cerver_uring_user_data_fd(user_data)			((i32) ((user_data) & 0xffffffff))
+
+struct _CerverUring;
+
+typedef struct _CerverUring CerverUring;
+
+// a completed operation from the ring
+typedef struct CerverUringCompletion {
+
+	CerverUringOp op;
+	u32 generation;             // of the connection that queued the request
+	i32 sock_fd;
+
+	i32 res;                    // same as the return value of the syscall
+	bool more;                  // a multishot request will keep posting completions
+	bool has_buffer;            // data is in a provided buffer
+	u16 buffer_id;
+
+	void *data;                 // the data that was queued with a send
+
+} CerverUringCompletion;
+
+// returns true if the running kernel supports all the io_uring features that we need,
+// a small ring is set up to probe for the ops & for the provided buffers ring registration
+CERVER_PRIVATE bool cerver_uring_is_supported (void);
+
+// sets up a new ring with a provided buffers ring of n_buffers, each one of buffer_size bytes
+// returns NULL if io_uring is not supported or if we failed to set it up
+CERVER_PRIVATE CerverUring *cerver_uring_create (
+	const unsigned int entries,
+	const unsigned int n_buffers, const size_t buffer_size
+);
+
+// closes the ring, the provided buffers are kept until the ones that are being held are released
+CERVER_PRIVATE void cerver_uring_delete (void *uring_ptr);
+
+// arms a multishot accept in the listening socket
+// returns 0 on success, 1 on error
+CERVER_PRIVATE u8 cerver_uring_accept (CerverUring *uring, const i32 sock_fd);
+
+// returns a new generation to tag the requests of a connection with, so the late completions
+// of a dropped connection are not taken for the ones of a new connection that reuses its sock fd
+CERVER_PRIVATE u32 cerver_uring_generation_next (CerverUring *uring);
+
+// arms a multishot recv that will pick buffers from the ring provided buffers
+// returns 0 on success, 1 on error
+CERVER_PRIVATE u8 cerver_uring_recv (CerverUring *uring, const i32 sock_fd, const u32 generation);
+
+// cancels the multishot recv of the sock fd, any other request is kept
+// returns 0 on success, 1 on error
+CERVER_PRIVATE u8 cerver_uring_cancel_recv (CerverUring *uring, const i32 sock_fd, const u32 generation);
+
+// queues a send of the buffer to the sock fd, data is returned with its completion,
+// sends that are queued from the thread that waits for the completions are submitted
+// all at once with the next wait, any other one is submitted right away
+// returns 0 on success, 1 on error
+CERVER_PRIVATE u8 cerver_uring_send (
+	CerverUring *uring, const i32 sock_fd,
+	const char *buffer, const size_t size,
+	void *data
+);
+
+// cancels any pending request for the sock fd
+// returns 0 on success, 1 on error
+CERVER_PRIVATE u8 cerver_uring_cancel (CerverUring *uring, const i32 sock_fd);
+
+// submits all the queued requests to the kernel in a single call
+// returns 0 on success, 1 on error
+CERVER_PRIVATE u8 cerver_uring_submit (CerverUring *uring);
+
+// submits any queued request and waits for at least one completion or until the timeout (in ms)
+// then copies up to max_completions into the completions array
+// returns the number of completions, -1 on error
+CERVER_PRIVATE int cerver_uring_wait (
+	CerverUring *uring,
+	CerverUringCompletion *completions, const unsigned int max_completions,
+	const u32 timeout
+);
+
+// gets the data that was placed by the kernel in a provided buffer
+CERVER_PRIVATE char *cerver_uring_buffer_get (CerverUring *uring, const u16 buffer_id);
+
+// returns the provided buffer back to the kernel so it can be used again
+CERVER_PRIVATE void cerver_uring_buffer_recycle (CerverUring *uring, const u16 buffer_id);
+
+// takes the provided buffer out of the ring until cerver_uring_buffer_release () is called,
+// so its data can be referenced without copying it
+// returns NULL if too many buffers are already being held, so the kernel never runs out of them
+CERVER_PRIVATE char *cerver_uring_buffer_hold (CerverUring *uring, const u16 buffer_id);
+
+// returns a buffer taken with cerver_uring_buffer_hold () back to the kernel,
+// it can be called from any thread & even after the ring has been deleted
+CERVER_PRIVATE void cerver_uring_buffer_release (void *uring_ptr, char *buffer);
+
+#endif
\ No newline at end of file
@@ -0,0 +1,18 @@
+#ifndef _CERVER_UTILS_CRC32C_H_
+#define _CERVER_UTILS_CRC32C_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+
+#include "cerver/config.h"
+
+// calculates the crc32c (castagnoli) of the buffer, continuing from crc
+// use 0 as the initial crc, so a buffer can be checked in pieces
+// the sse4.2 crc32 instruction is used when the cpu supports it
+CERVER_PUBLIC uint32_t crc32c_calc (uint32_t crc, const void *buffer, size_t len);
+
+// returns true if crc32c_calc () uses the cpu's crc32 instruction
+CERVER_PUBLIC bool crc32c_hardware (void);
+
+#endif
@@ -0,0 +1,31 @@
+#ifndef _CERVER_UTILS_LZ_H_
+#define _CERVER_UTILS_LZ_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "cerver/config.h"
+
+// a fast lz77 block codec with the same sequence layout as lz4:
+// a token with the literals & match lengths, the literals, a 16 bit offset & the extra match length
+// the last sequence only has literals
+
+// returns the max size that the compressed input can take
+CERVER_PUBLIC size_t lz_compress_bound (size_t input_size);
+
+// compresses the input into the output
+// returns the compressed size, 0 if it did not fit in the output
+CERVER_PUBLIC size_t lz_compress (
+	const void *input, size_t input_size,
+	void *output, size_t output_capacity
+);
+
+// decompresses the input into the output, that must be of the original size
+// every length & offset is checked, so it is safe to use with untrusted input
+// returns 0 on success, 1 if the input is corrupted or it does not match the output size
+CERVER_PUBLIC uint8_t lz_decompress (
+	const void *input, size_t input_size,
+	void *output, size_t output_size
+);
+
+#endif
@@ -16,10 +16,10 @@
 #include "cerver/connection.h"
 #include "cerver/handler.h"
 #include "cerver/packets.h"
+#include "cerver/pollfds.h"
 #include "cerver/events.h"
 
 #include "cerver/threads/thread.h"
-#include "cerver/threads/bsem.h"
 
 #include "cerver/utils/utils.h"
 #include "cerver/utils/log.h"
@@ -82,35 +82,35 @@ void admin_cerver_stats_print (AdminCerverStats *stats) {
 }
 
 static void admin_cerver_packet_send_update_stats (AdminCerverStats *stats,
-	PacketType packet_type, size_t sent) {
+	PacketType packet_type, size_t n_packets, size_t sent) {
 
-	stats->total_n_packets_sent += 1;
+	stats->total_n_packets_sent += n_packets;
 	stats->total_bytes_sent += sent;
 
 	switch (packet_type) {
 		case PACKET_TYPE_NONE: break;
 
-		case PACKET_TYPE_CERVER: stats->sent_packets->n_cerver_packets += 1; break;
+		case PACKET_TYPE_CERVER: stats->sent_packets->n_cerver_packets += n_packets; break;
 
 		case PACKET_TYPE_CLIENT: break;
 
-		case PACKET_TYPE_ERROR: stats->sent_packets->n_error_packets += 1; break;
+		case PACKET_TYPE_ERROR: stats->sent_packets->n_error_packets += n_packets; break;
 
-		case PACKET_TYPE_REQUEST: stats->sent_packets->n_request_packets += 1; break;
+		case PACKET_TYPE_REQUEST: stats->sent_packets->n_request_packets += n_packets; break;
 
-		case PACKET_TYPE_AUTH: stats->sent_packets->n_auth_packets += 1; break;
+		case PACKET_TYPE_AUTH: stats->sent_packets->n_auth_packets += n_packets; break;
 
-		case PACKET_TYPE_GAME: stats->sent_packets->n_game_packets += 1; break;
+		case PACKET_TYPE_GAME: stats->sent_packets->n_game_packets += n_packets; break;
 
-		case PACKET_TYPE_APP: stats->sent_packets->n_app_packets += 1; break;
+		case PACKET_TYPE_APP: stats->sent_packets->n_app_packets += n_packets; break;
 
-		case PACKET_TYPE_APP_ERROR: stats->sent_packets->n_app_error_packets += 1; break;
+		case PACKET_TYPE_APP_ERROR: stats->sent_packets->n_app_error_packets += n_packets; break;
 
-		case PACKET_TYPE_CUSTOM: stats->sent_packets->n_custom_packets += 1; break;
+		case PACKET_TYPE_CUSTOM: stats->sent_packets->n_custom_packets += n_packets; break;
 
-		case PACKET_TYPE_TEST: stats->sent_packets->n_test_packets += 1; break;
+		case PACKET_TYPE_TEST: stats->sent_packets->n_test_packets += n_packets; break;
 
-		default: stats->sent_packets->n_unknown_packets += 1; break;
+		default: stats->sent_packets->n_unknown_packets += n_packets; break;
 	}
 
 }
@@ -379,7 +379,7 @@ u8 admin_send_packet (Admin *admin, Packet *packet) {
 		if (!packet_send (packet, 0, &sent, false)) {
 			// printf ("admin_send_packet () - Sent to admin: %ld\n", sent);
 
-			admin_cerver_packet_send_update_stats (admin->admin_cerver->stats, packet->packet_type, sent);
+			admin_cerver_packet_send_update_stats (admin->admin_cerver->stats, packet->packet_type, 1, sent);
 
 			retval = 0;
 		}
@@ -410,7 +410,7 @@ u8 admin_send_packet_split (Admin *admin, Packet *packet) {
 		)) {
 			// printf ("admin_send_packet_split () - Sent to admin: %ld\n", sent);
 
-			admin_cerver_packet_send_update_stats (admin->admin_cerver->stats, packet->packet_type, sent);
+			admin_cerver_packet_send_update_stats (admin->admin_cerver->stats, packet->packet_type, 1, sent);
 
 			retval = 0;
 		}
@@ -448,7 +448,7 @@ u8 admin_send_packet_pieces (Admin *admin, Packet *packet,
 		)) {
 			printf ("admin_send_packet_pieces () - Sent to admin: %ld\n", sent);
 
-			admin_cerver_packet_send_update_stats (admin->admin_cerver->stats, packet->packet_type, sent);
+			admin_cerver_packet_send_update_stats (admin->admin_cerver->stats, packet->packet_type, 1, sent);
 
 			retval = 0;
 		}
@@ -481,7 +481,7 @@ AdminCerver *admin_cerver_new (void) {
 
 		admin_cerver->n_bad_packets_limit = DEFAULT_N_BAD_PACKETS_LIMIT;
 
-		admin_cerver->fds = NULL;
+		admin_cerver->poll_fds = NULL;
 		admin_cerver->max_n_fds = DEFAULT_ADMIN_MAX_N_FDS;
 		admin_cerver->current_n_fds = 0;
 		admin_cerver->poll_timeout = DEFAULT_ADMIN_POLL_TIMEOUT;
@@ -522,7 +522,7 @@ void admin_cerver_delete (AdminCerver *admin_cerver) {
 	if (admin_cerver) {
 		dlist_delete (admin_cerver->admins);
 
-		if (admin_cerver->fds) free (admin_cerver->fds);
+		poll_fds_delete (admin_cerver->poll_fds);
 
 		if (admin_cerver->poll_lock) {
 			pthread_mutex_destroy (admin_cerver->poll_lock);
@@ -760,12 +760,47 @@ u8 admin_cerver_broadcast_to_admins (AdminCerver *admin_cerver, Packet *packet)
 	u8 retval = 1;
 
 	if (admin_cerver && packet) {
-		u8 errors = 0;
-		for (ListElement *le = dlist_start (admin_cerver->admins); le; le = le->next) {
-			errors |= admin_send_packet ((Admin *) le->data, packet);
+		size_t n_admins = (size_t) dlist_size (admin_cerver->admins);
+		if (n_admins) {
+			PacketBroadcastTarget *targets = (PacketBroadcastTarget *) calloc (
+				n_admins, sizeof (PacketBroadcastTarget)
+			);
+
+			if (targets) {
+				// the packet is sent to the first connection of each admin
+				size_t n_targets = 0;
+				Admin *admin = NULL;
+				for (ListElement *le = dlist_start (admin_cerver->admins); le; le = le->next) {
+					admin = (Admin *) le->data;
+					if (dlist_start (admin->client->connections)) {
+						targets[n_targets].client = admin->client;
+						targets[n_targets].connection = (Connection *) dlist_start (admin->client->connections)->data;
+						n_targets += 1;
+					}
+				}
+
+				size_t n_sent = 0;
+				size_t total_sent = 0;
+				retval = packet_broadcast (
+					packet,
+					NULL, NULL,
+					targets, n_targets,
+					0,
+					&n_sent, &total_sent
+				);
+
+				admin_cerver_packet_send_update_stats (admin_cerver->stats, packet->packet_type, n_sent, total_sent);
+
+				if (retval || (n_targets < n_admins)) {
+					cerver_log_error ("admin_cerver_broadcast_to_admins () - Failed to send packet to some admins!");
+					retval = 1;
+				}
+
+				free (targets);
+			}
 		}
 
-		retval = errors;
+		else retval = 0;
 	}
 
 	return retval;
@@ -1020,13 +1055,8 @@ static u8 admin_cerver_start_internal (AdminCerver *admin_cerver) {
 	u8 retval = 1;
 
 	if (admin_cerver) {
-		admin_cerver->fds = (struct pollfd *) calloc (admin_cerver->max_n_fds, sizeof (struct pollfd));
-		if (admin_cerver->fds) {
-			memset (admin_cerver->fds, 0, sizeof (struct pollfd) * admin_cerver->max_n_fds);
-
-			for (u32 i = 0; i < admin_cerver->max_n_fds; i++)
-				admin_cerver->fds[i].fd = -1;
-
+		admin_cerver->poll_fds = poll_fds_create (admin_cerver->max_n_fds);
+		if (admin_cerver->poll_fds) {
 			admin_cerver->current_n_fds = 0;
 
 			admin_cerver->poll_lock = (pthread_mutex_t *) malloc (sizeof (pthread_mutex_t));
@@ -1287,7 +1317,7 @@ static u8 admin_cerver_app_handler_destroy (AdminCerver *admin_cerver) {
 		if (admin_cerver->app_packet_handler) {
 			if (!admin_cerver->app_packet_handler->direct_handle) {
 				// stop app handler
-				bsem_post_all (admin_cerver->app_packet_handler->job_queue->has_jobs);
+				job_queue_wake_all (admin_cerver->app_packet_handler->job_queue);
 			}
 		}
 	}
@@ -1304,7 +1334,7 @@ static u8 admin_cerver_app_error_handler_destroy (AdminCerver *admin_cerver) {
 		if (admin_cerver->app_error_packet_handler) {
 			if (!admin_cerver->app_error_packet_handler->direct_handle) {
 				// stop app error handler
-				bsem_post_all (admin_cerver->app_error_packet_handler->job_queue->has_jobs);
+				job_queue_wake_all (admin_cerver->app_error_packet_handler->job_queue);
 			}
 		}
 	}
@@ -1321,7 +1351,7 @@ static u8 admin_cerver_custom_handler_destroy (AdminCerver *admin_cerver) {
 		if (admin_cerver->custom_packet_handler) {
 			if (!admin_cerver->custom_packet_handler->direct_handle) {
 				// stop custom handler
-				bsem_post_all (admin_cerver->custom_packet_handler->job_queue->has_jobs);
+				job_queue_wake_all (admin_cerver->custom_packet_handler->job_queue);
 			}
 		}
 	}
@@ -1352,13 +1382,13 @@ static u8 admin_cerver_handlers_end (AdminCerver *admin_cerver) {
 		// poll remaining handlers
 		while (admin_cerver->num_handlers_alive) {
 			if (admin_cerver->app_packet_handler)
-				bsem_post_all (admin_cerver->app_packet_handler->job_queue->has_jobs);
+				job_queue_wake_all (admin_cerver->app_packet_handler->job_queue);
 
 			if (admin_cerver->app_error_packet_handler)
-				bsem_post_all (admin_cerver->app_error_packet_handler->job_queue->has_jobs);
+				job_queue_wake_all (admin_cerver->app_error_packet_handler->job_queue);
 
 			if (admin_cerver->custom_packet_handler)
-				bsem_post_all (admin_cerver->custom_packet_handler->job_queue->has_jobs);
+				job_queue_wake_all (admin_cerver->custom_packet_handler->job_queue);
 
 			sleep (1);
 		}
@@ -1507,15 +1537,7 @@ static void admin_app_packet_handler (Packet *packet) {
 		else {
 			// add the packet to the handler's job queueu to be handled
 			// as soon as the handler is available
-			if (job_queue_push (
-				packet->cerver->admin->app_packet_handler->job_queue,
-				job_create (NULL, packet)
-			)) {
-				cerver_log_error (
-					"Failed to push a new job to cerver's %s ADMIN app_packet_handler!",
-					packet->cerver->info->name->str
-				);
-			}
+			(void) handler_queue_packet (packet->cerver->admin->app_packet_handler, packet);
 		}
 	}
 
@@ -1543,15 +1565,7 @@ static void admin_app_error_packet_handler (Packet *packet) {
 		else {
 			// add the packet to the handler's job queueu to be handled
 			// as soon as the handler is available
-			if (job_queue_push (
-				packet->cerver->admin->app_error_packet_handler->job_queue,
-				job_create (NULL, packet)
-			)) {
-				cerver_log_error (
-					"Failed to push a new job to cerver's %s ADMIN app_error_packet_handler!",
-					packet->cerver->info->name->str
-				);
-			}
+			(void) handler_queue_packet (packet->cerver->admin->app_error_packet_handler, packet);
 		}
 	}
 
@@ -1579,15 +1593,7 @@ static void admin_custom_packet_handler (Packet *packet) {
 		else {
 			// add the packet to the handler's job queueu to be handled
 			// as soon as the handler is available
-			if (job_queue_push (
-				packet->cerver->admin->custom_packet_handler->job_queue,
-				job_create (NULL, packet)
-			)) {
-				cerver_log_error (
-					"Failed to push a new job to cerver's %s ADMIN custom_packet_handler!",
-					packet->cerver->info->name->str
-				);
-			}
+			(void) handler_queue_packet (packet->cerver->admin->custom_packet_handler, packet);
 		}
 	}
 
@@ -1611,6 +1617,7 @@ void admin_packet_handler (Packet *packet) {
 			// we expect the packet version in the packet's data
 			if (packet->data) {
 				packet->version = (PacketVersion *) packet->data_ptr;
+				packet->version_ref = true;
 				packet->data_ptr += sizeof (PacketVersion);
 				good = packet_check (packet);
 			}
@@ -1684,31 +1691,6 @@ void admin_packet_handler (Packet *packet) {
 
 #pragma region poll
 
-// get a free index in the admin cerver poll fds array
-static i32 admin_cerver_poll_get_free_idx (AdminCerver *admin_cerver) {
-
-	if (admin_cerver) {
-		for (u32 i = 0; i < admin_cerver->max_n_fds; i++)
-			if (admin_cerver->fds[i].fd == -1) return i;
-
-	}
-
-	return -1;
-
-}
-
-// get the idx of the connection sock fd in the admin cerver poll fds
-static i32 admin_cerver_poll_get_idx_by_sock_fd (AdminCerver *admin_cerver, i32 sock_fd) {
-
-	if (admin_cerver) {
-		for (u32 i = 0; i < admin_cerver->max_n_fds; i++)
-			if (admin_cerver->fds[i].fd == sock_fd) return i;
-	}
-
-	return -1;
-
-}
-
 // regsiters a client connection to the cerver's admin poll array
 // returns 0 on success, 1 on error
 u8 admin_cerver_poll_register_connection (AdminCerver *admin_cerver, Connection *connection) {
@@ -1718,10 +1700,8 @@ u8 admin_cerver_poll_register_connection (AdminCerver *admin_cerver, Connection
 	if (admin_cerver && connection) {
 		pthread_mutex_lock (admin_cerver->poll_lock);
 
-		i32 idx = admin_cerver_poll_get_free_idx (admin_cerver);
+		i32 idx = poll_fds_add (admin_cerver->poll_fds, connection->socket->sock_fd, POLLIN);
 		if (idx >= 0) {
-			admin_cerver->fds[idx].fd = connection->socket->sock_fd;
-			admin_cerver->fds[idx].events = POLLIN;
 			admin_cerver->current_n_fds++;
 
 			admin_cerver->stats->current_connections++;
@@ -1772,10 +1752,9 @@ u8 admin_cerver_poll_unregister_sock_fd (AdminCerver *admin_cerver, const i32 so
 	if (admin_cerver) {
 		pthread_mutex_lock (admin_cerver->poll_lock);
 
-		i32 idx = admin_cerver_poll_get_idx_by_sock_fd (admin_cerver, sock_fd);
+		// the slot is released but the array is compacted after handling the current events
+		i32 idx = poll_fds_remove (admin_cerver->poll_fds, sock_fd);
 		if (idx >= 0) {
-			admin_cerver->fds[idx].fd = -1;
-			admin_cerver->fds[idx].events = -1;
 			admin_cerver->current_n_fds--;
 
 			admin_cerver->stats->current_connections--;
@@ -1827,10 +1806,10 @@ static u8 admin_cerver_poll_unregister_connection (AdminCerver *admin_cerver, Co
 
 static inline void admin_poll_handle_actual (Cerver *cerver, const u32 idx, CerverReceive *cr) {
 
-	switch (cerver->admin->fds[idx].revents) {
+	switch (cerver->admin->poll_fds->fds[idx].revents) {
 		// A connection setup has been completed or new data arrived
 		case POLLIN: {
-			// printf ("admin_poll_handle () - Receive fd: %d\n", cerver->admin->fds[idx].fd);
+			// printf ("admin_poll_handle () - Receive fd: %d\n", cerver->admin->poll_fds->fds[idx].fd);
 
 			// if (cerver->thpool) {
 				// pthread_mutex_lock (socket->mutex);
@@ -1862,7 +1841,7 @@ static inline void admin_poll_handle_actual (Cerver *cerver, const u32 idx, Cerv
 		} break;
 
 		default: {
-			if (cerver->admin->fds[idx].revents != 0) {
+			if (cerver->admin->poll_fds->fds[idx].revents != 0) {
 				// handle as failed any other signal
 				// to avoid hanging up at 100% or getting a segfault
 				cerver_switch_receive_handle_failed (cr);
@@ -1878,15 +1857,20 @@ static inline void admin_poll_handle (Cerver *cerver) {
 		pthread_mutex_lock (cerver->admin->poll_lock);
 
 		// one or more fd(s) are readable, need to determine which ones they are
-		for (u32 idx = 0; idx < cerver->admin->max_n_fds; idx++) {
-			if (cerver->admin->fds[idx].fd != -1) {
-				CerverReceive *cr = cerver_receive_create (RECEIVE_TYPE_ADMIN, cerver, cerver->admin->fds[idx].fd);
+		// only the first n_fds slots are used, released ones have a -1 fd
+		PollFds *poll_fds = cerver->admin->poll_fds;
+		for (u32 idx = 0; idx < poll_fds->n_fds; idx++) {
+			if ((poll_fds->fds[idx].fd != -1) && poll_fds->fds[idx].revents) {
+				CerverReceive *cr = cerver_receive_create (RECEIVE_TYPE_ADMIN, cerver, poll_fds->fds[idx].fd);
 				if (cr) {
 					admin_poll_handle_actual (cerver, idx, cr);
 				}
 			}
 		}
 
+		// fill the slots that were released by dropped connections
+		poll_fds_compact (poll_fds);
+
 		pthread_mutex_unlock (cerver->admin->poll_lock);
 	}
 
@@ -1914,8 +1898,8 @@ static void *admin_poll (void *cerver_ptr) {
 		int poll_retval = 0;
 		while (cerver->isRunning) {
 			poll_retval = poll (
-				admin_cerver->fds,
-				admin_cerver->max_n_fds,
+				admin_cerver->poll_fds->fds,
+				admin_cerver->poll_fds->n_fds,
 				admin_cerver->poll_timeout
 			);
 
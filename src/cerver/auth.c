@@ -8,6 +8,7 @@
 #include "cerver/socket.h"
 #include "cerver/network.h"
 #include "cerver/packets.h"
+#include "cerver/pollfds.h"
 #include "cerver/errors.h"
 #include "cerver/handler.h"
 #include "cerver/sessions.h"
@@ -788,6 +789,7 @@ void on_hold_packet_handler (void *packet_ptr) {
 			// we expect the packet version in the packet's data
 			if (packet->data) {
 				packet->version = (PacketVersion *) packet->data_ptr;
+				packet->version_ref = true;
 				packet->data_ptr += sizeof (PacketVersion);
 				good = packet_check (packet);
 			}
@@ -806,6 +808,25 @@ void on_hold_packet_handler (void *packet_ptr) {
 				// acknowledge the client we have received his test packet
 				case PACKET_TYPE_TEST: cerver_test_packet_handler (packet); break;
 
+				// the header version can be agreed before authenticating
+				case PACKET_TYPE_CLIENT: {
+					if (packet->header->request_type == CLIENT_PACKET_TYPE_HEADER_V2) {
+						(void) connection_header_v2_accept (packet->cerver, NULL, packet->connection);
+					}
+
+					else if (packet->header->request_type == CLIENT_PACKET_TYPE_CHECKSUMS) {
+						(void) connection_checksums_accept (packet->cerver, NULL, packet->connection);
+					}
+
+					else if (packet->header->request_type == CLIENT_PACKET_TYPE_COMPRESSION) {
+						(void) connection_compression_accept (packet->cerver, NULL, packet->connection);
+					}
+
+					else {
+						cerver_on_hold_handle_max_bad_packets (packet->cerver, packet->connection);
+					}
+				} break;
+
 				default: {
 					#ifdef AUTH_DEBUG
 					cerver_log (
@@ -918,6 +939,9 @@ void on_hold_connection_drop (const Cerver *cerver, Connection *connection) {
 		// close the connection socket
 		connection_end (connection);
 
+		// the pending bytes & the queued buffers were for the sock fd that was just closed
+		socket_send_reset (connection->socket);
+
 		cerver_sockets_pool_push ((Cerver *) cerver, connection->socket);
 		connection->socket = NULL;
 
@@ -937,28 +961,6 @@ void on_hold_connection_drop (const Cerver *cerver, Connection *connection) {
 
 #pragma region poll
 
-static i32 on_hold_get_free_idx (Cerver *cerver) {
-
-	if (cerver) {
-		for (u32 i = 0; i < cerver->max_on_hold_connections; i++)
-			if (cerver->hold_fds[i].fd == -1) return i;
-	}
-
-	return -1;
-
-}
-
-static i32 on_hold_poll_get_idx_by_sock_fd (const Cerver *cerver, i32 sock_fd) {
-
-	if (cerver) {
-		for (u32 i = 0; i < cerver->max_on_hold_connections; i++)
-			if (cerver->hold_fds[i].fd == sock_fd) return i;
-	}
-
-	return -1;
-
-}
-
 // regsiters a connection to the cerver's on hold poll array
 // returns 0 on success, 1 on error
 static u8 on_hold_poll_register_connection (Cerver *cerver, Connection *connection) {
@@ -966,12 +968,10 @@ static u8 on_hold_poll_register_connection (Cerver *cerver, Connection *connecti
 	u8 retval = 1;
 
 	if (cerver && connection) {
-		// pthread_mutex_lock (cerver->on_hold_poll_lock);
+		pthread_mutex_lock (cerver->on_hold_poll_lock);
 
-		i32 idx = on_hold_get_free_idx (cerver);
+		i32 idx = poll_fds_add (cerver->hold_poll_fds, connection->socket->sock_fd, POLLIN);
 		if (idx >= 0) {
-			cerver->hold_fds[idx].fd = connection->socket->sock_fd;
-			cerver->hold_fds[idx].events = POLLIN;
 			cerver->current_on_hold_nfds++;
 
 			cerver->stats->current_n_hold_connections++;
@@ -1005,7 +1005,7 @@ static u8 on_hold_poll_register_connection (Cerver *cerver, Connection *connecti
 			#endif
 		}
 
-		// pthread_mutex_unlock (cerver->on_hold_poll_lock);
+		pthread_mutex_unlock (cerver->on_hold_poll_lock);
 	}
 
 	return retval;
@@ -1019,12 +1019,11 @@ u8 on_hold_poll_unregister_sock_fd (Cerver *cerver, const i32 sock_fd) {
 	u8 retval = 1;
 
 	if (cerver) {
-		// pthread_mutex_lock (cerver->on_hold_poll_lock);
+		pthread_mutex_lock (cerver->on_hold_poll_lock);
 
-		i32 idx = on_hold_poll_get_idx_by_sock_fd (cerver, sock_fd);
+		// the slot is released but the array is compacted after handling the current events
+		i32 idx = poll_fds_remove (cerver->hold_poll_fds, sock_fd);
 		if (idx >= 0) {
-			cerver->hold_fds[idx].fd = -1;
-			cerver->hold_fds[idx].events = -1;
 			cerver->current_on_hold_nfds--;
 
 			cerver->stats->current_n_hold_connections--;
@@ -1058,7 +1057,7 @@ u8 on_hold_poll_unregister_sock_fd (Cerver *cerver, const i32 sock_fd) {
 			// #endif
 		}
 
-		// pthread_mutex_unlock (cerver->on_hold_poll_lock);
+		pthread_mutex_unlock (cerver->on_hold_poll_lock);
 	}
 
 	return retval;
@@ -1076,10 +1075,10 @@ static u8 on_hold_poll_unregister_connection (Cerver *cerver, Connection *connec
 
 static inline void on_hold_poll_handle_actual (Cerver *cerver, const u32 idx, CerverReceive *cr) {
 
-	switch (cerver->hold_fds[idx].revents) {
+	switch (cerver->hold_poll_fds->fds[idx].revents) {
 		// A connection setup has been completed or new data arrived
 		case POLLIN: {
-			// printf ("on_hold_poll_handle () - Receive fd: %d\n", cerver->hold_fds[idx].fd);
+			// printf ("on_hold_poll_handle () - Receive fd: %d\n", cerver->hold_poll_fds->fds[idx].fd);
 
 			// if (cerver->thpool) {
 				// pthread_mutex_lock (socket->mutex);
@@ -1111,7 +1110,7 @@ static inline void on_hold_poll_handle_actual (Cerver *cerver, const u32 idx, Ce
 		} break;
 
 		default: {
-			if (cerver->hold_fds[idx].revents != 0) {
+			if (cerver->hold_poll_fds->fds[idx].revents != 0) {
 				// 17/06/2020 -- 15:06 -- handle as failed any other signal
 				// to avoid hanging up at 100% or getting a segfault
 				cerver_switch_receive_handle_failed (cr);
@@ -1127,18 +1126,23 @@ static inline void on_hold_poll_handle (Cerver *cerver) {
 		// pthread_mutex_lock (cerver->on_hold_poll_lock);
 
 		// one or more fd(s) are readable, need to determine which ones they are
-		for (u32 idx = 0; idx < cerver->max_on_hold_connections; idx++) {
-			if (cerver->hold_fds[idx].fd > -1) {
-				if (cerver->hold_fds[idx].fd != -1) {
-					CerverReceive *cr = cerver_receive_create (RECEIVE_TYPE_ON_HOLD, cerver, cerver->hold_fds[idx].fd);
-					if (cr) {
-						on_hold_poll_handle_actual (cerver, idx, cr);
-					}
+		// only the first n_fds slots are used, released ones have a -1 fd
+		PollFds *hold_poll_fds = cerver->hold_poll_fds;
+		for (u32 idx = 0; idx < hold_poll_fds->n_fds; idx++) {
+			if ((hold_poll_fds->fds[idx].fd > -1) && hold_poll_fds->fds[idx].revents) {
+				CerverReceive *cr = cerver_receive_create (RECEIVE_TYPE_ON_HOLD, cerver, hold_poll_fds->fds[idx].fd);
+				if (cr) {
+					on_hold_poll_handle_actual (cerver, idx, cr);
 				}
 			}
 		}
 
 		// pthread_mutex_unlock (cerver->on_hold_poll_lock);
+
+		// fill the slots that were released by dropped or authenticated connections
+		pthread_mutex_lock (cerver->on_hold_poll_lock);
+		poll_fds_compact (hold_poll_fds);
+		pthread_mutex_unlock (cerver->on_hold_poll_lock);
 	}
 
 }
@@ -1155,10 +1159,8 @@ void *on_hold_poll (void *cerver_ptr) {
 		);
 
 		char *thread_name = c_string_create ("%s-on-hold", cerver->info->name->str);
-		if (thread_name) {
-			thread_set_name (thread_name);
-			free (thread_name);
-		}
+		cerver_thread_setup (cerver, CERVER_THREAD_ROLE_ON_HOLD, thread_name);
+		if (thread_name) free (thread_name);
 
 		#ifdef AUTH_DEBUG
 		cerver_log (LOG_TYPE_DEBUG, LOG_TYPE_CERVER, "Waiting for connections to put on hold...");
@@ -1166,7 +1168,7 @@ void *on_hold_poll (void *cerver_ptr) {
 
 		int poll_retval = 0;
 		while (cerver->isRunning) {
-			poll_retval = poll (cerver->hold_fds, cerver->max_on_hold_connections, cerver->on_hold_poll_timeout);
+			poll_retval = poll (cerver->hold_poll_fds->fds, cerver->hold_poll_fds->n_fds, cerver->on_hold_poll_timeout);
 
 			switch (poll_retval) {
 				case -1: {
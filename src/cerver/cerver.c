@@ -6,6 +6,7 @@
 #include <pthread.h>
 
 #include <poll.h>
+#include <sys/epoll.h>
 #include <errno.h>
 
 #include "cerver/types/types.h"
@@ -26,6 +27,10 @@
 #include "cerver/handler.h"
 #include "cerver/network.h"
 #include "cerver/packets.h"
+#include "cerver/pollfds.h"
+#include "cerver/reactor.h"
+#include "cerver/udp.h"
+#include "cerver/uring.h"
 
 #include "cerver/threads/thread.h"
 #include "cerver/threads/thpool.h"
@@ -51,6 +56,8 @@ void cerver_init (void) {
 // should be called only once at the very end of the program
 void cerver_end (void) {
 
+	packets_cache_clear ();
+
 	cerver_log_end ();
 
 }
@@ -95,6 +102,30 @@ const char *cerver_handler_type_description (CerverHandlerType type) {
 	
 }
 
+const char *cerver_thread_role_to_string (CerverThreadRole role) {
+
+	switch (role) {
+		#define XX(num, name, string, description) case CERVER_THREAD_ROLE_##name: return #string;
+		CERVER_THREAD_ROLE_MAP(XX)
+		#undef XX
+	}
+
+	return cerver_thread_role_to_string (CERVER_THREAD_ROLE_THPOOL);
+
+}
+
+const char *cerver_thread_role_description (CerverThreadRole role) {
+
+	switch (role) {
+		#define XX(num, name, string, description) case CERVER_THREAD_ROLE_##name: return #description;
+		CERVER_THREAD_ROLE_MAP(XX)
+		#undef XX
+	}
+
+	return cerver_thread_role_description (CERVER_THREAD_ROLE_THPOOL);
+
+}
+
 #pragma endregion
 
 #pragma region info
@@ -216,13 +247,17 @@ void cerver_stats_print (Cerver *cerver, bool received, bool sent) {
 
 	if (cerver) {
 		if (cerver->stats) {
+			// add the stats that were updated by each reactor
+			CerverReactorStats reactors_stats = { 0 };
+			cerver_reactors_stats_get (cerver, &reactors_stats);
+
 			cerver_log_msg ("\nCerver's %s stats:\n", cerver->info->name->str);
 			cerver_log_msg ("Threshold time:                %ld\n", cerver->stats->threshold_time);
 
 			if (cerver->auth_required) {
 				cerver_log_msg ("Client packets received:       %ld", cerver->stats->client_n_packets_received);
-				cerver_log_msg ("Client receives done:          %ld", cerver->stats->client_receives_done);
-				cerver_log_msg ("Client bytes received:         %ld\n", cerver->stats->client_bytes_received);
+				cerver_log_msg ("Client receives done:          %ld", cerver->stats->client_receives_done + reactors_stats.client_receives_done);
+				cerver_log_msg ("Client bytes received:         %ld\n", cerver->stats->client_bytes_received + reactors_stats.client_bytes_received);
 
 				cerver_log_msg ("On hold packets received:      %ld", cerver->stats->on_hold_n_packets_received);
 				cerver_log_msg ("On hold receives done:         %ld", cerver->stats->on_hold_receives_done);
@@ -230,13 +265,13 @@ void cerver_stats_print (Cerver *cerver, bool received, bool sent) {
 			}
 
 			cerver_log_msg ("Total packets received:        %ld", cerver->stats->total_n_packets_received);
-			cerver_log_msg ("Total receives done:           %ld", cerver->stats->total_n_receives_done);
-			cerver_log_msg ("Total bytes received:          %ld\n", cerver->stats->total_bytes_received);
+			cerver_log_msg ("Total receives done:           %ld", cerver->stats->total_n_receives_done + reactors_stats.total_n_receives_done);
+			cerver_log_msg ("Total bytes received:          %ld\n", cerver->stats->total_bytes_received + reactors_stats.total_bytes_received);
 
 			cerver_log_msg ("N packets sent:                %ld", cerver->stats->n_packets_sent);
 			cerver_log_msg ("Total bytes sent:              %ld\n", cerver->stats->total_bytes_sent);
 
-			cerver_log_msg ("Current active client connections:         %ld", cerver->stats->current_active_client_connections);
+			cerver_log_msg ("Current active client connections:         %ld", cerver->stats->current_active_client_connections + reactors_stats.current_active_client_connections);
 			cerver_log_msg ("Current connected clients:                 %ld", cerver->stats->current_n_connected_clients);
 			cerver_log_msg ("Current on hold connections:               %ld", cerver->stats->current_n_hold_connections);
 			cerver_log_msg ("Total on hold connections:                 %ld", cerver->stats->total_on_hold_connections);
@@ -244,6 +279,20 @@ void cerver_stats_print (Cerver *cerver, bool received, bool sent) {
 			cerver_log_msg ("Unique clients:                            %ld", cerver->stats->unique_clients);
 			cerver_log_msg ("Total client connections:                  %ld", cerver->stats->total_client_connections);
 
+			if (cerver->reactors) {
+				cerver_log_msg ("\nReactors:                                  %d", cerver->n_reactors);
+				for (u16 idx = 0; idx < cerver->n_reactors; idx++) {
+					cerver_log_msg (
+						"Reactor %d - accepted: %ld - active connections: %ld - receives done: %ld - bytes received: %ld",
+						idx,
+						cerver->reactors[idx]->stats->n_accepted,
+						cerver->reactors[idx]->stats->current_active_client_connections,
+						cerver->reactors[idx]->stats->total_n_receives_done,
+						cerver->reactors[idx]->stats->total_bytes_received
+					);
+				}
+			}
+
 			if (received) {
 				cerver_log_msg ("\nReceived packets:");
 				packets_per_type_print (cerver->stats->received_packets);
@@ -290,7 +339,21 @@ Cerver *cerver_new (void) {
 		c->protocol = PROTOCOL_TCP;         // default protocol
 		c->use_ipv6 = false;
 		c->connection_queue = DEFAULT_CONNECTION_QUEUE;
+		c->max_accepts = DEFAULT_MAX_ACCEPTS;
 		c->receive_buffer_size = RECEIVE_PACKET_BUFFER_SIZE;
+		c->receive_budget = DEFAULT_RECEIVE_BUDGET;
+
+		c->outbound_queues = false;
+		c->outbound_low_watermark = DEFAULT_OUTBOUND_LOW_WATERMARK;
+		c->outbound_high_watermark = DEFAULT_OUTBOUND_HIGH_WATERMARK;
+		c->outbound_policy = DEFAULT_OUTBOUND_POLICY;
+		c->coalesce_sends = false;
+		c->zero_copy_sends = false;
+		c->zero_copy_send_threshold = DEFAULT_ZERO_COPY_SEND_THRESHOLD;
+		c->header_v2 = false;
+		c->packet_checksums = false;
+		c->compressor = NULL;
+		c->compression_threshold = PACKET_COMPRESSION_THRESHOLD;
 
 		c->isRunning = false;
 		c->blocking = true;
@@ -300,6 +363,9 @@ Cerver *cerver_new (void) {
 
 		c->n_thpool_threads = 0;
 		c->thpool = NULL;
+		c->ordered_dispatch = false;
+
+		(void) memset (c->thread_affinities, 0, sizeof (c->thread_affinities));
 
 		c->sockets_pool_init = DEFAULT_SOCKETS_INIT;
 		c->sockets_pool = NULL;
@@ -313,10 +379,25 @@ Cerver *cerver_new (void) {
 
 		c->handle_detachable_threads = false;
 
-		c->fds = NULL;
+		c->poll_fds = NULL;
 		c->poll_timeout = DEFAULT_POLL_TIMEOUT;
 		c->poll_lock = NULL;
 
+		c->epoll_fd = -1;
+		c->epoll_events = NULL;
+		c->epoll_max_events = DEFAULT_EPOLL_MAX_EVENTS;
+
+		c->uring = NULL;
+
+		c->n_reactors = 0;
+		c->reactors = NULL;
+		c->reactors_sock_fds = NULL;
+		c->n_reactors_sock_fds = 0;
+
+		c->udp = NULL;
+		c->udp_max_peers = DEFAULT_UDP_MAX_PEERS;
+		c->udp_peer_timeout = DEFAULT_UDP_PEER_TIMEOUT;
+
 		c->auth_required = false;
 		c->auth_packet = NULL;
 		c->max_auth_tries = DEFAULT_AUTH_TRIES;
@@ -324,7 +405,7 @@ Cerver *cerver_new (void) {
 
 		c->on_hold_connections = NULL;
 		c->on_hold_connection_sock_fd_map = NULL;
-		c->hold_fds = NULL;
+		c->hold_poll_fds = NULL;
 		c->on_hold_poll_timeout = DEFAULT_POLL_TIMEOUT;
 		c->on_hold_poll_lock = NULL;
 		c->on_hold_max_bad_packets = DEFAULT_ON_HOLD_MAX_BAD_PACKETS;
@@ -347,6 +428,8 @@ Cerver *cerver_new (void) {
 		c->handlers_lock = NULL;
 
 		c->check_packets = false;
+		c->zero_copy_packets = false;
+		c->max_packet_size = DEFAULT_MAX_PACKET_SIZE;
 
 		c->update = NULL;
 		c->update_args = NULL;
@@ -389,7 +472,7 @@ void cerver_delete (void *ptr) {
 		if (cerver->clients) avl_delete (cerver->clients);
 		if (cerver->client_sock_fd_map) htab_destroy (cerver->client_sock_fd_map);
 
-		if (cerver->fds) free (cerver->fds);
+		poll_fds_delete (cerver->poll_fds);
 
 		// 28/05/2020
 		if (cerver->poll_lock) {
@@ -397,11 +480,20 @@ void cerver_delete (void *ptr) {
 			free (cerver->poll_lock);
 		}
 
+		if (cerver->epoll_fd > -1) close (cerver->epoll_fd);
+		if (cerver->epoll_events) free (cerver->epoll_events);
+
+		cerver_uring_delete (cerver->uring);
+
+		cerver_reactors_delete (cerver);
+
+		cerver_udp_delete (cerver->udp);
+
 		packet_delete (cerver->auth_packet);
 
 		if (cerver->on_hold_connections) avl_delete (cerver->on_hold_connections);
 		if (cerver->on_hold_connection_sock_fd_map) htab_destroy (cerver->on_hold_connection_sock_fd_map);
-		if (cerver->hold_fds) free (cerver->hold_fds);
+		poll_fds_delete (cerver->hold_poll_fds);
 
 		if (cerver->on_hold_poll_lock) {
 			pthread_mutex_destroy (cerver->on_hold_poll_lock);
@@ -466,6 +558,15 @@ void cerver_set_connection_queue (Cerver *cerver, const u16 connection_queue) {
 
 }
 
+// sets the max n of pending connections that will be accepted every time the cerver's socket is ready
+// the rest will be accepted in the next wakeup, so a flood of new connections can't starve receives
+// only used with CERVER_HANDLER_TYPE_POLL, CERVER_HANDLER_TYPE_EPOLL & CERVER_HANDLER_TYPE_REACTORS
+void cerver_set_max_accepts (Cerver *cerver, const u32 max_accepts) {
+
+	if (cerver && max_accepts) cerver->max_accepts = max_accepts;
+
+}
+
 // sets the cerver's receive buffer size used in recv method
 void cerver_set_receive_buffer_size (Cerver *cerver, const u32 size) {
 
@@ -473,6 +574,132 @@ void cerver_set_receive_buffer_size (Cerver *cerver, const u32 size) {
 
 }
 
+// sets the max n of reads from a connection's socket every time it is ready
+// the connection is read until there is no more data or the budget is reached,
+// so a single busy connection can't starve the others
+// not used with CERVER_HANDLER_TYPE_THREADS & CERVER_HANDLER_TYPE_URING
+void cerver_set_receive_budget (Cerver *cerver, const u32 receive_budget) {
+
+	if (cerver && receive_budget) cerver->receive_budget = receive_budget;
+
+}
+
+// set whether every connection will have its own outbound queue
+// packets are sent without blocking & what can't be sent right away is queued
+// and flushed by the cerver when the connection's socket becomes writable again,
+// so a slow reader can't stall the thread that is sending to it
+// only used with CERVER_HANDLER_TYPE_EPOLL & CERVER_HANDLER_TYPE_REACTORS,
+// CERVER_HANDLER_TYPE_URING connections always queue their packets to send them with the
+// cerver's io_uring, but the watermarks & the outbound policy are only applied if this is turned on
+// CERVER_HANDLER_TYPE_POLL & CERVER_HANDLER_TYPE_THREADS connections use blocking sockets
+// that are not watched for writes, so this option is ignored & their sends block instead
+// by default, this option is turned off
+void cerver_set_outbound_queues (Cerver *cerver, bool outbound_queues) {
+
+	if (cerver) cerver->outbound_queues = outbound_queues;
+
+}
+
+// sets the outbound queues watermarks, when a queue reaches the high watermark
+// the cerver's outbound policy is applied, if its reads were paused,
+// they are resumed when the queue drains to the low watermark
+// ignored with CERVER_HANDLER_TYPE_POLL & CERVER_HANDLER_TYPE_THREADS as they have no outbound queues
+// the default values are DEFAULT_OUTBOUND_LOW_WATERMARK & DEFAULT_OUTBOUND_HIGH_WATERMARK
+void cerver_set_outbound_watermarks (
+	Cerver *cerver, const size_t low_watermark, const size_t high_watermark
+) {
+
+	if (cerver && (low_watermark < high_watermark)) {
+		cerver->outbound_low_watermark = low_watermark;
+		cerver->outbound_high_watermark = high_watermark;
+	}
+
+}
+
+// sets what to do with a connection whose outbound queue reached the high watermark
+// ignored with CERVER_HANDLER_TYPE_POLL & CERVER_HANDLER_TYPE_THREADS as they have no outbound queues
+// the default value is DEFAULT_OUTBOUND_POLICY
+void cerver_set_outbound_policy (Cerver *cerver, OutboundPolicy policy) {
+
+	if (cerver) cerver->outbound_policy = policy;
+
+}
+
+// set whether the packets that are sent to a connection while its received buffer is being handled
+// are coalesced & sent together with a single call once all the received packets have been handled,
+// useful when handlers reply with many small packets, only packets sent by direct handlers
+// & by the cerver itself are coalesced, use connection_cork () to coalesce other sends
+// by default, this option is turned off
+void cerver_set_coalesce_sends (Cerver *cerver, bool coalesce_sends) {
+
+	if (cerver) cerver->coalesce_sends = coalesce_sends;
+
+}
+
+// set whether the packets that are at least the zero copy threshold in size are sent with MSG_ZEROCOPY,
+// the kernel sends them directly from the packet's buffers instead of copying them,
+// so the buffers are held until the kernel reports that it is done with them
+// only used with tcp connections & if the kernel supports it
+// by default, this option is turned off
+void cerver_set_zero_copy_sends (Cerver *cerver, bool zero_copy_sends) {
+
+	if (cerver) cerver->zero_copy_sends = zero_copy_sends;
+
+}
+
+// sets the min size in bytes of the sends that are done with MSG_ZEROCOPY
+// the default value is DEFAULT_ZERO_COPY_SEND_THRESHOLD
+void cerver_set_zero_copy_send_threshold (Cerver *cerver, const size_t threshold) {
+
+	if (cerver && threshold) cerver->zero_copy_send_threshold = threshold;
+
+}
+
+// set whether the cerver offers the v2 packet header in its info packet,
+// clients that support it ask to use it & both ends switch to it in the middle of the stream,
+// clients that don't keep using the v1 header
+// only used with tcp connections
+// by default, this option is turned off
+void cerver_set_header_v2 (Cerver *cerver, bool header_v2) {
+
+	if (cerver) cerver->header_v2 = header_v2;
+
+}
+
+// set whether the cerver offers to follow every v2 header with the crc32c of its packet's data,
+// so packets that are corrupted on their way are dropped when they are received
+// the connections that ask for them switch right after agreeing to use the v2 header
+// it implies the v2 header, by default, this option is turned off
+void cerver_set_packet_checksums (Cerver *cerver, bool packet_checksums) {
+
+	if (cerver) {
+		cerver->packet_checksums = packet_checksums;
+		if (packet_checksums) cerver->header_v2 = true;
+	}
+
+}
+
+// sets the compressor that the cerver offers for the data of the packets in its connections,
+// the clients that have the same one ask to use it after agreeing to use the v2 header
+// & then both ends compress the data that reaches the compression threshold
+// it implies the v2 header, by default, there is no compression
+void cerver_set_compression (Cerver *cerver, const PacketCompressor *compressor) {
+
+	if (cerver) {
+		cerver->compressor = compressor;
+		if (compressor) cerver->header_v2 = true;
+	}
+
+}
+
+// sets the min data size that is compressed
+// the default is PACKET_COMPRESSION_THRESHOLD
+void cerver_set_compression_threshold (Cerver *cerver, const size_t threshold) {
+
+	if (cerver) cerver->compression_threshold = threshold;
+
+}
+
 // sets the cerver's data and a way to free it
 void cerver_set_cerver_data (Cerver *cerver, void *data, Action delete_data) {
 
@@ -495,6 +722,91 @@ void cerver_set_thpool_n_threads (Cerver *cerver, u16 n_threads) {
 
 }
 
+// set whether the buffers that are received from a connection are handled by the thpool in order,
+// one after the other, instead of by any free thread that has to wait for the socket's read mutex,
+// the buffers of different connections are still handled at the same time
+// only used if the cerver has a thpool
+// by default, this option is turned off
+void cerver_set_ordered_dispatch (Cerver *cerver, bool ordered_dispatch) {
+
+	if (cerver) cerver->ordered_dispatch = ordered_dispatch;
+
+}
+
+// sets the cpus that the cerver's threads with the role can run on,
+// an empty set lets them run on the ones they inherited, which is the default
+// must be called before the cerver is started
+void cerver_set_thread_affinity (
+	Cerver *cerver, CerverThreadRole role, const ThreadCpuSet *cpus
+) {
+
+	if (cerver && (role < CERVER_THREAD_ROLE_COUNT) && cpus) {
+		cerver->thread_affinities[role].cpus = *cpus;
+	}
+
+}
+
+// sets the cerver's threads with the role to run on the cpus of the numa node
+// must be called before the cerver is started
+// returns 0 on success, 1 on error
+u8 cerver_set_thread_affinity_numa_node (
+	Cerver *cerver, CerverThreadRole role, unsigned int node
+) {
+
+	u8 retval = 1;
+
+	if (cerver && (role < CERVER_THREAD_ROLE_COUNT)) {
+		ThreadCpuSet cpus;
+		if (!thread_cpu_set_numa_node (&cpus, node)) {
+			cerver->thread_affinities[role].cpus = cpus;
+			retval = 0;
+		}
+
+		else {
+			cerver_log_error (
+				"Failed to get the cpus of numa node %u for cerver %s %s threads!",
+				node, cerver->info->name->str, cerver_thread_role_to_string (role)
+			);
+		}
+	}
+
+	return retval;
+
+}
+
+// set whether the memory that the cerver's threads with the role allocate comes from their numa node,
+// the buffers that belong to a single thread, like a thpool thread's deque or a reactor's events,
+// are then allocated from inside the thread after it has been placed
+// must be called before the cerver is started
+// by default, this option is turned off
+void cerver_set_numa_local_buffers (
+	Cerver *cerver, CerverThreadRole role, bool numa_local
+) {
+
+	if (cerver && (role < CERVER_THREAD_ROLE_COUNT)) {
+		cerver->thread_affinities[role].numa_local = numa_local;
+	}
+
+}
+
+// names the calling thread & places it using the affinity of its role
+void cerver_thread_setup (
+	const Cerver *cerver, CerverThreadRole role, const char *name
+) {
+
+	if (cerver && (role < CERVER_THREAD_ROLE_COUNT)) {
+		if (name) (void) thread_set_name (name);
+
+		if (thread_set_affinity (&cerver->thread_affinities[role])) {
+			cerver_log_warning (
+				"Failed to set the affinity of cerver %s %s thread!",
+				cerver->info->name->str, cerver_thread_role_to_string (role)
+			);
+		}
+	}
+
+}
+
 // sets the initial number of sockets to be created in the cerver's sockets pool
 // the defauult value is 10
 void cerver_set_sockets_pool_init (Cerver *cerver, unsigned int n_sockets) {
@@ -544,6 +856,44 @@ void cerver_set_poll_time_out (Cerver *cerver, const u32 poll_timeout) {
 
 }
 
+// sets the max number of ready events that will be handled in every epoll_wait ()
+// only has effect if cerver handler type is CERVER_HANDLER_TYPE_EPOLL or CERVER_HANDLER_TYPE_REACTORS
+// the default value is DEFAULT_EPOLL_MAX_EVENTS
+void cerver_set_epoll_max_events (Cerver *cerver, const u32 max_events) {
+
+	if (cerver && max_events) cerver->epoll_max_events = max_events;
+
+}
+
+// sets the number of reactors to use if cerver handler type is CERVER_HANDLER_TYPE_REACTORS
+// each reactor has its own listening socket bound with SO_REUSEPORT to the cerver's port
+// and handles the connections that it accepts in its own thread
+// the default value (0) is to use one reactor for each online cpu
+void cerver_set_reactors (Cerver *cerver, const u16 n_reactors) {
+
+	if (cerver) cerver->n_reactors = n_reactors;
+
+}
+
+// sets the max n of udp peers that can be registered at the same time,
+// datagrams from new peers are ignored while the limit is reached
+// only has effect if the cerver protocol is PROTOCOL_UDP
+// 0 to disable the limit, the default value is DEFAULT_UDP_MAX_PEERS
+void cerver_set_udp_max_peers (Cerver *cerver, const u32 max_peers) {
+
+	if (cerver) cerver->udp_max_peers = max_peers;
+
+}
+
+// sets the secs after which a udp peer that has not sent any datagram is dropped
+// only has effect if the cerver protocol is PROTOCOL_UDP
+// 0 to never drop idle peers, the default value is DEFAULT_UDP_PEER_TIMEOUT
+void cerver_set_udp_peer_timeout (Cerver *cerver, const u32 peer_timeout) {
+
+	if (cerver) cerver->udp_peer_timeout = peer_timeout;
+
+}
+
 // enables cerver's built in authentication methods
 // cerver requires client authentication upon new client connections
 // retuns 0 on success, 1 on error
@@ -728,6 +1078,28 @@ void cerver_set_check_packets (Cerver *cerver, bool check_packets) {
 
 }
 
+// set whether received packets should reference the received buffer
+// instead of copying their header & data into their own allocated memory
+// the buffer is deleted when the last packet that references it gets deleted,
+// so packets that are kept by the application also keep the whole buffer alive
+// packets data can NOT be appended and this option is ignored with CERVER_HANDLER_TYPE_THREADS
+// by default, this option is turned off
+void cerver_set_zero_copy_packets (Cerver *cerver, bool zero_copy_packets) {
+
+	if (cerver) cerver->zero_copy_packets = zero_copy_packets;
+
+}
+
+// sets the max size (header included) of the packets that the cerver can receive,
+// the space for a packet is allocated using the size in its header before its data arrives,
+// so a header that claims a bigger size is counted as a bad packet & its connection is dropped
+// 0 to disable the limit, the default value is DEFAULT_MAX_PACKET_SIZE
+void cerver_set_max_packet_size (Cerver *cerver, size_t max_packet_size) {
+
+	if (cerver) cerver->max_packet_size = max_packet_size;
+
+}
+
 // sets a custom cerver update function to be executed every n ticks
 // a new thread will be created that will call your method each tick
 // the update args will be passed to your method as a CerverUpdate &
@@ -956,7 +1328,7 @@ static u8 cerver_multiple_app_handlers_destroy (Cerver *cerver) {
 			time (&start);
 			while (time_passed < timeout && cerver->num_handlers_alive) {
 				for (unsigned int i = 0; i < cerver->n_handlers; i++) {
-					bsem_post_all (cerver->handlers[i]->job_queue->has_jobs);
+					job_queue_wake_all (cerver->handlers[i]->job_queue);
 					time (&end);
 					time_passed = difftime (end, start);
 				}
@@ -965,7 +1337,7 @@ static u8 cerver_multiple_app_handlers_destroy (Cerver *cerver) {
 			// poll remaining handlers
 			while (cerver->num_handlers_alive) {
 				for (unsigned int i = 0; i < cerver->n_handlers; i++) {
-					bsem_post_all (cerver->handlers[i]->job_queue->has_jobs);
+					job_queue_wake_all (cerver->handlers[i]->job_queue);
 					sleep (1);
 				}
 			}
@@ -1007,7 +1379,7 @@ static u8 cerver_app_handlers_destroy (Cerver *cerver) {
 			if (cerver->app_packet_handler) {
 				if (!cerver->app_packet_handler->direct_handle) {
 					// stop app handler
-					bsem_post_all (cerver->app_packet_handler->job_queue->has_jobs);
+					job_queue_wake_all (cerver->app_packet_handler->job_queue);
 				}
 			}
 		}
@@ -1025,7 +1397,7 @@ static u8 cerver_app_error_handler_destroy (Cerver *cerver) {
 		if (cerver->app_error_packet_handler) {
 			if (!cerver->app_error_packet_handler->direct_handle) {
 				// stop app error handler
-				bsem_post_all (cerver->app_error_packet_handler->job_queue->has_jobs);
+				job_queue_wake_all (cerver->app_error_packet_handler->job_queue);
 			}
 		}
 	}
@@ -1042,7 +1414,7 @@ static u8 cerver_custom_handler_destroy (Cerver *cerver) {
 		if (cerver->custom_packet_handler) {
 			if (!cerver->custom_packet_handler->direct_handle) {
 				// stop custom handler
-				bsem_post_all (cerver->custom_packet_handler->job_queue->has_jobs);
+				job_queue_wake_all (cerver->custom_packet_handler->job_queue);
 			}
 		}
 	}
@@ -1074,13 +1446,13 @@ static u8 cerver_handlers_destroy (Cerver *cerver) {
 		// poll remaining handlers
 		while (cerver->num_handlers_alive) {
 			if (cerver->app_packet_handler)
-				bsem_post_all (cerver->app_packet_handler->job_queue->has_jobs);
+				job_queue_wake_all (cerver->app_packet_handler->job_queue);
 
 			if (cerver->app_error_packet_handler)
-				bsem_post_all (cerver->app_error_packet_handler->job_queue->has_jobs);
+				job_queue_wake_all (cerver->app_error_packet_handler->job_queue);
 
 			if (cerver->custom_packet_handler)
-				bsem_post_all (cerver->custom_packet_handler->job_queue->has_jobs);
+				job_queue_wake_all (cerver->custom_packet_handler->job_queue);
 
 			sleep (1);
 		}
@@ -1206,7 +1578,10 @@ static u8 cerver_network_init_block_socket (Cerver *cerver) {
 	switch (cerver->handler_type) {
 		case CERVER_HANDLER_TYPE_NONE: break;
 
-		case CERVER_HANDLER_TYPE_POLL: {
+		case CERVER_HANDLER_TYPE_POLL:
+		case CERVER_HANDLER_TYPE_EPOLL:
+		case CERVER_HANDLER_TYPE_URING:
+		case CERVER_HANDLER_TYPE_REACTORS: {
 			// set the socket to non blocking mode
 			if (sock_set_blocking (cerver->sock, cerver->blocking)) {
 				cerver->blocking = false;
@@ -1241,6 +1616,31 @@ static u8 cerver_network_init_block_socket (Cerver *cerver) {
 
 }
 
+// every reactor binds its own socket to the cerver's port
+// so the kernel can balance new connections between them
+static u8 cerver_network_init_reuse_port (Cerver *cerver) {
+
+	u8 retval = 0;
+
+	if (cerver->handler_type == CERVER_HANDLER_TYPE_REACTORS) {
+		int reuse = 1;
+		if (setsockopt (cerver->sock, SOL_SOCKET, SO_REUSEPORT, &reuse, sizeof (int))) {
+			cerver_log (
+				LOG_TYPE_ERROR, LOG_TYPE_CERVER,
+				"Failed to set SO_REUSEPORT in cerver %s socket!",
+				cerver->info->name->str
+			);
+
+			close (cerver->sock);
+
+			retval = 1;     // error
+		}
+	}
+
+	return retval;
+
+}
+
 // inits the cerver networking capabilities
 static u8 cerver_network_init (Cerver *cerver) {
 
@@ -1271,7 +1671,9 @@ static u8 cerver_network_init (Cerver *cerver) {
 			#endif
 
 			if (!cerver_network_init_block_socket (cerver)) {
-				retval = cerver_network_init_address (cerver);
+				if (!cerver_network_init_reuse_port (cerver)) {
+					retval = cerver_network_init_address (cerver);
+				}
 			}
 		}
 
@@ -1291,13 +1693,8 @@ static u8 cerver_init_poll_fds (Cerver *cerver) {
 
 	u8 retval = 1;
 
-	cerver->fds = (struct pollfd *) calloc (poll_n_fds, sizeof (struct pollfd));
-	if (cerver->fds) {
-		memset (cerver->fds, 0, sizeof (struct pollfd) * poll_n_fds);
-		// set all fds as available spaces
-		for (u32 i = 0; i < poll_n_fds; i++) cerver->fds[i].fd = -1;
-
-		cerver->max_n_fds = poll_n_fds;
+	cerver->poll_fds = poll_fds_create (poll_n_fds);
+	if (cerver->poll_fds) {
 		cerver->current_n_fds = 0;
 
 		retval = 0;     // success!!
@@ -1316,6 +1713,87 @@ static u8 cerver_init_poll_fds (Cerver *cerver) {
 
 }
 
+static u8 cerver_init_epoll (Cerver *cerver) {
+
+	u8 retval = 1;
+
+	cerver->epoll_fd = epoll_create1 (EPOLL_CLOEXEC);
+	if (cerver->epoll_fd > -1) {
+		cerver->epoll_events = (struct epoll_event *) calloc (cerver->epoll_max_events, sizeof (struct epoll_event));
+		if (cerver->epoll_events) {
+			cerver->current_n_fds = 0;
+
+			retval = 0;     // success!!
+		}
+
+		else {
+			#ifdef CERVER_DEBUG
+			cerver_log (
+				LOG_TYPE_ERROR, LOG_TYPE_CERVER,
+				"Failed to allocate cerver %s epoll events!", cerver->info->name->str
+			);
+			#endif
+
+			close (cerver->epoll_fd);
+			cerver->epoll_fd = -1;
+		}
+	}
+
+	else {
+		cerver_log (
+			LOG_TYPE_ERROR, LOG_TYPE_CERVER,
+			"Failed to create cerver %s epoll instance!", cerver->info->name->str
+		);
+
+		perror ("Error");
+	}
+
+	return retval;
+
+}
+
+// sets up the cerver's io_uring, if the kernel does not support it,
+// the cerver handler type will be changed to CERVER_HANDLER_TYPE_EPOLL
+static u8 cerver_init_uring (Cerver *cerver) {
+
+	u8 retval = 1;
+
+	cerver->uring = cerver_uring_create (
+		CERVER_URING_DEFAULT_ENTRIES,
+		CERVER_URING_DEFAULT_BUFFERS, cerver->receive_buffer_size
+	);
+
+	if (cerver->uring) {
+		cerver->current_n_fds = 0;
+
+		retval = 0;     // success!!
+	}
+
+	else {
+		cerver_log (
+			LOG_TYPE_WARNING, LOG_TYPE_CERVER,
+			"Cerver %s failed to set up io_uring - falling back to epoll...",
+			cerver->info->name->str
+		);
+
+		cerver->handler_type = CERVER_HANDLER_TYPE_EPOLL;
+
+		retval = cerver_init_epoll (cerver);
+	}
+
+	return retval;
+
+}
+
+// sets up the batches & the peers map for the cerver's udp socket
+static u8 cerver_init_udp (Cerver *cerver) {
+
+	cerver->udp = cerver_udp_create (cerver);
+
+	return cerver->udp ? 0 : 1;
+
+}
+
 static u8 cerver_init_data_structures (Cerver *cerver) {
 
 	u8 retval = 1;
@@ -1331,18 +1809,40 @@ static u8 cerver_init_data_structures (Cerver *cerver) {
 			if (cerver->client_sock_fd_map) {
 				u8 errors = 0;
 
+				// every udp peer is received from the cerver's socket
+				if (cerver->protocol == PROTOCOL_UDP) {
+					errors |= cerver_init_udp (cerver);
+				}
+
 				// init cerver handler type based values
-				switch (cerver->handler_type) {
-					case CERVER_HANDLER_TYPE_NONE: break;
+				else {
+					switch (cerver->handler_type) {
+						case CERVER_HANDLER_TYPE_NONE: break;
 
-					case CERVER_HANDLER_TYPE_POLL: {
-						// initialize main pollfd structures
-						errors |= cerver_init_poll_fds (cerver);
-					} break;
+						case CERVER_HANDLER_TYPE_POLL: {
+							// initialize main pollfd structures
+							errors |= cerver_init_poll_fds (cerver);
+						} break;
+
+						case CERVER_HANDLER_TYPE_THREADS: break;
+
+						case CERVER_HANDLER_TYPE_EPOLL: {
+							// create the epoll instance & its ready events array
+							errors |= cerver_init_epoll (cerver);
+						} break;
 
-					case CERVER_HANDLER_TYPE_THREADS: break;
+						case CERVER_HANDLER_TYPE_URING: {
+							// set up the ring or fall back to epoll
+							errors |= cerver_init_uring (cerver);
+						} break;
 
-					default: break;
+						case CERVER_HANDLER_TYPE_REACTORS: {
+							// create the reactors with their own sockets, epoll & client maps
+							errors |= cerver_reactors_create (cerver);
+						} break;
+
+						default: break;
+					}
 				}
 
 				retval = errors;
@@ -1437,6 +1937,7 @@ static u8 cerver_one_time_init_thpool (Cerver *cerver) {
 
 			cerver->thpool = thpool_create (cerver->n_thpool_threads);
 			thpool_set_name (cerver->thpool, cerver->info->name->str);
+			thpool_set_affinity (cerver->thpool, &cerver->thread_affinities[CERVER_THREAD_ROLE_THPOOL]);
 			if (thpool_init (cerver->thpool)) {
 				cerver_log (
 					LOG_TYPE_ERROR, LOG_TYPE_NONE,
@@ -1557,13 +2058,8 @@ static u8 cerver_auth_start (Cerver *cerver) {
 		cerver->on_hold_connections = avl_init (connection_comparator, connection_delete);
 		cerver->on_hold_connection_sock_fd_map = htab_create (cerver->max_on_hold_connections / 4, NULL, NULL);
 		if (cerver->on_hold_connections && cerver->on_hold_connection_sock_fd_map) {
-			cerver->hold_fds = (struct pollfd *) calloc (cerver->max_on_hold_connections, sizeof (struct pollfd));
-			if (cerver->hold_fds) {
-				memset (cerver->hold_fds, 0, sizeof (struct pollfd) * cerver->max_on_hold_connections);
-
-				for (u32 i = 0; i < cerver->max_on_hold_connections; i++)
-					cerver->hold_fds[i].fd = -1;
-
+			cerver->hold_poll_fds = poll_fds_create (cerver->max_on_hold_connections);
+			if (cerver->hold_poll_fds) {
 				cerver->current_on_hold_nfds = 0;
 
 				cerver->on_hold_poll_lock = (pthread_mutex_t *) malloc (sizeof (pthread_mutex_t));
@@ -1906,6 +2402,10 @@ static void *cerver_inactive_thread (void *args) {
 	if (args) {
 		Cerver *cerver = (Cerver *) args;
 
+		char thread_name[64] = { 0 };
+		(void) snprintf (thread_name, 64, "%s-inactive", cerver->info->name->str);
+		cerver_thread_setup (cerver, CERVER_THREAD_ROLE_UPDATE, thread_name);
+
 		u32 count = 0;
 		while (cerver->isRunning) {
 			if (count == cerver->check_inactive_interval) {
@@ -1985,8 +2485,7 @@ static u8 cerver_start_tcp (Cerver *cerver) {
 					time (&cerver->info->time_started);
 
 					// set up the initial listening socket
-					cerver->fds[cerver->current_n_fds].fd = cerver->sock;
-					cerver->fds[cerver->current_n_fds].events = POLLIN;
+					poll_fds_add (cerver->poll_fds, cerver->sock, POLLIN);
 					cerver->current_n_fds++;
 
 					cerver_event_trigger (
@@ -2053,6 +2552,125 @@ static u8 cerver_start_tcp (Cerver *cerver) {
 			}
 		} break;
 
+		case CERVER_HANDLER_TYPE_EPOLL: {
+			if (!cerver->blocking) {
+				if (!listen (cerver->sock, cerver->connection_queue)) {
+					// register the cerver start time
+					time (&cerver->info->time_started);
+
+					// set up the initial listening socket
+					if (!cerver_epoll_register_sock_fd (cerver, cerver->sock)) {
+						cerver_event_trigger (
+							CERVER_EVENT_STARTED,
+							cerver,
+							NULL, NULL
+						);
+
+						retval = cerver_epoll (cerver);
+					}
+
+					else {
+						cerver_log (
+							LOG_TYPE_ERROR, LOG_TYPE_CERVER,
+							"Failed to register cerver %s socket to epoll!",
+							cerver->info->name->str
+						);
+
+						close (cerver->sock);
+					}
+				}
+
+				else {
+					cerver_log (
+						LOG_TYPE_ERROR, LOG_TYPE_CERVER,
+						"Failed to listen in cerver %s socket!",
+						cerver->info->name->str
+					);
+
+					close (cerver->sock);
+				}
+			}
+
+			else {
+				cerver_log (
+					LOG_TYPE_ERROR, LOG_TYPE_CERVER,
+					"Can't start cerver %s in CERVER_HANDLER_TYPE_EPOLL - socket is NOT set to non blocking!",
+					cerver->info->name->str
+				);
+			}
+		} break;
+
+		case CERVER_HANDLER_TYPE_URING: {
+			if (!cerver->blocking) {
+				if (!listen (cerver->sock, cerver->connection_queue)) {
+					// register the cerver start time
+					time (&cerver->info->time_started);
+
+					cerver_event_trigger (
+						CERVER_EVENT_STARTED,
+						cerver,
+						NULL, NULL
+					);
+
+					retval = cerver_uring (cerver);
+				}
+
+				else {
+					cerver_log (
+						LOG_TYPE_ERROR, LOG_TYPE_CERVER,
+						"Failed to listen in cerver %s socket!",
+						cerver->info->name->str
+					);
+
+					close (cerver->sock);
+				}
+			}
+
+			else {
+				cerver_log (
+					LOG_TYPE_ERROR, LOG_TYPE_CERVER,
+					"Can't start cerver %s in CERVER_HANDLER_TYPE_URING - socket is NOT set to non blocking!",
+					cerver->info->name->str
+				);
+			}
+		} break;
+
+		case CERVER_HANDLER_TYPE_REACTORS: {
+			if (!cerver->blocking) {
+				// the other reactors sockets are already listening
+				if (!listen (cerver->sock, cerver->connection_queue)) {
+					// register the cerver start time
+					time (&cerver->info->time_started);
+
+					cerver_event_trigger (
+						CERVER_EVENT_STARTED,
+						cerver,
+						NULL, NULL
+					);
+
+					retval = cerver_reactors (cerver);
+				}
+
+				else {
+					cerver_log (
+						LOG_TYPE_ERROR, LOG_TYPE_CERVER,
+						"Failed to listen in cerver %s socket!",
+						cerver->info->name->str
+					);
+
+					close (cerver->sock);
+				}
+			}
+
+			else {
+				cerver_log (
+					LOG_TYPE_ERROR, LOG_TYPE_CERVER,
+					"Can't start cerver %s in CERVER_HANDLER_TYPE_REACTORS - socket is NOT set to non blocking!",
+					cerver->info->name->str
+				);
+			}
+		} break;
+
 		default: break;
 	}
 
@@ -2060,12 +2678,21 @@ static u8 cerver_start_tcp (Cerver *cerver) {
 
 }
 
-#pragma GCC diagnostic push
-#pragma GCC diagnostic ignored "-Wunused-function"
+// every peer is received from the cerver's socket, so it only needs to be bound
+static u8 cerver_start_udp (Cerver *cerver) {
 
-static void cerver_start_udp (Cerver *cerver) { /*** TODO: ***/ }
+	// register the cerver start time
+	time (&cerver->info->time_started);
 
-#pragma GCC diagnostic pop
+	cerver_event_trigger (
+		CERVER_EVENT_STARTED,
+		cerver,
+		NULL, NULL
+	);
+
+	return cerver_udp (cerver);
+
+}
 
 // tell the cerver to start listening for connections and packets
 // initializes cerver's structures like thpool (if any)
@@ -2131,11 +2758,7 @@ u8 cerver_start (Cerver *cerver) {
 					} break;
 
 					case PROTOCOL_UDP: {
-						// retval = cerver_start_udp (cerver);
-						cerver_log_warning (
-							"Cerver %s - udp server is not yet implemented!",
-							cerver->info->name->str
-						);
+						retval = cerver_start_udp (cerver);
 					} break;
 
 					default: {
@@ -2199,6 +2822,10 @@ static void cerver_update (void *args) {
 	if (args) {
 		Cerver *cerver = (Cerver *) args;
 
+		char thread_name[64] = { 0 };
+		(void) snprintf (thread_name, 64, "%s-update", cerver->info->name->str);
+		cerver_thread_setup (cerver, CERVER_THREAD_ROLE_UPDATE, thread_name);
+
 		#ifdef CERVER_DEBUG
 		cerver_log_success (
 			"Cerver's %s cerver_update () has started!",
@@ -2272,6 +2899,10 @@ static void cerver_update_interval (void *args) {
 	if (args) {
 		Cerver *cerver = (Cerver *) args;
 
+		char thread_name[64] = { 0 };
+		(void) snprintf (thread_name, 64, "%s-interval", cerver->info->name->str);
+		cerver_thread_setup (cerver, CERVER_THREAD_ROLE_UPDATE, thread_name);
+
 		#ifdef CERVER_DEBUG
 		cerver_log_success (
 			"Cerver's %s cerver_update_interval () has started!",
@@ -2351,10 +2982,8 @@ static void cerver_destroy_on_hold_connections (Cerver *cerver) {
 			avl_delete (cerver->on_hold_connections);
 			cerver->on_hold_connections = NULL;
 
-			if (cerver->hold_fds) {
-				free (cerver->hold_fds);
-				cerver->hold_fds = NULL;
-			}
+			poll_fds_delete (cerver->hold_poll_fds);
+			cerver->hold_poll_fds = NULL;
 		}
 	}
 
@@ -2364,6 +2993,9 @@ static void cerver_destroy_on_hold_connections (Cerver *cerver) {
 static void cerver_destroy_clients (Cerver *cerver) {
 
 	if (cerver) {
+		// reactors must not handle any connection while they are destroyed
+		cerver_reactors_stop (cerver);
+
 		if (cerver->stats->current_n_connected_clients > 0) {
 			// send a cerver teardown packet to all clients connected to cerver
 			Packet *packet = packet_generate_request (PACKET_TYPE_CERVER, CERVER_PACKET_TYPE_TEARDOWN, NULL, 0);
@@ -2381,10 +3013,26 @@ static void cerver_destroy_clients (Cerver *cerver) {
 		avl_delete (cerver->clients);
 		cerver->clients = NULL;
 
-		if (cerver->fds) {
-			free (cerver->fds);
-			cerver->fds = NULL;
+		poll_fds_delete (cerver->poll_fds);
+		cerver->poll_fds = NULL;
+
+		if (cerver->epoll_fd > -1) {
+			close (cerver->epoll_fd);
+			cerver->epoll_fd = -1;
 		}
+
+		if (cerver->epoll_events) {
+			free (cerver->epoll_events);
+			cerver->epoll_events = NULL;
+		}
+
+		cerver_uring_delete (cerver->uring);
+		cerver->uring = NULL;
+
+		cerver_reactors_delete (cerver);
+
+		cerver_udp_delete (cerver->udp);
+		cerver->udp = NULL;
 	}
 
 }
@@ -2753,6 +3401,12 @@ static SCerver *cerver_serliaze (Cerver *cerver) {
 				strncpy (scerver->welcome, cerver->info->welcome_msg->str, S_CERVER_WELCOME_LENGTH);
 
 			scerver->use_ipv6 = cerver->use_ipv6;
+			scerver->header_version = (cerver->header_v2 && (cerver->protocol == PROTOCOL_TCP)) ?
+				PACKET_HEADER_VERSION_V2 : PACKET_HEADER_VERSION_V1;
+			scerver->checksums = (scerver->header_version == PACKET_HEADER_VERSION_V2)
+				&& cerver->packet_checksums;
+			scerver->compressor = ((scerver->header_version == PACKET_HEADER_VERSION_V2) && cerver->compressor) ?
+				cerver->compressor->id : 0;
 			scerver->protocol = cerver->protocol;
 			scerver->port = cerver->port;
 
@@ -2783,6 +3437,10 @@ CerverReport *cerver_deserialize (SCerver *scerver) {
 
 			cerver_report->auth_required = scerver->auth_required;
 			cerver_report->uses_sessions = scerver->uses_sessions;
+			cerver_report->header_version = scerver->header_version ?
+				scerver->header_version : PACKET_HEADER_VERSION_V1;
+			cerver_report->checksums = scerver->checksums;
+			cerver_report->compressor = scerver->compressor;
 		}
 	}
 
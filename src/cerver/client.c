@@ -22,7 +22,9 @@
 #include "cerver/handler.h"
 #include "cerver/network.h"
 #include "cerver/packets.h"
+#include "cerver/reactor.h"
 #include "cerver/sessions.h"
+#include "cerver/socket.h"
 
 #include "cerver/threads/thread.h"
 
@@ -831,7 +833,7 @@ Client *client_remove_from_cerver (Cerver *cerver, Client *client) {
 			);
 			#endif
 
-			cerver->stats->current_n_connected_clients--;
+			(void) __atomic_sub_fetch (&cerver->stats->current_n_connected_clients, 1, __ATOMIC_RELAXED);
 			#ifdef CERVER_STATS
 			cerver_log (
 				LOG_TYPE_DEBUG, LOG_TYPE_CERVER,
@@ -867,8 +869,8 @@ static void client_register_to_cerver_internal (Cerver *cerver, Client *client)
 	);
 	#endif
 
-	cerver->stats->total_n_clients++;
-	cerver->stats->current_n_connected_clients++;
+	(void) __atomic_add_fetch (&cerver->stats->total_n_clients, 1, __ATOMIC_RELAXED);
+	(void) __atomic_add_fetch (&cerver->stats->current_n_connected_clients, 1, __ATOMIC_RELAXED);
 
 	#ifdef CERVER_STATS
 	cerver_log (
@@ -889,24 +891,36 @@ u8 client_register_to_cerver (Cerver *cerver, Client *client) {
 
 	if (cerver && client) {
 		if (!client_register_connections_to_cerver (cerver, client)) {
-			switch (cerver->handler_type) {
-				case CERVER_HANDLER_TYPE_NONE: break;
+			// udp peers are received from the cerver's socket, so they are only mapped by their address
+			if (cerver->protocol == PROTOCOL_UDP) {
+				client_register_to_cerver_internal (cerver, client);
 
-				case CERVER_HANDLER_TYPE_POLL: {
-					if (!client_register_connections_to_cerver_poll (cerver, client)) {
-						client_register_to_cerver_internal (cerver, client);
+				retval = 0;
+			}
 
-						retval = 0;
-					}
-				} break;
+			else {
+				switch (cerver->handler_type) {
+					case CERVER_HANDLER_TYPE_NONE: break;
 
-				case CERVER_HANDLER_TYPE_THREADS: {
-					client_register_to_cerver_internal (cerver, client);
+					case CERVER_HANDLER_TYPE_POLL:
+					case CERVER_HANDLER_TYPE_EPOLL:
+					case CERVER_HANDLER_TYPE_URING:
+					case CERVER_HANDLER_TYPE_REACTORS: {
+						if (!client_register_connections_to_cerver_poll (cerver, client)) {
+							client_register_to_cerver_internal (cerver, client);
 
-					retval = 0;
-				} break;
+							retval = 0;
+						}
+					} break;
 
-				default: break;
+					case CERVER_HANDLER_TYPE_THREADS: {
+						client_register_to_cerver_internal (cerver, client);
+
+						retval = 0;
+					} break;
+
+					default: break;
+				}
 			}
 		}
 	}
@@ -943,18 +957,25 @@ Client *client_unregister_from_cerver (Cerver *cerver, Client *client) {
 }
 
 // gets the client associated with a sock fd using the client-sock fd map
+// if the cerver uses reactors, the client map of the reactor that handles the sock fd will be used
 Client *client_get_by_sock_fd (Cerver *cerver, i32 sock_fd) {
 
 	Client *client = NULL;
 
 	if (cerver) {
-		const i32 *key = &sock_fd;
-		void *client_data = htab_get (
-			cerver->client_sock_fd_map,
-			key, sizeof (i32)
-		);
+		if (cerver->reactors) {
+			client = cerver_reactors_client_get_by_sock_fd (cerver, sock_fd);
+		}
+
+		else {
+			const i32 *key = &sock_fd;
+			void *client_data = htab_get (
+				cerver->client_sock_fd_map,
+				key, sizeof (i32)
+			);
 
-		if (client_data) client = (Client *) client_data;
+			if (client_data) client = (Client *) client_data;
+		}
 	}
 
 	return client;
@@ -984,30 +1005,74 @@ Client *client_get_by_session_id (Cerver *cerver, const char *session_id) {
 
 }
 
-// broadcast a packet to all clients inside an avl structure
-void client_broadcast_to_all_avl (
+// adds every active connection of the clients inside the avl structure as a broadcast target
+// returns 0 on success, 1 on error
+static u8 client_broadcast_targets_avl (
 	AVLNode *node,
-	Cerver *cerver,
-	Packet *packet
+	PacketBroadcastTarget **targets, size_t *n_targets, size_t *max_targets
 ) {
 
-	if (node && cerver && packet) {
-		client_broadcast_to_all_avl (node->right, cerver, packet);
+	u8 errors = 0;
+
+	if (node) {
+		errors |= client_broadcast_targets_avl (node->right, targets, n_targets, max_targets);
 
-		// send the packet to current client
 		if (node->id) {
 			Client *client = (Client *) node->id;
 
-			// send the packet to all of its active connections
-			Connection *connection = NULL;
 			for (ListElement *le = dlist_start (client->connections); le; le = le->next) {
-				connection = (Connection *) le->data;
-				packet_set_network_values (packet, cerver, client, connection, NULL);
-				packet_send (packet, 0, NULL, false);
+				if (*n_targets == *max_targets) {
+					size_t new_max = *max_targets ? *max_targets * 2 : 64;
+					PacketBroadcastTarget *new_targets = (PacketBroadcastTarget *) realloc (
+						*targets, new_max * sizeof (PacketBroadcastTarget)
+					);
+
+					if (!new_targets) return 1;
+
+					*targets = new_targets;
+					*max_targets = new_max;
+				}
+
+				(*targets)[*n_targets].client = client;
+				(*targets)[*n_targets].connection = (Connection *) le->data;
+				*n_targets += 1;
 			}
 		}
 
-		client_broadcast_to_all_avl (node->left, cerver, packet);
+		errors |= client_broadcast_targets_avl (node->left, targets, n_targets, max_targets);
+	}
+
+	return errors;
+
+}
+
+// broadcast a packet to all clients inside an avl structure
+// the packet is serialized only once & shared by all the sends
+void client_broadcast_to_all_avl (
+	AVLNode *node,
+	Cerver *cerver,
+	Packet *packet
+) {
+
+	if (node && cerver && packet) {
+		PacketBroadcastTarget *targets = NULL;
+		size_t n_targets = 0;
+		size_t max_targets = 0;
+		if (!client_broadcast_targets_avl (node, &targets, &n_targets, &max_targets)) {
+			(void) packet_broadcast (
+				packet,
+				cerver, NULL,
+				targets, n_targets,
+				0,
+				NULL, NULL
+			);
+		}
+
+		else {
+			cerver_log_error ("client_broadcast_to_all_avl () - Failed to get broadcast targets!");
+		}
+
+		if (targets) free (targets);
 	}
 
 }
@@ -2370,6 +2435,8 @@ static void client_cerver_packet_handle_info (Packet *packet) {
 		CerverReport *cerver_report = cerver_deserialize ((SCerver *) end);
 		if (cerver_report_check_info (cerver_report, packet->client, packet->connection))
 			cerver_log (LOG_TYPE_ERROR, LOG_TYPE_NONE, "Failed to correctly check cerver info!");
+
+		(void) connection_header_v2_request (packet->client, packet->connection);
 	}
 
 }
@@ -2391,6 +2458,18 @@ void client_cerver_packet_handler (Packet *packet) {
 			client_event_trigger (CLIENT_EVENT_DISCONNECTED, packet->client, NULL);
 			break;
 
+		// the cerver will send its next packets with the v2 header
+		case CERVER_PACKET_TYPE_HEADER_V2:
+			if (packet->connection->sock_receive)
+				packet->connection->sock_receive->header_version = PACKET_HEADER_VERSION_V2;
+			break;
+
+		// the cerver will send a checksum after its next headers
+		case CERVER_PACKET_TYPE_CHECKSUMS:
+			if (packet->connection->sock_receive)
+				packet->connection->sock_receive->header_checksum = true;
+			break;
+
 		default:
 			cerver_log (LOG_TYPE_WARNING, LOG_TYPE_NONE, "Unknown cerver type packet.");
 			break;
@@ -2687,15 +2766,7 @@ static void client_app_packet_handler (Packet *packet) {
 		else {
 			// add the packet to the handler's job queueu to be handled
 			// as soon as the handler is available
-			if (job_queue_push (
-				packet->client->app_packet_handler->job_queue,
-				job_create (NULL, packet)
-			)) {
-				cerver_log_error (
-					"Failed to push a new job to client's %s app_packet_handler!",
-					packet->client->name->str
-				);
-			}
+			(void) handler_queue_packet (packet->client->app_packet_handler, packet);
 		}
 	}
 
@@ -2722,15 +2793,7 @@ static void client_app_error_packet_handler (Packet *packet) {
 		else {
 			// add the packet to the handler's job queueu to be handled
 			// as soon as the handler is available
-			if (job_queue_push (
-				packet->client->app_error_packet_handler->job_queue,
-				job_create (NULL, packet)
-			)) {
-				cerver_log_error (
-					"Failed to push a new job to client's %s app_error_packet_handler!",
-					packet->client->name->str
-				);
-			}
+			(void) handler_queue_packet (packet->client->app_error_packet_handler, packet);
 		}
 	}
 
@@ -2757,15 +2820,7 @@ static void client_custom_packet_handler (Packet *packet) {
 		else {
 			// add the packet to the handler's job queueu to be handled
 			// as soon as the handler is available
-			if (job_queue_push (
-				packet->client->custom_packet_handler->job_queue,
-				job_create (NULL, packet)
-			)) {
-				cerver_log_error (
-					"Failed to push a new job to client's %s custom_packet_handler!",
-					packet->client->name->str
-				);
-			}
+			(void) handler_queue_packet (packet->client->custom_packet_handler, packet);
 		}
 	}
 
@@ -2790,6 +2845,7 @@ static void client_packet_handler (void *packet_ptr) {
 			// we expect the packet version in the packet's data
 			if (packet->data) {
 				packet->version = (PacketVersion *) packet->data_ptr;
+				packet->version_ref = true;
 				packet->data_ptr += sizeof (PacketVersion);
 				good = packet_check (packet);
 			}
@@ -2891,215 +2947,61 @@ static void client_packet_handler (void *packet_ptr) {
 
 }
 
-static void client_receive_handle_spare_packet (
-	Client *client, Connection *connection,
-	size_t buffer_size, char **end, size_t *buffer_pos
-) {
-
-	if (connection->sock_receive->header) {
-		// copy the remaining header size
-		memcpy (connection->sock_receive->header_end, (void *) *end, connection->sock_receive->remaining_header);
-
-		connection->sock_receive->complete_header = true;
-	}
-
-	else if (connection->sock_receive->spare_packet) {
-		size_t copy_to_spare = 0;
-		if (connection->sock_receive->missing_packet < buffer_size)
-			copy_to_spare = connection->sock_receive->missing_packet;
-
-		else copy_to_spare = buffer_size;
-
-		// append new data from buffer to the spare packet
-		if (copy_to_spare > 0) {
-			packet_append_data (connection->sock_receive->spare_packet, *end, copy_to_spare);
-
-			// check if we can handler the packet
-			size_t curr_packet_size = connection->sock_receive->spare_packet->data_size + sizeof (PacketHeader);
-			if (connection->sock_receive->spare_packet->header->packet_size == curr_packet_size) {
-				connection->sock_receive->spare_packet->client = client;
-				connection->sock_receive->spare_packet->connection = connection;
-
-				connection->full_packet = true;
-				client_packet_handler (connection->sock_receive->spare_packet);
-
-				connection->sock_receive->spare_packet = NULL;
-				connection->sock_receive->missing_packet = 0;
-			}
-
-			else connection->sock_receive->missing_packet -= copy_to_spare;
-
-			// offset for the buffer
-			if (copy_to_spare < buffer_size) *end += copy_to_spare;
-			*buffer_pos += copy_to_spare;
-		}
-	}
-
-}
-
 // splits the entry buffer in packets of the correct size
-static void client_receive_handle_buffer (
+// returns 1 if the rest of the stream can't be parsed & the connection must be ended
+static u8 client_receive_handle_buffer (
 	Client *client, Connection *connection,
 	char *buffer, size_t buffer_size
 ) {
 
-	char *end = buffer;
-	size_t buffer_pos = 0;
-
-	SockReceive *sock_receive = connection->sock_receive;
-
-	client_receive_handle_spare_packet (
-		client, connection,
-		buffer_size, &end,
-		&buffer_pos
-	);
-
-	PacketHeader *header = NULL;
-	size_t packet_size = 0;
-	// char *packet_data = NULL;
-
-	size_t remaining_buffer_size = 0;
-	size_t packet_real_size = 0;
-	size_t to_copy_size = 0;
-
-	bool spare_header = false;
-
-	while (buffer_pos < buffer_size) {
-		remaining_buffer_size = buffer_size - buffer_pos;
-
-		if (sock_receive->complete_header) {
-			packet_header_copy (&header, (PacketHeader *) sock_receive->header);
-			// header = ((PacketHeader *) sock_receive->header);
-			// packet_header_print (header);
-
-			end += sock_receive->remaining_header;
-			buffer_pos += sock_receive->remaining_header;
-			// printf ("buffer pos after copy to header: %ld\n", buffer_pos);
-
-			// reset sock header values
-			free (sock_receive->header);
-			sock_receive->header = NULL;
-			sock_receive->header_end = NULL;
-			// sock_receive->curr_header_pos = 0;
-			// sock_receive->remaining_header = 0;
-			sock_receive->complete_header = false;
-
-			spare_header = true;
-		}
-
-		else if (remaining_buffer_size >= sizeof (PacketHeader)) {
-			header = (PacketHeader *) end;
-			end += sizeof (PacketHeader);
-			buffer_pos += sizeof (PacketHeader);
-
-			// packet_header_print (header);
-
-			spare_header = false;
-		}
-
-		if (header) {
-			// check the packet size
-			packet_size = header->packet_size;
-			if ((packet_size > 0) /* && (packet_size < 65536) */) {
-				// printf ("packet_size: %ld\n", packet_size);
-				// end += sizeof (PacketHeader);
-				// buffer_pos += sizeof (PacketHeader);
-				// printf ("first buffer pos: %ld\n", buffer_pos);
-
-				Packet *packet = packet_new ();
-				if (packet) {
-					packet_header_copy (&packet->header, header);
-					packet->packet_size = header->packet_size;
-					// packet->cerver = cerver;
-					// packet->lobby = lobby;
-					packet->client = client;
-					packet->connection = connection;
-
-					if (spare_header) {
-						free (header);
-						header = NULL;
-					}
-
-					// check for packet size and only copy what is in the current buffer
-					packet_real_size = packet->header->packet_size - sizeof (PacketHeader);
-					to_copy_size = 0;
-					if ((remaining_buffer_size - sizeof (PacketHeader)) < packet_real_size) {
-						sock_receive->spare_packet = packet;
-
-						if (spare_header) to_copy_size = buffer_size - sock_receive->remaining_header;
-						else to_copy_size = remaining_buffer_size - sizeof (PacketHeader);
-
-						sock_receive->missing_packet = packet_real_size - to_copy_size;
-					}
-
-					else {
-						if ((header->packet_type == PACKET_TYPE_REQUEST) && (header->request_type == REQUEST_PACKET_TYPE_SEND_FILE)) {
-							to_copy_size = remaining_buffer_size - sizeof (PacketHeader);
-						}
-
-						else {
-							to_copy_size = packet_real_size;
-						}
-
-						packet_delete (sock_receive->spare_packet);
-						sock_receive->spare_packet = NULL;
-					}
-
-					// printf ("to copy size: %ld\n", to_copy_size);
-					packet_set_data (packet, (void *) end, to_copy_size);
-
-					end += to_copy_size;
-					buffer_pos += to_copy_size;
-					// printf ("second buffer pos: %ld\n", buffer_pos);
-
-					if (!sock_receive->spare_packet) {
-						connection->full_packet = true;
-						client_packet_handler (packet);
-					}
-				}
-
-				else {
-					cerver_log (
-						LOG_TYPE_ERROR, LOG_TYPE_CLIENT,
-						"Failed to create a new packet in cerver_handle_receive_buffer ()"
-					);
-				}
-			}
-
-			else {
-				cerver_log (
-					LOG_TYPE_WARNING, LOG_TYPE_CLIENT,
-					"Got a packet of invalid size: %ld", packet_size
-				);
+	u8 retval = 0;
 
-				break;
-			}
+	// the connection may be ended by one of its packets,
+	// so its sock receive is only checked if the buffer was not completely handled
+	size_t buffer_pos = 0;
+	Packet *packet = NULL;
+	while ((buffer_pos < buffer_size) && (packet = sock_receive_next_packet (
+		connection->sock_receive, NULL,
+		buffer, buffer_size, &buffer_pos
+	))) {
+		packet->client = client;
+		packet->connection = connection;
+
+		// packets that were corrupted on their way are dropped
+		if (
+			!packet_decompress (
+				packet, connection->compressor,
+				connection->sock_receive->max_packet_size, connection->stats
+			)
+			&& !packet_check_checksum (packet)
+		) {
+			connection->full_packet = true;
+			client_packet_handler (packet);
 		}
 
 		else {
-			if (sock_receive->spare_packet) packet_append_data (sock_receive->spare_packet, (void *) end, remaining_buffer_size);
-
-			else {
-				// copy the piece of possible header that was cut of between recv ()
-				sock_receive->header = malloc (sizeof (PacketHeader));
-				memcpy (sock_receive->header, (void *) end, remaining_buffer_size);
-
-				sock_receive->header_end = (char *) sock_receive->header;
-				sock_receive->header_end += remaining_buffer_size;
-
-				// sock_receive->curr_header_pos = remaining_buffer_size;
-				sock_receive->remaining_header = sizeof (PacketHeader) - remaining_buffer_size;
-
-				// printf ("curr header pos: %d\n", sock_receive->curr_header_pos);
-				// printf ("remaining header: %d\n", sock_receive->remaining_header);
-
-				buffer_pos += remaining_buffer_size;
-			}
+			client->stats->received_packets->n_bad_packets += 1;
+			connection->stats->received_packets->n_bad_packets += 1;
+			#ifdef CLIENT_DEBUG
+			cerver_log (LOG_TYPE_WARNING, LOG_TYPE_NONE, "Dropped a corrupted packet");
+			#endif
+			packet_delete (packet);
 		}
+	}
 
-		header = NULL;
+	// got a header with an invalid packet size
+	if (!packet && connection->sock_receive->failed) {
+		client->stats->received_packets->n_bad_packets += 1;
+		connection->stats->received_packets->n_bad_packets += 1;
+		#ifdef CLIENT_DEBUG
+		cerver_log (LOG_TYPE_WARNING, LOG_TYPE_NONE, "Got a packet of invalid size");
+		#endif
+
+		retval = 1;
 	}
 
+	return retval;
+
 }
 
 // handles a failed recive from a connection associatd with a client
@@ -3186,14 +3088,18 @@ unsigned int client_receive_internal (
 			connection->stats->total_bytes_received += rc;
 
 			// handle the recived packet buffer -> split them in packets of the correct size
-			client_receive_handle_buffer (
+			if (!client_receive_handle_buffer (
 				client,
 				connection,
 				buffer,
 				rc
-			);
+			)) {
+				retval = 0;
+			}
 
-			retval = 0;
+			else {
+				client_receive_handle_failed (client, connection);
+			}
 		} break;
 	}
 
@@ -3201,21 +3107,24 @@ unsigned int client_receive_internal (
 
 }
 
-// allocates a new packet buffer to receive incoming data from the connection's socket
+// uses the connection's socket packet buffer to receive incoming data from the connection's socket
 // returns 0 on success handle, 1 if any error ocurred and must likely the connection was ended
 unsigned int client_receive (Client *client, Connection *connection) {
 
 	unsigned int retval = 1;
 
 	if (client && connection) {
-		char *packet_buffer = (char *) calloc (connection->receive_packet_buffer_size, sizeof (char));
+		Socket *socket = connection->socket;
+		const size_t buffer_size = connection->receive_packet_buffer_size;
+
+		char *packet_buffer = socket_receive_buffer_get (socket, buffer_size);
 		if (packet_buffer) {
 			retval = client_receive_internal (
 				client, connection,
-				packet_buffer, connection->receive_packet_buffer_size
+				packet_buffer, buffer_size
 			);
 
-			free (packet_buffer);
+			socket_receive_buffer_release (socket, packet_buffer, buffer_size);
 		}
 
 		else {
@@ -3330,7 +3239,7 @@ static void client_app_handler_destroy (Client *client) {
 		if (client->app_packet_handler) {
 			if (!client->app_packet_handler->direct_handle) {
 				// stop app handler
-				bsem_post_all (client->app_packet_handler->job_queue->has_jobs);
+				job_queue_wake_all (client->app_packet_handler->job_queue);
 			}
 		}
 	}
@@ -3343,7 +3252,7 @@ static void client_app_error_handler_destroy (Client *client) {
 		if (client->app_error_packet_handler) {
 			if (!client->app_error_packet_handler->direct_handle) {
 				// stop app error handler
-				bsem_post_all (client->app_error_packet_handler->job_queue->has_jobs);
+				job_queue_wake_all (client->app_error_packet_handler->job_queue);
 			}
 		}
 	}
@@ -3356,7 +3265,7 @@ static void client_custom_handler_destroy (Client *client) {
 		if (client->custom_packet_handler) {
 			if (!client->custom_packet_handler->direct_handle) {
 				// stop custom handler
-				bsem_post_all (client->custom_packet_handler->job_queue->has_jobs);
+				job_queue_wake_all (client->custom_packet_handler->job_queue);
 			}
 		}
 	}
@@ -3380,13 +3289,13 @@ static void client_handlers_destroy (Client *client) {
 		// poll remaining handlers
 		while (client->num_handlers_alive) {
 			if (client->app_packet_handler)
-				bsem_post_all (client->app_packet_handler->job_queue->has_jobs);
+				job_queue_wake_all (client->app_packet_handler->job_queue);
 
 			if (client->app_error_packet_handler)
-				bsem_post_all (client->app_error_packet_handler->job_queue->has_jobs);
+				job_queue_wake_all (client->app_error_packet_handler->job_queue);
 
 			if (client->custom_packet_handler)
-				bsem_post_all (client->custom_packet_handler->job_queue->has_jobs);
+				job_queue_wake_all (client->custom_packet_handler->job_queue);
 
 			sleep (1);
 		}
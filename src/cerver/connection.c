@@ -19,7 +19,9 @@
 #include "cerver/handler.h"
 #include "cerver/network.h"
 #include "cerver/packets.h"
+#include "cerver/reactor.h"
 #include "cerver/socket.h"
+#include "cerver/udp.h"
 
 #include "cerver/threads/thread.h"
 
@@ -43,6 +45,22 @@ ConnectionStats *connection_stats_new (void) {
 
 }
 
+// returns how many times smaller the data that was sent compressed got, 0 if none was
+double connection_stats_get_compression_ratio (const ConnectionStats *stats) {
+
+	return (stats && stats->compression_bytes_out) ?
+		(double) stats->compression_bytes_in / (double) stats->compression_bytes_out : 0;
+
+}
+
+// returns how many times bigger the data that was received compressed got, 0 if none was
+double connection_stats_get_decompression_ratio (const ConnectionStats *stats) {
+
+	return (stats && stats->decompression_bytes_in) ?
+		(double) stats->decompression_bytes_out / (double) stats->decompression_bytes_in : 0;
+
+}
+
 static inline void connection_stats_delete (ConnectionStats *stats) {
 
 	if (stats) {
@@ -73,6 +91,16 @@ void connection_stats_print (Connection *connection) {
 
 			cerver_log_msg ("\nSent packets:");
 			packets_per_type_print (connection->stats->sent_packets);
+
+			if (connection->stats->n_packets_compressed || connection->stats->n_packets_decompressed) {
+				cerver_log_msg ("\nCompression:");
+				cerver_log_msg ("N packets compressed:      %ld", connection->stats->n_packets_compressed);
+				cerver_log_msg ("Compression ratio:         %.2f", connection_stats_get_compression_ratio (connection->stats));
+				cerver_log_msg ("Compression time:          %.3f ms", connection->stats->compression_time / 1000000.0);
+				cerver_log_msg ("N packets decompressed:    %ld", connection->stats->n_packets_decompressed);
+				cerver_log_msg ("Decompression ratio:       %.2f", connection_stats_get_decompression_ratio (connection->stats));
+				cerver_log_msg ("Decompression time:        %.3f ms", connection->stats->decompression_time / 1000000.0);
+			}
 		}
 
 		else {
@@ -123,6 +151,10 @@ Connection *connection_new (void) {
 
 		connection->receive_packet_buffer_size = RECEIVE_PACKET_BUFFER_SIZE;
 		connection->sock_receive = NULL;
+		connection->header_v2 = false;
+		connection->packet_checksums = false;
+		connection->compressor = NULL;
+		connection->compression_threshold = PACKET_COMPRESSION_THRESHOLD;
 
 		connection->update_thread_id = 0;
 		connection->update_timeout = DEFAULT_CONNECTION_TIMEOUT;
@@ -147,6 +179,9 @@ Connection *connection_new (void) {
 
 		connection->stats = NULL;
 
+		connection->reactor = NULL;
+		connection->udp = NULL;
+
 		connection->cond = NULL;
 		connection->mutex = NULL;
 	}
@@ -162,10 +197,10 @@ void connection_delete (void *ptr) {
 
 		str_delete (connection->name);
 
-		socket_delete (connection->socket);
-
 		if (connection->active) connection_end (connection);
 
+		socket_delete (connection->socket);
+
 		str_delete (connection->ip);
 
 		cerver_report_delete (connection->cerver_report);
@@ -310,6 +345,56 @@ void connection_set_update_timeout (Connection *connection, u32 timeout) {
 
 }
 
+// sets if the connection will ask the cerver to use the compact v2 packet header
+// it is only used if the cerver offers it in its info packet (default false)
+void connection_set_header_v2 (Connection *connection, bool header_v2) {
+
+	if (connection) connection->header_v2 = header_v2;
+
+}
+
+// sets if the connection will ask the cerver to follow every v2 header with
+// the crc32c of its packet's data, it implies the v2 header (default false)
+void connection_set_packet_checksums (Connection *connection, bool packet_checksums) {
+
+	if (connection) {
+		connection->packet_checksums = packet_checksums;
+		if (packet_checksums) connection->header_v2 = true;
+	}
+
+}
+
+// sets the compressor that the connection uses for the data of the packets that it sends
+// if the cerver offers the same one, both ends compress the data that reaches the threshold
+// it implies the v2 header (default NULL, no compression)
+void connection_set_compression (
+	Connection *connection, const PacketCompressor *compressor
+) {
+
+	if (connection) {
+		connection->compressor = compressor;
+		if (compressor) connection->header_v2 = true;
+	}
+
+}
+
+// sets the min data size that is compressed (default PACKET_COMPRESSION_THRESHOLD)
+void connection_set_compression_threshold (Connection *connection, size_t threshold) {
+
+	if (connection) connection->compression_threshold = threshold;
+
+}
+
+// sets the max size (header included) of the packets that the connection can receive,
+// a header that claims a bigger size is counted as a bad packet & the connection is ended
+// 0 to disable the limit (default DEFAULT_MAX_PACKET_SIZE)
+void connection_set_max_packet_size (Connection *connection, size_t max_packet_size) {
+
+	if (connection && connection->sock_receive)
+		connection->sock_receive->max_packet_size = max_packet_size;
+
+}
+
 // sets the connection received data
 // 01/01/2020 - a place to safely store the request response, like when using client_connection_request_to_cerver ()
 void connection_set_received_data (Connection *connection, void *data, size_t data_size, Action data_delete) {
@@ -509,7 +594,8 @@ void connection_end (Connection *connection) {
 
 	if (connection) {
 		if (connection->active) {
-			close (connection->socket->sock_fd);
+			// a udp peer shares the cerver's socket
+			if (!connection->udp) close (connection->socket->sock_fd);
 			connection->socket->sock_fd = -1;
 			connection->active = false;
 		}
@@ -524,6 +610,9 @@ void connection_drop (Cerver *cerver, Connection *connection) {
 		connection_end (connection);
 
 		if (cerver) {
+			// the pending bytes were for the sock fd that was just closed
+			socket_send_reset (connection->socket);
+
 			// move the socket to the cerver's socket pool to avoid destroying it
 			// to handle if any other thread is waiting to access the socket's mutex
 			cerver_sockets_pool_push (cerver, connection->socket);
@@ -650,10 +739,24 @@ u8 connection_register_to_cerver (Cerver *cerver, Client *client, Connection *co
 	u8 retval = 1;
 
 	if (cerver && client && connection) {
-		// map the socket fd with the client
-		const void *key = &connection->socket->sock_fd;
-		retval = (u8) htab_insert (cerver->client_sock_fd_map, key, sizeof (i32),
-			client, sizeof (Client));
+		// udp peers are mapped by their address as they all share the same sock fd
+		if (connection->udp) {
+			retval = cerver_udp_client_register (connection->udp, client, &connection->address);
+		}
+
+		else {
+			// map the socket fd with the client
+			// connections handled by a reactor are only mapped in the reactor's client map
+			const void *key = &connection->socket->sock_fd;
+			retval = (u8) htab_insert (
+				connection->reactor ? connection->reactor->client_sock_fd_map : cerver->client_sock_fd_map,
+				key, sizeof (i32),
+				client, sizeof (Client)
+			);
+
+			if (!retval && connection->reactor)
+				cerver_reactors_sock_fd_set (cerver, connection->socket->sock_fd, connection->reactor);
+		}
 	}
 
 	return retval;
@@ -666,10 +769,20 @@ u8 connection_unregister_from_cerver (Cerver *cerver, Connection *connection) {
 
 	u8 retval = 1;
 
-	if (cerver && connection) {
+	if (cerver && connection && connection->udp) {
+		retval = cerver_udp_client_unregister (connection->udp, &connection->address);
+	}
+
+	else if (cerver && connection) {
 		// remove the sock fd from each map
 		const void *key = &connection->socket->sock_fd;
-		if (htab_remove (cerver->client_sock_fd_map, key, sizeof (i32))) {
+		if (connection->reactor)
+			cerver_reactors_sock_fd_remove (cerver, connection->socket->sock_fd, connection->reactor);
+
+		if (htab_remove (
+			connection->reactor ? connection->reactor->client_sock_fd_map : cerver->client_sock_fd_map,
+			key, sizeof (i32)
+		)) {
 			// cerver_log_success (
 			// 	"Removed sock fd %d from cerver's %s client sock map.",
 			//     connection->socket->sock_fd, cerver->info->name->str
@@ -698,8 +811,32 @@ u8 connection_unregister_from_cerver (Cerver *cerver, Connection *connection) {
 // returns 0 on success, 1 on error
 u8 connection_register_to_cerver_poll (Cerver *cerver, Connection *connection) {
 
-	return (cerver && connection) ?
-		cerver_poll_register_connection (cerver, connection) : 1;
+	u8 retval = 1;
+
+	// udp peers are received from the cerver's socket
+	if (cerver && connection && connection->udp) retval = 0;
+
+	else if (cerver && connection) {
+		switch (cerver->handler_type) {
+			case CERVER_HANDLER_TYPE_EPOLL:
+				retval = cerver_epoll_register_connection (cerver, connection);
+				break;
+
+			case CERVER_HANDLER_TYPE_URING:
+				retval = cerver_uring_register_connection (cerver, connection);
+				break;
+
+			case CERVER_HANDLER_TYPE_REACTORS:
+				retval = cerver_reactor_register_connection (cerver, connection);
+				break;
+
+			default:
+				retval = cerver_poll_register_connection (cerver, connection);
+				break;
+		}
+	}
+
+	return retval;
 
 }
 
@@ -708,8 +845,31 @@ u8 connection_register_to_cerver_poll (Cerver *cerver, Connection *connection) {
 // returns 0 on success, 1 on error
 u8 connection_unregister_from_cerver_poll (Cerver *cerver, Connection *connection) {
 
-	return (cerver && connection) ?
-		cerver_poll_unregister_connection (cerver, connection) : 1;
+	u8 retval = 1;
+
+	if (cerver && connection && connection->udp) retval = 0;
+
+	else if (cerver && connection) {
+		switch (cerver->handler_type) {
+			case CERVER_HANDLER_TYPE_EPOLL:
+				retval = cerver_epoll_unregister_connection (cerver, connection);
+				break;
+
+			case CERVER_HANDLER_TYPE_URING:
+				retval = cerver_uring_unregister_connection (cerver, connection);
+				break;
+
+			case CERVER_HANDLER_TYPE_REACTORS:
+				retval = cerver_reactor_unregister_connection (cerver, connection);
+				break;
+
+			default:
+				retval = cerver_poll_unregister_connection (cerver, connection);
+				break;
+		}
+	}
+
+	return retval;
 
 }
 
@@ -742,6 +902,9 @@ u8 connection_remove_from_cerver (Cerver *cerver, Connection *connection) {
 	if (cerver && connection) {
 		switch (cerver->handler_type) {
 			case CERVER_HANDLER_TYPE_POLL:
+			case CERVER_HANDLER_TYPE_EPOLL:
+			case CERVER_HANDLER_TYPE_URING:
+			case CERVER_HANDLER_TYPE_REACTORS:
 				errors |= connection_unregister_from_cerver_poll (cerver, connection);
 				break;
 
@@ -755,6 +918,239 @@ u8 connection_remove_from_cerver (Cerver *cerver, Connection *connection) {
 
 }
 
+// starts coalescing the packets that are sent to the connection, they are kept
+// in the connection's socket & sent together with a single call when connection_uncork ()
+// is called the same n of times, so a tick that sends many small packets only makes one syscall
+void connection_cork (Connection *connection) {
+
+	if (connection) socket_cork (connection->socket);
+
+}
+
+// ends a connection_cork () call & sends the coalesced packets if it was the last one
+// returns 0 on success, 1 on error
+u8 connection_uncork (Connection *connection) {
+
+	return connection ? socket_uncork (connection->socket) : 1;
+
+}
+
+// what the socket starts using after a header switch packet
+typedef enum ConnectionHeaderSwitch {
+
+	CONNECTION_HEADER_SWITCH_V2				= 0,
+	CONNECTION_HEADER_SWITCH_CHECKSUMS		= 1,
+	CONNECTION_HEADER_SWITCH_COMPRESSION	= 2,
+
+} ConnectionHeaderSwitch;
+
+// sends the header switch packet with the current header & then switches the socket
+// to the v2 header, to checksums or to compression while holding its write mutex,
+// so no other packet can be sent in between
+static u8 connection_header_switch_send (
+	PacketType packet_type, u32 request_type, ConnectionHeaderSwitch header_switch,
+	Cerver *cerver, Client *client, Connection *connection
+) {
+
+	u8 retval = 1;
+
+	Packet *packet = packet_generate_request (packet_type, request_type, NULL, 0);
+	if (packet) {
+		packet_set_network_values (packet, cerver, client, connection, NULL);
+
+		pthread_mutex_lock (connection->socket->write_mutex);
+
+		if (!packet_send_unsafe (packet, 0, NULL, false)) {
+			switch (header_switch) {
+				case CONNECTION_HEADER_SWITCH_V2:
+					connection->socket->header_version = PACKET_HEADER_VERSION_V2;
+					break;
+
+				case CONNECTION_HEADER_SWITCH_CHECKSUMS:
+					connection->socket->header_checksum = true;
+					break;
+
+				case CONNECTION_HEADER_SWITCH_COMPRESSION:
+					connection->socket->compressor = connection->compressor;
+					connection->socket->compression_threshold = connection->compression_threshold;
+					break;
+
+				default: break;
+			}
+
+			retval = 0;
+		}
+
+		pthread_mutex_unlock (connection->socket->write_mutex);
+
+		packet_delete (packet);
+	}
+
+	return retval;
+
+}
+
+// asks the cerver to switch the connection to the v2 header if it offered it
+// the request is the last packet that is sent with the v1 header, packets are received
+// with the v1 header until the cerver's confirmation arrives
+// returns 0 on success, 1 if the v1 header is still used
+u8 connection_header_v2_request (Client *client, Connection *connection) {
+
+	u8 retval = 1;
+
+	if (
+		connection && connection->header_v2 && connection->cerver_report
+		&& (connection->cerver_report->header_version >= PACKET_HEADER_VERSION_V2)
+		&& (connection->protocol == PROTOCOL_TCP)
+	) {
+		retval = connection_header_switch_send (
+			PACKET_TYPE_CLIENT, CLIENT_PACKET_TYPE_HEADER_V2, CONNECTION_HEADER_SWITCH_V2,
+			NULL, client, connection
+		);
+
+		#ifdef CONNECTION_DEBUG
+		cerver_log (
+			retval ? LOG_TYPE_ERROR : LOG_TYPE_DEBUG, LOG_TYPE_NONE,
+			"Connection %s %s the v2 header",
+			connection->name->str, retval ? "failed to request" : "requested"
+		);
+		#endif
+
+		if (!retval && connection->packet_checksums && connection->cerver_report->checksums) {
+			// sent with the v2 header, the next ones are followed by their checksum
+			if (connection_header_switch_send (
+				PACKET_TYPE_CLIENT, CLIENT_PACKET_TYPE_CHECKSUMS, CONNECTION_HEADER_SWITCH_CHECKSUMS,
+				NULL, client, connection
+			)) {
+				cerver_log_error (
+					"Connection %s failed to request packet checksums",
+					connection->name->str
+				);
+			}
+		}
+
+		if (
+			!retval && connection->compressor
+			&& (connection->cerver_report->compressor == connection->compressor->id)
+		) {
+			// the cerver decompresses what is sent after the request,
+			// so the data of the next packets can be compressed right away
+			if (connection_header_switch_send (
+				PACKET_TYPE_CLIENT, CLIENT_PACKET_TYPE_COMPRESSION, CONNECTION_HEADER_SWITCH_COMPRESSION,
+				NULL, client, connection
+			)) {
+				cerver_log_error (
+					"Connection %s failed to request %s compression",
+					connection->name->str, connection->compressor->name
+				);
+			}
+		}
+	}
+
+	return retval;
+
+}
+
+// switches the connection to the v2 header after the client asked for it
+// the confirmation is the last packet that is sent with the v1 header,
+// & the client's request was the last one that it sent with it
+// returns 0 on success, 1 on error
+u8 connection_header_v2_accept (Cerver *cerver, Client *client, Connection *connection) {
+
+	u8 retval = 1;
+
+	if (cerver && connection && connection->sock_receive && cerver->header_v2 && !connection->udp) {
+		// the client sends with the v2 header right after its request
+		connection->sock_receive->header_version = PACKET_HEADER_VERSION_V2;
+
+		retval = connection_header_switch_send (
+			PACKET_TYPE_CERVER, CERVER_PACKET_TYPE_HEADER_V2, CONNECTION_HEADER_SWITCH_V2,
+			cerver, client, connection
+		);
+
+		#ifdef CONNECTION_DEBUG
+		cerver_log (
+			retval ? LOG_TYPE_ERROR : LOG_TYPE_DEBUG, LOG_TYPE_NONE,
+			"Connection %d %s the v2 header",
+			connection->socket->sock_fd, retval ? "failed to switch to" : "switched to"
+		);
+		#endif
+	}
+
+	return retval;
+
+}
+
+// starts sending & receiving checksums after the v2 header in the connection
+// the confirmation is the last packet that is sent without a checksum,
+// & the client's request was the last one that it sent without it
+// returns 0 on success, 1 on error
+u8 connection_checksums_accept (Cerver *cerver, Client *client, Connection *connection) {
+
+	u8 retval = 1;
+
+	if (
+		cerver && connection && connection->sock_receive && cerver->packet_checksums
+		&& (connection->sock_receive->header_version == PACKET_HEADER_VERSION_V2)
+	) {
+		connection->sock_receive->header_checksum = true;
+
+		retval = connection_header_switch_send (
+			PACKET_TYPE_CERVER, CERVER_PACKET_TYPE_CHECKSUMS, CONNECTION_HEADER_SWITCH_CHECKSUMS,
+			cerver, client, connection
+		);
+
+		#ifdef CONNECTION_DEBUG
+		cerver_log (
+			retval ? LOG_TYPE_ERROR : LOG_TYPE_DEBUG, LOG_TYPE_NONE,
+			"Connection %d %s packet checksums",
+			connection->socket->sock_fd, retval ? "failed to start" : "started"
+		);
+		#endif
+	}
+
+	return retval;
+
+}
+
+// starts compressing the data of the packets that are sent to the connection
+// with the cerver's compressor after the client asked for it, as every packet says
+// if its data is compressed, there is no need to confirm it
+// returns 0 on success, 1 on error
+u8 connection_compression_accept (Cerver *cerver, Client *client, Connection *connection) {
+
+	u8 retval = 1;
+
+	if (
+		cerver && connection && connection->sock_receive && cerver->compressor
+		&& (connection->sock_receive->header_version == PACKET_HEADER_VERSION_V2)
+	) {
+		// the client's packets are decompressed with the same compressor
+		connection->compressor = cerver->compressor;
+		connection->compression_threshold = cerver->compression_threshold;
+
+		pthread_mutex_lock (connection->socket->write_mutex);
+
+		connection->socket->compressor = connection->compressor;
+		connection->socket->compression_threshold = connection->compression_threshold;
+
+		pthread_mutex_unlock (connection->socket->write_mutex);
+
+		#ifdef CONNECTION_DEBUG
+		cerver_log (
+			LOG_TYPE_DEBUG, LOG_TYPE_NONE,
+			"Connection %d started %s compression",
+			connection->socket->sock_fd, connection->compressor->name
+		);
+		#endif
+
+		retval = 0;
+	}
+
+	return retval;
+
+}
+
 #pragma endregion
 
 #pragma region receive
@@ -629,8 +629,22 @@ static ssize_t file_send_actual (
 		cerver, client, connection,
 		actual_filename, filelen
 	)) {
-		// send the actual file
-		retval = sendfile (connection->socket->sock_fd, file_fd, NULL, filelen);
+		// send the actual file, a non blocking socket might not take all of it at once
+		off_t offset = 0;
+		while ((size_t) offset < filelen) {
+			retval = sendfile (connection->socket->sock_fd, file_fd, &offset, filelen - (size_t) offset);
+			if (retval < 0) {
+				if (sock_can_retry (connection->socket->sock_fd, POLLOUT)) continue;
+				break;
+			}
+
+			if (!retval) break;
+		}
+
+		// the peer expects the rest of the file, so the connection can't be used anymore
+		if ((size_t) offset < filelen) (void) shutdown (connection->socket->sock_fd, SHUT_RDWR);
+
+		if (retval >= 0) retval = (ssize_t) offset;
 	}
 
 	else {
@@ -735,12 +749,15 @@ static inline u8 file_receive_internal_receive (
 
 	u8 retval = 1;
 
-	*received = splice (
-		connection->socket->sock_fd, NULL,
-		pipefd, NULL,
-		buff_size,
-		SPLICE_F_MOVE | SPLICE_F_MORE
-	);
+	// the connection's socket might be non blocking
+	do {
+		*received = splice (
+			connection->socket->sock_fd, NULL,
+			pipefd, NULL,
+			buff_size,
+			SPLICE_F_MOVE | SPLICE_F_MORE
+		);
+	} while ((*received < 0) && sock_can_retry (connection->socket->sock_fd, POLLIN));
 
 	switch (*received) {
 		case -1: {
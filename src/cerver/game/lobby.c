@@ -19,6 +19,7 @@
 #include "cerver/client.h"
 #include "cerver/handler.h"
 #include "cerver/packets.h"
+#include "cerver/pollfds.h"
 
 #include "cerver/threads/thpool.h"
 #include "cerver/threads/thread.h"
@@ -161,7 +162,7 @@ Lobby *lobby_new (void) {
         lobby->id = NULL;
 
         lobby->sock_fd_player_map = NULL;
-        lobby->players_fds = NULL;
+        lobby->players_poll_fds = NULL;
         lobby->poll_timeout = LOBBY_DEFAULT_POLL_TIMEOUT;
 
         lobby->running = lobby->in_game = false;
@@ -199,7 +200,7 @@ void lobby_delete (void *lobby_ptr) {
         dlist_delete (lobby->players);
         htab_destroy (lobby->sock_fd_player_map);
 
-        if (lobby->players_fds) free (lobby->players_fds);
+        poll_fds_delete (lobby->players_poll_fds);
 
         lobby->owner = NULL;
 
@@ -395,16 +396,10 @@ u8 lobby_poll_init (Lobby *lobby, unsigned int max_players_fds) {
     u8 retval = 1;
 
     if (lobby) {
-        lobby->players_fds = (struct pollfd *) calloc (max_players_fds, sizeof (struct pollfd));
-        if (lobby->players_fds) {
-            lobby->max_players_fds = max_players_fds;
+        lobby->players_poll_fds = poll_fds_create (max_players_fds);
+        if (lobby->players_poll_fds) {
             lobby->current_players_fds = 0;
 
-            for (u32 i = 0; i < lobby->max_players_fds; i++) {
-                lobby->players_fds[i].fd = -1;
-                lobby->players_fds[i].events = -1;
-            }
-
             retval = 0;
         }
     }
@@ -413,47 +408,6 @@ u8 lobby_poll_init (Lobby *lobby, unsigned int max_players_fds) {
 
 }
 
-// reallocs lobby poll fds
-// returns 0 on success, 1 on error
-static u8 lobby_realloc_poll_fds (Lobby *lobby) {
-
-    u8 retval = 1;
-
-    if (lobby) {
-        lobby->max_players_fds = lobby->max_players_fds * 2;
-        lobby->players_fds = (struct pollfd *) realloc (lobby->players_fds,
-            lobby->max_players_fds * sizeof (struct pollfd));
-        if (lobby->players_fds) retval = 0;
-    }
-
-    return retval;
-
-}
-
-// gets a free idx in the lobby poll structure
-static i32 lobby_poll_get_free_idx (const Lobby *lobby) {
-
-    if (lobby) {
-        for (i32 i = 0; i < lobby->max_players_fds; i++) 
-            if (lobby->players_fds[i].fd == -1) return i;
-    }
-
-    return -1;
-
-}
-
-// gets the idx of the connection fd in the poll fds
-static i32 lobby_poll_get_idx_by_sock_fd (const Lobby *lobby, const i32 sock_fd) {
-
-    if (lobby) {
-        for (u32 i = 0; i < lobby->max_players_fds; i++)
-            if (lobby->players_fds[i].fd == sock_fd) return i;
-    }
-
-    return -1;
-
-}
-
 // registers a player's client connection to the lobby poll
 // and maps the sock fd to the player
 u8 lobby_poll_register_connection (Lobby *lobby, Player *player, Connection *connection) {
@@ -461,10 +415,8 @@ u8 lobby_poll_register_connection (Lobby *lobby, Player *player, Connection *con
     u8 retval = 1;
 
     if (lobby && player && connection) {
-        i32 idx = lobby_poll_get_free_idx (lobby);
+        i32 idx = poll_fds_add (lobby->players_poll_fds, connection->socket->sock_fd, POLLIN);
         if (idx >= 0) {
-            lobby->players_fds[idx].fd = connection->socket->sock_fd;
-            lobby->players_fds[idx].events = POLLIN;
             lobby->current_players_fds++;
 
             #ifdef CERVER_DEBUG
@@ -491,7 +443,7 @@ u8 lobby_poll_register_connection (Lobby *lobby, Player *player, Connection *con
             );
             #endif
 
-            if (lobby_realloc_poll_fds (lobby)) {
+            if (poll_fds_realloc (lobby->players_poll_fds)) {
                 cerver_log (
                     LOG_TYPE_ERROR, LOG_TYPE_NONE,
                     "Failed to realloc lobby %s poll structure!",
@@ -515,11 +467,9 @@ u8 lobby_poll_unregister_connection (Lobby *lobby, Player *player, Connection *c
     u8 retval = 1;
 
     if (lobby && player && connection) {
-        // get the idx of the connection sock in the lobby poll fds
-        i32 idx = lobby_poll_get_idx_by_sock_fd (lobby, connection->socket->sock_fd);
+        // the slot is released but the array is compacted after handling the current events
+        i32 idx = poll_fds_remove (lobby->players_poll_fds, connection->socket->sock_fd);
         if (idx >= 0) {
-            lobby->players_fds[idx].fd = -1;
-            lobby->players_fds[idx].events = -1;
             lobby->current_players_fds--;
 
             // const void *key = &connection->sock_fd;
@@ -553,7 +503,9 @@ void lobby_poll (void *ptr) {
 
         int poll_retval = 0;
         while (lobby->running) {
-            poll_retval = poll (lobby->players_fds, lobby->max_players_fds, lobby->poll_timeout);
+            poll_retval = poll (
+                lobby->players_poll_fds->fds, lobby->players_poll_fds->n_fds, lobby->poll_timeout
+            );
 
             // poll failed
             if (poll_retval < 0) {
@@ -576,11 +528,13 @@ void lobby_poll (void *ptr) {
             }
 
             // one or more fd(s) are readable, need to determine which ones they are
-            for (u16 i = 0; i < lobby->current_players_fds; i++) {
-                if (lobby->players_fds[i].revents == 0) continue;
-                if (lobby->players_fds[i].revents != POLLIN) continue;
+            // only the first n_fds slots are used, released ones have a -1 fd
+            PollFds *players_poll_fds = lobby->players_poll_fds;
+            for (u32 i = 0; i < players_poll_fds->n_fds; i++) {
+                if (players_poll_fds->fds[i].revents == 0) continue;
+                if (players_poll_fds->fds[i].revents != POLLIN) continue;
 
-                if (lobby->players_fds[i].fd >= 0) {
+                if (players_poll_fds->fds[i].fd >= 0) {
                     // cerver_receive (cerver_receive_new (cerver, lobby->players_fds[i].fd, false, lobby));
                     // FIXME: 07/07/2020 -- update with new CerverReceive structure
                     // cerver_receive (
@@ -599,6 +553,9 @@ void lobby_poll (void *ptr) {
                     // }
                 }
             }
+
+            // fill the slots that were released by players that left the lobby
+            poll_fds_compact (players_poll_fds);
         }
 
         // #ifdef CERVER_DEBUG
@@ -256,15 +256,38 @@ void player_broadcast_to_all (Cerver *cerver, const Lobby *lobby, Packet *packet
     Protocol protocol, int flags) {
 
     if (lobby && packet) {
-        Player *player = NULL;
-        for (ListElement *le = dlist_start (lobby->players); le; le = le->next) {
-            player = (Player *) le->data;
+        // every player's connection is a target of the same serialized packet
+        size_t n_targets = 0;
+        for (ListElement *le = dlist_start (lobby->players); le; le = le->next)
+            n_targets += (size_t) dlist_size (((Player *) le->data)->client->connections);
+
+        if (n_targets) {
+            PacketBroadcastTarget *targets = (PacketBroadcastTarget *) calloc (
+                n_targets, sizeof (PacketBroadcastTarget)
+            );
+
+            if (targets) {
+                size_t idx = 0;
+                Player *player = NULL;
+                for (ListElement *le = dlist_start (lobby->players); le; le = le->next) {
+                    player = (Player *) le->data;
+
+                    for (ListElement *le_sub = dlist_start (player->client->connections); le_sub; le_sub = le_sub->next) {
+                        targets[idx].client = player->client;
+                        targets[idx].connection = (Connection *) le_sub->data;
+                        idx += 1;
+                    }
+                }
 
-            Connection *connection = NULL;
-            for (ListElement *le_sub = dlist_start (player->client->connections); le_sub; le_sub = le_sub->next) {
-                connection = (Connection *) le_sub->data;
-                packet_set_network_values (packet, cerver, player->client, connection, (Lobby *) lobby);
-                packet_send (packet, flags, NULL, false);
+                (void) packet_broadcast (
+                    packet,
+                    cerver, (Lobby *) lobby,
+                    targets, n_targets,
+                    flags,
+                    NULL, NULL
+                );
+
+                free (targets);
             }
         }
     }
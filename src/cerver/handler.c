@@ -4,8 +4,10 @@
 #include <stdbool.h>
 
 #include <errno.h>
+#include <poll.h>
 
-#include <sys/prctl.h>
+#include <sys/uio.h>
+#include <sys/epoll.h>
 
 #include "cerver/types/types.h"
 
@@ -19,7 +21,11 @@
 #include "cerver/files.h"
 #include "cerver/handler.h"
 #include "cerver/packets.h"
+#include "cerver/pollfds.h"
+#include "cerver/reactor.h"
 #include "cerver/socket.h"
+#include "cerver/udp.h"
+#include "cerver/uring.h"
 
 #include "cerver/threads/thread.h"
 #include "cerver/threads/jobs.h"
@@ -34,8 +40,35 @@
 
 #pragma region handler
 
+const char *handler_queue_policy_to_string (HandlerQueuePolicy policy) {
+
+	switch (policy) {
+		#define XX(num, name, string, description) case HANDLER_QUEUE_POLICY_##name: return #string;
+		HANDLER_QUEUE_POLICY_MAP(XX)
+		#undef XX
+	}
+
+	return handler_queue_policy_to_string (HANDLER_QUEUE_POLICY_WAIT);
+
+}
+
+const char *handler_queue_policy_description (HandlerQueuePolicy policy) {
+
+	switch (policy) {
+		#define XX(num, name, string, description) case HANDLER_QUEUE_POLICY_##name: return #description;
+		HANDLER_QUEUE_POLICY_MAP(XX)
+		#undef XX
+	}
+
+	return handler_queue_policy_description (HANDLER_QUEUE_POLICY_WAIT);
+
+}
+
 static int unique_handler_id = 0;
 
+// set in the handlers' own threads
+static __thread bool handler_thread = false;
+
 static HandlerData *handler_data_new (void) {
 
 	HandlerData *handler_data = (HandlerData *) malloc (sizeof (HandlerData));
@@ -72,9 +105,13 @@ static Handler *handler_new (void) {
 		handler->data_delete = NULL;
 
 		handler->handler = NULL;
+		handler->batch_handler = NULL;
+		handler->batch_size = HANDLER_DEFAULT_BATCH_SIZE;
 		handler->direct_handle = false;
 
 		handler->job_queue = NULL;
+		handler->queue_policy = HANDLER_QUEUE_POLICY_WAIT;
+		handler->n_dropped_packets = 0;
 
 		handler->cerver = NULL;
 		handler->client = NULL;
@@ -167,142 +204,381 @@ void handler_set_direct_handle (Handler *handler, bool direct_handle) {
 
 }
 
-// while cerver is running, check for new jobs and handle them
-static void handler_do_while_cerver (Handler *handler) {
+// sets how many packets can wait in the handler's queue, JOB_QUEUE_DEFAULT_CAPACITY by default,
+// what happens with the packets that arrive while the queue is full depends on its queue policy
+// must be called before the handler starts
+// returns 0 on success, 1 on error
+u8 handler_set_queue_capacity (Handler *handler, size_t capacity) {
+
+	u8 retval = 1;
 
 	if (handler) {
-		Job *job = NULL;
-		Packet *packet = NULL;
-		PacketType packet_type = PACKET_TYPE_NONE;
-		HandlerData *handler_data = handler_data_new ();
-		while (handler->cerver->isRunning) {
-			bsem_wait (handler->job_queue->has_jobs);
+		JobQueue *job_queue = job_queue_create_with_capacity (capacity);
+		if (job_queue) {
+			job_queue_delete (handler->job_queue);
+			handler->job_queue = job_queue;
+
+			retval = 0;
+		}
+	}
 
-			if (handler->cerver->isRunning) {
-				pthread_mutex_lock (handler->cerver->handlers_lock);
-				handler->cerver->num_handlers_working += 1;
-				pthread_mutex_unlock (handler->cerver->handlers_lock);
+	return retval;
 
-				// read job from queue
-				job = job_queue_pull (handler->job_queue);
-				if (job) {
-					packet = (Packet *) job->args;
-					packet_type = packet->header->packet_type;
+}
 
-					handler_data->handler_id = handler->id;
-					handler_data->data = handler->data;
-					handler_data->packet = packet;
+// sets the max n of packets that the handler pulls from its queue & handles
+// every time it wakes up, HANDLER_DEFAULT_BATCH_SIZE by default
+// must be called before the handler starts
+void handler_set_batch_size (Handler *handler, unsigned int batch_size) {
 
-					handler->handler (handler_data);
+	if (handler && batch_size) handler->batch_size = batch_size;
 
-					job_delete (job);
+}
 
-					switch (packet_type) {
-						case PACKET_TYPE_APP: if (handler->cerver->app_packet_handler_delete_packet) packet_delete (packet); break;
-						case PACKET_TYPE_APP_ERROR: if (handler->cerver->app_error_packet_handler_delete_packet) packet_delete (packet); break;
-						case PACKET_TYPE_CUSTOM: if (handler->cerver->custom_packet_handler_delete_packet) packet_delete (packet); break;
+// sets a method that handles all the packets that were pulled from the queue at once,
+// it takes a HandlerBatch instead of a HandlerData & the handler method is then
+// only used to handle packets directly
+// must be called before the handler starts
+void handler_set_batch_handler (Handler *handler, Action batch_handler) {
 
-						default: packet_delete (packet); break;
-					}
-				}
+	if (handler) handler->batch_handler = batch_handler;
+
+}
+
+// sets what to do with the packets that arrive while the handler's queue is full
+// HANDLER_QUEUE_POLICY_WAIT (default) - the thread that received the packet sleeps until the handler
+// makes room for it, so no more data is read from the connections until the handler catches up,
+// packets pushed from the handlers' own threads are never waited for & are dropped instead
+// HANDLER_QUEUE_POLICY_DROP - the packet is deleted & counted as dropped, which is only
+// safe if the app can handle losing packets from connections that are otherwise reliable
+void handler_set_queue_policy (Handler *handler, HandlerQueuePolicy policy) {
 
-				pthread_mutex_lock (handler->cerver->handlers_lock);
-				handler->cerver->num_handlers_working -= 1;
-				pthread_mutex_unlock (handler->cerver->handlers_lock);
+	if (handler) handler->queue_policy = policy;
+
+}
+
+// returns the n of packets that the handler has dropped because its queue was full
+u64 handler_get_n_dropped_packets (const Handler *handler) {
+
+	return handler ? __atomic_load_n (&handler->n_dropped_packets, __ATOMIC_RELAXED) : 0;
+
+}
+
+// returns true while the handler's thread keeps pulling packets from its queue
+static inline bool handler_is_running (const Handler *handler) {
+
+	bool running = false;
+
+	switch (handler->type) {
+		case HANDLER_TYPE_CERVER:
+		case HANDLER_TYPE_ADMIN:
+			running = handler->cerver && handler->cerver->isRunning;
+			break;
+
+		case HANDLER_TYPE_CLIENT:
+			running = handler->client && handler->client->running;
+			break;
+
+		default: break;
+	}
+
+	return running;
+
+}
+
+// sleeps until the handler makes room in its queue for the packet,
+// the handler is checked every HANDLER_QUEUE_WAIT_TIMEOUT in case it has stopped
+// returns 0 on success, 1 if the handler stopped before that
+static u8 handler_queue_packet_wait (Handler *handler, Packet *packet) {
+
+	u8 retval = 1;
+
+	// handlers never wait for room in a queue, as a handler that pushes to its own queue
+	// or two of them that push into each other's queues would never make room
+	if (!handler_thread) {
+		while (handler_is_running (handler)) {
+			job_queue_wait_not_full (handler->job_queue, HANDLER_QUEUE_WAIT_TIMEOUT);
+
+			if (!job_queue_push (handler->job_queue, NULL, packet)) {
+				retval = 0;
+				break;
 			}
 		}
+	}
 
-		handler_data_delete (handler_data);
+	return retval;
+
+}
+
+// the packet is deleted, which also releases the received buffer that it references,
+// & only the first drop & then every time the count doubles are logged to avoid flooding the log
+static void handler_drop_packet (Handler *handler, Packet *packet) {
+
+	u64 n_dropped = __atomic_add_fetch (&handler->n_dropped_packets, 1, __ATOMIC_RELAXED);
+	if (!(n_dropped & (n_dropped - 1))) {
+		cerver_log (
+			LOG_TYPE_WARNING, LOG_TYPE_HANDLER,
+			"Handler %d queue is full - %lu packets have been dropped!",
+			handler->unique_id, n_dropped
+		);
 	}
 
+	packet_delete (packet);
+
 }
 
-// while client is running, check for new jobs and handle them
-static void handler_do_while_client (Handler *handler) {
+// pushes the packet to the handler's job queue, the handler takes ownership of it,
+// if the queue is full, the packet is handled based on the handler's queue policy,
+// packets are always dropped if the handler is no longer running
+// or if they are pushed from a handler's thread, as it could end up waiting for itself
+// returns 0 on success, 1 if the packet was dropped
+u8 handler_queue_packet (Handler *handler, Packet *packet) {
 
-	if (handler) {
-		Job *job = NULL;
-		Packet *packet = NULL;
-		HandlerData *handler_data = handler_data_new ();
-		while (handler->client->running) {
-			bsem_wait (handler->job_queue->has_jobs);
+	u8 retval = 1;
+
+	if (handler && packet) {
+		if (
+			!job_queue_push (handler->job_queue, NULL, packet)
+			|| (
+				(handler->queue_policy == HANDLER_QUEUE_POLICY_WAIT)
+				&& !handler_queue_packet_wait (handler, packet)
+			)
+		) {
+			retval = 0;
+		}
+
+		else {
+			handler_drop_packet (handler, packet);
+		}
+	}
 
-			if (handler->client->running) {
-				pthread_mutex_lock (handler->client->handlers_lock);
-				handler->client->num_handlers_working += 1;
-				pthread_mutex_unlock (handler->client->handlers_lock);
+	return retval;
 
-				// read job from queue
-				job = job_queue_pull (handler->job_queue);
-				if (job) {
-					packet = (Packet *) job->args;
+}
 
-					handler_data->handler_id = handler->id;
-					handler_data->data = handler->data;
-					handler_data->packet = packet;
+// adds a new reference to the packet & pushes it to the handler's job queue,
+// so the same packet can be handed to many handlers without being copied,
+// the reference is handled after the handler is done just as with any other packet
+// returns 0 on success, 1 on error
+u8 handler_push_packet (Handler *handler, Packet *packet) {
 
-					handler->handler (handler_data);
+	u8 retval = 1;
 
-					job_delete (job);
-					packet_delete (packet);
-				}
+	if (handler && handler->job_queue && packet) {
+		retval = handler_queue_packet (handler, packet_ref (packet));
+	}
 
-				pthread_mutex_lock (handler->client->handlers_lock);
-				handler->client->num_handlers_working -= 1;
-				pthread_mutex_unlock (handler->client->handlers_lock);
-			}
+	return retval;
+
+}
+
+static HandlerBatch *handler_batch_new (unsigned int batch_size) {
+
+	HandlerBatch *batch = (HandlerBatch *) malloc (sizeof (HandlerBatch));
+	if (batch) {
+		batch->handler_id = 0;
+
+		batch->data = NULL;
+
+		batch->packets = (Packet **) calloc (batch_size, sizeof (Packet *));
+		batch->n_packets = 0;
+	}
+
+	return batch;
+
+}
+
+static void handler_batch_delete (HandlerBatch *batch) {
+
+	if (batch) {
+		if (batch->packets) free (batch->packets);
+
+		free (batch);
+	}
+
+}
+
+// pulls up to batch size packets from the handler's queue
+// & keeps their types, as the handler method can take ownership of them
+// returns the n of packets that were pulled
+static unsigned int handler_batch_pull (
+	Handler *handler, HandlerBatch *batch, PacketType *packet_types
+) {
+
+	Job job = { 0 };
+	Packet *packet = NULL;
+
+	batch->n_packets = 0;
+	while ((batch->n_packets < handler->batch_size) && !job_queue_pull (handler->job_queue, &job)) {
+		packet = (Packet *) job.args;
+
+		batch->packets[batch->n_packets] = packet;
+		packet_types[batch->n_packets] = packet->header->packet_type;
+		batch->n_packets += 1;
+	}
+
+	return batch->n_packets;
+
+}
+
+// handles the packets with the batch method if it is set,
+// else it handles each one of them with the handler method
+static void handler_batch_handle (
+	Handler *handler, HandlerBatch *batch, HandlerData *handler_data
+) {
+
+	if (handler->batch_handler) {
+		batch->handler_id = handler->id;
+		batch->data = handler->data;
+
+		handler->batch_handler (batch);
+	}
+
+	else {
+		handler_data->handler_id = handler->id;
+		handler_data->data = handler->data;
+
+		for (unsigned int idx = 0; idx < batch->n_packets; idx++) {
+			handler_data->packet = batch->packets[idx];
+
+			handler->handler (handler_data);
 		}
+	}
 
-		handler_data_delete (handler_data);
+}
+
+// deletes the packets that the handler method has not taken ownership of
+static void handler_batch_delete_packets (
+	HandlerBatch *batch, const PacketType *packet_types,
+	bool app_delete_packet, bool app_error_delete_packet, bool custom_delete_packet
+) {
+
+	for (unsigned int idx = 0; idx < batch->n_packets; idx++) {
+		switch (packet_types[idx]) {
+			case PACKET_TYPE_APP: if (app_delete_packet) packet_delete (batch->packets[idx]); break;
+			case PACKET_TYPE_APP_ERROR: if (app_error_delete_packet) packet_delete (batch->packets[idx]); break;
+			case PACKET_TYPE_CUSTOM: if (custom_delete_packet) packet_delete (batch->packets[idx]); break;
+
+			default: packet_delete (batch->packets[idx]); break;
+		}
+
+		batch->packets[idx] = NULL;
 	}
 
+	batch->n_packets = 0;
+
 }
 
 // while cerver is running, check for new jobs and handle them
-static void handler_do_while_admin (Handler *handler) {
+// the packets are handled in batches, so the working count is only updated once for each one
+static void handler_do_while_cerver (Handler *handler) {
 
 	if (handler) {
-		Job *job = NULL;
-		Packet *packet = NULL;
-		PacketType packet_type = PACKET_TYPE_NONE;
 		HandlerData *handler_data = handler_data_new ();
-		while (handler->cerver->isRunning) {
-			bsem_wait (handler->job_queue->has_jobs);
+		HandlerBatch *batch = handler_batch_new (handler->batch_size);
+		PacketType *packet_types = (PacketType *) calloc (handler->batch_size, sizeof (PacketType));
+		if (handler_data && batch && batch->packets && packet_types) {
+			while (handler->cerver->isRunning) {
+				job_queue_wait (handler->job_queue);
+
+				if (handler->cerver->isRunning && handler_batch_pull (handler, batch, packet_types)) {
+					pthread_mutex_lock (handler->cerver->handlers_lock);
+					handler->cerver->num_handlers_working += 1;
+					pthread_mutex_unlock (handler->cerver->handlers_lock);
+
+					handler_batch_handle (handler, batch, handler_data);
+
+					handler_batch_delete_packets (
+						batch, packet_types,
+						handler->cerver->app_packet_handler_delete_packet,
+						handler->cerver->app_error_packet_handler_delete_packet,
+						handler->cerver->custom_packet_handler_delete_packet
+					);
+
+					pthread_mutex_lock (handler->cerver->handlers_lock);
+					handler->cerver->num_handlers_working -= 1;
+					pthread_mutex_unlock (handler->cerver->handlers_lock);
+				}
+			}
+		}
+
+		if (packet_types) free (packet_types);
+		handler_batch_delete (batch);
+		handler_data_delete (handler_data);
+	}
 
-			if (handler->cerver->isRunning) {
-				pthread_mutex_lock (handler->cerver->admin->handlers_lock);
-				handler->cerver->admin->num_handlers_working += 1;
-				pthread_mutex_unlock (handler->cerver->admin->handlers_lock);
+}
 
-				// read job from queue
-				job = job_queue_pull (handler->job_queue);
-				if (job) {
-					packet = (Packet *) job->args;
-					packet_type = packet->header->packet_type;
+// while client is running, check for new jobs and handle them
+// the packets are handled in batches, so the working count is only updated once for each one
+static void handler_do_while_client (Handler *handler) {
 
-					handler_data->handler_id = handler->id;
-					handler_data->data = handler->data;
-					handler_data->packet = packet;
+	if (handler) {
+		HandlerData *handler_data = handler_data_new ();
+		HandlerBatch *batch = handler_batch_new (handler->batch_size);
+		PacketType *packet_types = (PacketType *) calloc (handler->batch_size, sizeof (PacketType));
+		if (handler_data && batch && batch->packets && packet_types) {
+			while (handler->client->running) {
+				job_queue_wait (handler->job_queue);
 
-					handler->handler (handler_data);
+				if (handler->client->running && handler_batch_pull (handler, batch, packet_types)) {
+					pthread_mutex_lock (handler->client->handlers_lock);
+					handler->client->num_handlers_working += 1;
+					pthread_mutex_unlock (handler->client->handlers_lock);
 
-					job_delete (job);
+					handler_batch_handle (handler, batch, handler_data);
 
-					switch (packet_type) {
-						case PACKET_TYPE_APP: if (handler->cerver->admin->app_packet_handler_delete_packet) packet_delete (packet); break;
-						case PACKET_TYPE_APP_ERROR: if (handler->cerver->admin->app_error_packet_handler_delete_packet) packet_delete (packet); break;
-						case PACKET_TYPE_CUSTOM: if (handler->cerver->admin->custom_packet_handler_delete_packet) packet_delete (packet); break;
+					handler_batch_delete_packets (batch, packet_types, true, true, true);
 
-						default: packet_delete (packet); break;
-					}
+					pthread_mutex_lock (handler->client->handlers_lock);
+					handler->client->num_handlers_working -= 1;
+					pthread_mutex_unlock (handler->client->handlers_lock);
 				}
+			}
+		}
+
+		if (packet_types) free (packet_types);
+		handler_batch_delete (batch);
+		handler_data_delete (handler_data);
+	}
+
+}
+
+// while cerver is running, check for new jobs and handle them
+// the packets are handled in batches, so the working count is only updated once for each one
+static void handler_do_while_admin (Handler *handler) {
 
-				pthread_mutex_lock (handler->cerver->admin->handlers_lock);
-				handler->cerver->admin->num_handlers_working -= 1;
-				pthread_mutex_unlock (handler->cerver->admin->handlers_lock);
+	if (handler) {
+		HandlerData *handler_data = handler_data_new ();
+		HandlerBatch *batch = handler_batch_new (handler->batch_size);
+		PacketType *packet_types = (PacketType *) calloc (handler->batch_size, sizeof (PacketType));
+		if (handler_data && batch && batch->packets && packet_types) {
+			while (handler->cerver->isRunning) {
+				job_queue_wait (handler->job_queue);
+
+				if (handler->cerver->isRunning && handler_batch_pull (handler, batch, packet_types)) {
+					pthread_mutex_lock (handler->cerver->admin->handlers_lock);
+					handler->cerver->admin->num_handlers_working += 1;
+					pthread_mutex_unlock (handler->cerver->admin->handlers_lock);
+
+					handler_batch_handle (handler, batch, handler_data);
+
+					handler_batch_delete_packets (
+						batch, packet_types,
+						handler->cerver->admin->app_packet_handler_delete_packet,
+						handler->cerver->admin->app_error_packet_handler_delete_packet,
+						handler->cerver->admin->custom_packet_handler_delete_packet
+					);
+
+					pthread_mutex_lock (handler->cerver->admin->handlers_lock);
+					handler->cerver->admin->num_handlers_working -= 1;
+					pthread_mutex_unlock (handler->cerver->admin->handlers_lock);
+				}
 			}
 		}
 
+		if (packet_types) free (packet_types);
+		handler_batch_delete (batch);
 		handler_data_delete (handler_data);
 	}
 
@@ -313,6 +589,8 @@ static void *handler_do (void *handler_ptr) {
 	if (handler_ptr) {
 		Handler *handler = (Handler *) handler_ptr;
 
+		handler_thread = true;
+
 		pthread_mutex_t *handlers_lock = NULL;
 		switch (handler->type) {
 			case HANDLER_TYPE_CERVER: handlers_lock = handler->cerver->handlers_lock; break;
@@ -333,7 +611,16 @@ static void *handler_do (void *handler_ptr) {
 			}
 
 			// printf ("%s\n", thread_name);
-			prctl (PR_SET_NAME, thread_name);
+			(void) thread_set_name (thread_name);
+		}
+
+		// the client's handlers keep the affinity of the thread that started them
+		switch (handler->type) {
+			case HANDLER_TYPE_CERVER:
+			case HANDLER_TYPE_ADMIN:
+				cerver_thread_setup (handler->cerver, CERVER_THREAD_ROLE_HANDLER, NULL);
+				break;
+			default: break;
 		}
 
 		// TODO: register to signals to handle multiple actions
@@ -430,16 +717,29 @@ int handler_start (Handler *handler) {
 
 SockReceive *sock_receive_new (void) {
 
-	SockReceive *sr = (SockReceive *) malloc (sizeof (SockReceive));
+	SockReceive *sr = (SockReceive *) malloc (
+		sizeof (SockReceive) + sizeof (PacketHeader)
+		+ PACKET_HEADER_V2_SIZE + PACKET_HEADER_CHECKSUM_SIZE
+	);
+
 	if (sr) {
 		sr->spare_packet = NULL;
 		sr->missing_packet = 0;
 
-		sr->header = NULL;
-		sr->header_end = NULL;
-		// sr->curr_header_pos = 0;
-		sr->remaining_header = 0;
-		sr->complete_header = false;
+		sr->header = (PacketHeader *) (sr + 1);
+		memset (sr->header, 0, sizeof (PacketHeader));
+		sr->header_size = 0;
+
+		sr->header_version = PACKET_HEADER_VERSION_V1;
+		sr->wire_header = (char *) (sr->header + 1);
+
+		sr->header_checksum = false;
+		sr->checksum = 0;
+
+		sr->compressed = false;
+
+		sr->max_packet_size = DEFAULT_MAX_PACKET_SIZE;
+		sr->failed = false;
 	}
 
 	return sr;
@@ -452,98 +752,376 @@ void sock_receive_delete (void *sock_receive_ptr) {
 		SockReceive *sock_receive = (SockReceive *) sock_receive_ptr;
 
 		packet_delete (sock_receive->spare_packet);
-		if (sock_receive->header) free (sock_receive->header);
 
 		free (sock_receive_ptr);
 	}
 
 }
 
-#pragma endregion
+// copies the next fragment of the spare packet in place
+// returns the spare packet when it is complete, NULL if it still needs more data
+static Packet *sock_receive_handle_spare_packet (
+	SockReceive *sock_receive,
+	const char *end, const size_t remaining, size_t *buffer_pos
+) {
 
-#pragma region handlers
+	Packet *packet = NULL;
 
-// handles a packet of type PACKET_TYPE_CLIENT
-static void cerver_client_packet_handler (Packet *packet) {
+	Packet *spare_packet = sock_receive->spare_packet;
+	size_t to_copy = (sock_receive->missing_packet < remaining) ?
+		sock_receive->missing_packet : remaining;
 
-	if (packet->header) {
-		switch (packet->header->request_type) {
-			// the client is going to close its current connection
-			// but will remain in the cerver if it has another connection active
-			// if not, it will be dropped
-			case CLIENT_PACKET_TYPE_CLOSE_CONNECTION: {
-				#ifdef CERVER_DEBUG
-				cerver_log_debug (
-					"Client %ld requested to close the connection",
-					packet->client->id
-				);
-				#endif
+	memcpy (
+		(char *) spare_packet->data + (spare_packet->data_size - sock_receive->missing_packet),
+		end, to_copy
+	);
 
-				// check if the client is inside a lobby
-				if (packet->lobby) {
-					#ifdef CERVER_DEBUG
-					cerver_log (
-						LOG_TYPE_DEBUG, LOG_TYPE_GAME,
-						"Client %ld inside lobby %s wants to close the connection...",
-						packet->client->id, packet->lobby->id->str
-					);
-					#endif
+	sock_receive->missing_packet -= to_copy;
+	*buffer_pos += to_copy;
 
-					// remove the player from the lobby
-					Player *player = player_get_by_sock_fd_list (packet->lobby, packet->connection->socket->sock_fd);
-					player_unregister_from_lobby (packet->lobby, player);
-				}
+	if (!sock_receive->missing_packet) {
+		packet = spare_packet;
+		sock_receive->spare_packet = NULL;
+	}
 
-				client_remove_connection_by_sock_fd (packet->cerver,
-					packet->client, packet->connection->socket->sock_fd);
-			} break;
+	return packet;
 
-			// the client is going to disconnect and will close all of its active connections
-			// so drop it from the server
-			case CLIENT_PACKET_TYPE_DISCONNECT: {
-				// check if the client is inside a lobby
-				if (packet->lobby) {
-					#ifdef CERVER_DEBUG
-					cerver_log (
-						LOG_TYPE_DEBUG, LOG_TYPE_GAME,
-						"Client %ld inside lobby %s wants to close the connection...",
-						packet->client->id, packet->lobby->id->str
-					);
-					#endif
+}
 
-					// remove the player from the lobby
-					Player *player = player_get_by_sock_fd_list (packet->lobby, packet->connection->socket->sock_fd);
-					player_unregister_from_lobby (packet->lobby, player);
-				}
+// gets the next v2 header from the buffer & decodes it into the sock receive's header
+// the bytes of a header that was cut between reads are completed in its wire header
+// returns NULL if the buffer does not have the complete header
+static PacketHeader *sock_receive_get_header_v2 (
+	SockReceive *sock_receive,
+	char *end, const size_t remaining, size_t *buffer_pos
+) {
 
-				client_drop (packet->cerver, packet->client);
+	PacketHeader *header = NULL;
 
-				cerver_event_trigger (
-					CERVER_EVENT_CLIENT_DISCONNECTED,
-					packet->cerver,
-					NULL, NULL
-				);
-			} break;
+	size_t header_size = sock_receive->header_checksum ?
+		PACKET_HEADER_V2_SIZE + PACKET_HEADER_CHECKSUM_SIZE : PACKET_HEADER_V2_SIZE;
 
-			default: {
-				#ifdef HANDLER_DEBUG
-				cerver_log (
-					LOG_TYPE_WARNING, LOG_TYPE_HANDLER,
-					"Got an unknown client packet in cerver %s",
-					packet->cerver->info->name->str
-				);
-				#endif
-			} break;
-		}
+	size_t to_copy = header_size - sock_receive->header_size;
+	if (remaining < to_copy) to_copy = remaining;
+
+	const char *wire_header = end;
+	if (sock_receive->header_size || (to_copy < header_size)) {
+		memcpy (sock_receive->wire_header + sock_receive->header_size, end, to_copy);
+		wire_header = sock_receive->wire_header;
 	}
 
-}
+	sock_receive->header_size += to_copy;
+	*buffer_pos += to_copy;
 
-static inline void cerver_request_get_file_actual (Packet *packet) {
+	if (sock_receive->header_size == header_size) {
+		sock_receive->header_size = 0;
 
-	FileCerver *file_cerver = (FileCerver *) packet->cerver->cerver_data;
+		// an invalid size is handled as any other bad header
+		if (sock_receive->header_checksum) {
+			(void) packet_header_v2_decode_checksum (
+				wire_header, sock_receive->header, &sock_receive->checksum
+			);
+		}
 
-	file_cerver->stats->n_files_requests += 1;
+		else {
+			(void) packet_header_v2_decode (wire_header, sock_receive->header);
+		}
+
+		sock_receive->compressed = (sock_receive->header->packet_type & PACKET_HEADER_V2_COMPRESSED);
+		sock_receive->header->packet_type &= ~PACKET_HEADER_V2_COMPRESSED;
+
+		header = sock_receive->header;
+	}
+
+	return header;
+
+}
+
+// gets the next packet header from the buffer, it is always copied into the sock receive's header
+// as it can be at any offset of the buffer, a header that was cut between reads is completed there
+// returns NULL if the buffer does not have the complete header
+static PacketHeader *sock_receive_get_header (
+	SockReceive *sock_receive,
+	char *end, const size_t remaining, size_t *buffer_pos
+) {
+
+	PacketHeader *header = NULL;
+
+	if (sock_receive->header_version == PACKET_HEADER_VERSION_V2) {
+		header = sock_receive_get_header_v2 (sock_receive, end, remaining, buffer_pos);
+	}
+
+	else if (sock_receive->header_size) {
+		size_t to_copy = sizeof (PacketHeader) - sock_receive->header_size;
+		if (remaining < to_copy) to_copy = remaining;
+
+		memcpy ((char *) sock_receive->header + sock_receive->header_size, end, to_copy);
+		sock_receive->header_size += to_copy;
+		*buffer_pos += to_copy;
+
+		if (sock_receive->header_size == sizeof (PacketHeader)) {
+			sock_receive->header_size = 0;
+
+			header = sock_receive->header;
+		}
+	}
+
+	else if (remaining >= sizeof (PacketHeader)) {
+		memcpy (sock_receive->header, end, sizeof (PacketHeader));
+		*buffer_pos += sizeof (PacketHeader);
+
+		header = sock_receive->header;
+	}
+
+	// copy the piece of header that was cut of between reads
+	else {
+		memcpy (sock_receive->header, end, remaining);
+		sock_receive->header_size = remaining;
+		*buffer_pos += remaining;
+	}
+
+	return header;
+
+}
+
+// creates a new packet from the buffer, if its data is not complete,
+// the packet's data is allocated once & it is kept as the spare packet
+static Packet *sock_receive_handle_new_packet (
+	SockReceive *sock_receive, PacketBuffer *packet_buffer,
+	char *buffer, const size_t buffer_size, size_t *buffer_pos
+) {
+
+	Packet *packet = NULL;
+
+	PacketHeader *header = sock_receive_get_header (
+		sock_receive,
+		buffer + *buffer_pos, buffer_size - *buffer_pos, buffer_pos
+	);
+
+	if (header) {
+		if (
+			(header->packet_size >= sizeof (PacketHeader))
+			&& (!sock_receive->max_packet_size || (header->packet_size <= sock_receive->max_packet_size))
+		) {
+			char *data = buffer + *buffer_pos;
+			size_t remaining = buffer_size - *buffer_pos;
+			size_t data_size = header->packet_size - sizeof (PacketHeader);
+
+			packet = packet_new ();
+			if (packet) {
+				packet->packet_size = header->packet_size;
+
+				// the checksum is checked once the packet's data is complete
+				if ((sock_receive->header_version == PACKET_HEADER_VERSION_V2) && sock_receive->header_checksum) {
+					packet->has_checksum = true;
+					packet->checksum = sock_receive->checksum;
+				}
+
+				// the data is decompressed once it is complete
+				packet->compressed = (sock_receive->header_version == PACKET_HEADER_VERSION_V2)
+					&& sock_receive->compressed;
+
+				if (remaining < data_size) {
+					packet_set_header (packet, header);
+					if (!packet_allocate_data (packet, data_size)) {
+						memcpy (packet->data, data, remaining);
+
+						sock_receive->spare_packet = packet;
+						sock_receive->missing_packet = data_size - remaining;
+					}
+
+					else {
+						cerver_log (
+							LOG_TYPE_ERROR, LOG_TYPE_PACKET,
+							"Failed to allocate %ld bytes for a new packet!", data_size
+						);
+
+						packet_delete (packet);
+					}
+
+					packet = NULL;
+					*buffer_pos = buffer_size;
+				}
+
+				else {
+					// a file upload request is followed by the file's contents,
+					// the ones that we already got are handled with the request
+					if (
+						(header->packet_type == PACKET_TYPE_REQUEST)
+						&& (header->request_type == REQUEST_PACKET_TYPE_SEND_FILE)
+					) {
+						// the file's contents are not covered by the request's checksum
+						packet->has_checksum = false;
+
+						data_size = remaining;
+					}
+
+					// complete packets can reference the received buffer instead of copying their data
+					packet_set_header (packet, header);
+					if (packet_buffer) packet_set_buffer_ref (packet, packet_buffer, data, data_size);
+					else packet_set_data (packet, data, data_size);
+
+					*buffer_pos += data_size;
+				}
+			}
+
+			else {
+				cerver_log (
+					LOG_TYPE_ERROR, LOG_TYPE_PACKET,
+					"Failed to create a new packet in sock_receive_next_packet ()"
+				);
+
+				*buffer_pos = buffer_size;
+			}
+		}
+
+		else {
+			cerver_log (
+				LOG_TYPE_WARNING, LOG_TYPE_PACKET,
+				"Got a packet of invalid size: %ld", header->packet_size
+			);
+
+			// the next header can't be found, so the rest of the stream is discarded
+			sock_receive->failed = true;
+			*buffer_pos = buffer_size;
+		}
+	}
+
+	return packet;
+
+}
+
+// gets the next complete packet from the buffer starting at buffer_pos
+// the pieces of packets & headers that are cut between reads are kept in the sock receive
+// if a packet buffer is provided, complete packets will reference it instead of copying their data
+// returns NULL when the rest of the buffer has been consumed or if the sock receive has failed
+Packet *sock_receive_next_packet (
+	SockReceive *sock_receive, PacketBuffer *packet_buffer,
+	char *buffer, const size_t buffer_size, size_t *buffer_pos
+) {
+
+	Packet *packet = NULL;
+
+	while (!packet && (*buffer_pos < buffer_size) && !sock_receive->failed) {
+		if (sock_receive->spare_packet) {
+			packet = sock_receive_handle_spare_packet (
+				sock_receive,
+				buffer + *buffer_pos, buffer_size - *buffer_pos, buffer_pos
+			);
+		}
+
+		else {
+			packet = sock_receive_handle_new_packet (
+				sock_receive, packet_buffer,
+				buffer, buffer_size, buffer_pos
+			);
+		}
+	}
+
+	return packet;
+
+}
+
+#pragma endregion
+
+#pragma region handlers
+
+// handles a packet of type PACKET_TYPE_CLIENT
+static void cerver_client_packet_handler (Packet *packet) {
+
+	if (packet->header) {
+		switch (packet->header->request_type) {
+			// the client is going to close its current connection
+			// but will remain in the cerver if it has another connection active
+			// if not, it will be dropped
+			case CLIENT_PACKET_TYPE_CLOSE_CONNECTION: {
+				#ifdef CERVER_DEBUG
+				cerver_log_debug (
+					"Client %ld requested to close the connection",
+					packet->client->id
+				);
+				#endif
+
+				// check if the client is inside a lobby
+				if (packet->lobby) {
+					#ifdef CERVER_DEBUG
+					cerver_log (
+						LOG_TYPE_DEBUG, LOG_TYPE_GAME,
+						"Client %ld inside lobby %s wants to close the connection...",
+						packet->client->id, packet->lobby->id->str
+					);
+					#endif
+
+					// remove the player from the lobby
+					Player *player = player_get_by_sock_fd_list (packet->lobby, packet->connection->socket->sock_fd);
+					player_unregister_from_lobby (packet->lobby, player);
+				}
+
+				client_remove_connection_by_sock_fd (packet->cerver,
+					packet->client, packet->connection->socket->sock_fd);
+			} break;
+
+			// the client is going to disconnect and will close all of its active connections
+			// so drop it from the server
+			case CLIENT_PACKET_TYPE_DISCONNECT: {
+				// check if the client is inside a lobby
+				if (packet->lobby) {
+					#ifdef CERVER_DEBUG
+					cerver_log (
+						LOG_TYPE_DEBUG, LOG_TYPE_GAME,
+						"Client %ld inside lobby %s wants to close the connection...",
+						packet->client->id, packet->lobby->id->str
+					);
+					#endif
+
+					// remove the player from the lobby
+					Player *player = player_get_by_sock_fd_list (packet->lobby, packet->connection->socket->sock_fd);
+					player_unregister_from_lobby (packet->lobby, player);
+				}
+
+				client_drop (packet->cerver, packet->client);
+
+				cerver_event_trigger (
+					CERVER_EVENT_CLIENT_DISCONNECTED,
+					packet->cerver,
+					NULL, NULL
+				);
+			} break;
+
+			// the client will send its next packets with the v2 header
+			case CLIENT_PACKET_TYPE_HEADER_V2:
+				(void) connection_header_v2_accept (packet->cerver, packet->client, packet->connection);
+				break;
+
+			// the client will send a checksum after its next headers
+			case CLIENT_PACKET_TYPE_CHECKSUMS:
+				(void) connection_checksums_accept (packet->cerver, packet->client, packet->connection);
+				break;
+
+			// the client will compress the data of its next big packets
+			case CLIENT_PACKET_TYPE_COMPRESSION:
+				(void) connection_compression_accept (packet->cerver, packet->client, packet->connection);
+				break;
+
+			default: {
+				#ifdef HANDLER_DEBUG
+				cerver_log (
+					LOG_TYPE_WARNING, LOG_TYPE_HANDLER,
+					"Got an unknown client packet in cerver %s",
+					packet->cerver->info->name->str
+				);
+				#endif
+			} break;
+		}
+	}
+
+}
+
+static inline void cerver_request_get_file_actual (Packet *packet) {
+
+	FileCerver *file_cerver = (FileCerver *) packet->cerver->cerver_data;
+
+	file_cerver->stats->n_files_requests += 1;
 
 	// get the necessary information to fulfil the request
 	if (packet->data_size >= sizeof (FileHeader)) {
@@ -800,15 +1378,7 @@ static void cerver_app_packet_handler (Packet *packet) {
 			if (packet->cerver->handlers[packet->header->handler_id]) {
 				// add the packet to the handler's job queueu to be handled
 				// as soon as the handler is available
-				if (job_queue_push (
-					packet->cerver->handlers[packet->header->handler_id]->job_queue,
-					job_create (NULL, packet)
-				)) {
-					cerver_log_error (
-						"Failed to push a new job to cerver's %s <%d> handler!",
-						packet->cerver->info->name->str, packet->header->handler_id
-					);
-				}
+				(void) handler_queue_packet (packet->cerver->handlers[packet->header->handler_id], packet);
 			}
 		}
 	}
@@ -824,15 +1394,7 @@ static void cerver_app_packet_handler (Packet *packet) {
 			else {
 				// add the packet to the handler's job queueu to be handled
 				// as soon as the handler is available
-				if (job_queue_push (
-					packet->cerver->app_packet_handler->job_queue,
-					job_create (NULL, packet)
-				)) {
-					cerver_log_error (
-						"Failed to push a new job to cerver's %s app_packet_handler!",
-						packet->cerver->info->name->str
-					);
-				}
+				(void) handler_queue_packet (packet->cerver->app_packet_handler, packet);
 			}
 		}
 
@@ -860,15 +1422,7 @@ static void cerver_app_error_packet_handler (Packet *packet) {
 		else {
 			// add the packet to the handler's job queueu to be handled
 			// as soon as the handler is available
-			if (job_queue_push (
-				packet->cerver->app_error_packet_handler->job_queue,
-				job_create (NULL, packet)
-			)) {
-				cerver_log_error (
-					"Failed to push a new job to cerver's %s app_error_packet_handler!",
-					packet->cerver->info->name->str
-				);
-			}
+			(void) handler_queue_packet (packet->cerver->app_error_packet_handler, packet);
 		}
 	}
 
@@ -895,15 +1449,7 @@ static void cerver_custom_packet_handler (Packet *packet) {
 		else {
 			// add the packet to the handler's job queueu to be handled
 			// as soon as the handler is available
-			if (job_queue_push (
-				packet->cerver->custom_packet_handler->job_queue,
-				job_create (NULL, packet)
-			)) {
-				cerver_log_error (
-					"Failed to push a new job to cerver's %s custom_packet_handler!",
-					packet->cerver->info->name->str
-				);
-			}
+			(void) handler_queue_packet (packet->cerver->custom_packet_handler, packet);
 		}
 	}
 
@@ -922,15 +1468,16 @@ static void cerver_packet_handler (void *packet_ptr) {
 	if (packet_ptr) {
 		Packet *packet = (Packet *) packet_ptr;
 
-		packet->cerver->stats->client_n_packets_received += 1;
-		packet->cerver->stats->total_n_packets_received += 1;
-		if (packet->lobby) packet->lobby->stats->n_packets_received += 1;
+		(void) __atomic_add_fetch (&packet->cerver->stats->client_n_packets_received, 1, __ATOMIC_RELAXED);
+		(void) __atomic_add_fetch (&packet->cerver->stats->total_n_packets_received, 1, __ATOMIC_RELAXED);
+		if (packet->lobby) (void) __atomic_add_fetch (&packet->lobby->stats->n_packets_received, 1, __ATOMIC_RELAXED);
 
 		bool good = true;
 		if (packet->cerver->check_packets) {
 			// we expect the packet version in the packet's data
 			if (packet->data) {
 				packet->version = (PacketVersion *) packet->data_ptr;
+				packet->version_ref = true;
 				packet->data_ptr += sizeof (PacketVersion);
 				good = packet_check (packet);
 			}
@@ -948,95 +1495,95 @@ static void cerver_packet_handler (void *packet_ptr) {
 				case PACKET_TYPE_CERVER: break;
 
 				case PACKET_TYPE_CLIENT:
-					packet->cerver->stats->received_packets->n_client_packets += 1;
-					packet->client->stats->received_packets->n_client_packets += 1;
-					packet->connection->stats->received_packets->n_client_packets += 1;
-					if (packet->lobby) packet->lobby->stats->received_packets->n_client_packets += 1;
+					(void) __atomic_add_fetch (&packet->cerver->stats->received_packets->n_client_packets, 1, __ATOMIC_RELAXED);
+					(void) __atomic_add_fetch (&packet->client->stats->received_packets->n_client_packets, 1, __ATOMIC_RELAXED);
+					(void) __atomic_add_fetch (&packet->connection->stats->received_packets->n_client_packets, 1, __ATOMIC_RELAXED);
+					if (packet->lobby) (void) __atomic_add_fetch (&packet->lobby->stats->received_packets->n_client_packets, 1, __ATOMIC_RELAXED);
 					cerver_client_packet_handler (packet);
 					packet_delete (packet);
 					break;
 
 				// handles an error from the client
 				case PACKET_TYPE_ERROR:
-					packet->cerver->stats->received_packets->n_error_packets += 1;
-					packet->client->stats->received_packets->n_error_packets += 1;
-					packet->connection->stats->received_packets->n_error_packets += 1;
-					if (packet->lobby) packet->lobby->stats->received_packets->n_error_packets += 1;
+					(void) __atomic_add_fetch (&packet->cerver->stats->received_packets->n_error_packets, 1, __ATOMIC_RELAXED);
+					(void) __atomic_add_fetch (&packet->client->stats->received_packets->n_error_packets, 1, __ATOMIC_RELAXED);
+					(void) __atomic_add_fetch (&packet->connection->stats->received_packets->n_error_packets, 1, __ATOMIC_RELAXED);
+					if (packet->lobby) (void) __atomic_add_fetch (&packet->lobby->stats->received_packets->n_error_packets, 1, __ATOMIC_RELAXED);
 					cerver_error_packet_handler (packet);
 					packet_delete (packet);
 					break;
 
 				// handles a request made from the client
 				case PACKET_TYPE_REQUEST:
-					packet->cerver->stats->received_packets->n_request_packets += 1;
-					packet->client->stats->received_packets->n_request_packets += 1;
-					packet->connection->stats->received_packets->n_request_packets += 1;
-					if (packet->lobby) packet->lobby->stats->received_packets->n_request_packets += 1;
+					(void) __atomic_add_fetch (&packet->cerver->stats->received_packets->n_request_packets, 1, __ATOMIC_RELAXED);
+					(void) __atomic_add_fetch (&packet->client->stats->received_packets->n_request_packets, 1, __ATOMIC_RELAXED);
+					(void) __atomic_add_fetch (&packet->connection->stats->received_packets->n_request_packets, 1, __ATOMIC_RELAXED);
+					if (packet->lobby) (void) __atomic_add_fetch (&packet->lobby->stats->received_packets->n_request_packets, 1, __ATOMIC_RELAXED);
 					cerver_request_packet_handler (packet);
 					packet_delete (packet);
 					break;
 
 				// handles authentication packets
 				case PACKET_TYPE_AUTH:
-					packet->cerver->stats->received_packets->n_auth_packets += 1;
-					packet->client->stats->received_packets->n_auth_packets += 1;
-					packet->connection->stats->received_packets->n_auth_packets += 1;
-					if (packet->lobby) packet->lobby->stats->received_packets->n_auth_packets += 1;
+					(void) __atomic_add_fetch (&packet->cerver->stats->received_packets->n_auth_packets, 1, __ATOMIC_RELAXED);
+					(void) __atomic_add_fetch (&packet->client->stats->received_packets->n_auth_packets, 1, __ATOMIC_RELAXED);
+					(void) __atomic_add_fetch (&packet->connection->stats->received_packets->n_auth_packets, 1, __ATOMIC_RELAXED);
+					if (packet->lobby) (void) __atomic_add_fetch (&packet->lobby->stats->received_packets->n_auth_packets, 1, __ATOMIC_RELAXED);
 					/* TODO: */
 					packet_delete (packet);
 					break;
 
 				// handles a game packet sent from the client
 				case PACKET_TYPE_GAME:
-					packet->cerver->stats->received_packets->n_game_packets += 1;
-					packet->client->stats->received_packets->n_game_packets += 1;
-					packet->connection->stats->received_packets->n_game_packets += 1;
-					if (packet->lobby) packet->lobby->stats->received_packets->n_game_packets += 1;
+					(void) __atomic_add_fetch (&packet->cerver->stats->received_packets->n_game_packets, 1, __ATOMIC_RELAXED);
+					(void) __atomic_add_fetch (&packet->client->stats->received_packets->n_game_packets, 1, __ATOMIC_RELAXED);
+					(void) __atomic_add_fetch (&packet->connection->stats->received_packets->n_game_packets, 1, __ATOMIC_RELAXED);
+					if (packet->lobby) (void) __atomic_add_fetch (&packet->lobby->stats->received_packets->n_game_packets, 1, __ATOMIC_RELAXED);
 					game_packet_handler (packet);
 					break;
 
 				// user set handler to handle app specific packets
 				case PACKET_TYPE_APP:
-					packet->cerver->stats->received_packets->n_app_packets += 1;
-					packet->client->stats->received_packets->n_app_packets += 1;
-					packet->connection->stats->received_packets->n_app_packets += 1;
-					if (packet->lobby) packet->lobby->stats->received_packets->n_app_packets += 1;
+					(void) __atomic_add_fetch (&packet->cerver->stats->received_packets->n_app_packets, 1, __ATOMIC_RELAXED);
+					(void) __atomic_add_fetch (&packet->client->stats->received_packets->n_app_packets, 1, __ATOMIC_RELAXED);
+					(void) __atomic_add_fetch (&packet->connection->stats->received_packets->n_app_packets, 1, __ATOMIC_RELAXED);
+					if (packet->lobby) (void) __atomic_add_fetch (&packet->lobby->stats->received_packets->n_app_packets, 1, __ATOMIC_RELAXED);
 					cerver_app_packet_handler (packet);
 					break;
 
 				// user set handler to handle app specific errors
 				case PACKET_TYPE_APP_ERROR:
-					packet->cerver->stats->received_packets->n_app_error_packets += 1;
-					packet->client->stats->received_packets->n_app_error_packets += 1;
-					packet->connection->stats->received_packets->n_app_error_packets += 1;
-					if (packet->lobby) packet->lobby->stats->received_packets->n_app_error_packets += 1;
+					(void) __atomic_add_fetch (&packet->cerver->stats->received_packets->n_app_error_packets, 1, __ATOMIC_RELAXED);
+					(void) __atomic_add_fetch (&packet->client->stats->received_packets->n_app_error_packets, 1, __ATOMIC_RELAXED);
+					(void) __atomic_add_fetch (&packet->connection->stats->received_packets->n_app_error_packets, 1, __ATOMIC_RELAXED);
+					if (packet->lobby) (void) __atomic_add_fetch (&packet->lobby->stats->received_packets->n_app_error_packets, 1, __ATOMIC_RELAXED);
 					cerver_app_error_packet_handler (packet);
 					break;
 
 				// custom packet hanlder
 				case PACKET_TYPE_CUSTOM:
-					packet->cerver->stats->received_packets->n_custom_packets += 1;
-					packet->client->stats->received_packets->n_custom_packets += 1;
-					packet->connection->stats->received_packets->n_custom_packets += 1;
-					if (packet->lobby) packet->lobby->stats->received_packets->n_custom_packets += 1;
+					(void) __atomic_add_fetch (&packet->cerver->stats->received_packets->n_custom_packets, 1, __ATOMIC_RELAXED);
+					(void) __atomic_add_fetch (&packet->client->stats->received_packets->n_custom_packets, 1, __ATOMIC_RELAXED);
+					(void) __atomic_add_fetch (&packet->connection->stats->received_packets->n_custom_packets, 1, __ATOMIC_RELAXED);
+					if (packet->lobby) (void) __atomic_add_fetch (&packet->lobby->stats->received_packets->n_custom_packets, 1, __ATOMIC_RELAXED);
 					cerver_custom_packet_handler (packet);
 					break;
 
 				// acknowledge the client we have received his test packet
 				case PACKET_TYPE_TEST:
-					packet->cerver->stats->received_packets->n_test_packets += 1;
-					packet->client->stats->received_packets->n_test_packets += 1;
-					packet->connection->stats->received_packets->n_test_packets += 1;
-					if (packet->lobby) packet->lobby->stats->received_packets->n_test_packets += 1;
+					(void) __atomic_add_fetch (&packet->cerver->stats->received_packets->n_test_packets, 1, __ATOMIC_RELAXED);
+					(void) __atomic_add_fetch (&packet->client->stats->received_packets->n_test_packets, 1, __ATOMIC_RELAXED);
+					(void) __atomic_add_fetch (&packet->connection->stats->received_packets->n_test_packets, 1, __ATOMIC_RELAXED);
+					if (packet->lobby) (void) __atomic_add_fetch (&packet->lobby->stats->received_packets->n_test_packets, 1, __ATOMIC_RELAXED);
 					cerver_test_packet_handler (packet);
 					packet_delete (packet);
 					break;
 
 				default: {
-					packet->cerver->stats->received_packets->n_bad_packets += 1;
-					packet->client->stats->received_packets->n_bad_packets += 1;
-					packet->connection->stats->received_packets->n_bad_packets += 1;
-					if (packet->lobby) packet->lobby->stats->received_packets->n_bad_packets += 1;
+					(void) __atomic_add_fetch (&packet->cerver->stats->received_packets->n_bad_packets, 1, __ATOMIC_RELAXED);
+					(void) __atomic_add_fetch (&packet->client->stats->received_packets->n_bad_packets, 1, __ATOMIC_RELAXED);
+					(void) __atomic_add_fetch (&packet->connection->stats->received_packets->n_bad_packets, 1, __ATOMIC_RELAXED);
+					if (packet->lobby) (void) __atomic_add_fetch (&packet->lobby->stats->received_packets->n_bad_packets, 1, __ATOMIC_RELAXED);
 					#ifdef HANDLER_DEBUG
 					cerver_log (
 						LOG_TYPE_WARNING, LOG_TYPE_PACKET,
@@ -1062,9 +1609,9 @@ static void cerver_packet_select_handler (ReceiveHandle *receive_handle, Packet
 			packet->client = receive_handle->client;
 			packet->connection = receive_handle->connection;
 
-			packet->cerver->stats->client_n_packets_received += 1;
-			packet->client->stats->n_packets_received += 1;
-			packet->connection->stats->n_packets_received += 1;
+			(void) __atomic_add_fetch (&packet->cerver->stats->client_n_packets_received, 1, __ATOMIC_RELAXED);
+			(void) __atomic_add_fetch (&packet->client->stats->n_packets_received, 1, __ATOMIC_RELAXED);
+			(void) __atomic_add_fetch (&packet->connection->stats->n_packets_received, 1, __ATOMIC_RELAXED);
 
 			cerver_packet_handler (packet);
 		} break;
@@ -1073,8 +1620,8 @@ static void cerver_packet_select_handler (ReceiveHandle *receive_handle, Packet
 			packet->cerver = receive_handle->cerver;
 			packet->connection = receive_handle->connection;
 
-			packet->cerver->stats->on_hold_n_packets_received += 1;
-			packet->connection->stats->n_packets_received += 1;
+			(void) __atomic_add_fetch (&packet->cerver->stats->on_hold_n_packets_received, 1, __ATOMIC_RELAXED);
+			(void) __atomic_add_fetch (&packet->connection->stats->n_packets_received, 1, __ATOMIC_RELAXED);
 
 			on_hold_packet_handler (packet);
 		} break;
@@ -1084,11 +1631,11 @@ static void cerver_packet_select_handler (ReceiveHandle *receive_handle, Packet
 			packet->connection = receive_handle->connection;
 			packet->client = receive_handle->admin->client;
 
-			packet->cerver->admin->stats->total_n_packets_received += 1;
+			(void) __atomic_add_fetch (&packet->cerver->admin->stats->total_n_packets_received, 1, __ATOMIC_RELAXED);
 
-			receive_handle->admin->client->stats->n_packets_received += 1;
+			(void) __atomic_add_fetch (&receive_handle->admin->client->stats->n_packets_received, 1, __ATOMIC_RELAXED);
 
-			packet->connection->stats->n_packets_received += 1;
+			(void) __atomic_add_fetch (&packet->connection->stats->n_packets_received, 1, __ATOMIC_RELAXED);
 
 			admin_packet_handler (packet);
 		} break;
@@ -1098,11 +1645,56 @@ static void cerver_packet_select_handler (ReceiveHandle *receive_handle, Packet
 
 }
 
+static void cerver_receive_count_bad_packet (ReceiveHandle *receive_handle) {
+
+	receive_handle->cerver->stats->received_packets->n_bad_packets += 1;
+	if (receive_handle->client) receive_handle->client->stats->received_packets->n_bad_packets += 1;
+	if (receive_handle->connection) receive_handle->connection->stats->received_packets->n_bad_packets += 1;
+
+}
+
+// drops a packet whose data can't be decompressed or does not match the checksum it came with
+static void cerver_receive_handle_bad_packet (ReceiveHandle *receive_handle, Packet *packet) {
+
+	cerver_receive_count_bad_packet (receive_handle);
+
+	#ifdef HANDLER_DEBUG
+	cerver_log (
+		LOG_TYPE_WARNING, LOG_TYPE_PACKET,
+		"Dropped a corrupted packet from sock fd %d in cerver %s.",
+		receive_handle->socket->sock_fd, receive_handle->cerver->info->name->str
+	);
+	#endif
+
+	packet_delete (packet);
+
+}
+
+// a header with an invalid packet size is counted as a bad packet & its connection is dropped,
+// the socket is shutdown so the connection's next receive fails & is handled as any other failed receive
+static void cerver_receive_handle_bad_stream (ReceiveHandle *receive_handle) {
+
+	cerver_receive_count_bad_packet (receive_handle);
+
+	#ifdef HANDLER_DEBUG
+	cerver_log (
+		LOG_TYPE_WARNING, LOG_TYPE_PACKET,
+		"Dropping sock fd %d in cerver %s because of a packet of invalid size.",
+		receive_handle->socket->sock_fd, receive_handle->cerver->info->name->str
+	);
+	#endif
+
+	(void) shutdown (receive_handle->socket->sock_fd, SHUT_RDWR);
+
+}
+
 #pragma endregion
 
 #pragma region receive
 
 u8 cerver_poll_unregister_sock_fd (Cerver *cerver, const i32 sock_fd);
+u8 cerver_epoll_unregister_sock_fd (Cerver *cerver, const i32 sock_fd);
+u8 cerver_uring_unregister_sock_fd (Cerver *cerver, const i32 sock_fd);
 
 static ReceiveHandle *receive_handle_new (void) {
 
@@ -1121,6 +1713,8 @@ static ReceiveHandle *receive_handle_new (void) {
 
 		receive_handle->buffer = NULL;
 		receive_handle->buffer_size = 0;
+
+		receive_handle->packet_buffer = NULL;
 	}
 
 	return receive_handle;
@@ -1172,7 +1766,11 @@ static inline void cerver_receive_create_normal (CerverReceive *cr, Cerver *cerv
 			// #endif
 
 			// remove the sock fd from the cerver's main poll array
-			cerver_poll_unregister_sock_fd (cerver, sock_fd);
+			switch (cerver->handler_type) {
+				case CERVER_HANDLER_TYPE_EPOLL: cerver_epoll_unregister_sock_fd (cerver, sock_fd); break;
+				case CERVER_HANDLER_TYPE_URING: cerver_uring_unregister_sock_fd (cerver, sock_fd); break;
+				default: cerver_poll_unregister_sock_fd (cerver, sock_fd); break;
+			}
 
 			// try to remove the sock fd from the cerver's map
 			const void *key = &sock_fd;
@@ -1286,53 +1884,12 @@ CerverReceive *cerver_receive_create_full (
 
 }
 
-static void cerver_receive_handle_spare_packet (ReceiveHandle *receive_handle,
-	SockReceive *sock_receive,
-	size_t buffer_size, char **end, size_t *buffer_pos) {
-
-	if (sock_receive) {
-		if (sock_receive->header) {
-			// copy the remaining header size
-			memcpy (sock_receive->header_end, (void *) *end, sock_receive->remaining_header);
-			// *end += sock_receive->remaining_header;
-			// *buffer_pos += sock_receive->remaining_header;
+// the buffers of each connection are handled in order by its socket's serial executor,
+// so they don't need the socket's read mutex
+static inline bool cerver_receive_is_ordered (const Cerver *cerver) {
 
-			// printf ("size in new header: %ld\n", ((PacketHeader *) sock_receive->header)->packet_size);
-			// packet_header_print (((PacketHeader *) sock_receive->header));
-
-			sock_receive->complete_header = true;
-		}
-
-		else if (sock_receive->spare_packet) {
-			size_t copy_to_spare = 0;
-			if (sock_receive->missing_packet < buffer_size)
-				copy_to_spare = sock_receive->missing_packet;
-
-			else copy_to_spare = buffer_size;
-
-			// printf ("copy to spare: %ld\n", copy_to_spare);
-
-			// append new data from buffer to the spare packet
-			if (copy_to_spare > 0) {
-				packet_append_data (sock_receive->spare_packet, (void *) *end, copy_to_spare);
-
-				// check if we can handle the packet
-				size_t curr_packet_size = sock_receive->spare_packet->data_size + sizeof (PacketHeader);
-				if (sock_receive->spare_packet->header->packet_size == curr_packet_size) {
-					cerver_packet_select_handler (receive_handle, sock_receive->spare_packet);
-					sock_receive->spare_packet = NULL;
-					sock_receive->missing_packet = 0;
-				}
-
-				else sock_receive->missing_packet -= copy_to_spare;
-
-				// offset for the buffer
-				if (copy_to_spare < buffer_size) *end += copy_to_spare;
-				*buffer_pos += copy_to_spare;
-				// printf ("buffer pos after copy to spare: %ld\n", *buffer_pos);
-			}
-		}
-	}
+	return cerver->ordered_dispatch && cerver->thpool
+		&& (cerver->handler_type != CERVER_HANDLER_TYPE_THREADS);
 
 }
 
@@ -1352,171 +1909,60 @@ void cerver_receive_handle_buffer (void *receive_handle_ptr) {
 		// size_t buffer_size = receive_handle->socket->packet_buffer_size;
 		Lobby *lobby = receive_handle->lobby;
 
-		pthread_mutex_lock (receive_handle->socket->read_mutex);
+		bool ordered = cerver_receive_is_ordered (cerver);
+		if (!ordered) pthread_mutex_lock (receive_handle->socket->read_mutex);
+
+		// the threads handler reuses its buffer for every recv ()
+		// so its packets can't reference it
+		PacketBuffer *packet_buffer = receive_handle->packet_buffer;
+		if (
+			!packet_buffer && buffer && cerver->zero_copy_packets
+			&& (cerver->handler_type != CERVER_HANDLER_TYPE_THREADS)
+		) {
+			packet_buffer = packet_buffer_create (buffer, buffer_size);
+		}
 
 		SockReceive *sock_receive = receive_handle->connection ? receive_handle->connection->sock_receive : NULL;
 		if (sock_receive) {
-			if (buffer && (buffer_size > 0)) {
-				char *end = buffer;
-				size_t buffer_pos = 0;
+			// the socket outlives its connection, so it can be uncorked
+			// even if the connection was dropped by one of its packets
+			bool corked = cerver->coalesce_sends && buffer && (buffer_size > 0);
+			if (corked) socket_cork (receive_handle->socket);
 
-				cerver_receive_handle_spare_packet (
-					receive_handle,
-					sock_receive,
-					buffer_size, &end, &buffer_pos
-				);
-
-				PacketHeader *header = NULL;
-				size_t packet_size = 0;
-				// char *packet_data = NULL;
-
-				size_t remaining_buffer_size = 0;
-				size_t packet_real_size = 0;
-				size_t to_copy_size = 0;
-
-				bool spare_header = false;
-
-				while (buffer_pos < buffer_size) {
-					remaining_buffer_size = buffer_size - buffer_pos;
-
-					if (sock_receive->complete_header) {
-						packet_header_copy (&header, (PacketHeader *) sock_receive->header);
-						// header = ((PacketHeader *) sock_receive->header);
-						// packet_header_print (header);
-
-						end += sock_receive->remaining_header;
-						buffer_pos += sock_receive->remaining_header;
-						// printf ("buffer pos after copy to header: %ld\n", buffer_pos);
-
-						// reset sock header values
-						free (sock_receive->header);
-						sock_receive->header = NULL;
-						sock_receive->header_end = NULL;
-						// sock_receive->curr_header_pos = 0;
-						// sock_receive->remaining_header = 0;
-						sock_receive->complete_header = false;
+			if (buffer && (buffer_size > 0)) {
+				bool failed = sock_receive->failed;
 
-						spare_header = true;
+				// the connection may be dropped by one of its packets,
+				// so its sock receive is only checked if the buffer was not completely handled
+				size_t buffer_pos = 0;
+				Packet *packet = NULL;
+				while ((buffer_pos < buffer_size) && (packet = sock_receive_next_packet (
+					sock_receive, cerver->zero_copy_packets ? packet_buffer : NULL,
+					buffer, buffer_size, &buffer_pos
+				))) {
+					packet->cerver = cerver;
+					packet->lobby = lobby;
+
+					// packets that were corrupted on their way are dropped
+					if (
+						!packet_decompress (
+							packet, receive_handle->connection->compressor,
+							sock_receive->max_packet_size, receive_handle->connection->stats
+						)
+						&& !packet_check_checksum (packet)
+					) {
+						cerver_packet_select_handler (receive_handle, packet);
 					}
 
-					else if (remaining_buffer_size >= sizeof (PacketHeader)) {
-						header = (PacketHeader *) end;
-						end += sizeof (PacketHeader);
-						buffer_pos += sizeof (PacketHeader);
-
-						// packet_header_print (header);
-
-						spare_header = false;
+					else {
+						cerver_receive_handle_bad_packet (receive_handle, packet);
 					}
+				}
 
-					if (header) {
-						// check the packet size
-						packet_size = header->packet_size;
-						if ((packet_size > 0) /* && (packet_size < 65536) */) {
-							// printf ("packet_size: %ld\n", packet_size);
-							// end += sizeof (PacketHeader);
-							// buffer_pos += sizeof (PacketHeader);
-							// printf ("first buffer pos: %ld\n", buffer_pos);
-
-							Packet *packet = packet_new ();
-							if (packet) {
-								packet_header_copy (&packet->header, header);
-								packet->packet_size = header->packet_size;
-								packet->cerver = cerver;
-								packet->lobby = lobby;
-
-								if (spare_header) {
-									free (header);
-									header = NULL;
-								}
+				if (!packet && !failed && sock_receive->failed) cerver_receive_handle_bad_stream (receive_handle);
+			}
 
-								// check for packet size and only copy what is in the current buffer
-								packet_real_size = packet->header->packet_size - sizeof (PacketHeader);
-								to_copy_size = 0;
-								if ((remaining_buffer_size - sizeof (PacketHeader)) < packet_real_size) {
-									sock_receive->spare_packet = packet;
-
-									if (spare_header) to_copy_size = buffer_size - sock_receive->remaining_header;
-									else to_copy_size = remaining_buffer_size - sizeof (PacketHeader);
-
-									sock_receive->missing_packet = packet_real_size - to_copy_size;
-								}
-
-								else {
-									if ((header->packet_type == PACKET_TYPE_REQUEST) && (header->request_type == REQUEST_PACKET_TYPE_SEND_FILE)) {
-										to_copy_size = remaining_buffer_size - sizeof (PacketHeader);
-									}
-
-									else {
-										to_copy_size = packet_real_size;
-									}
-
-									packet_delete (sock_receive->spare_packet);
-									sock_receive->spare_packet = NULL;
-								}
-
-								// printf ("to copy size: %ld\n", to_copy_size);
-								packet_set_data (packet, (void *) end, to_copy_size);
-
-								end += to_copy_size;
-								buffer_pos += to_copy_size;
-								// printf ("second buffer pos: %ld\n", buffer_pos);
-
-								if (!sock_receive->spare_packet) {
-									cerver_packet_select_handler (receive_handle, packet);
-								}
-
-							}
-
-							else {
-								cerver_log (
-									LOG_TYPE_ERROR, LOG_TYPE_PACKET,
-									"Failed to create a new packet in cerver_handle_receive_buffer ()"
-								);
-							}
-						}
-
-						else {
-							cerver_log (
-								LOG_TYPE_WARNING, LOG_TYPE_PACKET,
-								"Got a packet of invalid size: %ld", packet_size
-							);
-
-							// FIXME: what to do next?
-
-							break;
-						}
-					}
-
-					else {
-						if (sock_receive->spare_packet) packet_append_data (sock_receive->spare_packet, (void *) end, remaining_buffer_size);
-
-						else {
-							// handle part of a new header
-							// #ifdef CERVER_DEBUG
-							// cerver_log_debug ("Handle part of a new header...");
-							// #endif
-
-							// copy the piece of possible header that was cut of between recv ()
-							sock_receive->header = malloc (sizeof (PacketHeader));
-							memcpy (sock_receive->header, (void *) end, remaining_buffer_size);
-
-							sock_receive->header_end = (char *) sock_receive->header;
-							sock_receive->header_end += remaining_buffer_size;
-
-							// sock_receive->curr_header_pos = remaining_buffer_size;
-							sock_receive->remaining_header = sizeof (PacketHeader) - remaining_buffer_size;
-
-							// printf ("curr header pos: %d\n", sock_receive->curr_header_pos);
-							// printf ("remaining header: %d\n", sock_receive->remaining_header);
-
-							buffer_pos += remaining_buffer_size;
-						}
-					}
-
-					header = NULL;
-				}
-			}
+			if (corked) (void) socket_uncork (receive_handle->socket);
 		}
 
 		else {
@@ -1531,15 +1977,40 @@ void cerver_receive_handle_buffer (void *receive_handle_ptr) {
 
 		// 28/05/2020 -- deleting the created buffer from cerver_receive ()
 		// to correct handle both cases: using thpool and single threaded
+		if (packet_buffer) {
+			// if packets still reference the buffer, it will be deleted with the last one
+			// & a buffer that has an owner is always returned to it
+			buffer = packet_buffer_unref_take (packet_buffer);
+		}
+
 		if (cerver->handler_type != CERVER_HANDLER_TYPE_THREADS) {
-			// TODO: avoid deleting buffer every time
-			if (buffer) free (receive_handle->buffer);
+			// the buffer is kept by the socket to be used in the next recv (),
+			// unless it was grown to fit a burst, as only then it holds more than the receive buffer size
+			if (buffer_size <= cerver->receive_buffer_size)
+				socket_receive_buffer_release (receive_handle->socket, buffer, cerver->receive_buffer_size);
+			else
+				free (buffer);
 		}
 
 		// free (receive->socket->packet_buffer);
 		// receive->socket->packet_buffer = NULL;
 
-		pthread_mutex_unlock (receive_handle->socket->read_mutex);
+		if (!ordered) pthread_mutex_unlock (receive_handle->socket->read_mutex);
+
+		receive_handle_delete (receive_handle);
+	}
+
+}
+
+// discards a buffer that was queued for a connection that has been dropped,
+// its socket may have been reused, so the buffer is not returned to it
+static void cerver_receive_handle_buffer_discard (void *receive_handle_ptr) {
+
+	if (receive_handle_ptr) {
+		ReceiveHandle *receive_handle = (ReceiveHandle *) receive_handle_ptr;
+
+		if (receive_handle->packet_buffer) packet_buffer_unref (receive_handle->packet_buffer);
+		else if (receive_handle->buffer) free (receive_handle->buffer);
 
 		receive_handle_delete (receive_handle);
 	}
@@ -1554,7 +2025,8 @@ static void cerver_receive_handle_failed (void *cr_ptr) {
 		CerverReceive *cr = (CerverReceive *) cr_ptr;
 
 		if (cr->socket) {
-			pthread_mutex_lock (cr->socket->read_mutex);
+			bool ordered = cerver_receive_is_ordered (cr->cerver);
+			if (!ordered) pthread_mutex_lock (cr->socket->read_mutex);
 
 			if (cr->socket->sock_fd > 0) {
 				switch (cr->type) {
@@ -1582,7 +2054,7 @@ static void cerver_receive_handle_failed (void *cr_ptr) {
 				}
 			}
 
-			pthread_mutex_unlock (cr->socket->read_mutex);
+			if (!ordered) pthread_mutex_unlock (cr->socket->read_mutex);
 		}
 
 		cerver_receive_delete (cr);
@@ -1595,7 +2067,16 @@ void cerver_switch_receive_handle_failed (CerverReceive *cr) {
 
 	if (cr) {
 		if (cr->cerver->thpool) {
-			if (thpool_add_work (cr->cerver->thpool, cerver_receive_handle_failed, cr)) {
+			// after the buffers that were received before it
+			// a connection that was already dropped by one of its packets has cancelled it
+			int failed = (cerver_receive_is_ordered (cr->cerver) && cr->socket) ?
+				thpool_add_serial_work (
+					cr->cerver->thpool, socket_dispatch_get (cr->socket),
+					cerver_receive_handle_failed, cerver_receive_delete, cr
+				) :
+				thpool_add_work (cr->cerver->thpool, cerver_receive_handle_failed, cr);
+
+			if (failed) {
 				cerver_log (
 					LOG_TYPE_ERROR, LOG_TYPE_NONE,
 					"Failed to add cerver_receive_handle_failed () to cerver's %s thpool!",
@@ -1611,7 +2092,10 @@ void cerver_switch_receive_handle_failed (CerverReceive *cr) {
 
 }
 
-static inline void cerver_receive_success_receive_handle (CerverReceive *cr, ssize_t rc, char *packet_buffer) {
+static inline void cerver_receive_success_receive_handle (
+	CerverReceive *cr, ssize_t rc,
+	char *packet_buffer, PacketBuffer *owned_buffer
+) {
 
 	ReceiveHandle *receive_handle = receive_handle_new ();
 	if (receive_handle) {
@@ -1629,14 +2113,27 @@ static inline void cerver_receive_success_receive_handle (CerverReceive *cr, ssi
 		receive_handle->buffer = packet_buffer;
 		receive_handle->buffer_size = rc;
 
+		receive_handle->packet_buffer = owned_buffer;
+
 		switch (receive_handle->cerver->handler_type) {
 			case CERVER_HANDLER_TYPE_NONE: break;
 
-			case CERVER_HANDLER_TYPE_POLL: {
+			case CERVER_HANDLER_TYPE_POLL:
+			case CERVER_HANDLER_TYPE_EPOLL:
+			case CERVER_HANDLER_TYPE_URING:
+			case CERVER_HANDLER_TYPE_REACTORS: {
 				if (cr->cerver->thpool) {
 					// 28/05/2020 -- 02:37 -- added thpool here instead of cerver_poll ()
 					// and it seems to be working as expected
-					if (!thpool_add_work (cr->cerver->thpool, cr->cerver->handle_received_buffer, receive_handle)) {
+					int failed = cerver_receive_is_ordered (cr->cerver) ?
+						thpool_add_serial_work (
+							cr->cerver->thpool, socket_dispatch_get (cr->socket),
+							cr->cerver->handle_received_buffer, cerver_receive_handle_buffer_discard,
+							receive_handle
+						) :
+						thpool_add_work (cr->cerver->thpool, cr->cerver->handle_received_buffer, receive_handle);
+
+					if (!failed) {
 						// cerver_log_debug (
 						// 	"Added %s cr->cerver->handle_received_buffer () to thpool!",
 						//     cr->cerver->info->name->str
@@ -1678,7 +2175,11 @@ static inline void cerver_receive_success_receive_handle (CerverReceive *cr, ssi
 
 }
 
-static void cerver_receive_success (CerverReceive *cr, ssize_t rc, char *packet_buffer) {
+// owned_buffer is set if the packet buffer belongs to someone else & is released with it
+static void cerver_receive_success (
+	CerverReceive *cr, ssize_t rc,
+	char *packet_buffer, PacketBuffer *owned_buffer
+) {
 
 	// cerver_log (
 	// 	LOG_TYPE_DEBUG, LOG_TYPE_CERVER,
@@ -1686,10 +2187,20 @@ static void cerver_receive_success (CerverReceive *cr, ssize_t rc, char *packet_
 	//     cr->cerver->info->name->str, rc, cr->socket->sock_fd
 	// );
 
-	cr->socket->packet_buffer_size = rc;
+	// each reactor only updates its own stats
+	CerverReactor *reactor = ((cr->type == RECEIVE_TYPE_NORMAL) && cr->connection) ?
+		cr->connection->reactor : NULL;
+
+	if (reactor) {
+		reactor->stats->total_n_receives_done += 1;
+		reactor->stats->total_bytes_received += rc;
+	}
 
-	cr->cerver->stats->total_n_receives_done += 1;
-	cr->cerver->stats->total_bytes_received += rc;
+	// the stats can be updated from many threads at once
+	else {
+		(void) __atomic_add_fetch (&cr->cerver->stats->total_n_receives_done, 1, __ATOMIC_RELAXED);
+		(void) __atomic_add_fetch (&cr->cerver->stats->total_bytes_received, rc, __ATOMIC_RELAXED);
+	}
 
 	switch (cr->cerver->type) {
 		case CERVER_TYPE_WEB:
@@ -1698,132 +2209,248 @@ static void cerver_receive_success (CerverReceive *cr, ssize_t rc, char *packet_
 
 		default: {
 			if (cr->lobby) {
-				cr->lobby->stats->n_receives_done += 1;
-				cr->lobby->stats->bytes_received += rc;
+				(void) __atomic_add_fetch (&cr->lobby->stats->n_receives_done, 1, __ATOMIC_RELAXED);
+				(void) __atomic_add_fetch (&cr->lobby->stats->bytes_received, rc, __ATOMIC_RELAXED);
 			}
 
 			switch (cr->type) {
 				case RECEIVE_TYPE_NORMAL: {
-					cr->cerver->stats->client_receives_done += 1;
-					cr->cerver->stats->client_bytes_received += rc;
+					if (reactor) {
+						reactor->stats->client_receives_done += 1;
+						reactor->stats->client_bytes_received += rc;
+					}
+
+					else {
+						(void) __atomic_add_fetch (&cr->cerver->stats->client_receives_done, 1, __ATOMIC_RELAXED);
+						(void) __atomic_add_fetch (&cr->cerver->stats->client_bytes_received, rc, __ATOMIC_RELAXED);
+					}
 
-					cr->client->stats->n_receives_done += 1;
-					cr->client->stats->total_bytes_received += rc;
+					(void) __atomic_add_fetch (&cr->client->stats->n_receives_done, 1, __ATOMIC_RELAXED);
+					(void) __atomic_add_fetch (&cr->client->stats->total_bytes_received, rc, __ATOMIC_RELAXED);
 
-					cr->connection->stats->n_receives_done += 1;
-					cr->connection->stats->total_bytes_received += rc;
+					(void) __atomic_add_fetch (&cr->connection->stats->n_receives_done, 1, __ATOMIC_RELAXED);
+					(void) __atomic_add_fetch (&cr->connection->stats->total_bytes_received, rc, __ATOMIC_RELAXED);
 				} break;
 
 				case RECEIVE_TYPE_ON_HOLD: {
-					cr->cerver->stats->on_hold_receives_done += 1;
-					cr->cerver->stats->on_hold_bytes_received += rc;
+					(void) __atomic_add_fetch (&cr->cerver->stats->on_hold_receives_done, 1, __ATOMIC_RELAXED);
+					(void) __atomic_add_fetch (&cr->cerver->stats->on_hold_bytes_received, rc, __ATOMIC_RELAXED);
 
-					cr->connection->stats->n_receives_done += 1;
-					cr->connection->stats->total_bytes_received += rc;
+					(void) __atomic_add_fetch (&cr->connection->stats->n_receives_done, 1, __ATOMIC_RELAXED);
+					(void) __atomic_add_fetch (&cr->connection->stats->total_bytes_received, rc, __ATOMIC_RELAXED);
 				} break;
 
 				case RECEIVE_TYPE_ADMIN: {
-					cr->cerver->admin->stats->total_n_receives_done += 1;
-					cr->cerver->admin->stats->total_bytes_received += rc;
+					(void) __atomic_add_fetch (&cr->cerver->admin->stats->total_n_receives_done, 1, __ATOMIC_RELAXED);
+					(void) __atomic_add_fetch (&cr->cerver->admin->stats->total_bytes_received, rc, __ATOMIC_RELAXED);
 
-					cr->client->stats->n_receives_done += 1;
-					cr->client->stats->total_bytes_received += rc;
+					(void) __atomic_add_fetch (&cr->client->stats->n_receives_done, 1, __ATOMIC_RELAXED);
+					(void) __atomic_add_fetch (&cr->client->stats->total_bytes_received, rc, __ATOMIC_RELAXED);
 
-					cr->connection->stats->n_receives_done += 1;
-					cr->connection->stats->total_bytes_received += rc;
+					(void) __atomic_add_fetch (&cr->connection->stats->n_receives_done, 1, __ATOMIC_RELAXED);
+					(void) __atomic_add_fetch (&cr->connection->stats->total_bytes_received, rc, __ATOMIC_RELAXED);
 				} break;
 
 				default: break;
 			}
 
-			cerver_receive_success_receive_handle (cr, rc, packet_buffer);
+			cerver_receive_success_receive_handle (cr, rc, packet_buffer, owned_buffer);
 		} break;
 	}
 
 }
 
-// receive all incoming data from the socket
-void cerver_receive (void *cerver_receive_ptr) {
+static CerverReceive *cerver_receive_copy (const CerverReceive *cr) {
 
-	if (cerver_receive_ptr) {
-		CerverReceive *cr = (CerverReceive *) cerver_receive_ptr;
+	CerverReceive *copy = cerver_receive_new ();
+	if (copy) memcpy (copy, cr, sizeof (CerverReceive));
 
-		if (cr->cerver && cr->socket) {
-			if (cr->socket->sock_fd > 0) {
-				char *packet_buffer = (char *) calloc (cr->cerver->receive_buffer_size, sizeof (char));
-				// cr->socket->packet_buffer = (char *) calloc (cr->cerver->receive_buffer_size, sizeof (char));
-				if (packet_buffer) {
-					// ssize_t rc = read (cr->sock_fd, packet_buffer, cr->cerver->receive_buffer_size);
-					ssize_t rc = recv (cr->socket->sock_fd, packet_buffer, cr->cerver->receive_buffer_size, 0);
-
-					switch (rc) {
-						case -1: {
-							// no more data to read
-							if (errno != EWOULDBLOCK) {
-								#ifdef CERVER_DEBUG
-								cerver_log (
-									LOG_TYPE_ERROR, LOG_TYPE_CERVER,
-									"cerver_receive () - rc < 0 - sock fd: %d",
-									cr->socket->sock_fd
-								);
+	return copy;
 
-								perror ("Error ");
-								#endif
+}
 
-								cerver_switch_receive_handle_failed (cr);
-							}
+// moves the data that was read into the spare buffer to the end of the packet buffer
+// the packet buffer grows to fit all the data, so it always ends up with more data than
+// the cerver's receive buffer size & it is freed instead of being kept by the socket
+// returns 0 on success, 1 on error
+static u8 cerver_receive_internal_spare (
+	char **packet_buffer, size_t *buffer_size, const size_t received,
+	const char *spare, const size_t spare_size
+) {
+
+	u8 retval = 1;
+
+	size_t new_size = *buffer_size * 2;
+	if (new_size < (received + spare_size)) new_size = received + spare_size;
+
+	char *new_buffer = (char *) realloc (*packet_buffer, new_size);
+	if (new_buffer) {
+		memcpy (new_buffer + received, spare, spare_size);
 
-							free (packet_buffer);
-						} break;
+		*packet_buffer = new_buffer;
+		*buffer_size = new_size;
 
-						case 0: {
-							// man recv -> steam socket perfomed an orderly shutdown
-							// but in dgram it might mean something?
-							#ifdef CERVER_DEBUG
+		retval = 0;
+	}
+
+	return retval;
+
+}
+
+// reads from the cr's socket until there is no more data or until the cerver's receive budget is reached
+// every recvmsg () fills the free space at the end of the packet buffer & a spare buffer,
+// so big bursts are received with a few calls, everything is handled as a single received buffer
+// returns 0 if the receive budget was reached (more data might be waiting), 1 if there is nothing more to read
+// or if the connection has failed, in all cases cr has been consumed
+static u8 cerver_receive_internal (CerverReceive *cr) {
+
+	u8 retval = 1;
+
+	// reads are paused until the connection drains its outbound queue,
+	// the cerver re-arms the sock fd when they are resumed
+	if (cr->socket && socket_outbound_paused (cr->socket)) {
+		cerver_receive_delete (cr);
+	}
+
+	else if (cr->cerver && cr->socket && (cr->socket->sock_fd > 0)) {
+		Cerver *cerver = cr->cerver;
+		const i32 sock_fd = cr->socket->sock_fd;
+
+		size_t buffer_size = cerver->receive_buffer_size;
+		char *packet_buffer = socket_receive_buffer_get (cr->socket, buffer_size);
+		if (packet_buffer) {
+			char spare[RECEIVE_SPARE_BUFFER_SIZE];
+			struct iovec iov[2];
+
+			// the poll handler's sock fds are blocking, so we never wait for more data
+			struct msghdr msg = { 0 };
+			msg.msg_iov = iov;
+			msg.msg_iovlen = 2;
+
+			size_t received = 0;
+			bool drained = false;
+			bool failed = false;
+
+			ssize_t rc = 0;
+			u32 n_reads = 0;
+			while (!drained && !failed && (n_reads < cerver->receive_budget)) {
+				iov[0].iov_base = packet_buffer + received;
+				iov[0].iov_len = buffer_size - received;
+				iov[1].iov_base = spare;
+				iov[1].iov_len = RECEIVE_SPARE_BUFFER_SIZE;
+
+				rc = recvmsg (sock_fd, &msg, MSG_DONTWAIT);
+				if (rc > 0) {
+					n_reads += 1;
+
+					if ((size_t) rc > iov[0].iov_len) {
+						if (cerver_receive_internal_spare (
+							&packet_buffer, &buffer_size, received + iov[0].iov_len,
+							spare, (size_t) rc - iov[0].iov_len
+						)) {
 							cerver_log (
-								LOG_TYPE_DEBUG, LOG_TYPE_CERVER,
-								"cerver_recieve () - rc == 0 - sock fd: %d",
-								cr->socket->sock_fd
+								LOG_TYPE_ERROR, LOG_TYPE_HANDLER,
+								"cerver_receive () - Failed to grow packet buffer for connection with sock fd <%d>!",
+								sock_fd
 							);
 
-							// perror ("Error ");
-							#endif
+							failed = true;
+						}
+					}
 
-							cerver_switch_receive_handle_failed (cr);
+					if (!failed) received += (size_t) rc;
+				}
 
-							free (packet_buffer);
-						} break;
+				// man recv -> steam socket perfomed an orderly shutdown
+				else if (!rc) {
+					#ifdef CERVER_DEBUG
+					cerver_log (
+						LOG_TYPE_DEBUG, LOG_TYPE_CERVER,
+						"cerver_recieve () - rc == 0 - sock fd: %d",
+						sock_fd
+					);
+					#endif
 
-						default: {
-							cerver_receive_success (cr, rc, packet_buffer);
-						} break;
-					}
+					failed = true;
+				}
 
-					// 28/05/2020 -- 02:40
-					// packet_buffer is not free from inside cr->cerver->handle_received_buffer ()
-					// free (packet_buffer);
+				// no more data to read
+				else if ((errno == EAGAIN) || (errno == EWOULDBLOCK)) {
+					drained = true;
 				}
 
-				else {
+				else if (errno != EINTR) {
+					#ifdef CERVER_DEBUG
 					cerver_log (
-						LOG_TYPE_ERROR, LOG_TYPE_HANDLER,
-						"cerver_receive () - Failed to allocate packet buffer for connection with sock fd <%d>!",
-						cr->connection->socket->sock_fd
+						LOG_TYPE_ERROR, LOG_TYPE_CERVER,
+						"cerver_receive () - rc < 0 - sock fd: %d",
+						sock_fd
 					);
+
+					perror ("Error ");
+					#endif
+
+					failed = true;
 				}
 			}
 
+			if (received) {
+				// the data that was read before the connection failed still needs to be handled
+				CerverReceive *failed_cr = failed ? cerver_receive_copy (cr) : NULL;
+
+				// packet_buffer is released from inside cr->cerver->handle_received_buffer ()
+				cerver_receive_success (cr, (ssize_t) received, packet_buffer, NULL);
+
+				cr = failed_cr;
+			}
+
+			else if (failed) {
+				free (packet_buffer);
+			}
+
 			else {
-				cerver_log_warning ("cerver_receive () - cr->socket <= 0");
-				cerver_receive_delete (cr);
+				socket_receive_buffer_release (cr->socket, packet_buffer, buffer_size);
+			}
+
+			if (failed) {
+				if (cr) cerver_switch_receive_handle_failed (cr);
+			}
+
+			else {
+				if (!drained) retval = 0;
+				if (!received) cerver_receive_delete (cr);
 			}
 		}
 
 		else {
+			cerver_log (
+				LOG_TYPE_ERROR, LOG_TYPE_HANDLER,
+				"cerver_receive () - Failed to allocate packet buffer for connection with sock fd <%d>!",
+				sock_fd
+			);
+
 			cerver_receive_delete (cr);
 		}
 	}
 
+	else {
+		if (cr->socket && (cr->socket->sock_fd <= 0))
+			cerver_log_warning ("cerver_receive () - cr->socket <= 0");
+
+		cerver_receive_delete (cr);
+	}
+
+	return retval;
+
+}
+
+// receive all incoming data from the socket, up to the cerver's receive budget
+void cerver_receive (void *cerver_receive_ptr) {
+
+	if (cerver_receive_ptr) {
+		(void) cerver_receive_internal ((CerverReceive *) cerver_receive_ptr);
+	}
+
 }
 
 // packet buffer only gets deleted if cerver_receive_handle_buffer () is used
@@ -1874,7 +2501,7 @@ static inline u8 cerver_receive_threads_actual (
 		} break;
 
 		default: {
-			cerver_receive_success (cr, rc, buffer);
+			cerver_receive_success (cr, rc, buffer, NULL);
 
 			retval = 0;
 		} break;
@@ -1902,7 +2529,7 @@ static void *cerver_receive_threads (void *cerver_receive_ptr) {
 	(void) sock_set_timeout (sock_fd, DEFAULT_SOCKET_RECV_TIMEOUT);
 
 	const size_t buffer_size = cr->cerver->receive_buffer_size;
-	char *buffer = (char *) calloc (buffer_size, sizeof (char));
+	char *buffer = socket_receive_buffer_get (cr->socket, buffer_size);
 	if (buffer) {
 		while (
 			(cr->socket->sock_fd > 0)
@@ -1910,7 +2537,7 @@ static void *cerver_receive_threads (void *cerver_receive_ptr) {
 			&& !cerver_receive_threads_actual (cr, buffer, buffer_size)
 		);
 
-		free (buffer);
+		socket_receive_buffer_release (cr->socket, buffer, buffer_size);
 	}
 
 	else {
@@ -1949,10 +2576,12 @@ static void *cerver_receive_http (void *cerver_receive_ptr) {
 
 	i32 sock_fd = cr->socket->sock_fd;
 	ssize_t rc = 0;
-	do {
-		char *packet_buffer = (char *) calloc (cr->cerver->receive_buffer_size, sizeof (char));
-		if (packet_buffer) {
-			rc = recv (cr->socket->sock_fd, packet_buffer, cr->cerver->receive_buffer_size, 0);
+
+	const size_t buffer_size = cr->cerver->receive_buffer_size;
+	char *packet_buffer = socket_receive_buffer_get (cr->socket, buffer_size);
+	if (packet_buffer) {
+		do {
+			rc = recv (cr->socket->sock_fd, packet_buffer, buffer_size, 0);
 
 			switch (rc) {
 				case -1: {
@@ -1982,21 +2611,21 @@ static void *cerver_receive_http (void *cerver_receive_ptr) {
 				} break;
 
 				default: {
-					cerver_receive_success (cr, rc, packet_buffer);
+					cerver_receive_success (cr, rc, packet_buffer, NULL);
 				} break;
 			}
+		} while (rc > 0);
 
-			free (packet_buffer);
-		}
+		socket_receive_buffer_release (cr->socket, packet_buffer, buffer_size);
+	}
 
-		else {
-			cerver_log (
-				LOG_TYPE_ERROR, LOG_TYPE_HANDLER,
-				"cerver_receive_http () - Failed to allocate packet buffer for connection with sock fd <%d>!",
-				cr->connection->socket->sock_fd
-			);
-		}
-	} while (rc > 0);
+	else {
+		cerver_log (
+			LOG_TYPE_ERROR, LOG_TYPE_HANDLER,
+			"cerver_receive_http () - Failed to allocate packet buffer for connection with sock fd <%d>!",
+			cr->connection->socket->sock_fd
+		);
+	}
 
 	cerver_log (
 		LOG_TYPE_DEBUG, LOG_TYPE_CERVER,
@@ -2039,6 +2668,7 @@ static Connection *cerver_connection_create (Cerver *cerver,
 
 					// from connection_create ()
 					retval->socket->sock_fd = new_fd;
+					socket_dispatch_reset (retval->socket);
 					memcpy (&retval->address, &client_address, sizeof (struct sockaddr_storage));
 					retval->protocol = cerver->protocol;
 
@@ -2054,6 +2684,9 @@ static Connection *cerver_connection_create (Cerver *cerver,
 		else {
 			retval = connection_create (new_fd, client_address, cerver->protocol);
 		}
+
+		if (retval && retval->sock_receive)
+			retval->sock_receive->max_packet_size = cerver->max_packet_size;
 	}
 
 	return retval;
@@ -2074,7 +2707,7 @@ static u8 cerver_register_new_connection_auth_required (Cerver *cerver, Connecti
 		);
 		#endif
 
-		cerver->stats->total_on_hold_connections += 1;
+		(void) __atomic_add_fetch (&cerver->stats->total_on_hold_connections, 1, __ATOMIC_RELAXED);
 
 		connection->active = true;
 
@@ -2227,6 +2860,9 @@ static u8 cerver_register_new_connection_normal_default (Cerver *cerver, Connect
 				case CERVER_HANDLER_TYPE_NONE: break;
 
 				case CERVER_HANDLER_TYPE_POLL:
+				case CERVER_HANDLER_TYPE_EPOLL:
+				case CERVER_HANDLER_TYPE_URING:
+				case CERVER_HANDLER_TYPE_REACTORS:
 					// nothing to be done, as connection will be handled by poll ()
 					// after being registered to the cerver
 					retval = 0;     // success
@@ -2334,13 +2970,19 @@ static inline u8 cerver_register_new_connection_select (Cerver *cerver, Connecti
 
 }
 
+// the reactor is only used with CERVER_HANDLER_TYPE_REACTORS
 static void cerver_register_new_connection (
-	Cerver *cerver,
+	Cerver *cerver, CerverReactor *reactor,
 	const i32 new_fd, const struct sockaddr_storage client_address
 ) {
 
 	Connection *connection = cerver_connection_create (cerver, new_fd, client_address);
 	if (connection) {
+		connection->reactor = reactor;
+
+		if (cerver->zero_copy_sends)
+			(void) socket_set_zero_copy (connection->socket, cerver->zero_copy_send_threshold);
+
 		// #ifdef CERVER_DEBUG
 		cerver_log (
 			LOG_TYPE_DEBUG, LOG_TYPE_CLIENT,
@@ -2382,58 +3024,67 @@ static void cerver_register_new_connection (
 
 }
 
-// accepst a new connection to the cerver
-static void cerver_accept (void *cerver_ptr) {
-
-	if (cerver_ptr) {
-		Cerver *cerver = (Cerver *) cerver_ptr;
-
-		struct sockaddr_storage client_address;
-		memset (&client_address, 0, sizeof (struct sockaddr_storage));
-		socklen_t socklen = sizeof (struct sockaddr_storage);
+CerverAcceptBatch *cerver_accept_batch_create (
+	Cerver *cerver, CerverReactor *reactor
+) {
 
-		// accept the new connection
-		i32 new_fd = accept (cerver->sock, (struct sockaddr *) &client_address, &socklen);
-		if (new_fd > 0) {
-			printf ("Accepted fd: %d\n", new_fd);
-			cerver_register_new_connection (cerver, new_fd, client_address);
-		}
+	CerverAcceptBatch *batch = (CerverAcceptBatch *) malloc (sizeof (CerverAcceptBatch));
+	if (batch) {
+		batch->cerver = cerver;
+		batch->reactor = reactor;
 
-		else {
-			// if we get EWOULDBLOCK, we have accepted all connections
-			if (errno != EWOULDBLOCK) {
-				cerver_log (LOG_TYPE_ERROR, LOG_TYPE_CERVER, "Accept failed!");
-				perror ("Error");
-			}
+		batch->n_accepted = 0;
+		batch->accepted = (CerverAccepted *) calloc (cerver->max_accepts, sizeof (CerverAccepted));
+		if (!batch->accepted) {
+			free (batch);
+			batch = NULL;
 		}
 	}
 
+	return batch;
+
 }
 
-#pragma endregion
+void cerver_accept_batch_delete (void *batch_ptr) {
 
-#pragma region poll
+	if (batch_ptr) {
+		CerverAcceptBatch *batch = (CerverAcceptBatch *) batch_ptr;
 
-// reallocs main cerver poll fds
-// returns 0 on success, 1 on error
-u8 cerver_realloc_main_poll_fds (Cerver *cerver) {
+		if (batch->accepted) free (batch->accepted);
+
+		free (batch);
+	}
+
+}
+
+// accepts a single connection from the sock
+// the new sock fd is created with the flags that are passed to accept4 ()
+// returns 0 on success, 1 if there are no more pending connections or on error
+static u8 cerver_accept_single (
+	Cerver *cerver, const i32 sock, const int flags,
+	CerverAccepted *accepted
+) {
 
 	u8 retval = 1;
 
-	if (cerver) {
-		u32 current_max = cerver->max_n_fds;
-		cerver->max_n_fds *= 2;
-		cerver->fds = (struct pollfd *) realloc (cerver->fds, cerver->max_n_fds * sizeof (struct pollfd));
-		if (cerver->fds) {
-			#pragma GCC diagnostic push
-			#pragma GCC diagnostic ignored "-Wunused-value"
+	memset (&accepted->address, 0, sizeof (struct sockaddr_storage));
+	socklen_t socklen = sizeof (struct sockaddr_storage);
 
-			for (u32 i = current_max; i < cerver->max_n_fds; i++)
-				cerver->fds[i].fd == -1;
+	accepted->sock_fd = accept4 (sock, (struct sockaddr *) &accepted->address, &socklen, flags);
+	if (accepted->sock_fd > -1) {
+		retval = 0;
+	}
 
-			#pragma GCC diagnostic pop
+	else {
+		// if we get EWOULDBLOCK, we have accepted all connections
+		// ECONNABORTED means that the connection was closed while in the queue
+		if ((errno != EWOULDBLOCK) && (errno != EAGAIN) && (errno != ECONNABORTED) && (errno != EINTR)) {
+			cerver_log (
+				LOG_TYPE_ERROR, LOG_TYPE_CERVER,
+				"Cerver %s accept failed!", cerver->info->name->str
+			);
 
-			retval = 0;
+			perror ("Error");
 		}
 	}
 
@@ -2441,41 +3092,132 @@ u8 cerver_realloc_main_poll_fds (Cerver *cerver) {
 
 }
 
-// get a free index in the main cerver poll array
-i32 cerver_poll_get_free_idx (Cerver *cerver) {
+// only the handlers that read until EAGAIN need non blocking sock fds,
+// the poll & threads handlers keep them blocking so their sends wait until they are done
+static inline int cerver_accept_flags (const Cerver *cerver) {
 
-	if (cerver) {
-		for (u32 i = 0; i < cerver->max_n_fds; i++)
-			if (cerver->fds[i].fd == -1) return i;
+	int flags = SOCK_CLOEXEC;
+	switch (cerver->handler_type) {
+		case CERVER_HANDLER_TYPE_EPOLL:
+		case CERVER_HANDLER_TYPE_URING:
+		case CERVER_HANDLER_TYPE_REACTORS:
+			flags |= SOCK_NONBLOCK;
+			break;
+
+		default: break;
 	}
 
-	return -1;
+	return flags;
 
 }
 
-// get the idx of the connection sock fd in the cerver poll fds
-i32 cerver_poll_get_idx_by_sock_fd (Cerver *cerver, i32 sock_fd) {
+// accepts pending connections from the sock until there are no more or the batch is full
+// returns the n of connections that were accepted
+u32 cerver_accept_batch (CerverAcceptBatch *batch, const i32 sock) {
+
+	const int flags = cerver_accept_flags (batch->cerver);
+
+	batch->n_accepted = 0;
+	while (
+		(batch->n_accepted < batch->cerver->max_accepts)
+		&& !cerver_accept_single (
+			batch->cerver, sock, flags,
+			&batch->accepted[batch->n_accepted]
+		)
+	) {
+		batch->n_accepted += 1;
+	}
+
+	return batch->n_accepted;
 
-	if (cerver) {
-		for (u32 i = 0; i < cerver->max_n_fds; i++)
-			if (cerver->fds[i].fd == sock_fd) return i;
+}
+
+// registers every connection in the batch to the cerver & deletes the batch
+void cerver_accept_batch_register (void *batch_ptr) {
+
+	if (batch_ptr) {
+		CerverAcceptBatch *batch = (CerverAcceptBatch *) batch_ptr;
+
+		for (u32 idx = 0; idx < batch->n_accepted; idx++) {
+			cerver_register_new_connection (
+				batch->cerver, batch->reactor,
+				batch->accepted[idx].sock_fd, batch->accepted[idx].address
+			);
+		}
+
+		#ifdef HANDLER_DEBUG
+		cerver_log_debug (
+			"Cerver %s registered %d new connections",
+			batch->cerver->info->name->str, batch->n_accepted
+		);
+		#endif
+
+		cerver_accept_batch_delete (batch);
+	}
+
+}
+
+// accepts all the pending connections (up to cerver->max_accepts) in the calling thread
+// so the listening socket is not reported again until they are taken,
+// then they are registered in the cerver's thpool if available
+static void cerver_accept (Cerver *cerver) {
+
+	CerverAcceptBatch *batch = cerver_accept_batch_create (cerver, NULL);
+	if (batch) {
+		if (cerver_accept_batch (batch, cerver->sock)) {
+			if (cerver->thpool) {
+				if (thpool_add_work (cerver->thpool, cerver_accept_batch_register, batch)) {
+					cerver_log_error (
+						"Failed to add cerver_accept_batch_register () to cerver's %s thpool!",
+						cerver->info->name->str
+					);
+
+					cerver_accept_batch_register (batch);
+				}
+			}
+
+			else {
+				cerver_accept_batch_register (batch);
+			}
+		}
+
+		else {
+			cerver_accept_batch_delete (batch);
+		}
+	}
+
+	else {
+		cerver_log_error (
+			"Failed to allocate cerver %s accept batch!",
+			cerver->info->name->str
+		);
 	}
 
-	return -1;
+}
+
+// waits for a single new connection in the cerver's blocking socket
+static void cerver_accept_blocking (Cerver *cerver) {
+
+	CerverAccepted accepted = { 0 };
+	if (!cerver_accept_single (cerver, cerver->sock, SOCK_CLOEXEC, &accepted)) {
+		cerver_register_new_connection (cerver, NULL, accepted.sock_fd, accepted.address);
+	}
 
 }
 
+#pragma endregion
+
+#pragma region poll
+
 static u8 cerver_poll_register_connection_internal (Cerver *cerver, Connection *connection) {
 
 	u8 retval = 1;
 
-	i32 idx = cerver_poll_get_free_idx (cerver);
-	if (idx > 0) {
-		cerver->fds[idx].fd = connection->socket->sock_fd;
-		cerver->fds[idx].events = POLLIN;
+	i32 idx = poll_fds_add (cerver->poll_fds, connection->socket->sock_fd, POLLIN);
+	if (idx > -1) {
 		cerver->current_n_fds++;
 
-		cerver->stats->current_active_client_connections++;
+		(void) __atomic_add_fetch (&cerver->stats->current_active_client_connections, 1, __ATOMIC_RELAXED);
 
 		#ifdef CERVER_DEBUG
 		cerver_log (
@@ -2523,7 +3265,7 @@ u8 cerver_poll_register_connection (Cerver *cerver, Connection *connection) {
 			);
 			#endif
 
-			if (cerver_realloc_main_poll_fds (cerver)) {
+			if (poll_fds_realloc (cerver->poll_fds)) {
 				cerver_log (
 					LOG_TYPE_ERROR, LOG_TYPE_NONE,
 					"Failed to realloc cerver %s main poll fds!",
@@ -2553,14 +3295,12 @@ u8 cerver_poll_unregister_sock_fd (Cerver *cerver, const i32 sock_fd) {
 	if (cerver) {
 		pthread_mutex_lock (cerver->poll_lock);
 
-		// get the idx of the sock fd in the cerver poll fds
-		i32 idx = cerver_poll_get_idx_by_sock_fd (cerver, sock_fd);
-		if (idx > 0) {
-			cerver->fds[idx].fd = -1;
-			cerver->fds[idx].events = -1;
+		// the slot is released but the array is compacted after handling the current events
+		i32 idx = poll_fds_remove (cerver->poll_fds, sock_fd);
+		if (idx > -1) {
 			cerver->current_n_fds--;
 
-			cerver->stats->current_active_client_connections--;
+			(void) __atomic_sub_fetch (&cerver->stats->current_active_client_connections, 1, __ATOMIC_RELAXED);
 
 			#ifdef CERVER_DEBUG
 			cerver_log (
@@ -2607,29 +3347,28 @@ u8 cerver_poll_unregister_connection (Cerver *cerver, Connection *connection) {
 
 }
 
-static inline void cerver_poll_handle_actual_accept (Cerver *cerver) {
-
-	if (cerver->thpool) {
-		if (thpool_add_work (cerver->thpool, cerver_accept, cerver))  {
-			cerver_log_error (
-				"Failed to add cerver_accept () to cerver's %s thpool!",
-				cerver->info->name->str
-			);
-		}
-	}
+// the completions of the zero copy sends are reported as socket errors
+// returns true if the connection's socket does not have an actual error
+static inline bool cerver_connection_zero_copy_handle (CerverReceive *cr) {
 
-	else {
-		cerver_accept (cerver);
-	}
+	return cr->socket ? socket_zero_copy_handle_error (cr->socket) : false;
 
 }
 
 static inline void cerver_poll_handle_actual_receive (Cerver *cerver, const u32 idx, CerverReceive *cr) {
 
-	switch (cerver->fds[idx].revents) {
+	// the completions of the zero copy sends are not handled as errors
+	if (
+		(cerver->poll_fds->fds[idx].revents & POLLERR)
+		&& cerver_connection_zero_copy_handle (cr)
+	) {
+		cerver->poll_fds->fds[idx].revents &= ~POLLERR;
+	}
+
+	switch (cerver->poll_fds->fds[idx].revents) {
 		// A connection setup has been completed or new data arrived
 		case POLLIN: {
-			// printf ("Receive fd: %d\n", cerver->fds[i].fd);
+			// printf ("Receive fd: %d\n", cerver->poll_fds->fds[idx].fd);
 
 			if (cerver->thpool) {
 				// pthread_mutex_lock (socket->mutex);
@@ -2678,11 +3417,15 @@ static inline void cerver_poll_handle_actual_receive (Cerver *cerver, const u32
 		} break;
 
 		default: {
-			if (cerver->fds[idx].revents != 0) {
+			if (cerver->poll_fds->fds[idx].revents != 0) {
 				// 17/06/2020 -- 15:06 -- handle as failed any other signal
 				// to avoid hanging up at 100% or getting a segfault
 				cerver_switch_receive_handle_failed (cr);
 			}
+
+			else {
+				cerver_receive_delete (cr);
+			}
 		} break;
 	}
 
@@ -2694,14 +3437,16 @@ static inline void cerver_poll_handle (Cerver *cerver) {
 		if (cerver->thpool) pthread_mutex_lock (cerver->poll_lock);
 
 		// one or more fd(s) are readable, need to determine which ones they are
-		for (u32 idx = 0; idx < cerver->max_n_fds; idx++) {
-			if (cerver->fds[idx].fd != -1) {
-				if (idx == 0) {
-					cerver_poll_handle_actual_accept (cerver);
+		// only the first n_fds slots are used, released ones have a -1 fd
+		PollFds *poll_fds = cerver->poll_fds;
+		for (u32 idx = 0; idx < poll_fds->n_fds; idx++) {
+			if ((poll_fds->fds[idx].fd != -1) && poll_fds->fds[idx].revents) {
+				if (poll_fds->fds[idx].fd == cerver->sock) {
+					cerver_accept (cerver);
 				}
 
 				else {
-					CerverReceive *cr = cerver_receive_create (RECEIVE_TYPE_NORMAL, cerver, cerver->fds[idx].fd);
+					CerverReceive *cr = cerver_receive_create (RECEIVE_TYPE_NORMAL, cerver, poll_fds->fds[idx].fd);
 					if (cr) {
 						cerver_poll_handle_actual_receive (cerver, idx, cr);
 					}
@@ -2709,7 +3454,11 @@ static inline void cerver_poll_handle (Cerver *cerver) {
 			}
 		}
 
-		if (cerver->thpool) pthread_mutex_unlock (cerver->poll_lock);
+		// fill the slots that were released by dropped connections
+		// so the next poll () only checks the active ones
+		if (!cerver->thpool) pthread_mutex_lock (cerver->poll_lock);
+		poll_fds_compact (cerver->poll_fds);
+		pthread_mutex_unlock (cerver->poll_lock);
 	}
 
 }
@@ -2732,7 +3481,7 @@ u8 cerver_poll (Cerver *cerver) {
 
 		int poll_retval = 0;
 		while (cerver->isRunning) {
-			poll_retval = poll (cerver->fds, cerver->max_n_fds, cerver->poll_timeout);
+			poll_retval = poll (cerver->poll_fds->fds, cerver->poll_fds->n_fds, cerver->poll_timeout);
 
 			switch (poll_retval) {
 				case -1: {
@@ -2782,6 +3531,1442 @@ u8 cerver_poll (Cerver *cerver) {
 
 #pragma endregion
 
+#pragma region epoll
+
+// connections are always edge triggered, if they have an outbound queue,
+// they are also notified every time their socket becomes writable again
+static inline u32 cerver_epoll_connection_events (const Cerver *cerver) {
+
+	return cerver->outbound_queues ? (EPOLLIN | EPOLLOUT | EPOLLET) : (EPOLLIN | EPOLLET);
+
+}
+
+// creates the connection's outbound queue if the cerver uses them
+// returns 0 on success, 1 on error
+static u8 cerver_connection_outbound_init (Cerver *cerver, Connection *connection) {
+
+	u8 retval = 0;
+
+	if (cerver->outbound_queues && !connection->socket->outbound) {
+		SocketOutbound *outbound = socket_outbound_create (
+			cerver->outbound_low_watermark, cerver->outbound_high_watermark,
+			cerver->outbound_policy
+		);
+
+		if (outbound) socket_set_outbound (connection->socket, outbound);
+		else retval = 1;
+	}
+
+	return retval;
+
+}
+
+// flushes the connection's outbound queue when its socket is writable again
+// returns true if the connection's reads were resumed & its sock fd needs to be re-armed
+static inline bool cerver_connection_outbound_handle (CerverReceive *cr) {
+
+	bool resumed = false;
+
+	if (cr->socket && cr->socket->outbound)
+		(void) socket_outbound_flush (cr->socket, &resumed);
+
+	return resumed;
+
+}
+
+static u8 cerver_epoll_ctl (Cerver *cerver, const int op, const i32 sock_fd, const u32 events) {
+
+	struct epoll_event event = { 0 };
+	event.events = events;
+	event.data.fd = sock_fd;
+
+	return epoll_ctl (cerver->epoll_fd, op, sock_fd, &event) ? 1 : 0;
+
+}
+
+// registers the cerver's listening socket to the cerver's epoll
+// the listening socket is level triggered, so no connection is lost
+// if cerver_accept () does not take all the pending ones
+// returns 0 on success, 1 on error
+u8 cerver_epoll_register_sock_fd (Cerver *cerver, const i32 sock_fd) {
+
+	return cerver ? cerver_epoll_ctl (cerver, EPOLL_CTL_ADD, sock_fd, EPOLLIN) : 1;
+
+}
+
+// registers a client connection to the cerver's epoll
+// connections are edge triggered, so they must be read until EAGAIN
+// returns 0 on success, 1 on error
+u8 cerver_epoll_register_connection (Cerver *cerver, Connection *connection) {
+
+	u8 retval = 1;
+
+	if (cerver && connection && !cerver_connection_outbound_init (cerver, connection)) {
+		if (!cerver_epoll_ctl (
+			cerver,
+			EPOLL_CTL_ADD, connection->socket->sock_fd, cerver_epoll_connection_events (cerver)
+		)) {
+			pthread_mutex_lock (cerver->poll_lock);
+			cerver->current_n_fds++;
+			(void) __atomic_add_fetch (&cerver->stats->current_active_client_connections, 1, __ATOMIC_RELAXED);
+			pthread_mutex_unlock (cerver->poll_lock);
+
+			#ifdef CERVER_DEBUG
+			cerver_log (
+				LOG_TYPE_DEBUG, LOG_TYPE_CERVER,
+				"Added sock fd <%d> to cerver %s epoll",
+				connection->socket->sock_fd, cerver->info->name->str
+			);
+			#endif
+
+			#ifdef CERVER_STATS
+			cerver_log (
+				LOG_TYPE_CERVER, LOG_TYPE_NONE,
+				"Cerver %s current active connections: %ld",
+				cerver->info->name->str, cerver->stats->current_active_client_connections
+			);
+			#endif
+
+			retval = 0;
+		}
+
+		else {
+			cerver_log (
+				LOG_TYPE_ERROR, LOG_TYPE_CERVER,
+				"Failed to add sock fd <%d> to cerver %s epoll!",
+				connection->socket->sock_fd, cerver->info->name->str
+			);
+		}
+	}
+
+	return retval;
+
+}
+
+// removes a sock fd from the cerver's epoll
+// returns 0 on success, 1 on error
+u8 cerver_epoll_unregister_sock_fd (Cerver *cerver, const i32 sock_fd) {
+
+	u8 retval = 1;
+
+	if (cerver) {
+		if (!cerver_epoll_ctl (cerver, EPOLL_CTL_DEL, sock_fd, 0)) {
+			pthread_mutex_lock (cerver->poll_lock);
+			cerver->current_n_fds--;
+			(void) __atomic_sub_fetch (&cerver->stats->current_active_client_connections, 1, __ATOMIC_RELAXED);
+			pthread_mutex_unlock (cerver->poll_lock);
+
+			#ifdef CERVER_DEBUG
+			cerver_log (
+				LOG_TYPE_DEBUG, LOG_TYPE_CERVER,
+				"Removed sock fd <%d> from cerver %s epoll",
+				sock_fd, cerver->info->name->str
+			);
+			#endif
+
+			#ifdef CERVER_STATS
+			cerver_log (
+				LOG_TYPE_CERVER, LOG_TYPE_NONE,
+				"Cerver %s current active connections: %ld",
+				cerver->info->name->str, cerver->stats->current_active_client_connections
+			);
+			#endif
+
+			retval = 0;     // removed the sock fd form the cerver epoll
+		}
+
+		else {
+			// #ifdef CERVER_DEBUG
+			cerver_log (
+				LOG_TYPE_WARNING, LOG_TYPE_CERVER,
+				"Sock fd <%d> was NOT found in cerver %s epoll!",
+				sock_fd, cerver->info->name->str
+			);
+			// #endif
+		}
+	}
+
+	return retval;
+
+}
+
+// unregisters a client connection from the cerver's epoll
+// returns 0 on success, 1 on error
+u8 cerver_epoll_unregister_connection (Cerver *cerver, Connection *connection) {
+
+	return (cerver && connection) ?
+		cerver_epoll_unregister_sock_fd (cerver, connection->socket->sock_fd) : 1;
+
+}
+
+// as the connection is edge triggered, cerver_receive_internal () reads until there is no more data,
+// if the receive budget was reached first, the sock fd is re-armed to get a new event for the remaining data
+// the connection's outbound queue is flushed first if its socket is writable
+// & an error event is ignored if it only reported completed zero copy sends
+static inline void cerver_epoll_handle_actual_receive (Cerver *cerver, const i32 sock_fd, u32 events) {
+
+	CerverReceive *cr = cerver_receive_create (RECEIVE_TYPE_NORMAL, cerver, sock_fd);
+	if (cr) {
+		if ((events & EPOLLERR) && cerver_connection_zero_copy_handle (cr)) events &= ~EPOLLERR;
+
+		bool rearm = (events & EPOLLOUT) ? cerver_connection_outbound_handle (cr) : false;
+
+		if (events & EPOLLIN) {
+			if (!cerver_receive_internal (cr)) rearm = true;
+		}
+
+		else if (events & (EPOLLHUP | EPOLLERR)) {
+			cerver_switch_receive_handle_failed (cr);
+			rearm = false;
+		}
+
+		else {
+			cerver_receive_delete (cr);
+		}
+
+		if (rearm) {
+			(void) cerver_epoll_ctl (cerver, EPOLL_CTL_MOD, sock_fd, cerver_epoll_connection_events (cerver));
+		}
+	}
+
+}
+
+static inline void cerver_epoll_handle (Cerver *cerver, const int n_events) {
+
+	struct epoll_event *event = NULL;
+	for (int idx = 0; idx < n_events; idx++) {
+		event = &cerver->epoll_events[idx];
+
+		if (event->data.fd == cerver->sock) {
+			cerver_accept (cerver);
+		}
+
+		// new data arrived - this also reports an orderly shutdown as recv () will return 0
+		// or the socket is writable again & the connection's outbound queue can be flushed
+		// or the kernel completed zero copy sends
+		else if (event->events & (EPOLLIN | EPOLLOUT | EPOLLERR)) {
+			cerver_epoll_handle_actual_receive (cerver, event->data.fd, event->events);
+		}
+
+		// the connection is broken or an asynchronous error occurred
+		else if (event->events & (EPOLLHUP | EPOLLERR)) {
+			CerverReceive *cr = cerver_receive_create (RECEIVE_TYPE_NORMAL, cerver, event->data.fd);
+			if (cr) cerver_switch_receive_handle_failed (cr);
+		}
+	}
+
+}
+
+// cerver epoll loop that only handles the sockets that are ready
+u8 cerver_epoll (Cerver *cerver) {
+
+	u8 retval = 1;
+
+	if (cerver) {
+		cerver_log (
+			LOG_TYPE_SUCCESS, LOG_TYPE_CERVER,
+			"Cerver %s ready in port %d!",
+			cerver->info->name->str, cerver->port
+		);
+
+		#ifdef CERVER_DEBUG
+		cerver_log (LOG_TYPE_DEBUG, LOG_TYPE_CERVER, "Waiting for connections...");
+		#endif
+
+		int n_events = 0;
+		while (cerver->isRunning) {
+			n_events = epoll_wait (
+				cerver->epoll_fd,
+				cerver->epoll_events, cerver->epoll_max_events,
+				cerver->poll_timeout
+			);
+
+			switch (n_events) {
+				case -1: {
+					// we were interrupted by a signal handler
+					if (errno == EINTR) break;
+
+					cerver_log (
+						LOG_TYPE_ERROR, LOG_TYPE_CERVER,
+						"Cerver %s main epoll has failed!", cerver->info->name->str
+					);
+
+					perror ("Error");
+					cerver->isRunning = false;
+				} break;
+
+				case 0: break;
+
+				default: {
+					cerver_epoll_handle (cerver, n_events);
+				} break;
+			}
+		}
+
+		#ifdef CERVER_DEBUG
+		cerver_log (
+			LOG_TYPE_CERVER, LOG_TYPE_NONE,
+			"Cerver %s main epoll has stopped!", cerver->info->name->str
+		);
+		#endif
+
+		retval = 0;
+	}
+
+	else {
+		cerver_log (
+			LOG_TYPE_ERROR, LOG_TYPE_CERVER,
+			"Can't listen for connections on a NULL cerver!"
+		);
+	}
+
+	return retval;
+
+}
+
+#pragma endregion
+
+#pragma region udp
+
+// a packet can't be continued in another datagram
+static inline void cerver_udp_sock_receive_reset (SockReceive *sock_receive) {
+
+	if (sock_receive->spare_packet) {
+		packet_delete (sock_receive->spare_packet);
+		sock_receive->spare_packet = NULL;
+	}
+
+	sock_receive->missing_packet = 0;
+	sock_receive->header_size = 0;
+
+	sock_receive->failed = false;
+
+}
+
+// new peers always start with a v1 header, so the datagram must start
+// with a complete packet of a known type before the peer is registered
+static bool cerver_udp_peer_datagram_is_valid (
+	const Cerver *cerver, const char *buffer, const size_t buffer_size
+) {
+
+	bool retval = false;
+
+	if (buffer_size >= sizeof (PacketHeader)) {
+		PacketHeader header = { 0 };
+		memcpy (&header, buffer, sizeof (PacketHeader));
+
+		retval = (header.packet_type > PACKET_TYPE_NONE)
+			&& (header.packet_type <= PACKET_TYPE_TEST)
+			&& (header.packet_size >= sizeof (PacketHeader))
+			&& (header.packet_size <= buffer_size)
+			&& (!cerver->max_packet_size || (header.packet_size <= cerver->max_packet_size));
+	}
+
+	return retval;
+
+}
+
+// creates a client with a connection for the new peer & registers it to the cerver
+// returns NULL on error
+static Client *cerver_udp_register_peer (Cerver *cerver, const struct sockaddr_storage *address) {
+
+	Client *client = NULL;
+
+	Connection *connection = connection_create (cerver->sock, *address, PROTOCOL_UDP);
+	if (connection) {
+		connection->udp = cerver->udp;
+		connection->sock_receive->max_packet_size = cerver->max_packet_size;
+
+		client = client_create ();
+		if (client) {
+			(void) connection_register_to_client (client, connection);
+
+			if (!client_register_to_cerver (cerver, client)) {
+				connection->active = true;
+
+				cerver_info_send_info_packet (cerver, client, connection);
+
+				cerver_event_trigger (
+					CERVER_EVENT_CLIENT_CONNECTED,
+					cerver,
+					client, connection
+				);
+			}
+
+			// the client has already been dropped with its connection
+			else {
+				cerver_log_error (
+					"cerver_udp_register_peer () - Failed to register new udp peer %s:%d in cerver %s!",
+					connection->ip->str, connection->port, cerver->info->name->str
+				);
+
+				client = NULL;
+			}
+		}
+
+		else {
+			connection_delete (connection);
+		}
+	}
+
+	return client;
+
+}
+
+// gets the client of a new peer, datagrams from unknown addresses are not replied & don't
+// create anything until they start with a valid packet & while there is room for another peer
+// returns NULL if the datagram must be ignored
+static Client *cerver_udp_new_peer (
+	Cerver *cerver, const struct sockaddr_storage *address,
+	const char *buffer, const size_t buffer_size
+) {
+
+	Client *client = NULL;
+
+	if (!cerver_udp_peer_datagram_is_valid (cerver, buffer, buffer_size)) {
+		cerver->stats->received_packets->n_bad_packets += 1;
+	}
+
+	else if (cerver->udp_max_peers && (cerver->udp->clients_map->count >= cerver->udp_max_peers)) {
+		#ifdef CERVER_DEBUG
+		cerver_log (
+			LOG_TYPE_WARNING, LOG_TYPE_CERVER,
+			"Cerver %s has reached its max n of udp peers (%d)!",
+			cerver->info->name->str, cerver->udp_max_peers
+		);
+		#endif
+	}
+
+	else {
+		client = cerver_udp_register_peer (cerver, address);
+	}
+
+	return client;
+
+}
+
+// handles the packets in the datagram as if they were received from the peer's connection
+static void cerver_udp_handle_datagram (
+	Cerver *cerver, const struct sockaddr_storage *address,
+	char *buffer, const size_t buffer_size,
+	const time_t current_time
+) {
+
+	Client *client = cerver_udp_client_get (cerver->udp, address);
+	if (!client) client = cerver_udp_new_peer (cerver, address, buffer, buffer_size);
+
+	if (client && dlist_start (client->connections)) {
+		Connection *connection = (Connection *) dlist_start (client->connections)->data;
+
+		client->last_activity = current_time;
+
+		cerver->stats->client_receives_done += 1;
+		cerver->stats->client_bytes_received += buffer_size;
+
+		client->stats->n_receives_done += 1;
+		client->stats->total_bytes_received += buffer_size;
+
+		connection->stats->n_receives_done += 1;
+		connection->stats->total_bytes_received += buffer_size;
+
+		ReceiveHandle receive_handle = {
+			.type = RECEIVE_TYPE_NORMAL,
+			.cerver = cerver,
+			.socket = connection->socket,
+			.connection = connection,
+			.client = client,
+			.admin = NULL,
+			.lobby = NULL,
+			.buffer = buffer,
+			.buffer_size = buffer_size
+		};
+
+		// the batch buffer is reused, so packets always copy their data
+		SockReceive *sock_receive = connection->sock_receive;
+		cerver_udp_sock_receive_reset (sock_receive);
+
+		bool dropped = false;
+		size_t buffer_pos = 0;
+		Packet *packet = NULL;
+		while ((packet = sock_receive_next_packet (
+			sock_receive, NULL,
+			buffer, buffer_size, &buffer_pos
+		))) {
+			packet->cerver = cerver;
+			packet->lobby = NULL;
+
+			cerver_packet_select_handler (&receive_handle, packet);
+
+			// the peer may have been dropped by the packet
+			if (cerver_udp_client_get (cerver->udp, address) != client) {
+				dropped = true;
+				break;
+			}
+		}
+
+		// each datagram is parsed on its own, so only its remaining packets are discarded
+		if (!dropped && sock_receive->failed) cerver_receive_count_bad_packet (&receive_handle);
+	}
+
+}
+
+// receives up to CERVER_UDP_BATCH_SIZE datagrams with a single call & handles them,
+// the packets that are sent meanwhile are sent together after the batch
+// returns the n of datagrams that were received, -1 on error
+static int cerver_udp_receive_batch (Cerver *cerver) {
+
+	CerverUdp *udp = cerver->udp;
+
+	for (unsigned int idx = 0; idx < CERVER_UDP_BATCH_SIZE; idx++)
+		udp->recv_msgs[idx].msg_hdr.msg_namelen = sizeof (struct sockaddr_storage);
+
+	int n_received = recvmmsg (udp->sock, udp->recv_msgs, CERVER_UDP_BATCH_SIZE, MSG_DONTWAIT, NULL);
+	if (n_received > 0) {
+		time_t current_time = time (NULL);
+
+		cerver_udp_cork (udp);
+
+		for (int idx = 0; idx < n_received; idx++) {
+			cerver->stats->total_n_receives_done += 1;
+			cerver->stats->total_bytes_received += udp->recv_msgs[idx].msg_len;
+
+			// a datagram that didn't fit can't be parsed
+			if (udp->recv_msgs[idx].msg_hdr.msg_flags & MSG_TRUNC) {
+				cerver->stats->received_packets->n_bad_packets += 1;
+				continue;
+			}
+
+			cerver_udp_handle_datagram (
+				cerver, &udp->recv_addresses[idx],
+				(char *) udp->recv_iovs[idx].iov_base, udp->recv_msgs[idx].msg_len,
+				current_time
+			);
+		}
+
+		(void) cerver_udp_uncork (udp);
+	}
+
+	return n_received;
+
+}
+
+// drops the peers that have not sent any datagram in the cerver's udp peer timeout,
+// it is done by the udp loop, so the peers are never dropped while their datagrams are handled
+static void cerver_udp_drop_idle_peers (Cerver *cerver, const time_t current_time) {
+
+	Client *idle[CERVER_UDP_BATCH_SIZE] = { NULL };
+	size_t n_idle = 0;
+
+	time_t threshold = current_time - (time_t) cerver->udp_peer_timeout;
+	do {
+		n_idle = cerver_udp_clients_get_idle (cerver->udp, threshold, idle, CERVER_UDP_BATCH_SIZE);
+
+		// the peer's address is unregistered with its only connection
+		for (size_t idx = 0; idx < n_idle; idx++) {
+			#ifdef CERVER_DEBUG
+			cerver_log (
+				LOG_TYPE_DEBUG, LOG_TYPE_CERVER,
+				"Dropping idle udp client %ld from cerver %s",
+				idle[idx]->id, cerver->info->name->str
+			);
+			#endif
+
+			(void) client_remove_connection_by_sock_fd (cerver, idle[idx], cerver->sock);
+		}
+	} while (n_idle == CERVER_UDP_BATCH_SIZE);
+
+	cerver->udp->last_idle_check = current_time;
+
+}
+
+// cerver udp loop, datagrams are received in batches with recvmmsg ()
+// & mapped to their clients by the peer's address, the packets that are sent
+// while handling a batch are sent together with sendmmsg ()
+u8 cerver_udp (Cerver *cerver) {
+
+	u8 retval = 1;
+
+	if (cerver && cerver->udp) {
+		cerver_log (
+			LOG_TYPE_SUCCESS, LOG_TYPE_CERVER,
+			"Cerver %s ready in port %d!",
+			cerver->info->name->str, cerver->port
+		);
+
+		#ifdef CERVER_DEBUG
+		cerver_log (LOG_TYPE_DEBUG, LOG_TYPE_CERVER, "Waiting for datagrams...");
+		#endif
+
+		struct pollfd pfd = { .fd = cerver->udp->sock, .events = POLLIN, .revents = 0 };
+
+		int n_received = 0;
+		u32 n_batches = 0;
+		time_t current_time = 0;
+		while (cerver->isRunning) {
+			switch (poll (&pfd, 1, cerver->poll_timeout)) {
+				case -1: {
+					// we were interrupted by a signal handler
+					if (errno == EINTR) break;
+
+					cerver_log (
+						LOG_TYPE_ERROR, LOG_TYPE_CERVER,
+						"Cerver %s udp poll has failed!", cerver->info->name->str
+					);
+
+					perror ("Error");
+					cerver->isRunning = false;
+				} break;
+
+				case 0: break;
+
+				default: {
+					// keep reading full batches up to the cerver's receive budget
+					n_batches = 0;
+					do {
+						n_received = cerver_udp_receive_batch (cerver);
+						n_batches += 1;
+					} while (
+						(n_received == CERVER_UDP_BATCH_SIZE)
+						&& (n_batches < cerver->receive_budget)
+						&& cerver->isRunning
+					);
+				} break;
+			}
+
+			if (cerver->udp_peer_timeout) {
+				current_time = time (NULL);
+				if ((current_time - cerver->udp->last_idle_check) >= CERVER_UDP_IDLE_CHECK_INTERVAL)
+					cerver_udp_drop_idle_peers (cerver, current_time);
+			}
+		}
+
+		#ifdef CERVER_DEBUG
+		cerver_log (
+			LOG_TYPE_CERVER, LOG_TYPE_NONE,
+			"Cerver %s udp loop has stopped!", cerver->info->name->str
+		);
+		#endif
+
+		retval = 0;
+	}
+
+	else {
+		cerver_log (
+			LOG_TYPE_ERROR, LOG_TYPE_CERVER,
+			"Can't receive datagrams on a NULL cerver!"
+		);
+	}
+
+	return retval;
+
+}
+
+#pragma endregion
+
+#pragma region uring
+
+// creates the connection's outbound queue, every send is queued
+// & then sent in batches with the cerver's io_uring,
+// the queue is only limited if the cerver uses outbound queues
+// returns 0 on success, 1 on error
+static u8 cerver_uring_connection_outbound_init (Cerver *cerver, Connection *connection) {
+
+	u8 retval = 0;
+
+	if (!connection->socket->outbound || !connection->socket->outbound->uring) {
+		SocketOutbound *outbound = socket_outbound_create_uring (
+			cerver->uring,
+			cerver->outbound_low_watermark,
+			cerver->outbound_queues ? cerver->outbound_high_watermark : SIZE_MAX,
+			cerver->outbound_policy
+		);
+
+		if (outbound) socket_set_outbound (connection->socket, outbound);
+		else retval = 1;
+	}
+
+	return retval;
+
+}
+
+// registers a client connection to the cerver's io_uring
+// by arming a multishot recv in the connection's sock fd
+// returns 0 on success, 1 on error
+u8 cerver_uring_register_connection (Cerver *cerver, Connection *connection) {
+
+	u8 retval = 1;
+
+	if (cerver && connection) {
+		connection->socket->uring_generation = cerver_uring_generation_next (cerver->uring);
+
+		// submit right away as we might not be in the cerver's uring thread
+		if (
+			!cerver_uring_connection_outbound_init (cerver, connection)
+			&& !cerver_uring_recv (cerver->uring, connection->socket->sock_fd, connection->socket->uring_generation)
+			&& !cerver_uring_submit (cerver->uring)
+		) {
+			pthread_mutex_lock (cerver->poll_lock);
+			cerver->current_n_fds++;
+			(void) __atomic_add_fetch (&cerver->stats->current_active_client_connections, 1, __ATOMIC_RELAXED);
+			pthread_mutex_unlock (cerver->poll_lock);
+
+			#ifdef CERVER_DEBUG
+			cerver_log (
+				LOG_TYPE_DEBUG, LOG_TYPE_CERVER,
+				"Added sock fd <%d> to cerver %s uring",
+				connection->socket->sock_fd, cerver->info->name->str
+			);
+			#endif
+
+			#ifdef CERVER_STATS
+			cerver_log (
+				LOG_TYPE_CERVER, LOG_TYPE_NONE,
+				"Cerver %s current active connections: %ld",
+				cerver->info->name->str, cerver->stats->current_active_client_connections
+			);
+			#endif
+
+			retval = 0;
+		}
+
+		else {
+			cerver_log (
+				LOG_TYPE_ERROR, LOG_TYPE_CERVER,
+				"Failed to add sock fd <%d> to cerver %s uring!",
+				connection->socket->sock_fd, cerver->info->name->str
+			);
+		}
+	}
+
+	return retval;
+
+}
+
+// cancels the sock fd's pending recv in the cerver's io_uring
+// returns 0 on success, 1 on error
+u8 cerver_uring_unregister_sock_fd (Cerver *cerver, const i32 sock_fd) {
+
+	u8 retval = 1;
+
+	if (cerver) {
+		if (!cerver_uring_cancel (cerver->uring, sock_fd)) {
+			pthread_mutex_lock (cerver->poll_lock);
+			cerver->current_n_fds--;
+			(void) __atomic_sub_fetch (&cerver->stats->current_active_client_connections, 1, __ATOMIC_RELAXED);
+			pthread_mutex_unlock (cerver->poll_lock);
+
+			#ifdef CERVER_DEBUG
+			cerver_log (
+				LOG_TYPE_DEBUG, LOG_TYPE_CERVER,
+				"Removed sock fd <%d> from cerver %s uring",
+				sock_fd, cerver->info->name->str
+			);
+			#endif
+
+			#ifdef CERVER_STATS
+			cerver_log (
+				LOG_TYPE_CERVER, LOG_TYPE_NONE,
+				"Cerver %s current active connections: %ld",
+				cerver->info->name->str, cerver->stats->current_active_client_connections
+			);
+			#endif
+
+			retval = 0;
+		}
+
+		else {
+			cerver_log (
+				LOG_TYPE_WARNING, LOG_TYPE_CERVER,
+				"Failed to cancel sock fd <%d> requests in cerver %s uring!",
+				sock_fd, cerver->info->name->str
+			);
+		}
+	}
+
+	return retval;
+
+}
+
+// unregisters a client connection from the cerver's io_uring
+// returns 0 on success, 1 on error
+u8 cerver_uring_unregister_connection (Cerver *cerver, Connection *connection) {
+
+	return (cerver && connection) ?
+		cerver_uring_unregister_sock_fd (cerver, connection->socket->sock_fd) : 1;
+
+}
+
+static void cerver_uring_handle_accept (Cerver *cerver, const CerverUringCompletion *completion) {
+
+	if (completion->res > 0) {
+		struct sockaddr_storage client_address;
+		memset (&client_address, 0, sizeof (struct sockaddr_storage));
+		socklen_t socklen = sizeof (struct sockaddr_storage);
+
+		(void) getpeername (completion->res, (struct sockaddr *) &client_address, &socklen);
+
+		cerver_register_new_connection (cerver, NULL, completion->res, client_address);
+	}
+
+	else if (completion->res != -ECANCELED) {
+		cerver_log (
+			LOG_TYPE_ERROR, LOG_TYPE_CERVER,
+			"Cerver %s uring accept failed: %s",
+			cerver->info->name->str, strerror (-completion->res)
+		);
+	}
+
+	// the kernel has stopped the multishot request
+	if (!completion->more && cerver->isRunning) {
+		(void) cerver_uring_accept (cerver->uring, cerver->sock);
+	}
+
+}
+
+// we only handle completions for sock fds that still belong to a connection with the same generation,
+// as any other one might be a late completion from a connection that has already been dropped,
+// even if its sock fd has already been reused by a new one
+static Connection *cerver_uring_connection_get (
+	Cerver *cerver, const CerverUringCompletion *completion, Client **client
+) {
+
+	Connection *connection = NULL;
+
+	*client = client_get_by_sock_fd (cerver, completion->sock_fd);
+	if (*client) {
+		connection = connection_get_by_sock_fd_from_client (*client, completion->sock_fd);
+		if (connection && (connection->socket->uring_generation != completion->generation))
+			connection = NULL;
+	}
+
+	return connection;
+
+}
+
+static CerverReceive *cerver_uring_receive_create (Cerver *cerver, const CerverUringCompletion *completion) {
+
+	Client *client = NULL;
+	Connection *connection = cerver_uring_connection_get (cerver, completion, &client);
+
+	return connection ?
+		cerver_receive_create_full (RECEIVE_TYPE_NORMAL, cerver, client, connection) : NULL;
+
+}
+
+// the received data is parsed directly from the provided buffer, which is returned
+// to the kernel when its last packet is deleted, only if too many of them are being held,
+// or if the packet buffer can't be created, the data is copied into the socket's buffer
+static void cerver_uring_receive_buffer (
+	Cerver *cerver, CerverReceive *cr, const CerverUringCompletion *completion
+) {
+
+	char *buffer = (cerver->type != CERVER_TYPE_WEB) ?
+		cerver_uring_buffer_hold (cerver->uring, completion->buffer_id) : NULL;
+
+	PacketBuffer *owned_buffer = buffer ?
+		packet_buffer_create_with_release (buffer, completion->res, cerver_uring_buffer_release, cerver->uring) : NULL;
+
+	if (owned_buffer) {
+		cerver_receive_success (cr, completion->res, buffer, owned_buffer);
+	}
+
+	else {
+		char *packet_buffer = socket_receive_buffer_get (cr->socket, cerver->receive_buffer_size);
+		if (packet_buffer) {
+			memcpy (
+				packet_buffer,
+				cerver_uring_buffer_get (cerver->uring, completion->buffer_id),
+				completion->res
+			);
+		}
+
+		// the provided buffer is returned to the kernel only after its data has been copied
+		if (buffer) cerver_uring_buffer_release (cerver->uring, buffer);
+		else cerver_uring_buffer_recycle (cerver->uring, completion->buffer_id);
+
+		if (packet_buffer) cerver_receive_success (cr, completion->res, packet_buffer, NULL);
+		else cerver_receive_delete (cr);
+	}
+
+}
+
+// while a connection's reads are paused, its multishot recv is canceled
+// until its outbound queue drains to its low watermark
+// returns true if the recv was canceled
+static bool cerver_uring_check_paused (Cerver *cerver, Socket *socket) {
+
+	bool paused = false;
+
+	SocketOutbound *outbound = socket->outbound;
+	if (outbound && outbound->uring_stopped) {
+		paused = true;
+	}
+
+	else if (outbound && socket_outbound_paused (socket)) {
+		if (!cerver_uring_cancel_recv (cerver->uring, socket->sock_fd, socket->uring_generation)) {
+			outbound->uring_stopped = true;
+			paused = true;
+		}
+	}
+
+	return paused;
+
+}
+
+static void cerver_uring_handle_recv (Cerver *cerver, const CerverUringCompletion *completion) {
+
+	const i32 sock_fd = completion->sock_fd;
+
+	if (completion->res > 0) {
+		CerverReceive *cr = cerver_uring_receive_create (cerver, completion);
+		Socket *socket = cr ? cr->socket : NULL;
+
+		if (completion->has_buffer) {
+			if (cr) cerver_uring_receive_buffer (cerver, cr, completion);
+			else cerver_uring_buffer_recycle (cerver->uring, completion->buffer_id);
+		}
+
+		else {
+			cerver_receive_delete (cr);
+		}
+
+		// the kernel has stopped the multishot request but the connection is still alive
+		if (
+			socket && !cerver_uring_check_paused (cerver, socket)
+			&& !completion->more && client_get_by_sock_fd (cerver, sock_fd)
+		) {
+			(void) cerver_uring_recv (cerver->uring, sock_fd, socket->uring_generation);
+		}
+	}
+
+	// we ran out of provided buffers, just try again
+	else if (completion->res == -ENOBUFS) {
+		if (!completion->more) {
+			Client *client = NULL;
+			Connection *connection = cerver_uring_connection_get (cerver, completion, &client);
+			if (connection && !cerver_uring_check_paused (cerver, connection->socket))
+				(void) cerver_uring_recv (cerver->uring, sock_fd, connection->socket->uring_generation);
+		}
+	}
+
+	// the connection has been dropped & its requests canceled
+	else if (completion->res == -ECANCELED) {}
+
+	// orderly shutdown (0) or any other error
+	else {
+		#ifdef CERVER_DEBUG
+		cerver_log (
+			LOG_TYPE_DEBUG, LOG_TYPE_CERVER,
+			"cerver_uring_handle_recv () - rc: %d - sock fd: %d",
+			completion->res, sock_fd
+		);
+		#endif
+
+		CerverReceive *cr = cerver_uring_receive_create (cerver, completion);
+		if (cr) cerver_switch_receive_handle_failed (cr);
+	}
+
+}
+
+// a send of a connection's outbound queue has completed, the next queued bytes are sent right away,
+// & if its reads were paused & the queue has drained, its multishot recv is armed again
+static void cerver_uring_handle_send (Cerver *cerver, const CerverUringCompletion *completion) {
+
+	SocketOutbound *outbound = (SocketOutbound *) completion->data;
+	if (outbound) {
+		Socket *socket = outbound->socket;
+
+		bool resumed = false;
+		if (!socket_outbound_sent (outbound, completion->res, &resumed) && resumed) {
+			if (outbound->uring_stopped && client_get_by_sock_fd (cerver, socket->sock_fd)) {
+				outbound->uring_stopped = false;
+				(void) cerver_uring_recv (cerver->uring, socket->sock_fd, socket->uring_generation);
+			}
+		}
+	}
+
+}
+
+static inline void cerver_uring_handle (Cerver *cerver, const CerverUringCompletion *completions, const int n_completions) {
+
+	const CerverUringCompletion *completion = NULL;
+	for (int idx = 0; idx < n_completions; idx++) {
+		completion = &completions[idx];
+
+		switch (completion->op) {
+			case CERVER_URING_OP_ACCEPT: cerver_uring_handle_accept (cerver, completion); break;
+
+			case CERVER_URING_OP_RECV: cerver_uring_handle_recv (cerver, completion); break;
+
+			case CERVER_URING_OP_SEND: cerver_uring_handle_send (cerver, completion); break;
+
+			default: break;
+		}
+	}
+
+}
+
+// cerver io_uring loop, accept & recv requests are multishot, so the kernel
+// keeps posting completions for them, and every re-armed request is submitted
+// all at once every time we wait for new completions
+u8 cerver_uring (Cerver *cerver) {
+
+	u8 retval = 1;
+
+	if (cerver) {
+		CerverUringCompletion *completions = (CerverUringCompletion *) calloc (
+			CERVER_URING_DEFAULT_COMPLETIONS, sizeof (CerverUringCompletion)
+		);
+
+		if (completions && !cerver_uring_accept (cerver->uring, cerver->sock)) {
+			cerver_log (
+				LOG_TYPE_SUCCESS, LOG_TYPE_CERVER,
+				"Cerver %s ready in port %d!",
+				cerver->info->name->str, cerver->port
+			);
+
+			#ifdef CERVER_DEBUG
+			cerver_log (LOG_TYPE_DEBUG, LOG_TYPE_CERVER, "Waiting for connections...");
+			#endif
+
+			int n_completions = 0;
+			while (cerver->isRunning) {
+				n_completions = cerver_uring_wait (
+					cerver->uring,
+					completions, CERVER_URING_DEFAULT_COMPLETIONS,
+					cerver->poll_timeout
+				);
+
+				switch (n_completions) {
+					case -1: {
+						cerver_log (
+							LOG_TYPE_ERROR, LOG_TYPE_CERVER,
+							"Cerver %s main uring has failed!", cerver->info->name->str
+						);
+
+						perror ("Error");
+						cerver->isRunning = false;
+					} break;
+
+					case 0: break;
+
+					default: {
+						cerver_uring_handle (cerver, completions, n_completions);
+					} break;
+				}
+			}
+
+			#ifdef CERVER_DEBUG
+			cerver_log (
+				LOG_TYPE_CERVER, LOG_TYPE_NONE,
+				"Cerver %s main uring has stopped!", cerver->info->name->str
+			);
+			#endif
+
+			retval = 0;
+		}
+
+		else {
+			cerver_log (
+				LOG_TYPE_ERROR, LOG_TYPE_CERVER,
+				"Failed to start cerver %s uring!", cerver->info->name->str
+			);
+		}
+
+		if (completions) free (completions);
+	}
+
+	else {
+		cerver_log (
+			LOG_TYPE_ERROR, LOG_TYPE_CERVER,
+			"Can't listen for connections on a NULL cerver!"
+		);
+	}
+
+	return retval;
+
+}
+
+#pragma endregion
+
+#pragma region reactors
+
+static u8 cerver_reactor_epoll_ctl (CerverReactor *reactor, const int op, const i32 sock_fd, const u32 events) {
+
+	struct epoll_event event = { 0 };
+	event.events = events;
+	event.data.fd = sock_fd;
+
+	return epoll_ctl (reactor->epoll_fd, op, sock_fd, &event) ? 1 : 0;
+
+}
+
+// registers a client connection to the epoll of the reactor that accepted it
+// returns 0 on success, 1 on error
+u8 cerver_reactor_register_connection (Cerver *cerver, Connection *connection) {
+
+	u8 retval = 1;
+
+	if (cerver && connection) {
+		CerverReactor *reactor = connection->reactor;
+		if (reactor && !cerver_connection_outbound_init (cerver, connection)) {
+			if (!cerver_reactor_epoll_ctl (
+				reactor,
+				EPOLL_CTL_ADD, connection->socket->sock_fd, cerver_epoll_connection_events (cerver)
+			)) {
+				pthread_mutex_lock (reactor->lock);
+				reactor->current_n_fds++;
+				reactor->stats->current_active_client_connections++;
+				pthread_mutex_unlock (reactor->lock);
+
+				#ifdef CERVER_DEBUG
+				cerver_log (
+					LOG_TYPE_DEBUG, LOG_TYPE_CERVER,
+					"Added sock fd <%d> to cerver %s reactor %d",
+					connection->socket->sock_fd, cerver->info->name->str, reactor->id
+				);
+				#endif
+
+				retval = 0;
+			}
+
+			else {
+				cerver_log (
+					LOG_TYPE_ERROR, LOG_TYPE_CERVER,
+					"Failed to add sock fd <%d> to cerver %s reactor %d!",
+					connection->socket->sock_fd, cerver->info->name->str, reactor->id
+				);
+			}
+		}
+
+		else {
+			cerver_log (
+				LOG_TYPE_ERROR, LOG_TYPE_CERVER,
+				"Sock fd <%d> connection does NOT belong to any cerver %s reactor!",
+				connection->socket->sock_fd, cerver->info->name->str
+			);
+		}
+	}
+
+	return retval;
+
+}
+
+// removes a sock fd from the reactor's epoll
+// returns 0 on success, 1 on error
+u8 cerver_reactor_unregister_sock_fd (CerverReactor *reactor, const i32 sock_fd) {
+
+	u8 retval = 1;
+
+	if (reactor) {
+		if (!cerver_reactor_epoll_ctl (reactor, EPOLL_CTL_DEL, sock_fd, 0)) {
+			pthread_mutex_lock (reactor->lock);
+			reactor->current_n_fds--;
+			reactor->stats->current_active_client_connections--;
+			pthread_mutex_unlock (reactor->lock);
+
+			#ifdef CERVER_DEBUG
+			cerver_log (
+				LOG_TYPE_DEBUG, LOG_TYPE_CERVER,
+				"Removed sock fd <%d> from cerver %s reactor %d",
+				sock_fd, reactor->cerver->info->name->str, reactor->id
+			);
+			#endif
+
+			retval = 0;
+		}
+
+		else {
+			// #ifdef CERVER_DEBUG
+			cerver_log (
+				LOG_TYPE_WARNING, LOG_TYPE_CERVER,
+				"Sock fd <%d> was NOT found in cerver %s reactor %d!",
+				sock_fd, reactor->cerver->info->name->str, reactor->id
+			);
+			// #endif
+		}
+	}
+
+	return retval;
+
+}
+
+// unregisters a client connection from its reactor's epoll
+// returns 0 on success, 1 on error
+u8 cerver_reactor_unregister_connection (Cerver *cerver, Connection *connection) {
+
+	return (cerver && connection) ?
+		cerver_reactor_unregister_sock_fd (connection->reactor, connection->socket->sock_fd) : 1;
+
+}
+
+// accepts the pending connections (up to cerver->max_accepts) from the reactor's socket
+// they will be handled by the same reactor for their entire life
+static void cerver_reactor_accept (CerverReactor *reactor) {
+
+	CerverAcceptBatch *batch = cerver_accept_batch_create (reactor->cerver, reactor);
+	if (batch) {
+		reactor->stats->n_accepted += cerver_accept_batch (batch, reactor->sock);
+
+		cerver_accept_batch_register (batch);
+	}
+
+}
+
+// the client is only searched in the reactor's client map
+static CerverReceive *cerver_reactor_receive_create (CerverReactor *reactor, const i32 sock_fd) {
+
+	CerverReceive *cr = NULL;
+
+	Client *client = cerver_reactor_client_get_by_sock_fd (reactor, sock_fd);
+	if (client) {
+		cr = cerver_receive_create_full (
+			RECEIVE_TYPE_NORMAL,
+			reactor->cerver,
+			client, connection_get_by_sock_fd_from_client (client, sock_fd)
+		);
+	}
+
+	// the connection was already dropped but we got an event that was
+	// posted before, the sock fd is NOT closed as its number might have already been
+	// taken by a new connection that was accepted by another reactor
+	else {
+		#ifdef CERVER_DEBUG
+		cerver_log_warning (
+			"cerver_reactor_receive_create () - reactor %d - no client with sock fd <%d>",
+			reactor->id, sock_fd
+		);
+		#endif
+
+		(void) epoll_ctl (reactor->epoll_fd, EPOLL_CTL_DEL, sock_fd, NULL);
+	}
+
+	return cr;
+
+}
+
+// as the connection is edge triggered, cerver_receive_internal () reads until there is no more data,
+// if the receive budget was reached first, the sock fd is re-armed to get a new event for the remaining data
+// the connection's outbound queue is flushed first if its socket is writable
+// & an error event is ignored if it only reported completed zero copy sends
+static inline void cerver_reactor_handle_actual_receive (CerverReactor *reactor, const i32 sock_fd, u32 events) {
+
+	CerverReceive *cr = cerver_reactor_receive_create (reactor, sock_fd);
+	if (cr) {
+		if ((events & EPOLLERR) && cerver_connection_zero_copy_handle (cr)) events &= ~EPOLLERR;
+
+		bool rearm = (events & EPOLLOUT) ? cerver_connection_outbound_handle (cr) : false;
+
+		if (events & EPOLLIN) {
+			if (!cerver_receive_internal (cr)) rearm = true;
+		}
+
+		else if (events & (EPOLLHUP | EPOLLERR)) {
+			cerver_switch_receive_handle_failed (cr);
+			rearm = false;
+		}
+
+		else {
+			cerver_receive_delete (cr);
+		}
+
+		if (rearm) {
+			(void) cerver_reactor_epoll_ctl (
+				reactor, EPOLL_CTL_MOD, sock_fd, cerver_epoll_connection_events (reactor->cerver)
+			);
+		}
+	}
+
+}
+
+static inline void cerver_reactor_handle (CerverReactor *reactor, const int n_events) {
+
+	struct epoll_event *event = NULL;
+	for (int idx = 0; idx < n_events; idx++) {
+		event = &reactor->epoll_events[idx];
+
+		if (event->data.fd == reactor->sock) {
+			cerver_reactor_accept (reactor);
+		}
+
+		// new data arrived - this also reports an orderly shutdown as recv () will return 0
+		// or the socket is writable again & the connection's outbound queue can be flushed
+		// or the kernel completed zero copy sends
+		else if (event->events & (EPOLLIN | EPOLLOUT | EPOLLERR)) {
+			cerver_reactor_handle_actual_receive (reactor, event->data.fd, event->events);
+		}
+
+		// the connection is broken or an asynchronous error occurred
+		else if (event->events & (EPOLLHUP | EPOLLERR)) {
+			CerverReceive *cr = cerver_reactor_receive_create (reactor, event->data.fd);
+			if (cr) cerver_switch_receive_handle_failed (cr);
+		}
+	}
+
+}
+
+static void cerver_reactor_loop (CerverReactor *reactor) {
+
+	Cerver *cerver = reactor->cerver;
+
+	#ifdef CERVER_DEBUG
+	cerver_log (
+		LOG_TYPE_DEBUG, LOG_TYPE_CERVER,
+		"Cerver %s reactor %d waiting for connections...",
+		cerver->info->name->str, reactor->id
+	);
+	#endif
+
+	int n_events = 0;
+	while (cerver->isRunning && reactor->running) {
+		n_events = epoll_wait (
+			reactor->epoll_fd,
+			reactor->epoll_events, cerver->epoll_max_events,
+			cerver->poll_timeout
+		);
+
+		switch (n_events) {
+			case -1: {
+				// we were interrupted by a signal handler
+				if (errno == EINTR) break;
+
+				cerver_log (
+					LOG_TYPE_ERROR, LOG_TYPE_CERVER,
+					"Cerver %s reactor %d epoll has failed!",
+					cerver->info->name->str, reactor->id
+				);
+
+				perror ("Error");
+				reactor->running = false;
+			} break;
+
+			case 0: break;
+
+			default: {
+				cerver_reactor_handle (reactor, n_events);
+			} break;
+		}
+	}
+
+	#ifdef CERVER_DEBUG
+	cerver_log (
+		LOG_TYPE_CERVER, LOG_TYPE_NONE,
+		"Cerver %s reactor %d has stopped!",
+		cerver->info->name->str, reactor->id
+	);
+	#endif
+
+}
+
+static void *cerver_reactor_thread (void *reactor_ptr) {
+
+	CerverReactor *reactor = (CerverReactor *) reactor_ptr;
+
+	char *thread_name = c_string_create ("%s-reactor-%d", reactor->cerver->info->name->str, reactor->id);
+	cerver_thread_setup (reactor->cerver, CERVER_THREAD_ROLE_REACTOR, thread_name);
+	if (thread_name) free (thread_name);
+
+	// only this thread uses the events, so they can come from its own node
+	if (reactor->cerver->thread_affinities[CERVER_THREAD_ROLE_REACTOR].numa_local) {
+		struct epoll_event *epoll_events = (struct epoll_event *) calloc (
+			reactor->cerver->epoll_max_events, sizeof (struct epoll_event)
+		);
+
+		if (epoll_events) {
+			free (reactor->epoll_events);
+			reactor->epoll_events = epoll_events;
+		}
+	}
+
+	cerver_reactor_loop (reactor);
+
+	return NULL;
+
+}
+
+// waits for the reactor's thread to finish, the thread is only joined once
+// even if the reactors are stopped from another thread at the same time
+static void cerver_reactor_join (CerverReactor *reactor) {
+
+	pthread_t thread_id = __atomic_exchange_n (&reactor->thread_id, 0, __ATOMIC_ACQ_REL);
+	if (thread_id) (void) pthread_join (thread_id, NULL);
+
+}
+
+// starts a thread for every reactor, so all of them are set up with the reactors' affinity,
+// & waits in the calling thread until all of them have stopped
+u8 cerver_reactors (Cerver *cerver) {
+
+	u8 retval = 1;
+
+	if (cerver && cerver->reactors) {
+		u16 n_started = 0;
+
+		CerverReactor *reactor = NULL;
+		for (u16 idx = 0; idx < cerver->n_reactors; idx++) {
+			reactor = cerver->reactors[idx];
+			reactor->running = true;
+
+			if (!pthread_create (&reactor->thread_id, NULL, cerver_reactor_thread, reactor)) {
+				n_started += 1;
+			}
+
+			else {
+				cerver_log (
+					LOG_TYPE_ERROR, LOG_TYPE_CERVER,
+					"Failed to create cerver %s reactor %d thread!",
+					cerver->info->name->str, idx
+				);
+
+				reactor->running = false;
+				reactor->thread_id = 0;
+			}
+		}
+
+		if (n_started) {
+			cerver_log (
+				LOG_TYPE_SUCCESS, LOG_TYPE_CERVER,
+				"Cerver %s ready in port %d with %d reactors!",
+				cerver->info->name->str, cerver->port, n_started
+			);
+
+			for (u16 idx = 0; idx < cerver->n_reactors; idx++)
+				cerver_reactor_join (cerver->reactors[idx]);
+
+			retval = 0;
+		}
+
+		cerver_reactors_stop (cerver);
+	}
+
+	else {
+		cerver_log (
+			LOG_TYPE_ERROR, LOG_TYPE_CERVER,
+			"Can't listen for connections on a cerver without reactors!"
+		);
+	}
+
+	return retval;
+
+}
+
+// stops the reactors threads & waits for them to finish
+void cerver_reactors_stop (Cerver *cerver) {
+
+	if (cerver && cerver->reactors) {
+		CerverReactor *reactor = NULL;
+		for (u16 idx = 0; idx < cerver->n_reactors; idx++) {
+			reactor = cerver->reactors[idx];
+			reactor->running = false;
+
+			cerver_reactor_join (reactor);
+		}
+	}
+
+}
+
+#pragma endregion
+
 #pragma region threads
 
 // handle new connections in dedicated threads
@@ -2801,7 +4986,7 @@ u8 cerver_threads (Cerver *cerver) {
 		#endif
 
 		while (cerver->isRunning) {
-			cerver_accept (cerver);
+			cerver_accept_blocking (cerver);
 		}
 
 		#ifdef CERVER_DEBUG
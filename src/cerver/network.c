@@ -2,8 +2,13 @@
 #include <string.h>
 
 #include <fcntl.h>
+#include <errno.h>
+#include <limits.h>
+#include <poll.h>
 
 #include <sys/time.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
 
 #include "cerver/network.h"
 
@@ -126,4 +131,80 @@ int sock_set_timeout (int sock_fd, time_t timeout) {
 		(const char *) &tv, sizeof (struct timeval)
 	);
 
-}
\ No newline at end of file
+}
+
+// checks why a send () or recv () like call has failed, if the socket is non blocking
+// and it was not ready, waits until it is ready for the events (up to SOCK_WAIT_TIMEOUT)
+// returns true if the call should be retried, false on any other error
+bool sock_can_retry (int sock_fd, short events) {
+
+	bool retval = false;
+
+	switch (errno) {
+		case EINTR: retval = true; break;
+
+		case EAGAIN:
+		#if EAGAIN != EWOULDBLOCK
+		case EWOULDBLOCK:
+		#endif
+		{
+			struct pollfd pfd = { .fd = sock_fd, .events = events, .revents = 0 };
+			retval = (poll (&pfd, 1, SOCK_WAIT_TIMEOUT) > 0) && (pfd.revents & events);
+		} break;
+
+		default: break;
+	}
+
+	return retval;
+
+}
+
+// sends all the iovec buffers using as few sendmsg () calls as possible
+// the iovec is modified to keep track of what has been sent,
+// the buffers that were completely sent are set to a zero length
+// if wait is false, it returns as soon as the socket is not ready,
+// so total_sent might be less than the total size of the buffers
+// returns 0 on success, 1 on error
+u8 sock_send_iov (
+	int sock_fd, struct iovec *iov, int iovcnt,
+	int flags, bool wait, size_t *total_sent
+) {
+
+	u8 retval = 0;
+
+	size_t actual_sent = 0;
+	ssize_t sent = 0;
+	struct msghdr msg = { 0 };
+	while (iovcnt > 0) {
+		msg.msg_iov = iov;
+		msg.msg_iovlen = (iovcnt > IOV_MAX) ? IOV_MAX : iovcnt;
+
+		sent = sendmsg (sock_fd, &msg, flags);
+		if (sent < 0) {
+			if (!wait && ((errno == EAGAIN) || (errno == EWOULDBLOCK))) break;
+			if (sock_can_retry (sock_fd, POLLOUT)) continue;
+			retval = 1;
+			break;
+		}
+
+		actual_sent += (size_t) sent;
+
+		// skip the buffers that were completely sent
+		while ((iovcnt > 0) && ((size_t) sent >= iov->iov_len)) {
+			sent -= (ssize_t) iov->iov_len;
+			iov->iov_len = 0;
+			iov++;
+			iovcnt--;
+		}
+
+		if (iovcnt > 0) {
+			iov->iov_base = (char *) iov->iov_base + sent;
+			iov->iov_len -= (size_t) sent;
+		}
+	}
+
+	if (total_sent) *total_sent = actual_sent;
+
+	return retval;
+
+}
@@ -1,6 +1,9 @@
 #include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
+#include <stdint.h>
+#include <endian.h>
+#include <time.h>
 
 #ifdef PACKETS_DEBUG
 #include <errno.h>
@@ -8,6 +11,7 @@
 
 #include <sys/types.h>
 #include <sys/socket.h>
+#include <sys/uio.h>
 
 #include "cerver/types/types.h"
 #include "cerver/types/string.h"
@@ -16,9 +20,18 @@
 #include "cerver/packets.h"
 #include "cerver/cerver.h"
 #include "cerver/client.h"
+#include "cerver/connection.h"
+#include "cerver/socket.h"
+#include "cerver/udp.h"
 
 #include "cerver/game/lobby.h"
 
+#include "cerver/threads/thpool.h"
+#include "cerver/threads/thread.h"
+
+#include "cerver/utils/crc32c.h"
+#include "cerver/utils/lz.h"
+
 #ifdef PACKETS_DEBUG
 #include "cerver/utils/log.h"
 #endif
@@ -38,11 +51,197 @@ void packets_set_protocol_version (ProtocolVersion version) { protocol_version =
 
 #pragma endregion
 
+#pragma region cache
+
+// the free objects are linked using their first bytes
+typedef struct PacketsCacheList {
+
+	void *head;
+	unsigned int n_objects;
+
+	// the events that have not been added to the global stats
+	u32 n_hits;
+	u32 n_misses;
+
+} PacketsCacheList;
+
+_Static_assert (sizeof (PacketVersion) >= sizeof (void *), "cached objects must fit a pointer");
+
+static const size_t packets_cache_object_size[PACKETS_CACHE_N_TYPES] = {
+	sizeof (Packet), sizeof (PacketHeader), sizeof (PacketVersion)
+};
+
+static PacketsCacheStats packets_cache_stats[PACKETS_CACHE_N_TYPES] = { 0 };
+
+static __thread PacketsCacheList packets_cache[PACKETS_CACHE_N_TYPES] = { 0 };
+static __thread bool packets_cache_registered = false;
+
+static pthread_once_t packets_cache_once = PTHREAD_ONCE_INIT;
+static pthread_key_t packets_cache_key;
+
+const char *packets_cache_type_to_string (PacketsCacheType type) {
+
+	switch (type) {
+		#define XX(num, name, string) case PACKETS_CACHE_TYPE_##name: return #string;
+		PACKETS_CACHE_TYPE_MAP(XX)
+		#undef XX
+	}
+
+	return packets_cache_type_to_string (PACKETS_CACHE_TYPE_PACKET);
+
+}
+
+static void packets_cache_flush_stats (PacketsCacheType type, PacketsCacheList *list) {
+
+	if (list->n_hits) __atomic_add_fetch (&packets_cache_stats[type].n_hits, list->n_hits, __ATOMIC_RELAXED);
+	if (list->n_misses) __atomic_add_fetch (&packets_cache_stats[type].n_misses, list->n_misses, __ATOMIC_RELAXED);
+
+	list->n_hits = 0;
+	list->n_misses = 0;
+
+}
+
+// called when a thread that has cached objects exits
+static void packets_cache_destroy (void *data) {
+
+	(void) data;
+
+	// objects that are cached by other destructors register the thread again
+	packets_cache_registered = false;
+
+	packets_cache_clear ();
+
+}
+
+static void packets_cache_init (void) {
+
+	(void) pthread_key_create (&packets_cache_key, packets_cache_destroy);
+
+}
+
+// the key's destructor is only called if the thread has set a value
+static void packets_cache_register (void) {
+
+	(void) pthread_once (&packets_cache_once, packets_cache_init);
+	(void) pthread_setspecific (packets_cache_key, packets_cache);
+
+	packets_cache_registered = true;
+
+}
+
+// takes a free object from the thread's cache or allocates a new one
+// the object is NOT initialized
+static void *packets_cache_get (PacketsCacheType type) {
+
+	PacketsCacheList *list = &packets_cache[type];
+
+	void *object = list->head;
+	if (object) {
+		list->head = *(void **) object;
+		list->n_objects -= 1;
+		list->n_hits += 1;
+	}
+
+	else {
+		object = malloc (packets_cache_object_size[type]);
+		list->n_misses += 1;
+	}
+
+	if ((list->n_hits + list->n_misses) >= PACKETS_CACHE_STATS_FLUSH)
+		packets_cache_flush_stats (type, list);
+
+	return object;
+
+}
+
+// keeps the object in the thread's cache to be reused, if it is full, the object is freed
+static void packets_cache_put (PacketsCacheType type, void *object) {
+
+	if (object) {
+		PacketsCacheList *list = &packets_cache[type];
+		if (list->n_objects < PACKETS_CACHE_SIZE) {
+			if (!packets_cache_registered) packets_cache_register ();
+
+			*(void **) object = list->head;
+			list->head = object;
+			list->n_objects += 1;
+		}
+
+		else {
+			free (object);
+		}
+	}
+
+}
+
+// gets the stats of the objects of the requested type
+// every thread adds its events in batches of PACKETS_CACHE_STATS_FLUSH
+void packets_cache_get_stats (PacketsCacheType type, PacketsCacheStats *stats) {
+
+	if (stats && (type < PACKETS_CACHE_N_TYPES)) {
+		stats->n_hits = __atomic_load_n (&packets_cache_stats[type].n_hits, __ATOMIC_RELAXED);
+		stats->n_misses = __atomic_load_n (&packets_cache_stats[type].n_misses, __ATOMIC_RELAXED);
+	}
+
+}
+
+// returns the percentage of the objects of the requested type that were taken from a cache
+double packets_cache_get_hit_rate (PacketsCacheType type) {
+
+	double hit_rate = 0;
+
+	PacketsCacheStats stats = { 0 };
+	packets_cache_get_stats (type, &stats);
+	if (stats.n_hits + stats.n_misses)
+		hit_rate = ((double) stats.n_hits / (double) (stats.n_hits + stats.n_misses)) * 100;
+
+	return hit_rate;
+
+}
+
+void packets_cache_stats_print (void) {
+
+	PacketsCacheStats stats = { 0 };
+	for (unsigned int type = 0; type < PACKETS_CACHE_N_TYPES; type++) {
+		packets_cache_get_stats ((PacketsCacheType) type, &stats);
+		cerver_log_msg (
+			"%-16s hits: %ld - misses: %ld - hit rate: %.2f%%",
+			packets_cache_type_to_string ((PacketsCacheType) type),
+			stats.n_hits, stats.n_misses,
+			packets_cache_get_hit_rate ((PacketsCacheType) type)
+		);
+	}
+
+}
+
+// frees every object in the calling thread's caches
+// it is done automatically when a thread that has cached objects exits
+void packets_cache_clear (void) {
+
+	PacketsCacheList *list = NULL;
+	void *object = NULL;
+	for (unsigned int type = 0; type < PACKETS_CACHE_N_TYPES; type++) {
+		list = &packets_cache[type];
+		while (list->head) {
+			object = list->head;
+			list->head = *(void **) object;
+			free (object);
+		}
+
+		list->n_objects = 0;
+
+		packets_cache_flush_stats ((PacketsCacheType) type, list);
+	}
+
+}
+
+#pragma endregion
+
 #pragma region version
 
 PacketVersion *packet_version_new (void) {
 
-	PacketVersion *version = (PacketVersion *) malloc (sizeof (PacketVersion));
+	PacketVersion *version = (PacketVersion *) packets_cache_get (PACKETS_CACHE_TYPE_VERSION);
 	if (version) {
 		version->protocol_id = 0;
 		version->protocol_version.minor = version->protocol_version.major = 0;
@@ -52,11 +251,15 @@ PacketVersion *packet_version_new (void) {
 
 }
 
-void packet_version_delete (PacketVersion *version) { if (version) free (version); }
+void packet_version_delete (PacketVersion *version) {
+
+	packets_cache_put (PACKETS_CACHE_TYPE_VERSION, version);
+
+}
 
 PacketVersion *packet_version_create (void) {
 
-	PacketVersion *version = (PacketVersion *) malloc (sizeof (PacketVersion));
+	PacketVersion *version = (PacketVersion *) packets_cache_get (PACKETS_CACHE_TYPE_VERSION);
 	if (version) {
 		version->protocol_id = protocol_id;
 		version->protocol_version = protocol_version;
@@ -89,6 +292,30 @@ PacketsPerType *packets_per_type_new (void) {
 
 void packets_per_type_delete (void *ptr) { if (ptr) free (ptr); }
 
+// adds n packets to the packet type's counter
+void packets_per_type_add (
+	PacketsPerType *packets_per_type, PacketType packet_type, u64 n
+) {
+
+	switch (packet_type) {
+		case PACKET_TYPE_NONE: break;
+
+		case PACKET_TYPE_CERVER: (void) __atomic_add_fetch (&packets_per_type->n_cerver_packets, n, __ATOMIC_RELAXED); break;
+		case PACKET_TYPE_CLIENT: (void) __atomic_add_fetch (&packets_per_type->n_client_packets, n, __ATOMIC_RELAXED); break;
+		case PACKET_TYPE_ERROR: (void) __atomic_add_fetch (&packets_per_type->n_error_packets, n, __ATOMIC_RELAXED); break;
+		case PACKET_TYPE_REQUEST: (void) __atomic_add_fetch (&packets_per_type->n_request_packets, n, __ATOMIC_RELAXED); break;
+		case PACKET_TYPE_AUTH: (void) __atomic_add_fetch (&packets_per_type->n_auth_packets, n, __ATOMIC_RELAXED); break;
+		case PACKET_TYPE_GAME: (void) __atomic_add_fetch (&packets_per_type->n_game_packets, n, __ATOMIC_RELAXED); break;
+		case PACKET_TYPE_APP: (void) __atomic_add_fetch (&packets_per_type->n_app_packets, n, __ATOMIC_RELAXED); break;
+		case PACKET_TYPE_APP_ERROR: (void) __atomic_add_fetch (&packets_per_type->n_app_error_packets, n, __ATOMIC_RELAXED); break;
+		case PACKET_TYPE_CUSTOM: (void) __atomic_add_fetch (&packets_per_type->n_custom_packets, n, __ATOMIC_RELAXED); break;
+		case PACKET_TYPE_TEST: (void) __atomic_add_fetch (&packets_per_type->n_test_packets, n, __ATOMIC_RELAXED); break;
+
+		default: (void) __atomic_add_fetch (&packets_per_type->n_unknown_packets, n, __ATOMIC_RELAXED); break;
+	}
+
+}
+
 void packets_per_type_print (PacketsPerType *packets_per_type) {
 
 	if (packets_per_type) {
@@ -114,7 +341,7 @@ void packets_per_type_print (PacketsPerType *packets_per_type) {
 
 PacketHeader *packet_header_new (void) {
 
-	PacketHeader *header = (PacketHeader *) malloc (sizeof (PacketHeader));
+	PacketHeader *header = (PacketHeader *) packets_cache_get (PACKETS_CACHE_TYPE_HEADER);
 	if (header) {
 		memset (header, 0, sizeof (PacketHeader));
 	}
@@ -123,21 +350,34 @@ PacketHeader *packet_header_new (void) {
 
 }
 
-void packet_header_delete (PacketHeader *header) { if (header) free (header); }
+void packet_header_delete (PacketHeader *header) {
 
-PacketHeader *packet_header_create (PacketType packet_type, size_t packet_size, u32 req_type) {
+	packets_cache_put (PACKETS_CACHE_TYPE_HEADER, header);
 
-	PacketHeader *header = (PacketHeader *) malloc (sizeof (PacketHeader));
-	if (header) {
-		header->packet_type = packet_type;
-		header->packet_size = packet_size;
+}
+
+static inline void packet_header_init (
+	PacketHeader *header,
+	PacketType packet_type, size_t packet_size, u32 req_type
+) {
 
-		header->handler_id = 0;
+	memset (header, 0, sizeof (PacketHeader));
 
-		header->request_type = req_type;
+	header->packet_type = packet_type;
+	header->packet_size = packet_size;
 
-		header->sock_fd = 0;
-	}
+	header->handler_id = 0;
+
+	header->request_type = req_type;
+
+	header->sock_fd = 0;
+
+}
+
+PacketHeader *packet_header_create (PacketType packet_type, size_t packet_size, u32 req_type) {
+
+	PacketHeader *header = (PacketHeader *) packets_cache_get (PACKETS_CACHE_TYPE_HEADER);
+	if (header) packet_header_init (header, packet_type, packet_size, req_type);
 
 	return header;
 
@@ -162,7 +402,7 @@ u8 packet_header_copy (PacketHeader **dest, PacketHeader *source) {
 	u8 retval = 1;
 
 	if (source) {
-		*dest = (PacketHeader *) malloc (sizeof (PacketHeader));
+		*dest = (PacketHeader *) packets_cache_get (PACKETS_CACHE_TYPE_HEADER);
 		if (*dest) {
 			memcpy (*dest, source, sizeof (PacketHeader));
 			retval = 0;
@@ -173,6 +413,292 @@ u8 packet_header_copy (PacketHeader **dest, PacketHeader *source) {
 
 }
 
+// writes the v2 header, its packet size counts the header's wire size
+static u8 packet_header_v2_write (const PacketHeader *header, size_t header_size, char *buffer) {
+
+	u8 retval = 1;
+
+	if (header && buffer) {
+		if (
+			(header->packet_size >= sizeof (PacketHeader))
+			&& ((header->packet_size - sizeof (PacketHeader)) <= (UINT32_MAX - header_size))
+			&& ((u32) header->packet_type <= UINT8_MAX)
+		) {
+			u16 sock_fd = htole16 (header->sock_fd);
+			u32 request_type = htole32 (header->request_type);
+			u32 packet_size = htole32 ((u32) (header->packet_size - sizeof (PacketHeader) + header_size));
+
+			buffer[0] = (char) header->packet_type;
+			buffer[1] = (char) header->handler_id;
+			memcpy (buffer + 2, &sock_fd, sizeof (u16));
+			memcpy (buffer + 4, &request_type, sizeof (u32));
+			memcpy (buffer + 8, &packet_size, sizeof (u32));
+
+			retval = 0;
+		}
+	}
+
+	return retval;
+
+}
+
+// reads the v2 header, its packet size is converted back to count the PacketHeader
+static u8 packet_header_v2_read (const char *buffer, size_t header_size, PacketHeader *header) {
+
+	u8 retval = 1;
+
+	if (buffer && header) {
+		u16 sock_fd = 0;
+		u32 request_type = 0;
+		u32 packet_size = 0;
+
+		memcpy (&sock_fd, buffer + 2, sizeof (u16));
+		memcpy (&request_type, buffer + 4, sizeof (u32));
+		memcpy (&packet_size, buffer + 8, sizeof (u32));
+
+		header->packet_type = (PacketType) (u8) buffer[0];
+		header->handler_id = (u8) buffer[1];
+		header->sock_fd = le16toh (sock_fd);
+		header->request_type = le32toh (request_type);
+
+		packet_size = le32toh (packet_size);
+		if (packet_size >= header_size) {
+			header->packet_size = (size_t) packet_size - header_size + sizeof (PacketHeader);
+			retval = 0;
+		}
+
+		else {
+			header->packet_size = 0;
+		}
+	}
+
+	return retval;
+
+}
+
+// writes the header into the buffer using the v2 layout
+// returns 0 on success, 1 if the header does not fit in it
+u8 packet_header_v2_encode (const PacketHeader *header, char *buffer) {
+
+	return packet_header_v2_write (header, PACKET_HEADER_V2_SIZE, buffer);
+
+}
+
+// writes the header using the v2 layout followed by the checksum
+// returns 0 on success, 1 if the header does not fit in it
+u8 packet_header_v2_encode_checksum (
+	const PacketHeader *header, u32 checksum, char *buffer
+) {
+
+	u8 retval = packet_header_v2_write (
+		header, PACKET_HEADER_V2_SIZE + PACKET_HEADER_CHECKSUM_SIZE, buffer
+	);
+
+	if (!retval) {
+		checksum = htole32 (checksum);
+		memcpy (buffer + PACKET_HEADER_V2_SIZE, &checksum, sizeof (u32));
+	}
+
+	return retval;
+
+}
+
+// reads a v2 header from the buffer into the header
+// its packet size is converted back to count the PacketHeader
+// returns 0 on success, 1 if the packet size is invalid (it is set to 0)
+u8 packet_header_v2_decode (const char *buffer, PacketHeader *header) {
+
+	return packet_header_v2_read (buffer, PACKET_HEADER_V2_SIZE, header);
+
+}
+
+// reads a v2 header that is followed by a checksum
+// returns 0 on success, 1 if the packet size is invalid (it is set to 0)
+u8 packet_header_v2_decode_checksum (
+	const char *buffer, PacketHeader *header, u32 *checksum
+) {
+
+	u8 retval = packet_header_v2_read (
+		buffer, PACKET_HEADER_V2_SIZE + PACKET_HEADER_CHECKSUM_SIZE, header
+	);
+
+	if (buffer && checksum) {
+		memcpy (checksum, buffer + PACKET_HEADER_V2_SIZE, sizeof (u32));
+		*checksum = le32toh (*checksum);
+	}
+
+	return retval;
+
+}
+
+#pragma endregion
+
+#pragma region compression
+
+// the built in compressor, a fast lz77 codec (utils/lz.h)
+const PacketCompressor packet_compressor_lz = {
+	.id = PACKET_COMPRESSOR_LZ_ID,
+	.name = "lz",
+	.bound = lz_compress_bound,
+	.compress = lz_compress,
+	.decompress = lz_decompress
+};
+
+static inline u64 packet_compression_clock (void) {
+
+	struct timespec now = { 0 };
+	(void) clock_gettime (CLOCK_THREAD_CPUTIME_ID, &now);
+
+	return ((u64) now.tv_sec * 1000000000) + (u64) now.tv_nsec;
+
+}
+
+// data that is big enough is compressed for the sockets that agreed on it,
+// except for file uploads, whose request is followed by the file's raw contents
+static inline bool packet_compression_use (
+	const Socket *socket, const PacketHeader *header, size_t data_size
+) {
+
+	return socket->compressor && header
+		&& data_size && (data_size >= socket->compression_threshold)
+		&& (data_size <= UINT32_MAX)
+		&& !(
+			(header->packet_type == PACKET_TYPE_REQUEST)
+			&& (header->request_type == REQUEST_PACKET_TYPE_SEND_FILE)
+		);
+
+}
+
+// compresses the data into a new buffer that starts with the data's original size
+// the cpu time that it took is added to the stats (if set)
+// returns NULL if the compressed data would not be smaller than the original one
+static char *packet_compress (
+	const PacketCompressor *compressor, const void *data, size_t data_size,
+	ConnectionStats *stats, size_t *compressed_size
+) {
+
+	u64 start = packet_compression_clock ();
+
+	size_t capacity = sizeof (u32) + compressor->bound (data_size);
+	char *compressed = (char *) malloc (capacity);
+	if (compressed) {
+		u32 original_size = htole32 ((u32) data_size);
+		memcpy (compressed, &original_size, sizeof (u32));
+
+		size_t size = compressor->compress (
+			data, data_size, compressed + sizeof (u32), capacity - sizeof (u32)
+		);
+
+		if (size && ((sizeof (u32) + size) < data_size)) {
+			*compressed_size = sizeof (u32) + size;
+		}
+
+		else {
+			free (compressed);
+			compressed = NULL;
+		}
+	}
+
+	if (stats) (void) __atomic_add_fetch (&stats->compression_time, packet_compression_clock () - start, __ATOMIC_RELAXED);
+
+	return compressed;
+
+}
+
+static inline void packet_compression_update_stats (
+	ConnectionStats *stats, size_t data_size, size_t compressed_size
+) {
+
+	if (stats) {
+		(void) __atomic_add_fetch (&stats->n_packets_compressed, 1, __ATOMIC_RELAXED);
+		(void) __atomic_add_fetch (&stats->compression_bytes_in, data_size, __ATOMIC_RELAXED);
+		(void) __atomic_add_fetch (&stats->compression_bytes_out, compressed_size, __ATOMIC_RELAXED);
+	}
+
+}
+
+#pragma endregion
+
+#pragma region buffer
+
+// creates a new packet buffer that takes ownership of the buffer
+// the packet buffer starts with one reference
+PacketBuffer *packet_buffer_create (char *buffer, const size_t buffer_size) {
+
+	PacketBuffer *packet_buffer = (PacketBuffer *) malloc (sizeof (PacketBuffer));
+	if (packet_buffer) {
+		packet_buffer->buffer = buffer;
+		packet_buffer->buffer_size = buffer_size;
+
+		packet_buffer->ref_count = 1;
+
+		packet_buffer->release = NULL;
+		packet_buffer->owner = NULL;
+	}
+
+	return packet_buffer;
+
+}
+
+// creates a new packet buffer whose buffer belongs to owner,
+// release (owner, buffer) is called when its last reference is removed
+// the packet buffer starts with one reference
+PacketBuffer *packet_buffer_create_with_release (
+	char *buffer, const size_t buffer_size,
+	void (*release) (void *owner, char *buffer), void *owner
+) {
+
+	PacketBuffer *packet_buffer = packet_buffer_create (buffer, buffer_size);
+	if (packet_buffer) {
+		packet_buffer->release = release;
+		packet_buffer->owner = owner;
+	}
+
+	return packet_buffer;
+
+}
+
+// adds a new reference to the packet buffer
+void packet_buffer_ref (PacketBuffer *packet_buffer) {
+
+	if (packet_buffer) __atomic_add_fetch (&packet_buffer->ref_count, 1, __ATOMIC_RELAXED);
+
+}
+
+// removes a reference from the packet buffer
+// if it was the last one, returns the buffer so it can be reused, otherwise returns NULL
+// a buffer that belongs to an owner is always released to it & NULL is returned
+char *packet_buffer_unref_take (PacketBuffer *packet_buffer) {
+
+	char *buffer = NULL;
+
+	if (packet_buffer) {
+		if (!__atomic_sub_fetch (&packet_buffer->ref_count, 1, __ATOMIC_ACQ_REL)) {
+			if (packet_buffer->release) {
+				packet_buffer->release (packet_buffer->owner, packet_buffer->buffer);
+			}
+
+			else {
+				buffer = packet_buffer->buffer;
+			}
+
+			free (packet_buffer);
+		}
+	}
+
+	return buffer;
+
+}
+
+// removes a reference from the packet buffer
+// if it was the last one, the buffer is freed
+void packet_buffer_unref (PacketBuffer *packet_buffer) {
+
+	char *buffer = packet_buffer_unref_take (packet_buffer);
+	if (buffer) free (buffer);
+
+}
+
 #pragma endregion
 
 #pragma region packets
@@ -181,7 +707,7 @@ u8 packet_append_data (Packet *packet, void *data, size_t data_size);
 
 Packet *packet_new (void) {
 
-	Packet *packet = (Packet *) malloc (sizeof (Packet));
+	Packet *packet = (Packet *) packets_cache_get (PACKETS_CACHE_TYPE_PACKET);
 	if (packet) {
 		packet->cerver = NULL;
 		packet->client = NULL;
@@ -197,11 +723,21 @@ Packet *packet_new (void) {
 		packet->data_end = NULL;
 		packet->data_ref = false;
 
+		packet->data_buffer = NULL;
+
 		packet->header = NULL;
 		packet->version = NULL;
+		packet->version_ref = false;
 		packet->packet_size = 0;
 		packet->packet = NULL;
 		packet->packet_ref = false;
+
+		packet->has_checksum = false;
+		packet->checksum = 0;
+
+		packet->compressed = false;
+
+		packet->ref_count = 1;
 	}
 
 	return packet;
@@ -222,30 +758,200 @@ Packet *packet_create (PacketType type, void *data, size_t data_size) {
 
 }
 
+// deletes the packet's header if it was allocated on its own
+static inline void packet_header_release (Packet *packet) {
+
+	if (packet->header != &packet->own_header)
+		packet_header_delete (packet->header);
+
+	packet->header = NULL;
+
+}
+
+// makes the packet use its own header if it does not have one yet
+static inline PacketHeader *packet_header_get_own (Packet *packet) {
+
+	if (!packet->header) packet->header = &packet->own_header;
+
+	return packet->header;
+
+}
+
+// deletes the packet's data if it owns it & drops its reference to the buffer that keeps it,
+// a buffer that the data was moved into for zero copy sends is deleted once they are done with it
+static void packet_data_release (Packet *packet) {
+
+	if (!packet->data_ref) {
+		if (packet->data) free (packet->data);
+	}
+
+	packet->data = NULL;
+	packet->data_size = 0;
+	packet->data_ptr = NULL;
+	packet->data_end = NULL;
+	packet->data_ref = false;
+
+	packet_buffer_unref (packet->data_buffer);
+	packet->data_buffer = NULL;
+
+}
+
+// replaces the data that is kept by the packet's buffer with a copy that is owned by the packet
+// returns 0 on success, 1 on error
+static u8 packet_data_take (Packet *packet) {
+
+	u8 retval = 1;
+
+	size_t data_size = packet->data_size;
+	void *data = data_size ? malloc (data_size) : NULL;
+	if (data || !data_size) {
+		if (data) memcpy (data, packet->data, data_size);
+
+		packet_data_release (packet);
+
+		packet->data = data;
+		packet->data_size = data_size;
+		packet->data_ptr = (char *) data;
+		packet->data_end = (char *) data + data_size;
+
+		retval = 0;
+	}
+
+	return retval;
+
+}
+
 void packet_delete (void *ptr) {
 
 	if (ptr) {
 		Packet *packet = (Packet *) ptr;
 
-		packet->cerver = NULL;
-		packet->client = NULL;
-		packet->connection = NULL;
-		packet->lobby = NULL;
+		if (!__atomic_sub_fetch (&packet->ref_count, 1, __ATOMIC_ACQ_REL)) {
+			packet->cerver = NULL;
+			packet->client = NULL;
+			packet->connection = NULL;
+			packet->lobby = NULL;
 
-		if (!packet->data_ref) {
-			if (packet->data) free (packet->data);
+			if (!packet->data_ref) {
+				if (packet->data) free (packet->data);
+			}
+
+			packet_header_release (packet);
+			if (!packet->version_ref) packet_version_delete (packet->version);
+
+			if (!packet->packet_ref) {
+				if (packet->packet) free (packet->packet);
+			}
+
+			// the received buffer is deleted with its last packet
+			packet_buffer_unref (packet->data_buffer);
+
+			packets_cache_put (PACKETS_CACHE_TYPE_PACKET, packet);
 		}
+	}
 
-		packet_header_delete (packet->header);
-		packet_version_delete (packet->version);
+}
 
-		if (!packet->packet_ref) {
-			if (packet->packet) free (packet->packet);
+// adds a new reference to the packet, so it can be kept or handed to other consumers
+// without being copied, each reference must be removed with packet_unref ()
+// the consumers that share a packet should not move its data_ptr
+// returns the same packet
+Packet *packet_ref (Packet *packet) {
+
+	if (packet) __atomic_add_fetch (&packet->ref_count, 1, __ATOMIC_RELAXED);
+
+	return packet;
+
+}
+
+// removes a reference from the packet, it works just as packet_delete ()
+void packet_unref (Packet *packet) {
+
+	packet_delete (packet);
+
+}
+
+// checks the packet's data against the checksum that it was received with
+// returns 0 if it matches or if the packet came without one, 1 if the data was corrupted
+u8 packet_check_checksum (const Packet *packet) {
+
+	u8 retval = 1;
+
+	if (packet) {
+		retval = (packet->has_checksum && (crc32c_calc (0, packet->data, packet->data_size) != packet->checksum)) ?
+			1 : 0;
+	}
+
+	return retval;
+
+}
+
+// replaces the data of a packet that was received compressed with the original one,
+// that is owned by the packet, the cpu time that it took is added to the stats (if set)
+// the original size is claimed by the peer, so it is limited to max_packet_size (header included, 0 for no limit)
+// returns 0 on success or if the data was not compressed, 1 if it is corrupted or too big
+u8 packet_decompress (
+	Packet *packet, const PacketCompressor *compressor,
+	const size_t max_packet_size, ConnectionStats *stats
+) {
+
+	u8 retval = 1;
+
+	if (packet && !packet->compressed) {
+		retval = 0;
+	}
+
+	else if (packet && compressor && (packet->data_size > sizeof (u32))) {
+		u64 start = packet_compression_clock ();
+
+		u32 original_size = 0;
+		memcpy (&original_size, packet->data, sizeof (u32));
+		original_size = le32toh (original_size);
+
+		size_t compressed_size = packet->data_size - sizeof (u32);
+		if (
+			original_size && ((original_size / PACKET_COMPRESSION_MAX_RATIO) <= compressed_size)
+			&& (!max_packet_size || (((size_t) original_size + sizeof (PacketHeader)) <= max_packet_size))
+		) {
+			char *data = (char *) malloc (original_size);
+			if (data) {
+				if (!compressor->decompress (
+					(char *) packet->data + sizeof (u32), compressed_size,
+					data, original_size
+				)) {
+					if (stats) {
+						(void) __atomic_add_fetch (&stats->n_packets_decompressed, 1, __ATOMIC_RELAXED);
+						(void) __atomic_add_fetch (&stats->decompression_bytes_in, packet->data_size, __ATOMIC_RELAXED);
+						(void) __atomic_add_fetch (&stats->decompression_bytes_out, original_size, __ATOMIC_RELAXED);
+					}
+
+					// the received buffer that kept the compressed data is no longer needed
+					packet_data_release (packet);
+
+					packet->data = data;
+					packet->data_size = original_size;
+					packet->data_ptr = data;
+					packet->data_end = data + original_size;
+
+					packet->packet_size = sizeof (PacketHeader) + original_size;
+					if (packet->header) packet->header->packet_size = packet->packet_size;
+
+					packet->compressed = false;
+
+					retval = 0;
+				}
+
+				else {
+					free (data);
+				}
+			}
 		}
 
-		free (packet);
+		if (stats) (void) __atomic_add_fetch (&stats->decompression_time, packet_compression_clock () - start, __ATOMIC_RELAXED);
 	}
 
+	return retval;
+
 }
 
 // sets the pakcet destinatary is directed to and the protocol to use
@@ -266,8 +972,7 @@ void packet_set_network_values (Packet *packet, Cerver *cerver,
 void packet_set_header (Packet *packet, PacketHeader *header) {
 
 	if (packet && header) {
-		if (!packet->header) packet->header = (PacketHeader *) malloc (sizeof (PacketHeader));
-		if (packet->header) memcpy (&packet->header, header, sizeof (PacketHeader));
+		memcpy (packet_header_get_own (packet), header, sizeof (PacketHeader));
 	}
 
 }
@@ -282,14 +987,12 @@ void packet_set_header_values (
 ) {
 
 	if (packet) {
-		if (!packet->header) packet->header = (PacketHeader *) malloc (sizeof (PacketHeader));
-		if (packet->header) {
-			packet->header->packet_type = packet_type;
-			packet->header->packet_size = packet_size;
-			packet->header->handler_id = handler_id;
-			packet->header->request_type = request_type;
-			packet->header->sock_fd = sock_fd;
-		}
+		PacketHeader *header = packet_header_get_own (packet);
+		header->packet_type = packet_type;
+		header->packet_size = packet_size;
+		header->handler_id = handler_id;
+		header->request_type = request_type;
+		header->sock_fd = sock_fd;
 	}
 
 }
@@ -303,9 +1006,7 @@ u8 packet_set_data (Packet *packet, void *data, size_t data_size) {
 
 	if (packet && data) {
 		// check if there was data in the packet before
-		if (!packet->data_ref) {
-			if (packet->data) free (packet->data);
-		}
+		packet_data_release (packet);
 
 		packet->data_size = data_size;
 		packet->data = malloc (packet->data_size);
@@ -325,15 +1026,48 @@ u8 packet_set_data (Packet *packet, void *data, size_t data_size) {
 
 }
 
+// allocates the packet's data buffer without initializing it
+// if the packet had data before it is deleted
+// returns 0 on success, 1 on error
+u8 packet_allocate_data (Packet *packet, size_t data_size) {
+
+	u8 retval = 1;
+
+	if (packet) {
+		packet_data_release (packet);
+
+		packet->data_size = data_size;
+		packet->data = malloc (packet->data_size);
+		if (packet->data) {
+			packet->data_ptr = (char *) packet->data;
+			packet->data_end = packet->data_ptr + packet->data_size;
+
+			retval = 0;
+		}
+
+		else {
+			packet->data_size = 0;
+			packet->data_ptr = NULL;
+			packet->data_end = NULL;
+		}
+	}
+
+	return retval;
+
+}
+
 // appends the data to the end if the packet already has data
 // if the packet is empty, creates a new buffer
 // it creates a new copy of the data and the original can be safely freed
-// this does not work if the data has been set using a reference
+// this does not work if the data has been set using packet_set_data_ref ()
 u8 packet_append_data (Packet *packet, void *data, size_t data_size) {
 
 	u8 retval = 1;
 
-	if (packet && data) {
+	// data that is kept by a received or a zero copy buffer is copied first, so it can grow
+	if (packet && data && packet->data_buffer) (void) packet_data_take (packet);
+
+	if (packet && data && !packet->data_ref) {
 		// append the data to the end if the packet already has data
 		if (packet->data) {
 			size_t new_size = packet->data_size + data_size;
@@ -394,6 +1128,38 @@ u8 packet_append_data (Packet *packet, void *data, size_t data_size) {
 
 }
 
+// sets the packet's data as a reference to a received packet buffer, the header is not referenced
+// as it can be at any offset of the buffer, so it must be copied with packet_set_header ()
+// a new reference is added to the packet buffer & removed when the packet gets deleted
+// returns 0 on success, 1 on error
+u8 packet_set_buffer_ref (
+	Packet *packet, PacketBuffer *packet_buffer,
+	void *data, size_t data_size
+) {
+
+	u8 retval = 1;
+
+	if (packet && packet_buffer && !packet->data_buffer) {
+		if (!packet->data_ref) {
+			if (packet->data) free (packet->data);
+		}
+
+		packet->data = data;
+		packet->data_size = data_size;
+		packet->data_ptr = (char *) packet->data;
+		packet->data_end = (char *) data + data_size;
+		packet->data_ref = true;
+
+		packet_buffer_ref (packet_buffer);
+		packet->data_buffer = packet_buffer;
+
+		retval = 0;
+	}
+
+	return retval;
+
+}
+
 // sets a reference to a data buffer to send
 // data will not be copied into the packet and will not be freed after use
 // this method is usefull for example if you just want to send a raw json packet to a non-cerver
@@ -403,9 +1169,7 @@ u8 packet_set_data_ref (Packet *packet, void *data, size_t data_size) {
 	u8 retval = 1;
 
 	if (packet && data) {
-		if (!packet->data_ref) {
-			if (packet->data) free (packet->data);
-		}
+		packet_data_release (packet);
 
 		packet->data = data;
 		packet->data_size = data_size;
@@ -470,20 +1234,25 @@ u8 packet_set_packet_ref (Packet *packet, void *data, size_t packet_size) {
 // returns 0 on sucess, 1 on error
 u8 packet_generate (Packet *packet) {
 
-	u8 retval = 0;
+	u8 retval = 1;
 
 	if (packet) {
 		if (packet->packet) {
-			free (packet->packet);
+			if (!packet->packet_ref) free (packet->packet);
 			packet->packet = NULL;
-			packet->packet_size = 0;
+			packet->packet_ref = false;
 		}
 
 		packet->packet_size = sizeof (PacketHeader) + packet->data_size;
-		if (!packet->header)
-			packet->header = packet_header_create (packet->packet_type, packet->packet_size, packet->req_type);
+		if (!packet->header) {
+			packet_header_init (
+				packet_header_get_own (packet),
+				packet->packet_type, packet->packet_size, packet->req_type
+			);
+		}
 
-		// create the packet buffer to be sent
+		// create the packet buffer to be sent,
+		// it is sent with a single iovec in place of the header & data ones
 		packet->packet = malloc (packet->packet_size);
 		if (packet->packet) {
 			char *end = (char *) packet->packet;
@@ -534,217 +1303,332 @@ Packet *packet_generate_request (
 
 }
 
-static inline u8 packet_send_tcp_actual (
-	const Packet *packet, Connection *connection, int flags, size_t *total_sent, bool raw
+// the biggest header that is sent in place of the PacketHeader
+#define PACKET_WIRE_HEADER_SIZE				(PACKET_HEADER_V2_SIZE + PACKET_HEADER_CHECKSUM_SIZE)
+
+// encodes the v2 header for the socket, followed by the data's checksum if it uses them
+// if the data is sent compressed, the header is flagged & counts it instead of the original one
+// returns the size of the wire header, 0 if it can't be encoded
+static size_t packet_wire_header_encode (
+	const Socket *socket, const PacketHeader *header,
+	const struct iovec *data_iov, int data_iovcnt,
+	const struct iovec *compressed,
+	char wire_header[PACKET_WIRE_HEADER_SIZE]
 ) {
 
-	ssize_t sent = 0;
-	char *p = raw ? (char *) packet->data : (char *) packet->packet;
-	size_t packet_size = raw ? packet->data_size : packet->packet_size;
+	size_t header_size = 0;
 
-	while (packet_size > 0) {
-		sent = send (connection->socket->sock_fd, p, packet_size, flags);
-		if (sent < 0) {
-			return 1;
-		}
+	PacketHeader compressed_header = { 0 };
+	if (compressed) {
+		memcpy (&compressed_header, header, sizeof (PacketHeader));
+		compressed_header.packet_type = (PacketType) (header->packet_type | PACKET_HEADER_V2_COMPRESSED);
+		compressed_header.packet_size = sizeof (PacketHeader) + compressed->iov_len;
+		header = &compressed_header;
+	}
+
+	if (socket->header_checksum) {
+		u32 checksum = 0;
+		for (int i = 0; i < data_iovcnt; i++)
+			checksum = crc32c_calc (checksum, data_iov[i].iov_base, data_iov[i].iov_len);
 
-		p += sent;
-		packet_size -= (size_t) sent;
+		if (!packet_header_v2_encode_checksum (header, checksum, wire_header))
+			header_size = PACKET_WIRE_HEADER_SIZE;
 	}
 
-	if (total_sent) *total_sent = (size_t) sent;
+	else {
+		if (!packet_header_v2_encode (header, wire_header))
+			header_size = PACKET_HEADER_V2_SIZE;
+	}
 
-	return 0;
+	return header_size;
 
 }
 
-// sends a packet directly using the tcp protocol and the packet sock fd
-// returns 0 on success, 1 on error
-static u8 packet_send_tcp (
-	const Packet *packet, Connection *connection, int flags, size_t *total_sent, bool raw
+// sets the iovec to send the packet's buffers
+// if the packet has a packet buffer (set using packet_set_packet () or similar) it is used,
+// otherwise the header & data are taken directly from their own buffers
+// if the socket uses the v2 header, the header is encoded into the wire header
+// & sent in place of the PacketHeader, udp sends pass a NULL socket as they always use v1
+// if the socket uses compression, big data is replaced by a compressed copy that is returned
+// in compressed & must be freed by the caller after the send
+// returns the n of used iovec entries, 0 if the header can't be encoded
+static inline int packet_get_iov (
+	const Packet *packet, bool raw, bool split,
+	const Socket *socket, ConnectionStats *stats,
+	char wire_header[PACKET_WIRE_HEADER_SIZE], char **compressed,
+	struct iovec iov[2]
 ) {
 
-	u8 retval = 1;
+	int iovcnt = 0;
 
-	pthread_mutex_lock (connection->socket->write_mutex);
+	if (raw) {
+		iov[0].iov_base = packet->data;
+		iov[0].iov_len = packet->data_size;
+		iovcnt = 1;
+	}
 
-	retval = packet_send_tcp_actual (packet, connection, flags, total_sent, raw);
+	else if (socket && (socket->header_version == PACKET_HEADER_VERSION_V2)) {
+		// the packet buffer starts with its PacketHeader
+		bool whole = packet->packet && !split && (packet->packet_size >= sizeof (PacketHeader));
+		const PacketHeader *header = whole ? (const PacketHeader *) packet->packet : packet->header;
 
-	pthread_mutex_unlock (connection->socket->write_mutex);
+		iov[1].iov_base = whole ? (char *) packet->packet + sizeof (PacketHeader) : packet->data;
+		iov[1].iov_len = whole ? packet->packet_size - sizeof (PacketHeader) : packet->data_size;
 
-	return retval;
+		struct iovec compressed_iov = { 0 };
+		if (packet_compression_use (socket, header, iov[1].iov_len)) {
+			*compressed = packet_compress (
+				socket->compressor, iov[1].iov_base, iov[1].iov_len,
+				stats, &compressed_iov.iov_len
+			);
+
+			compressed_iov.iov_base = *compressed;
+		}
+
+		iov[0].iov_base = wire_header;
+		iov[0].iov_len = header ? packet_wire_header_encode (
+			socket, header, &iov[1], 1, *compressed ? &compressed_iov : NULL, wire_header
+		) : 0;
+
+		if (iov[0].iov_len) {
+			if (*compressed) {
+				packet_compression_update_stats (stats, iov[1].iov_len, compressed_iov.iov_len);
+				iov[1] = compressed_iov;
+			}
+
+			iovcnt = 2;
+		}
+	}
+
+	else if (packet->packet && !split) {
+		iov[0].iov_base = packet->packet;
+		iov[0].iov_len = packet->packet_size;
+		iovcnt = 1;
+	}
+
+	else {
+		iov[0].iov_base = packet->header;
+		iov[0].iov_len = sizeof (PacketHeader);
+		iov[1].iov_base = packet->data;
+		iov[1].iov_len = packet->data_size;
+		iovcnt = 2;
+	}
+
+	return iovcnt;
 
 }
 
-// sends a packet to the socket in two parts, first the header & then the data
-// returns 0 on success, 1 on error
-static u8 packet_send_split_tcp (const Packet *packet, Connection *connection, int flags, size_t *total_sent) {
+// the buffers that a zero copy send of a packet holds until the kernel is done with them
+typedef struct PacketZeroCopy {
 
-	u8 retval = 1;
+	char header[sizeof (PacketHeader)];	// a copy, so the packet's header can be deleted right away
+	PacketBuffer *buffer;
 
-	if (packet && connection) {
-		pthread_mutex_lock (connection->socket->write_mutex);
+} PacketZeroCopy;
 
-		size_t actual_sent = 0;
+static void packet_zero_copy_release (void *zero_copy_ptr) {
+
+	PacketZeroCopy *zero_copy = (PacketZeroCopy *) zero_copy_ptr;
+
+	packet_buffer_unref (zero_copy->buffer);
+
+	free (zero_copy);
+
+}
 
-		// first send the header
-		bool fail = false;
-		ssize_t sent = 0;
-		char *p = (char *) packet->header;
-		size_t packet_size = sizeof (PacketHeader);
-
-		while (packet_size > 0) {
-			sent = send (connection->socket->sock_fd, p, packet_size, flags);
-			if (sent < 0) {
-				fail = true;
-				break;
+// gets a new reference to the packet buffer that owns the packet's data
+// if the packet owns its data, it is moved into a new packet buffer,
+// so it is freed once both the packet & the zero copy send are done with it
+// returns NULL if the data is only referenced by the packet
+static PacketBuffer *packet_zero_copy_buffer (const Packet *packet) {
+
+	Packet *owner = (Packet *) packet;
+
+	PacketBuffer *buffer = __atomic_load_n (&owner->data_buffer, __ATOMIC_ACQUIRE);
+	if (!buffer && !__atomic_load_n (&owner->data_ref, __ATOMIC_ACQUIRE) && owner->data) {
+		PacketBuffer *new_buffer = packet_buffer_create ((char *) owner->data, owner->data_size);
+		if (new_buffer) {
+			// the same packet might be sent at the same time from another thread
+			if (__atomic_compare_exchange_n (
+				&owner->data_buffer, &buffer, new_buffer,
+				false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE
+			)) {
+				__atomic_store_n (&owner->data_ref, true, __ATOMIC_RELEASE);
+				buffer = new_buffer;
 			}
 
-			p += sent;
-			actual_sent += (size_t) sent;
-			packet_size -= (size_t) sent;
-			fail = false;
+			else {
+				free (new_buffer);
+			}
 		}
+	}
 
-		// now send the data
-		if (!fail) {
-			sent = 0;
-			p = (char *) packet->data;
-			packet_size = packet->data_size;
-
-			while (packet_size > 0) {
-				sent = send (connection->socket->sock_fd, p, packet_size, flags);
-				if (sent < 0) break;
-				p += sent;
-				actual_sent += (size_t) sent;
-				packet_size -= (size_t) sent;
-			}
+	packet_buffer_ref (buffer);
 
-			if (total_sent) *total_sent = actual_sent;
+	return buffer;
 
-			retval = 0;
+}
+
+// sends the packet's buffers with MSG_ZEROCOPY, if they are the packet's header & data,
+// the data is held until the kernel is done with it, otherwise, as they are owned by the caller,
+// the kernel is waited to complete the send before returning
+static u8 packet_send_zero_copy (
+	const Packet *packet, Socket *socket,
+	struct iovec *iov, int iovcnt, int flags, size_t *total_sent, bool raw
+) {
+
+	PacketZeroCopy *zero_copy = NULL;
+
+	bool data_only = raw || ((iovcnt == 2) && (iov[1].iov_base == packet->data));
+	PacketBuffer *buffer = data_only ? packet_zero_copy_buffer (packet) : NULL;
+	if (buffer) {
+		zero_copy = (PacketZeroCopy *) malloc (sizeof (PacketZeroCopy));
+		if (zero_copy) {
+			zero_copy->buffer = buffer;
+
+			if (!raw) {
+				memcpy (zero_copy->header, iov[0].iov_base, iov[0].iov_len);
+				iov[0].iov_base = zero_copy->header;
+			}
 		}
 
-		pthread_mutex_unlock (connection->socket->write_mutex);
+		else {
+			packet_buffer_unref (buffer);
+		}
 	}
 
-	return retval;
+	return socket_send_iov_zero_copy (
+		socket, iov, iovcnt, flags,
+		zero_copy, zero_copy ? packet_zero_copy_release : NULL,
+		total_sent
+	);
 
 }
 
-#pragma GCC diagnostic push
-#pragma GCC diagnostic ignored "-Wunused-function"
-static u8 packet_send_udp (const void *packet, size_t packet_size) {
+// sends the packet's buffers to the socket
+// the compression stats are added to the connection's stats (if set)
+// the socket's write mutex must be locked by the caller
+static inline u8 packet_send_socket_actual (
+	const Packet *packet, Socket *socket, ConnectionStats *stats,
+	int flags, size_t *total_sent, bool raw, bool split
+) {
+
+	u8 retval = 1;
+
+	char wire_header[PACKET_WIRE_HEADER_SIZE];
+	char *compressed = NULL;
+	struct iovec iov[2];
+	int iovcnt = packet_get_iov (packet, raw, split, socket, stats, wire_header, &compressed, iov);
+	if (iovcnt) {
+		size_t size = iov[0].iov_len + ((iovcnt > 1) ? iov[1].iov_len : 0);
+
+		// the compressed copy is freed right after the send
+		retval = (!compressed && socket_zero_copy_use (socket, size)) ?
+			packet_send_zero_copy (packet, socket, iov, iovcnt, flags, total_sent, raw) :
+			socket_send_iov (socket, iov, iovcnt, flags, total_sent);
+	}
 
-	// TODO:
+	if (compressed) free (compressed);
 
-	return 0;
+	return retval;
 
 }
-#pragma GCC diagnostic pop
 
-static void packet_send_update_stats (
-	PacketType packet_type, size_t sent,
-	Cerver *cerver, Client *client, Connection *connection, Lobby *lobby
+static inline u8 packet_send_tcp_actual (
+	const Packet *packet, Connection *connection, int flags, size_t *total_sent, bool raw, bool split
 ) {
 
-	if (cerver) {
-		cerver->stats->n_packets_sent += 1;
-		cerver->stats->total_bytes_sent += sent;
-	}
+	return packet_send_socket_actual (
+		packet, connection->socket, connection->stats, flags, total_sent, raw, split
+	);
 
-	if (client) {
-		client->stats->n_packets_sent += 1;
-		client->stats->total_bytes_sent += sent;
-	}
+}
 
-	connection->stats->n_packets_sent += 1;
-	connection->stats->total_bytes_sent += sent;
+// sends a packet directly using the tcp protocol and the packet sock fd
+// returns 0 on success, 1 on error
+static u8 packet_send_tcp (
+	const Packet *packet, Connection *connection, int flags, size_t *total_sent, bool raw, bool split
+) {
 
-	if (lobby) {
-		lobby->stats->n_packets_sent += 1;
-		lobby->stats->bytes_sent += sent;
+	u8 retval = 1;
+
+	pthread_mutex_lock (connection->socket->write_mutex);
+
+	retval = packet_send_tcp_actual (packet, connection, flags, total_sent, raw, split);
+
+	pthread_mutex_unlock (connection->socket->write_mutex);
+
+	return retval;
+
+}
+
+// sends the packet as a single datagram to the connection's address
+// a cerver's udp peer is sent to using the cerver's socket,
+// so the datagram can be batched with the other ones that are sent while handling a batch
+// returns 0 on success, 1 on error
+static u8 packet_send_udp (
+	const Packet *packet, Connection *connection, int flags, size_t *total_sent, bool raw
+) {
+
+	u8 retval = 1;
+
+	// udp peers don't negotiate the header version
+	struct iovec iov[2];
+	int iovcnt = packet_get_iov (packet, raw, false, NULL, NULL, NULL, NULL, iov);
+
+	if (connection->udp) {
+		retval = cerver_udp_send (connection->udp, &connection->address, iov, iovcnt, total_sent);
 	}
 
-	switch (packet_type) {
-		case PACKET_TYPE_NONE: break;
+	else {
+		struct msghdr msg = { 0 };
+		msg.msg_name = &connection->address;
+		msg.msg_namelen = cerver_udp_address_len (&connection->address);
+		msg.msg_iov = iov;
+		msg.msg_iovlen = (size_t) iovcnt;
 
-		case PACKET_TYPE_CERVER:
-			if (cerver) cerver->stats->sent_packets->n_cerver_packets += 1;
-			if (client) client->stats->sent_packets->n_cerver_packets += 1;
-			connection->stats->sent_packets->n_cerver_packets += 1;
-			if (lobby) lobby->stats->sent_packets->n_cerver_packets += 1;
-			break;
+		pthread_mutex_lock (connection->socket->write_mutex);
 
-		case PACKET_TYPE_CLIENT:
-			if (cerver) cerver->stats->sent_packets->n_client_packets += 1;
-			if (client) client->stats->sent_packets->n_client_packets += 1;
-			connection->stats->sent_packets->n_client_packets += 1;
-			if (lobby) lobby->stats->sent_packets->n_client_packets += 1;
-			break;
+		ssize_t sent = sendmsg (connection->socket->sock_fd, &msg, flags | MSG_NOSIGNAL);
 
-		case PACKET_TYPE_ERROR:
-			if (cerver) cerver->stats->sent_packets->n_error_packets += 1;
-			if (client) client->stats->sent_packets->n_error_packets += 1;
-			connection->stats->sent_packets->n_error_packets += 1;
-			if (lobby) lobby->stats->sent_packets->n_error_packets += 1;
-			break;
+		pthread_mutex_unlock (connection->socket->write_mutex);
 
-		case PACKET_TYPE_REQUEST:
-			if (cerver) cerver->stats->sent_packets->n_request_packets += 1;
-			if (client) client->stats->sent_packets->n_request_packets += 1;
-			connection->stats->sent_packets->n_request_packets += 1;
-			if (lobby) lobby->stats->sent_packets->n_request_packets += 1;
-			break;
+		if (sent >= 0) {
+			*total_sent = (size_t) sent;
+			retval = 0;
+		}
+	}
 
-		case PACKET_TYPE_AUTH:
-			if (cerver) cerver->stats->sent_packets->n_auth_packets += 1;
-			if (client) client->stats->sent_packets->n_auth_packets += 1;
-			connection->stats->sent_packets->n_auth_packets += 1;
-			if (lobby) lobby->stats->sent_packets->n_auth_packets += 1;
-			break;
+	return retval;
 
-		case PACKET_TYPE_GAME:
-			if (cerver) cerver->stats->sent_packets->n_game_packets += 1;
-			if (client) client->stats->sent_packets->n_game_packets += 1;
-			connection->stats->sent_packets->n_game_packets += 1;
-			if (lobby) lobby->stats->sent_packets->n_game_packets += 1;
-			break;
+}
 
-		case PACKET_TYPE_APP:
-			if (cerver) cerver->stats->sent_packets->n_app_packets += 1;
-			if (client) client->stats->sent_packets->n_app_packets += 1;
-			connection->stats->sent_packets->n_app_packets += 1;
-			if (lobby) lobby->stats->sent_packets->n_app_packets += 1;
-			break;
+// the stats are shared by every thread that sends, so they are updated atomically
+static void packet_send_update_stats (
+	PacketType packet_type, size_t sent,
+	Cerver *cerver, Client *client, Connection *connection, Lobby *lobby
+) {
 
-		case PACKET_TYPE_APP_ERROR:
-			if (cerver) cerver->stats->sent_packets->n_app_error_packets += 1;
-			if (client) client->stats->sent_packets->n_app_error_packets += 1;
-			connection->stats->sent_packets->n_app_error_packets += 1;
-			if (lobby) lobby->stats->sent_packets->n_app_error_packets += 1;
-			break;
+	if (cerver) {
+		(void) __atomic_add_fetch (&cerver->stats->n_packets_sent, 1, __ATOMIC_RELAXED);
+		(void) __atomic_add_fetch (&cerver->stats->total_bytes_sent, sent, __ATOMIC_RELAXED);
+		packets_per_type_add (cerver->stats->sent_packets, packet_type, 1);
+	}
 
-		case PACKET_TYPE_CUSTOM:
-			if (cerver) cerver->stats->sent_packets->n_custom_packets += 1;
-			if (client) client->stats->sent_packets->n_custom_packets += 1;
-			connection->stats->sent_packets->n_custom_packets += 1;
-			if (lobby) lobby->stats->sent_packets->n_custom_packets += 1;
-			break;
+	if (client) {
+		(void) __atomic_add_fetch (&client->stats->n_packets_sent, 1, __ATOMIC_RELAXED);
+		(void) __atomic_add_fetch (&client->stats->total_bytes_sent, sent, __ATOMIC_RELAXED);
+		packets_per_type_add (client->stats->sent_packets, packet_type, 1);
+	}
 
-		case PACKET_TYPE_TEST:
-			if (cerver) cerver->stats->sent_packets->n_test_packets += 1;
-			if (client) client->stats->sent_packets->n_test_packets += 1;
-			connection->stats->sent_packets->n_test_packets += 1;
-			if (lobby) lobby->stats->sent_packets->n_test_packets += 1;
-			break;
+	(void) __atomic_add_fetch (&connection->stats->n_packets_sent, 1, __ATOMIC_RELAXED);
+	(void) __atomic_add_fetch (&connection->stats->total_bytes_sent, sent, __ATOMIC_RELAXED);
+	packets_per_type_add (connection->stats->sent_packets, packet_type, 1);
 
-		default:
-			if (cerver) cerver->stats->sent_packets->n_unknown_packets += 1;
-			if (client) client->stats->sent_packets->n_unknown_packets += 1;
-			connection->stats->sent_packets->n_unknown_packets += 1;
-			if (lobby) lobby->stats->sent_packets->n_unknown_packets += 1;
-			break;
+	if (lobby) {
+		(void) __atomic_add_fetch (&lobby->stats->n_packets_sent, 1, __ATOMIC_RELAXED);
+		(void) __atomic_add_fetch (&lobby->stats->bytes_sent, sent, __ATOMIC_RELAXED);
+		packets_per_type_add (lobby->stats->sent_packets, packet_type, 1);
 	}
 
 }
@@ -759,43 +1643,44 @@ static inline u8 packet_send_internal (
 	u8 retval = 1;
 
 	if (packet && connection) {
+		size_t sent = 0;
+		u8 send_error = 1;
 		switch (connection->protocol) {
 			case PROTOCOL_TCP: {
-				size_t sent = 0;
+				send_error = unsafe ? packet_send_tcp_actual (packet, connection, flags, &sent, raw, split)
+					: packet_send_tcp (packet, connection, flags, &sent, raw, split);
+			} break;
 
-				if (!(split ? packet_send_split_tcp (packet, connection, flags, &sent)
-					: unsafe ? packet_send_tcp_actual (packet, connection, flags, &sent, raw) 
-						: packet_send_tcp (packet, connection, flags, &sent, raw))
-				) {
-					if (total_sent) *total_sent = sent;
+			case PROTOCOL_UDP: {
+				send_error = packet_send_udp (packet, connection, flags, &sent, raw);
+			} break;
 
-					packet_send_update_stats (
-						packet->packet_type, sent,
-						cerver, client, connection, lobby
-					);
+			default: break;
+		}
 
-					retval = 0;
-				}
+		if (!send_error) {
+			if (total_sent) *total_sent = sent;
 
-				else {
-					#ifdef PACKETS_DEBUG
-					printf ("\n");
-					perror ("packet_send_internal () - Error");
-					printf ("\n");
-					#endif
+			packet_send_update_stats (
+				packet->packet_type, sent,
+				cerver, client, connection, lobby
+			);
 
-					if (cerver) cerver->stats->sent_packets->n_bad_packets += 1;
-					if (client) client->stats->sent_packets->n_bad_packets += 1;
-					if (connection) connection->stats->sent_packets->n_bad_packets += 1;
+			retval = 0;
+		}
 
-					if (total_sent) *total_sent = 0;
-				}
-			} break;
+		else {
+			#ifdef PACKETS_DEBUG
+			printf ("\n");
+			perror ("packet_send_internal () - Error");
+			printf ("\n");
+			#endif
 
-			case PROTOCOL_UDP:
-				break;
+			if (cerver) (void) __atomic_add_fetch (&cerver->stats->sent_packets->n_bad_packets, 1, __ATOMIC_RELAXED);
+			if (client) (void) __atomic_add_fetch (&client->stats->sent_packets->n_bad_packets, 1, __ATOMIC_RELAXED);
+			if (connection) (void) __atomic_add_fetch (&connection->stats->sent_packets->n_bad_packets, 1, __ATOMIC_RELAXED);
 
-			default: break;
+			if (total_sent) *total_sent = 0;
 		}
 	}
 
@@ -881,27 +1766,78 @@ u8 packet_send_to_split (
 
 }
 
-static u8 packet_send_pieces_actual (
-	Socket *socket,
-	char *data, size_t data_size,
+// sends the packet's header followed by the iovec buffers
+// the caller must hold the socket's write mutex
+// returns 0 on success, 1 on error
+static u8 packet_send_iov_internal (
+	const Packet *packet,
+	const struct iovec *iov, int iovcnt,
+	int flags, size_t *total_sent
+) {
+
+	u8 retval = 1;
+
+	struct iovec local_iov[PACKET_SEND_IOV_LOCAL];
+	struct iovec *packet_iov = ((iovcnt + 1) > PACKET_SEND_IOV_LOCAL) ?
+		(struct iovec *) malloc ((iovcnt + 1) * sizeof (struct iovec)) : local_iov;
+
+	Socket *socket = packet->connection->socket;
+	char wire_header[PACKET_WIRE_HEADER_SIZE];
+	bool header_v2 = (socket->header_version == PACKET_HEADER_VERSION_V2);
+
+	size_t header_size = sizeof (PacketHeader);
+	if (packet_iov && header_v2) {
+		header_size = packet_wire_header_encode (socket, packet->header, iov, iovcnt, NULL, wire_header);
+	}
+
+	if (packet_iov && header_size) {
+		packet_iov[0].iov_base = header_v2 ? (void *) wire_header : (void *) packet->header;
+		packet_iov[0].iov_len = header_size;
+		if (iovcnt > 0) memcpy (&packet_iov[1], iov, iovcnt * sizeof (struct iovec));
+
+		size_t size = 0;
+		for (int i = 0; i <= iovcnt; i++) size += packet_iov[i].iov_len;
+
+		// the pieces are owned by the caller, so a zero copy send
+		// is waited to be completed by the kernel before returning
+		size_t actual_sent = 0;
+		retval = socket_zero_copy_use (socket, size) ?
+			socket_send_iov_zero_copy (socket, packet_iov, iovcnt + 1, flags, NULL, NULL, &actual_sent) :
+			socket_send_iov (socket, packet_iov, iovcnt + 1, flags, &actual_sent);
+
+		packet_send_update_stats (
+			packet->packet_type, actual_sent,
+			packet->cerver, packet->client, packet->connection, packet->lobby
+		);
+
+		if (total_sent) *total_sent = actual_sent;
+	}
+
+	if (packet_iov != local_iov) free (packet_iov);
+
+	return retval;
+
+}
+
+// sends the packet's header followed by the iovec buffers
+// everything is sent using a single sendmsg () call when possible
+// socket mutex will be locked for the entire operation
+// returns 0 on success, 1 on error
+u8 packet_send_iov (
+	const Packet *packet,
+	const struct iovec *iov, int iovcnt,
 	int flags,
-	size_t *actual_sent
+	size_t *total_sent
 ) {
 
-	u8 retval = 0;
+	u8 retval = 1;
 
-	ssize_t sent = 0;
-	char *p = data;
-	while (data_size > 0) {
-		sent = send (socket->sock_fd, p, data_size, flags);
-		if (sent < 0) {
-			retval = 1;
-			break;
-		}
+	if (packet && packet->header && packet->connection && (iov || !iovcnt) && (iovcnt >= 0)) {
+		pthread_mutex_lock (packet->connection->socket->write_mutex);
+
+		retval = packet_send_iov_internal (packet, iov, iovcnt, flags, total_sent);
 
-		p += sent;
-		*actual_sent += (size_t) sent;
-		data_size -= (size_t) sent;
+		pthread_mutex_unlock (packet->connection->socket->write_mutex);
 	}
 
 	return retval;
@@ -922,38 +1858,20 @@ u8 packet_send_pieces (
 	u8 retval = 1;
 
 	if (packet && pieces && sizes) {
-		pthread_mutex_lock (packet->connection->socket->write_mutex);
-
-		size_t actual_sent = 0;
+		struct iovec local_iov[PACKET_SEND_IOV_LOCAL];
+		struct iovec *iov = (n_pieces > PACKET_SEND_IOV_LOCAL) ?
+			(struct iovec *) malloc (n_pieces * sizeof (struct iovec)) : local_iov;
 
-		// first send the header
-		if (!packet_send_pieces_actual (
-			packet->connection->socket,
-			(char *) packet->header, sizeof (PacketHeader),
-			flags,
-			&actual_sent
-		)) {
-			// send the pieces of data
+		if (iov) {
 			for (u32 i = 0; i < n_pieces; i++) {
-				(void) packet_send_pieces_actual (
-					packet->connection->socket,
-					(char *) pieces[i], sizes[i],
-					flags,
-					&actual_sent
-				);
+				iov[i].iov_base = pieces[i];
+				iov[i].iov_len = sizes[i];
 			}
 
-			retval = 0;
-		}
-
-		packet_send_update_stats (
-			packet->packet_type, actual_sent,
-			packet->cerver, packet->client, packet->connection, packet->lobby
-		);
-
-		if (total_sent) *total_sent = actual_sent;
+			retval = packet_send_iov (packet, iov, (int) n_pieces, flags, total_sent);
 
-		pthread_mutex_unlock (packet->connection->socket->write_mutex);
+			if (iov != local_iov) free (iov);
+		}
 	}
 
 	return retval;
@@ -970,25 +1888,10 @@ u8 packet_send_to_socket (
 
 	u8 retval = 0;
 
-	if (packet) {
-		ssize_t sent = 0;
-		const char *p = raw ? (char *) packet->data : (char *) packet->packet;
-		size_t packet_size = raw ? packet->data_size : packet->packet_size;
-
+	if (packet && socket) {
 		pthread_mutex_lock (socket->write_mutex);
 
-		while (packet_size > 0) {
-			sent = send (socket->sock_fd, p, packet_size, flags);
-			if (sent < 0) {
-				retval = 1;
-				break;
-			};
-
-			p += sent;
-			packet_size -= sent;
-		}
-
-		if (total_sent) *total_sent = (size_t) sent;
+		retval = packet_send_socket_actual (packet, socket, NULL, flags, total_sent, raw, false);
 
 		pthread_mutex_unlock (socket->write_mutex);
 	}
@@ -1030,4 +1933,470 @@ bool packet_check (Packet *packet) {
 
 }
 
-#pragma endregion
\ No newline at end of file
+#pragma endregion
+
+#pragma region broadcast
+
+// the packet's wire bytes that are shared by all the sends of a broadcast,
+// the threads that take part in it claim chunks of targets until there are no more
+typedef struct PacketBroadcast {
+
+	PacketType packet_type;
+
+	char *wire;
+	size_t wire_size;
+	bool wire_ref;                  // the packet's own packet buffer is used
+
+	// sent in place of the wire's PacketHeader to the connections that use the v2 header
+	char header_v2[PACKET_HEADER_V2_SIZE];
+	bool header_v2_valid;
+
+	// the checksum is only calculated when a connection that uses them is reached
+	char header_checksum[PACKET_WIRE_HEADER_SIZE];
+	bool header_checksum_done;
+	bool header_checksum_valid;
+
+	// the data is only compressed once, by the first thread that reaches
+	// a connection that uses compression, with that connection's compressor
+	const PacketCompressor *compressor;
+	char *compressed;
+	size_t compressed_size;
+	char compressed_header_v2[PACKET_HEADER_V2_SIZE];
+	char compressed_header_checksum[PACKET_WIRE_HEADER_SIZE];
+	bool compressed_done;
+
+	const PacketBroadcastTarget *targets;
+	size_t n_targets;
+	int flags;
+
+	size_t next;                    // the next target to be claimed
+	size_t done;                    // n of targets that have been handled
+	size_t n_sent;
+	size_t total_sent;
+
+	// the bytes that were sent to each target (0 if its send failed), the same client or connection
+	// can be reached by different threads, so their stats are only updated after all the sends
+	size_t *sent;
+
+	// the broadcast is deleted by the last thread that references it,
+	// thpool jobs that start after every target was handled only release it
+	unsigned int ref_count;
+
+	pthread_mutex_t *mutex;
+	pthread_cond_t *done_cond;
+
+} PacketBroadcast;
+
+static void packet_broadcast_delete (PacketBroadcast *broadcast) {
+
+	if (broadcast->wire && !broadcast->wire_ref) free (broadcast->wire);
+	if (broadcast->compressed) free (broadcast->compressed);
+
+	if (broadcast->sent) free (broadcast->sent);
+
+	pthread_mutex_delete (broadcast->mutex);
+	pthread_cond_delete (broadcast->done_cond);
+
+	free (broadcast);
+
+}
+
+static inline void packet_broadcast_unref (PacketBroadcast *broadcast) {
+
+	if (!__atomic_sub_fetch (&broadcast->ref_count, 1, __ATOMIC_ACQ_REL))
+		packet_broadcast_delete (broadcast);
+
+}
+
+// builds the packet's wire bytes only once
+static PacketBroadcast *packet_broadcast_create (
+	const Packet *packet,
+	const PacketBroadcastTarget *targets, size_t n_targets,
+	int flags
+) {
+
+	PacketBroadcast *broadcast = (PacketBroadcast *) malloc (sizeof (PacketBroadcast));
+	if (broadcast) {
+		broadcast->packet_type = packet->packet_type;
+
+		// a packet buffer that was set directly is sent as it is
+		if (packet->packet) {
+			broadcast->wire = (char *) packet->packet;
+			broadcast->wire_size = packet->packet_size;
+			broadcast->wire_ref = true;
+		}
+
+		else {
+			broadcast->wire_size = sizeof (PacketHeader) + packet->data_size;
+			broadcast->wire = (char *) malloc (broadcast->wire_size);
+			if (broadcast->wire) {
+				if (packet->header) memcpy (broadcast->wire, packet->header, sizeof (PacketHeader));
+				else {
+					PacketHeader *header = (PacketHeader *) broadcast->wire;
+					header->packet_type = packet->packet_type;
+					header->packet_size = broadcast->wire_size;
+					header->handler_id = 0;
+					header->request_type = packet->req_type;
+					header->sock_fd = 0;
+				}
+
+				if (packet->data_size)
+					memcpy (broadcast->wire + sizeof (PacketHeader), packet->data, packet->data_size);
+			}
+
+			broadcast->wire_ref = false;
+		}
+
+		broadcast->header_v2_valid = broadcast->wire
+			&& (broadcast->wire_size >= sizeof (PacketHeader))
+			&& !packet_header_v2_encode ((const PacketHeader *) broadcast->wire, broadcast->header_v2);
+
+		broadcast->header_checksum_done = false;
+		broadcast->header_checksum_valid = false;
+
+		broadcast->compressor = NULL;
+		broadcast->compressed = NULL;
+		broadcast->compressed_size = 0;
+		broadcast->compressed_done = false;
+
+		broadcast->targets = targets;
+		broadcast->n_targets = n_targets;
+		broadcast->flags = flags;
+
+		broadcast->next = 0;
+		broadcast->done = 0;
+		broadcast->n_sent = 0;
+		broadcast->total_sent = 0;
+
+		broadcast->sent = n_targets ? (size_t *) calloc (n_targets, sizeof (size_t)) : NULL;
+
+		broadcast->ref_count = 1;
+
+		broadcast->mutex = pthread_mutex_new ();
+		broadcast->done_cond = pthread_cond_new ();
+
+		if (
+			!broadcast->wire || (n_targets && !broadcast->sent)
+			|| !broadcast->mutex || !broadcast->done_cond
+		) {
+			packet_broadcast_delete (broadcast);
+			broadcast = NULL;
+		}
+	}
+
+	return broadcast;
+
+}
+
+// gets the v2 header that is followed by the wire's checksum, it is encoded once
+// by the first thread that needs it
+// returns NULL if it can't be encoded
+static const char *packet_broadcast_get_header_checksum (PacketBroadcast *broadcast) {
+
+	if (!__atomic_load_n (&broadcast->header_checksum_done, __ATOMIC_ACQUIRE)) {
+		pthread_mutex_lock (broadcast->mutex);
+
+		if (!broadcast->header_checksum_done) {
+			u32 checksum = crc32c_calc (
+				0, broadcast->wire + sizeof (PacketHeader), broadcast->wire_size - sizeof (PacketHeader)
+			);
+
+			broadcast->header_checksum_valid = !packet_header_v2_encode_checksum (
+				(const PacketHeader *) broadcast->wire, checksum, broadcast->header_checksum
+			);
+
+			__atomic_store_n (&broadcast->header_checksum_done, true, __ATOMIC_RELEASE);
+		}
+
+		pthread_mutex_unlock (broadcast->mutex);
+	}
+
+	return broadcast->header_checksum_valid ? broadcast->header_checksum : NULL;
+
+}
+
+// compresses the wire's data with the compressor & encodes the headers that are sent with it,
+// it is done once by the first thread that needs it, whose connection gets the cpu time
+// returns false if the data was not compressed with the same compressor
+static bool packet_broadcast_get_compressed (
+	PacketBroadcast *broadcast, const PacketCompressor *compressor, ConnectionStats *stats
+) {
+
+	if (!__atomic_load_n (&broadcast->compressed_done, __ATOMIC_ACQUIRE)) {
+		pthread_mutex_lock (broadcast->mutex);
+
+		if (!broadcast->compressed_done) {
+			const char *data = broadcast->wire + sizeof (PacketHeader);
+			size_t data_size = broadcast->wire_size - sizeof (PacketHeader);
+
+			broadcast->compressor = compressor;
+			broadcast->compressed = packet_compress (
+				compressor, data, data_size, stats, &broadcast->compressed_size
+			);
+
+			if (broadcast->compressed) {
+				PacketHeader header = { 0 };
+				memcpy (&header, broadcast->wire, sizeof (PacketHeader));
+				header.packet_type = (PacketType) (header.packet_type | PACKET_HEADER_V2_COMPRESSED);
+				header.packet_size = sizeof (PacketHeader) + broadcast->compressed_size;
+
+				// the checksum is still the one of the original data
+				if (
+					packet_header_v2_encode (&header, broadcast->compressed_header_v2)
+					|| packet_header_v2_encode_checksum (
+						&header, crc32c_calc (0, data, data_size), broadcast->compressed_header_checksum
+					)
+				) {
+					free (broadcast->compressed);
+					broadcast->compressed = NULL;
+				}
+			}
+
+			__atomic_store_n (&broadcast->compressed_done, true, __ATOMIC_RELEASE);
+		}
+
+		pthread_mutex_unlock (broadcast->mutex);
+	}
+
+	return broadcast->compressed && (broadcast->compressor == compressor);
+
+}
+
+// sends the wire bytes to the target's connection
+// returns 0 on success, 1 on error
+static u8 packet_broadcast_send (
+	PacketBroadcast *broadcast, const PacketBroadcastTarget *target, size_t *sent
+) {
+
+	u8 retval = 1;
+
+	Connection *connection = target->connection;
+	if (connection && connection->socket) {
+		struct iovec iov = { .iov_base = broadcast->wire, .iov_len = broadcast->wire_size };
+
+		if (connection->udp) {
+			retval = cerver_udp_send (connection->udp, &connection->address, &iov, 1, sent);
+		}
+
+		else {
+			pthread_mutex_lock (connection->socket->write_mutex);
+
+			size_t data_size = broadcast->wire_size - sizeof (PacketHeader);
+			if (
+				(connection->socket->header_version == PACKET_HEADER_VERSION_V2) && broadcast->header_v2_valid
+				&& packet_compression_use (connection->socket, (const PacketHeader *) broadcast->wire, data_size)
+				&& packet_broadcast_get_compressed (broadcast, connection->socket->compressor, connection->stats)
+			) {
+				struct iovec iov_compressed[2] = {
+					{
+						.iov_base = connection->socket->header_checksum ?
+							broadcast->compressed_header_checksum : broadcast->compressed_header_v2,
+						.iov_len = connection->socket->header_checksum ?
+							PACKET_WIRE_HEADER_SIZE : PACKET_HEADER_V2_SIZE
+					},
+					{ .iov_base = broadcast->compressed, .iov_len = broadcast->compressed_size }
+				};
+
+				retval = socket_send_iov (connection->socket, iov_compressed, 2, broadcast->flags, sent);
+				if (!retval) packet_compression_update_stats (connection->stats, data_size, broadcast->compressed_size);
+			}
+
+			else if (connection->socket->header_version == PACKET_HEADER_VERSION_V2) {
+				const char *header = NULL;
+				size_t header_size = 0;
+				if (connection->socket->header_checksum) {
+					header = broadcast->header_v2_valid ? packet_broadcast_get_header_checksum (broadcast) : NULL;
+					header_size = PACKET_WIRE_HEADER_SIZE;
+				}
+
+				else {
+					header = broadcast->header_v2_valid ? broadcast->header_v2 : NULL;
+					header_size = PACKET_HEADER_V2_SIZE;
+				}
+
+				if (header) {
+					struct iovec iov_v2[2] = {
+						{ .iov_base = (void *) header, .iov_len = header_size },
+						{
+							.iov_base = broadcast->wire + sizeof (PacketHeader),
+							.iov_len = broadcast->wire_size - sizeof (PacketHeader)
+						}
+					};
+
+					retval = socket_send_iov (connection->socket, iov_v2, 2, broadcast->flags, sent);
+				}
+			}
+
+			else {
+				retval = socket_send_iov (connection->socket, &iov, 1, broadcast->flags, sent);
+			}
+
+			pthread_mutex_unlock (connection->socket->write_mutex);
+		}
+	}
+
+	return retval;
+
+}
+
+// claims chunks of targets until every one has been claimed
+static void packet_broadcast_handle (PacketBroadcast *broadcast) {
+
+	size_t start = 0;
+	size_t end = 0;
+	size_t sent = 0;
+	size_t n_sent = 0;
+	size_t total_sent = 0;
+	while (
+		(start = __atomic_fetch_add (&broadcast->next, PACKET_BROADCAST_CHUNK_SIZE, __ATOMIC_ACQ_REL))
+		< broadcast->n_targets
+	) {
+		end = start + PACKET_BROADCAST_CHUNK_SIZE;
+		if (end > broadcast->n_targets) end = broadcast->n_targets;
+
+		n_sent = 0;
+		total_sent = 0;
+		for (size_t idx = start; idx < end; idx++) {
+			sent = 0;
+			if (!packet_broadcast_send (broadcast, &broadcast->targets[idx], &sent)) {
+				broadcast->sent[idx] = sent;
+
+				n_sent += 1;
+				total_sent += sent;
+			}
+		}
+
+		(void) __atomic_add_fetch (&broadcast->n_sent, n_sent, __ATOMIC_ACQ_REL);
+		(void) __atomic_add_fetch (&broadcast->total_sent, total_sent, __ATOMIC_ACQ_REL);
+
+		if (__atomic_add_fetch (&broadcast->done, end - start, __ATOMIC_ACQ_REL) == broadcast->n_targets) {
+			pthread_mutex_lock (broadcast->mutex);
+			pthread_cond_signal (broadcast->done_cond);
+			pthread_mutex_unlock (broadcast->mutex);
+		}
+	}
+
+}
+
+// a thpool job that takes part in the broadcast
+static void packet_broadcast_work (void *broadcast_ptr) {
+
+	PacketBroadcast *broadcast = (PacketBroadcast *) broadcast_ptr;
+
+	packet_broadcast_handle (broadcast);
+
+	packet_broadcast_unref (broadcast);
+
+}
+
+// adds jobs to the thpool to help the calling thread with the sends
+static void packet_broadcast_fan_out (PacketBroadcast *broadcast, Thpool *thpool) {
+
+	size_t n_chunks = (broadcast->n_targets + PACKET_BROADCAST_CHUNK_SIZE - 1) / PACKET_BROADCAST_CHUNK_SIZE;
+
+	// the calling thread also takes part
+	size_t n_jobs = n_chunks - 1;
+	if (n_jobs > thpool->n_threads) n_jobs = thpool->n_threads;
+
+	for (size_t i = 0; i < n_jobs; i++) {
+		(void) __atomic_add_fetch (&broadcast->ref_count, 1, __ATOMIC_ACQ_REL);
+		if (thpool_add_work (thpool, packet_broadcast_work, broadcast)) {
+			(void) __atomic_sub_fetch (&broadcast->ref_count, 1, __ATOMIC_ACQ_REL);
+			break;
+		}
+	}
+
+}
+
+// called by the broadcasting thread after every send has been done
+static void packet_broadcast_update_stats (
+	const PacketBroadcast *broadcast, Cerver *cerver, Lobby *lobby
+) {
+
+	const PacketBroadcastTarget *target = NULL;
+	for (size_t idx = 0; idx < broadcast->n_targets; idx++) {
+		target = &broadcast->targets[idx];
+		if (target->connection) {
+			if (broadcast->sent[idx]) {
+				packet_send_update_stats (
+					broadcast->packet_type, broadcast->sent[idx],
+					NULL, target->client, target->connection, NULL
+				);
+			}
+
+			else {
+				if (target->client) (void) __atomic_add_fetch (&target->client->stats->sent_packets->n_bad_packets, 1, __ATOMIC_RELAXED);
+				(void) __atomic_add_fetch (&target->connection->stats->sent_packets->n_bad_packets, 1, __ATOMIC_RELAXED);
+			}
+		}
+	}
+
+	if (cerver) {
+		(void) __atomic_add_fetch (&cerver->stats->n_packets_sent, broadcast->n_sent, __ATOMIC_RELAXED);
+		(void) __atomic_add_fetch (&cerver->stats->total_bytes_sent, broadcast->total_sent, __ATOMIC_RELAXED);
+		packets_per_type_add (cerver->stats->sent_packets, broadcast->packet_type, broadcast->n_sent);
+		(void) __atomic_add_fetch (&cerver->stats->sent_packets->n_bad_packets, broadcast->n_targets - broadcast->n_sent, __ATOMIC_RELAXED);
+	}
+
+	if (lobby) {
+		(void) __atomic_add_fetch (&lobby->stats->n_packets_sent, broadcast->n_sent, __ATOMIC_RELAXED);
+		(void) __atomic_add_fetch (&lobby->stats->bytes_sent, broadcast->total_sent, __ATOMIC_RELAXED);
+		packets_per_type_add (lobby->stats->sent_packets, broadcast->packet_type, broadcast->n_sent);
+	}
+
+}
+
+// sends the packet to every target, the packet's header & data are copied only once
+// into an immutable buffer that is shared by all the sends & the packet is never modified
+// if the cerver has a thpool & there are at least PACKET_BROADCAST_MIN_PARALLEL targets,
+// the sends are split between its threads & the calling thread, which waits for all of them
+// the cerver & lobby stats are updated only once with the totals & the stats of the targets
+// are updated by the calling thread after every send has been done
+// n_sent & total_sent (if set) get the n of connections the packet was sent to & the n of bytes sent
+// returns 0 if the packet was sent to every target, 1 on any error
+u8 packet_broadcast (
+	const Packet *packet,
+	Cerver *cerver, Lobby *lobby,
+	const PacketBroadcastTarget *targets, size_t n_targets,
+	int flags,
+	size_t *n_sent, size_t *total_sent
+) {
+
+	u8 retval = 1;
+
+	if (packet && (targets || !n_targets)) {
+		PacketBroadcast *broadcast = packet_broadcast_create (packet, targets, n_targets, flags);
+		if (broadcast) {
+			// the datagrams to udp peers are sent together with sendmmsg ()
+			CerverUdp *udp = cerver ? cerver->udp : NULL;
+			cerver_udp_cork (udp);
+
+			if (cerver && cerver->thpool && (n_targets >= PACKET_BROADCAST_MIN_PARALLEL))
+				packet_broadcast_fan_out (broadcast, cerver->thpool);
+
+			packet_broadcast_handle (broadcast);
+
+			// wait for the chunks that were claimed by the thpool
+			pthread_mutex_lock (broadcast->mutex);
+			while (__atomic_load_n (&broadcast->done, __ATOMIC_ACQUIRE) < broadcast->n_targets)
+				pthread_cond_wait (broadcast->done_cond, broadcast->mutex);
+			pthread_mutex_unlock (broadcast->mutex);
+
+			(void) cerver_udp_uncork (udp);
+
+			packet_broadcast_update_stats (broadcast, cerver, lobby);
+
+			if (n_sent) *n_sent = broadcast->n_sent;
+			if (total_sent) *total_sent = broadcast->total_sent;
+
+			retval = (broadcast->n_sent == n_targets) ? 0 : 1;
+
+			packet_broadcast_unref (broadcast);
+		}
+	}
+
+	return retval;
+
+}
+
+#pragma endregion
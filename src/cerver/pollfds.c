@@ -0,0 +1,233 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include <poll.h>
+
+#include "cerver/types/types.h"
+
+#include "cerver/pollfds.h"
+
+static PollFds *poll_fds_new (void) {
+
+	PollFds *poll_fds = (PollFds *) malloc (sizeof (PollFds));
+	if (poll_fds) {
+		poll_fds->fds = NULL;
+		poll_fds->max_n_fds = 0;
+		poll_fds->n_fds = 0;
+		poll_fds->current_n_fds = 0;
+
+		poll_fds->free_idxs = NULL;
+		poll_fds->n_free_idxs = 0;
+
+		poll_fds->sock_fd_idxs = NULL;
+		poll_fds->max_sock_fd = 0;
+	}
+
+	return poll_fds;
+
+}
+
+void poll_fds_delete (void *poll_fds_ptr) {
+
+	if (poll_fds_ptr) {
+		PollFds *poll_fds = (PollFds *) poll_fds_ptr;
+
+		if (poll_fds->fds) free (poll_fds->fds);
+		if (poll_fds->free_idxs) free (poll_fds->free_idxs);
+		if (poll_fds->sock_fd_idxs) free (poll_fds->sock_fd_idxs);
+
+		free (poll_fds);
+	}
+
+}
+
+static inline void poll_fds_reset_slots (PollFds *poll_fds, const u32 from, const u32 to) {
+
+	for (u32 idx = from; idx < to; idx++) {
+		poll_fds->fds[idx].fd = -1;
+		poll_fds->fds[idx].events = 0;
+		poll_fds->fds[idx].revents = 0;
+	}
+
+}
+
+// creates a new pollfd array with max_n_fds slots
+PollFds *poll_fds_create (const u32 max_n_fds) {
+
+	PollFds *poll_fds = poll_fds_new ();
+	if (poll_fds) {
+		poll_fds->max_n_fds = max_n_fds ? max_n_fds : 1;
+		poll_fds->fds = (struct pollfd *) calloc (poll_fds->max_n_fds, sizeof (struct pollfd));
+		poll_fds->free_idxs = (u32 *) calloc (poll_fds->max_n_fds, sizeof (u32));
+
+		poll_fds->max_sock_fd = poll_fds->max_n_fds * 2;
+		poll_fds->sock_fd_idxs = (i32 *) malloc (poll_fds->max_sock_fd * sizeof (i32));
+
+		if (poll_fds->fds && poll_fds->free_idxs && poll_fds->sock_fd_idxs) {
+			poll_fds_reset_slots (poll_fds, 0, poll_fds->max_n_fds);
+			memset (poll_fds->sock_fd_idxs, -1, poll_fds->max_sock_fd * sizeof (i32));
+		}
+
+		else {
+			poll_fds_delete (poll_fds);
+			poll_fds = NULL;
+		}
+	}
+
+	return poll_fds;
+
+}
+
+// doubles the n of slots in the pollfd array
+// returns 0 on success, 1 on error
+u8 poll_fds_realloc (PollFds *poll_fds) {
+
+	u8 retval = 1;
+
+	if (poll_fds) {
+		u32 new_max = poll_fds->max_n_fds * 2;
+
+		struct pollfd *fds = (struct pollfd *) realloc (poll_fds->fds, new_max * sizeof (struct pollfd));
+		if (fds) {
+			poll_fds->fds = fds;
+
+			u32 *free_idxs = (u32 *) realloc (poll_fds->free_idxs, new_max * sizeof (u32));
+			if (free_idxs) {
+				poll_fds->free_idxs = free_idxs;
+
+				poll_fds_reset_slots (poll_fds, poll_fds->max_n_fds, new_max);
+				poll_fds->max_n_fds = new_max;
+
+				retval = 0;
+			}
+		}
+	}
+
+	return retval;
+
+}
+
+// makes room in the sock fd idxs map for a new sock fd
+static u8 poll_fds_sock_fd_idxs_realloc (PollFds *poll_fds, const i32 sock_fd) {
+
+	u8 retval = 1;
+
+	u32 new_max = poll_fds->max_sock_fd * 2;
+	while (new_max <= (u32) sock_fd) new_max *= 2;
+
+	i32 *sock_fd_idxs = (i32 *) realloc (poll_fds->sock_fd_idxs, new_max * sizeof (i32));
+	if (sock_fd_idxs) {
+		memset (sock_fd_idxs + poll_fds->max_sock_fd, -1, (new_max - poll_fds->max_sock_fd) * sizeof (i32));
+
+		poll_fds->sock_fd_idxs = sock_fd_idxs;
+		poll_fds->max_sock_fd = new_max;
+
+		retval = 0;
+	}
+
+	return retval;
+
+}
+
+// puts the sock fd in a free slot
+// returns the slot idx, or -1 if the array is full or the sock fd is already in it
+i32 poll_fds_add (PollFds *poll_fds, const i32 sock_fd, const short events) {
+
+	i32 idx = -1;
+
+	if (poll_fds && (sock_fd > -1)) {
+		if ((u32) sock_fd >= poll_fds->max_sock_fd) {
+			if (poll_fds_sock_fd_idxs_realloc (poll_fds, sock_fd)) return -1;
+		}
+
+		if (poll_fds->sock_fd_idxs[sock_fd] < 0) {
+			// first try to reuse a released slot
+			if (poll_fds->n_free_idxs) {
+				idx = (i32) poll_fds->free_idxs[--poll_fds->n_free_idxs];
+			}
+
+			else if (poll_fds->n_fds < poll_fds->max_n_fds) {
+				idx = (i32) poll_fds->n_fds++;
+			}
+
+			if (idx > -1) {
+				poll_fds->fds[idx].fd = sock_fd;
+				poll_fds->fds[idx].events = events;
+				poll_fds->fds[idx].revents = 0;
+
+				poll_fds->sock_fd_idxs[sock_fd] = idx;
+				poll_fds->current_n_fds++;
+			}
+		}
+	}
+
+	return idx;
+
+}
+
+// releases the sock fd slot, the array is NOT compacted
+// so this can be called while looping through the slots
+// returns the slot idx that was released, or -1 if the sock fd was not found
+i32 poll_fds_remove (PollFds *poll_fds, const i32 sock_fd) {
+
+	i32 idx = poll_fds_get_idx (poll_fds, sock_fd);
+	if (idx > -1) {
+		poll_fds->fds[idx].fd = -1;
+		poll_fds->fds[idx].events = 0;
+		poll_fds->fds[idx].revents = 0;
+
+		poll_fds->sock_fd_idxs[sock_fd] = -1;
+		poll_fds->free_idxs[poll_fds->n_free_idxs++] = (u32) idx;
+		poll_fds->current_n_fds--;
+	}
+
+	return idx;
+
+}
+
+// returns the idx of the sock fd in the array, -1 if it was not found
+i32 poll_fds_get_idx (const PollFds *poll_fds, const i32 sock_fd) {
+
+	return (poll_fds && (sock_fd > -1) && ((u32) sock_fd < poll_fds->max_sock_fd)) ?
+		poll_fds->sock_fd_idxs[sock_fd] : -1;
+
+}
+
+// removes the released slots that are at the end of the used ones
+static inline void poll_fds_trim (PollFds *poll_fds) {
+
+	while (poll_fds->n_fds && (poll_fds->fds[poll_fds->n_fds - 1].fd == -1))
+		poll_fds->n_fds--;
+
+}
+
+// moves the last used slots into the released ones
+// so all the sock fds are in the first n_fds slots
+void poll_fds_compact (PollFds *poll_fds) {
+
+	if (poll_fds) {
+		u32 free_idx = 0;
+		u32 last_idx = 0;
+		while (poll_fds->n_free_idxs) {
+			poll_fds_trim (poll_fds);
+
+			free_idx = poll_fds->free_idxs[--poll_fds->n_free_idxs];
+
+			// the released slot was already trimmed
+			if (free_idx >= poll_fds->n_fds) continue;
+
+			last_idx = poll_fds->n_fds - 1;
+			poll_fds->fds[free_idx] = poll_fds->fds[last_idx];
+			poll_fds->sock_fd_idxs[poll_fds->fds[free_idx].fd] = (i32) free_idx;
+
+			poll_fds->fds[last_idx].fd = -1;
+			poll_fds->fds[last_idx].events = 0;
+			poll_fds->fds[last_idx].revents = 0;
+
+			poll_fds->n_fds--;
+		}
+
+		poll_fds_trim (poll_fds);
+	}
+
+}
@@ -0,0 +1,372 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <unistd.h>
+#include <pthread.h>
+
+#include <sys/socket.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+
+#include "cerver/types/types.h"
+
+#include "cerver/collections/htab.h"
+
+#include "cerver/cerver.h"
+#include "cerver/client.h"
+#include "cerver/reactor.h"
+
+#include "cerver/threads/thread.h"
+
+#include "cerver/utils/log.h"
+
+static CerverReactorStats *cerver_reactor_stats_new (void) {
+
+	CerverReactorStats *stats = (CerverReactorStats *) malloc (sizeof (CerverReactorStats));
+	if (stats) memset (stats, 0, sizeof (CerverReactorStats));
+
+	return stats;
+
+}
+
+static inline void cerver_reactor_stats_delete (CerverReactorStats *stats) { if (stats) free (stats); }
+
+static CerverReactor *cerver_reactor_new (void) {
+
+	CerverReactor *reactor = (CerverReactor *) malloc (sizeof (CerverReactor));
+	if (reactor) {
+		reactor->cerver = NULL;
+
+		reactor->id = 0;
+		reactor->thread_id = 0;
+		reactor->running = false;
+
+		reactor->sock = -1;
+		reactor->epoll_fd = -1;
+		reactor->epoll_events = NULL;
+		reactor->current_n_fds = 0;
+
+		reactor->client_sock_fd_map = NULL;
+
+		reactor->lock = NULL;
+		reactor->stats = NULL;
+	}
+
+	return reactor;
+
+}
+
+void cerver_reactor_delete (void *reactor_ptr) {
+
+	if (reactor_ptr) {
+		CerverReactor *reactor = (CerverReactor *) reactor_ptr;
+
+		// reactor 0 uses the cerver's socket, it is closed by cerver_shutdown ()
+		if (reactor->id && (reactor->sock > -1)) close (reactor->sock);
+
+		if (reactor->epoll_fd > -1) close (reactor->epoll_fd);
+		if (reactor->epoll_events) free (reactor->epoll_events);
+
+		htab_destroy (reactor->client_sock_fd_map);
+
+		pthread_mutex_delete (reactor->lock);
+		cerver_reactor_stats_delete (reactor->stats);
+
+		free (reactor);
+	}
+
+}
+
+// creates a new non blocking listening socket that shares the cerver's port
+static i32 cerver_reactor_socket_create (Cerver *cerver) {
+
+	i32 sock = socket (
+		(cerver->use_ipv6 ? AF_INET6 : AF_INET),
+		SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0
+	);
+
+	if (sock > -1) {
+		int reuse = 1;
+		if (!setsockopt (sock, SOL_SOCKET, SO_REUSEPORT, &reuse, sizeof (int))) {
+			if (!bind (sock, (const struct sockaddr *) &cerver->address, sizeof (struct sockaddr_storage))) {
+				if (listen (sock, cerver->connection_queue)) {
+					cerver_log_error (
+						"Failed to listen in cerver %s reactor socket!",
+						cerver->info->name->str
+					);
+
+					close (sock);
+					sock = -1;
+				}
+			}
+
+			else {
+				cerver_log_error (
+					"Failed to bind cerver %s reactor socket!",
+					cerver->info->name->str
+				);
+
+				close (sock);
+				sock = -1;
+			}
+		}
+
+		else {
+			cerver_log_error (
+				"Failed to set SO_REUSEPORT in cerver %s reactor socket!",
+				cerver->info->name->str
+			);
+
+			close (sock);
+			sock = -1;
+		}
+	}
+
+	else {
+		cerver_log_error (
+			"Failed to create cerver %s reactor socket!",
+			cerver->info->name->str
+		);
+	}
+
+	return sock;
+
+}
+
+// creates a new reactor for the cerver with its own epoll instance, client map & stats
+// if sock is -1, a new listening socket will be created & bound with SO_REUSEPORT
+// to the cerver's address, otherwise the reactor will use the provided one
+// returns NULL on error
+CerverReactor *cerver_reactor_create (
+	Cerver *cerver, const u16 id, const i32 sock
+) {
+
+	CerverReactor *reactor = NULL;
+
+	if (cerver) {
+		reactor = cerver_reactor_new ();
+		if (reactor) {
+			reactor->cerver = cerver;
+			reactor->id = id;
+
+			reactor->sock = (sock > -1) ? sock : cerver_reactor_socket_create (cerver);
+			reactor->epoll_fd = epoll_create1 (EPOLL_CLOEXEC);
+			reactor->epoll_events = (struct epoll_event *) calloc (
+				cerver->epoll_max_events, sizeof (struct epoll_event)
+			);
+
+			reactor->client_sock_fd_map = htab_create (poll_n_fds, NULL, NULL);
+
+			reactor->lock = pthread_mutex_new ();
+			reactor->stats = cerver_reactor_stats_new ();
+
+			if (
+				(reactor->sock < 0) || (reactor->epoll_fd < 0) || !reactor->epoll_events
+				|| !reactor->client_sock_fd_map || !reactor->lock || !reactor->stats
+			) {
+				cerver_log_error (
+					"Failed to create cerver %s reactor %d!",
+					cerver->info->name->str, id
+				);
+
+				// don't close the cerver's socket
+				if (sock > -1) reactor->sock = -1;
+
+				cerver_reactor_delete (reactor);
+				reactor = NULL;
+			}
+
+			else {
+				// the listening socket is level triggered, so no connection is lost
+				struct epoll_event event = { 0 };
+				event.events = EPOLLIN;
+				event.data.fd = reactor->sock;
+
+				if (epoll_ctl (reactor->epoll_fd, EPOLL_CTL_ADD, reactor->sock, &event)) {
+					cerver_log_error (
+						"Failed to register cerver %s reactor %d socket to its epoll!",
+						cerver->info->name->str, id
+					);
+
+					if (sock > -1) reactor->sock = -1;
+
+					cerver_reactor_delete (reactor);
+					reactor = NULL;
+				}
+			}
+		}
+	}
+
+	return reactor;
+
+}
+
+// creates the cerver's reactors, reactor 0 uses the cerver's socket
+// and the others create their own listening sockets
+// if cerver->n_reactors is 0, one reactor will be created for each online cpu
+// returns 0 on success, 1 on error
+u8 cerver_reactors_create (Cerver *cerver) {
+
+	u8 retval = 1;
+
+	if (cerver) {
+		if (!cerver->n_reactors) {
+			long n_cpus = sysconf (_SC_NPROCESSORS_ONLN);
+			cerver->n_reactors = (n_cpus > 0) ? (u16) n_cpus : 1;
+		}
+
+		if (cerver->n_reactors > CERVER_REACTOR_MAX_N_REACTORS)
+			cerver->n_reactors = CERVER_REACTOR_MAX_N_REACTORS;
+
+		// every sock fd that can be opened is mapped to its reactor
+		struct rlimit limit = { 0 };
+		cerver->n_reactors_sock_fds = (!getrlimit (RLIMIT_NOFILE, &limit) && (limit.rlim_cur < CERVER_REACTOR_MAX_SOCK_FDS)) ?
+			(u32) limit.rlim_cur : CERVER_REACTOR_MAX_SOCK_FDS;
+
+		cerver->reactors_sock_fds = (u16 *) calloc (cerver->n_reactors_sock_fds, sizeof (u16));
+
+		cerver->reactors = (CerverReactor **) calloc (cerver->n_reactors, sizeof (CerverReactor *));
+		if (cerver->reactors && cerver->reactors_sock_fds) {
+			u8 errors = 0;
+			for (u16 idx = 0; idx < cerver->n_reactors; idx++) {
+				cerver->reactors[idx] = cerver_reactor_create (
+					cerver, idx, idx ? -1 : cerver->sock
+				);
+
+				if (!cerver->reactors[idx]) errors = 1;
+			}
+
+			if (!errors) {
+				#ifdef CERVER_DEBUG
+				cerver_log_debug (
+					"Created %d reactors in cerver %s",
+					cerver->n_reactors, cerver->info->name->str
+				);
+				#endif
+
+				retval = 0;
+			}
+
+			else {
+				cerver_reactors_delete (cerver);
+			}
+		}
+
+		else {
+			cerver_reactors_delete (cerver);
+		}
+	}
+
+	return retval;
+
+}
+
+// deletes all the cerver's reactors
+// their threads should have been stopped before calling this method
+void cerver_reactors_delete (Cerver *cerver) {
+
+	if (cerver) {
+		if (cerver->reactors) {
+			for (u16 idx = 0; idx < cerver->n_reactors; idx++)
+				cerver_reactor_delete (cerver->reactors[idx]);
+
+			free (cerver->reactors);
+			cerver->reactors = NULL;
+		}
+
+		if (cerver->reactors_sock_fds) {
+			free (cerver->reactors_sock_fds);
+			cerver->reactors_sock_fds = NULL;
+			cerver->n_reactors_sock_fds = 0;
+		}
+	}
+
+}
+
+// gets the client associated with a sock fd from the reactor's client map
+Client *cerver_reactor_client_get_by_sock_fd (
+	CerverReactor *reactor, const i32 sock_fd
+) {
+
+	const i32 *key = &sock_fd;
+	return (Client *) htab_get (reactor->client_sock_fd_map, key, sizeof (i32));
+
+}
+
+// maps the sock fd to the reactor that handles it
+void cerver_reactors_sock_fd_set (
+	Cerver *cerver, const i32 sock_fd, const CerverReactor *reactor
+) {
+
+	if (cerver->reactors_sock_fds && (sock_fd > -1) && ((u32) sock_fd < cerver->n_reactors_sock_fds)) {
+		__atomic_store_n (&cerver->reactors_sock_fds[sock_fd], (u16) (reactor->id + 1), __ATOMIC_RELEASE);
+	}
+
+}
+
+// removes the sock fd from the map if it still belongs to the reactor
+void cerver_reactors_sock_fd_remove (
+	Cerver *cerver, const i32 sock_fd, const CerverReactor *reactor
+) {
+
+	if (cerver->reactors_sock_fds && (sock_fd > -1) && ((u32) sock_fd < cerver->n_reactors_sock_fds)) {
+		// the sock fd might have been reused by a connection in another reactor
+		u16 expected = (u16) (reactor->id + 1);
+		(void) __atomic_compare_exchange_n (
+			&cerver->reactors_sock_fds[sock_fd], &expected, 0,
+			false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE
+		);
+	}
+
+}
+
+// gets the client associated with a sock fd from the map of the reactor that handles it
+Client *cerver_reactors_client_get_by_sock_fd (Cerver *cerver, const i32 sock_fd) {
+
+	Client *client = NULL;
+
+	if (cerver->reactors_sock_fds && (sock_fd > -1) && ((u32) sock_fd < cerver->n_reactors_sock_fds)) {
+		u16 owner = __atomic_load_n (&cerver->reactors_sock_fds[sock_fd], __ATOMIC_ACQUIRE);
+		if (owner && (owner <= cerver->n_reactors))
+			client = cerver_reactor_client_get_by_sock_fd (cerver->reactors[owner - 1], sock_fd);
+	}
+
+	else {
+		for (u16 idx = 0; idx < cerver->n_reactors; idx++) {
+			client = cerver_reactor_client_get_by_sock_fd (cerver->reactors[idx], sock_fd);
+			if (client) break;
+		}
+	}
+
+	return client;
+
+}
+
+// adds the stats from all the cerver's reactors into the provided stats
+void cerver_reactors_stats_get (
+	Cerver *cerver, CerverReactorStats *stats
+) {
+
+	if (cerver && stats) {
+		memset (stats, 0, sizeof (CerverReactorStats));
+
+		CerverReactorStats *reactor_stats = NULL;
+		for (u16 idx = 0; cerver->reactors && (idx < cerver->n_reactors); idx++) {
+			if (cerver->reactors[idx]) {
+				reactor_stats = cerver->reactors[idx]->stats;
+
+				stats->n_accepted += reactor_stats->n_accepted;
+
+				stats->client_receives_done += reactor_stats->client_receives_done;
+				stats->client_bytes_received += reactor_stats->client_bytes_received;
+
+				stats->total_n_receives_done += reactor_stats->total_n_receives_done;
+				stats->total_bytes_received += reactor_stats->total_bytes_received;
+
+				stats->current_active_client_connections += reactor_stats->current_active_client_connections;
+			}
+		}
+	}
+
+}
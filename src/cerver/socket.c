@@ -1,11 +1,29 @@
 #include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <limits.h>
 
 #include <pthread.h>
+#include <poll.h>
 
+#include <sys/socket.h>
+#include <sys/uio.h>
+
+#include <netinet/in.h>
+
+#include "cerver/network.h"
 #include "cerver/socket.h"
 #include "cerver/cerver.h"
 #include "cerver/client.h"
 #include "cerver/handler.h"
+#include "cerver/packets.h"
+#include "cerver/uring.h"
+
+#include "cerver/utils/log.h"
+
+#ifdef CERVER_ZERO_COPY_SUPPORTED
+#include <linux/errqueue.h>
+#endif
 
 Socket *socket_new (void) {
 
@@ -16,6 +34,30 @@ Socket *socket_new (void) {
         socket->packet_buffer = NULL;
         socket->packet_buffer_size = 0;
 
+        socket->outbound = NULL;
+
+        socket->uring_generation = 0;
+
+        socket->cork_buffer = NULL;
+        socket->cork_buffer_size = 0;
+        socket->cork_size = 0;
+        socket->corked = 0;
+
+        socket->zero_copy_threshold = 0;
+        socket->zero_copy_copied = false;
+        socket->zero_copy_next_id = 0;
+        socket->zero_copy_n_completed = 0;
+        socket->zero_copy_pending = NULL;
+        socket->zero_copy_last = NULL;
+
+        socket->header_version = PACKET_HEADER_VERSION_V1;
+        socket->header_checksum = false;
+
+        socket->compressor = NULL;
+        socket->compression_threshold = 0;
+
+        socket->dispatch = NULL;
+
         socket->read_mutex = NULL;
         socket->write_mutex = NULL;
     }
@@ -24,6 +66,8 @@ Socket *socket_new (void) {
 
 }
 
+static void socket_zero_copy_release_all (Socket *socket);
+
 void socket_delete (void *socket_ptr) {
 
     if (socket_ptr) {
@@ -34,6 +78,16 @@ void socket_delete (void *socket_ptr) {
 
         if (socket->packet_buffer) free (socket->packet_buffer);
 
+        // the cerver's io_uring has been closed by now, so a send can't be in flight
+        socket_outbound_delete (socket->outbound);
+        if (socket->cork_buffer) free (socket->cork_buffer);
+
+        socket_zero_copy_release_all (socket);
+
+        // its jobs may still be running, so they keep the executor alive
+        thpool_serial_cancel (socket->dispatch);
+        thpool_serial_delete (socket->dispatch);
+
         if (socket->read_mutex) {
             pthread_mutex_unlock (socket->read_mutex);
             pthread_mutex_destroy (socket->read_mutex);
@@ -75,4 +129,1041 @@ Socket *socket_create (int fd) {
 
     return socket;
 
-}
\ No newline at end of file
+}
+// takes the socket's receive buffer, if the socket does not have one or if it is in use,
+// a new one is allocated, the buffer is NOT zeroed
+char *socket_receive_buffer_get (Socket *socket, const size_t size) {
+
+    char *buffer = NULL;
+
+    if (socket) {
+        // the first request sets the size of the buffers that the socket keeps
+        if (!socket->packet_buffer_size) socket->packet_buffer_size = size;
+
+        if (size == socket->packet_buffer_size)
+            buffer = __atomic_exchange_n (&socket->packet_buffer, NULL, __ATOMIC_ACQ_REL);
+
+        if (!buffer) buffer = (char *) malloc (size);
+    }
+
+    return buffer;
+
+}
+
+// returns a buffer taken with socket_receive_buffer_get () to the socket
+// so it can be used by the next recv (), if the socket already has one, it is freed
+void socket_receive_buffer_release (Socket *socket, char *buffer, const size_t size) {
+
+    if (buffer) {
+        char *expected = NULL;
+        if (
+            !socket || (size != socket->packet_buffer_size)
+            || !__atomic_compare_exchange_n (
+                &socket->packet_buffer, &expected, buffer,
+                false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE
+            )
+        ) {
+            free (buffer);
+        }
+    }
+
+}
+
+#pragma region zero copy
+
+// enables MSG_ZEROCOPY for the sends to the socket that are at least threshold bytes
+// returns 0 on success, 1 on error or if the kernel does not support it
+u8 socket_set_zero_copy (Socket *socket, const size_t threshold) {
+
+    u8 retval = 1;
+
+    #ifdef CERVER_ZERO_COPY_SUPPORTED
+    if (socket) {
+        int enable = 1;
+        if (!setsockopt (socket->sock_fd, SOL_SOCKET, SO_ZEROCOPY, &enable, sizeof (int))) {
+            pthread_mutex_lock (socket->write_mutex);
+
+            socket->zero_copy_threshold = threshold ? threshold : 1;
+            socket->zero_copy_copied = false;
+
+            pthread_mutex_unlock (socket->write_mutex);
+
+            retval = 0;
+        }
+    }
+    #endif
+
+    return retval;
+
+}
+
+// returns true if a send of size bytes to the socket would be done with MSG_ZEROCOPY
+// the socket's write mutex must be locked by the caller
+bool socket_zero_copy_use (const Socket *socket, const size_t size) {
+
+    return socket->zero_copy_threshold
+        && (size >= socket->zero_copy_threshold)
+        && !socket->zero_copy_copied
+        && !socket->corked;
+
+}
+
+static void socket_zero_copy_release (SocketZeroCopy *zero_copy) {
+
+    if (zero_copy->release) zero_copy->release (zero_copy->hold);
+
+    free (zero_copy);
+
+}
+
+// releases the buffers of every pending zero copy send
+// used when the socket has been closed, so the kernel won't report them
+static void socket_zero_copy_release_all (Socket *socket) {
+
+    SocketZeroCopy *zero_copy = socket->zero_copy_pending;
+    SocketZeroCopy *next = NULL;
+    while (zero_copy) {
+        next = zero_copy->next;
+        socket_zero_copy_release (zero_copy);
+        zero_copy = next;
+    }
+
+    socket->zero_copy_pending = NULL;
+    socket->zero_copy_last = NULL;
+    socket->zero_copy_next_id = 0;
+    socket->zero_copy_n_completed = 0;
+
+}
+
+// keeps the zero copy send until the kernel completes the n sendmsg () calls it took
+// returns 0 on success, 1 on error
+static u8 socket_zero_copy_push (Socket *socket, const u32 n_sends, void *hold, Action release) {
+
+    u8 retval = 1;
+
+    SocketZeroCopy *zero_copy = (SocketZeroCopy *) malloc (sizeof (SocketZeroCopy));
+    if (zero_copy) {
+        zero_copy->first_id = socket->zero_copy_next_id;
+        zero_copy->last_id = socket->zero_copy_next_id + n_sends - 1;
+        zero_copy->remaining = n_sends;
+
+        zero_copy->hold = hold;
+        zero_copy->release = release;
+
+        zero_copy->next = NULL;
+
+        if (socket->zero_copy_last) socket->zero_copy_last->next = zero_copy;
+        else socket->zero_copy_pending = zero_copy;
+        socket->zero_copy_last = zero_copy;
+
+        retval = 0;
+    }
+
+    // the ids are assigned by the kernel even if we can't keep track of them
+    socket->zero_copy_next_id += n_sends;
+
+    return retval;
+
+}
+
+// the kernel completed the ids from first to last,
+// a single completion can cover many sends & they might arrive out of order
+static void socket_zero_copy_complete (Socket *socket, const u32 first, const u32 last) {
+
+    SocketZeroCopy *prev = NULL;
+    SocketZeroCopy *zero_copy = socket->zero_copy_pending;
+    SocketZeroCopy *next = NULL;
+    while (zero_copy) {
+        next = zero_copy->next;
+
+        u32 start = (first > zero_copy->first_id) ? first : zero_copy->first_id;
+        u32 end = (last < zero_copy->last_id) ? last : zero_copy->last_id;
+        if (start <= end) {
+            zero_copy->remaining -= (end - start) + 1;
+            if (!zero_copy->remaining) {
+                if (prev) prev->next = next;
+                else socket->zero_copy_pending = next;
+
+                if (socket->zero_copy_last == zero_copy) socket->zero_copy_last = prev;
+
+                socket_zero_copy_release (zero_copy);
+                zero_copy = prev;
+            }
+        }
+
+        prev = zero_copy;
+        zero_copy = next;
+    }
+
+}
+
+// reads every completion that is in the socket's error queue without blocking
+// returns the n of completions that were read
+static unsigned int socket_zero_copy_reap (Socket *socket) {
+
+    unsigned int n_completions = 0;
+
+    #ifdef CERVER_ZERO_COPY_SUPPORTED
+    char control[CMSG_SPACE (sizeof (struct sock_extended_err) + sizeof (struct sockaddr_storage))];
+    struct msghdr msg = { 0 };
+    struct cmsghdr *cmsg = NULL;
+    struct sock_extended_err *error = NULL;
+    for (;;) {
+        msg.msg_control = control;
+        msg.msg_controllen = sizeof (control);
+
+        if (recvmsg (socket->sock_fd, &msg, MSG_ERRQUEUE | MSG_DONTWAIT) < 0) break;
+
+        for (cmsg = CMSG_FIRSTHDR (&msg); cmsg; cmsg = CMSG_NXTHDR (&msg, cmsg)) {
+            if (
+                ((cmsg->cmsg_level == IPPROTO_IP) && (cmsg->cmsg_type == IP_RECVERR))
+                || ((cmsg->cmsg_level == IPPROTO_IPV6) && (cmsg->cmsg_type == IPV6_RECVERR))
+            ) {
+                error = (struct sock_extended_err *) CMSG_DATA (cmsg);
+                if (!error->ee_errno && (error->ee_origin == SO_EE_ORIGIN_ZEROCOPY)) {
+                    // the kernel could not send from our buffers, so the next sends are copied
+                    if (error->ee_code & SO_EE_CODE_ZEROCOPY_COPIED) socket->zero_copy_copied = true;
+
+                    socket_zero_copy_complete (socket, error->ee_info, error->ee_data);
+                    socket->zero_copy_n_completed += (error->ee_data - error->ee_info) + 1;
+                    n_completions += 1;
+                }
+            }
+        }
+    }
+    #endif
+
+    return n_completions;
+
+}
+
+// waits up to SOCK_WAIT_TIMEOUT for the socket to be writable or for new completions,
+// which are reaped as they are reported as socket errors
+// returns true if the socket is writable or, if writable is false, when there were new completions
+static bool socket_zero_copy_wait (Socket *socket, bool writable) {
+
+    bool retval = false;
+
+    struct pollfd pfd = { .fd = socket->sock_fd, .events = writable ? POLLOUT : 0, .revents = 0 };
+    for (;;) {
+        pfd.revents = 0;
+        int rc = poll (&pfd, 1, SOCK_WAIT_TIMEOUT);
+        if (rc < 0) {
+            if (errno == EINTR) continue;
+            break;
+        }
+
+        if (!rc) break;
+
+        if ((pfd.revents & POLLERR) && !socket_zero_copy_reap (socket)) break;
+
+        if (pfd.revents & (POLLHUP | POLLNVAL)) break;
+
+        if (!writable || (pfd.revents & POLLOUT)) {
+            retval = true;
+            break;
+        }
+    }
+
+    return retval;
+
+}
+
+// works like sock_send_iov () but n_sends is incremented for every call that was done
+// with MSG_ZEROCOPY, & the completions that arrive while waiting for the socket are reaped
+// returns 0 on success, 1 on error
+static u8 socket_zero_copy_send_actual (
+    Socket *socket,
+    struct iovec *iov, int iovcnt, int flags, bool wait,
+    size_t *total_sent, u32 *n_sends
+) {
+
+    u8 retval = 0;
+
+    size_t actual_sent = 0;
+    ssize_t sent = 0;
+    struct msghdr msg = { 0 };
+    while (iovcnt > 0) {
+        msg.msg_iov = iov;
+        msg.msg_iovlen = (iovcnt > IOV_MAX) ? IOV_MAX : iovcnt;
+
+        sent = sendmsg (socket->sock_fd, &msg, flags);
+        if (sent < 0) {
+            if (errno == EINTR) continue;
+
+            #ifdef CERVER_ZERO_COPY_SUPPORTED
+            // the kernel can't pin more pages for this socket, so the rest is copied
+            if ((errno == ENOBUFS) && (flags & MSG_ZEROCOPY)) {
+                flags &= ~MSG_ZEROCOPY;
+                continue;
+            }
+            #endif
+
+            if ((errno == EAGAIN) || (errno == EWOULDBLOCK)) {
+                if (!wait) break;
+                if (socket_zero_copy_wait (socket, true)) continue;
+            }
+
+            retval = 1;
+            break;
+        }
+
+        #ifdef CERVER_ZERO_COPY_SUPPORTED
+        if ((flags & MSG_ZEROCOPY) && n_sends) *n_sends += 1;
+        #endif
+
+        actual_sent += (size_t) sent;
+
+        // skip the buffers that were completely sent
+        while ((iovcnt > 0) && ((size_t) sent >= iov->iov_len)) {
+            sent -= (ssize_t) iov->iov_len;
+            iov->iov_len = 0;
+            iov++;
+            iovcnt--;
+        }
+
+        if (iovcnt > 0) {
+            iov->iov_base = (char *) iov->iov_base + sent;
+            iov->iov_len -= (size_t) sent;
+        }
+    }
+
+    if (total_sent) *total_sent = actual_sent;
+
+    return retval;
+
+}
+
+// sends the iovec buffers directly to the socket's fd
+// sockets with zero copy sends must reap their completions while they wait to be writable
+// if the send fails after part of it was written, the peer is left in the middle of a packet,
+// so the socket is shut down & the cerver drops its connection as soon as it fails to read from it
+static inline u8 socket_sock_send_iov (
+    Socket *socket,
+    struct iovec *iov, int iovcnt, int flags, bool wait,
+    size_t *total_sent, u32 *n_sends
+) {
+
+    size_t sent = 0;
+    u8 retval = socket->zero_copy_threshold ?
+        socket_zero_copy_send_actual (socket, iov, iovcnt, flags, wait, &sent, n_sends) :
+        sock_send_iov (socket->sock_fd, iov, iovcnt, flags, wait, &sent);
+
+    if (retval && sent) (void) shutdown (socket->sock_fd, SHUT_RDWR);
+
+    if (total_sent) *total_sent = sent;
+
+    return retval;
+
+}
+
+// reaps the completions of the socket's zero copy sends that the kernel reports as socket errors
+// returns true if the socket does not have an actual error
+bool socket_zero_copy_handle_error (Socket *socket) {
+
+    bool retval = false;
+
+    if (socket && socket->zero_copy_threshold) {
+        pthread_mutex_lock (socket->write_mutex);
+
+        (void) socket_zero_copy_reap (socket);
+
+        pthread_mutex_unlock (socket->write_mutex);
+
+        int error = 0;
+        socklen_t error_len = sizeof (int);
+        retval = !getsockopt (socket->sock_fd, SOL_SOCKET, SO_ERROR, &error, &error_len) && !error;
+    }
+
+    return retval;
+
+}
+
+#pragma endregion
+
+#pragma region send
+
+const char *outbound_policy_to_string (OutboundPolicy policy) {
+
+    switch (policy) {
+        #define XX(num, name, string, description) case OUTBOUND_POLICY_##name: return #string;
+        OUTBOUND_POLICY_MAP(XX)
+        #undef XX
+    }
+
+    return outbound_policy_to_string (OUTBOUND_POLICY_PAUSE);
+
+}
+
+const char *outbound_policy_description (OutboundPolicy policy) {
+
+    switch (policy) {
+        #define XX(num, name, string, description) case OUTBOUND_POLICY_##name: return #description;
+        OUTBOUND_POLICY_MAP(XX)
+        #undef XX
+    }
+
+    return outbound_policy_description (OUTBOUND_POLICY_PAUSE);
+
+}
+
+SocketOutbound *socket_outbound_create (
+    const size_t low_watermark, const size_t high_watermark,
+    OutboundPolicy policy
+) {
+
+    SocketOutbound *outbound = (SocketOutbound *) malloc (sizeof (SocketOutbound));
+    if (outbound) {
+        outbound->buffer = NULL;
+        outbound->buffer_size = 0;
+        outbound->start = 0;
+        outbound->end = 0;
+
+        outbound->low_watermark = low_watermark;
+        outbound->high_watermark = high_watermark;
+        outbound->policy = policy;
+
+        outbound->paused = false;
+
+        outbound->uring = NULL;
+        outbound->socket = NULL;
+        outbound->uring_stopped = false;
+
+        outbound->sending = NULL;
+        outbound->sending_size = 0;
+        outbound->sending_start = 0;
+        outbound->sending_end = 0;
+        outbound->in_flight = false;
+    }
+
+    return outbound;
+
+}
+
+void socket_outbound_delete (void *outbound_ptr) {
+
+    if (outbound_ptr) {
+        SocketOutbound *outbound = (SocketOutbound *) outbound_ptr;
+
+        if (outbound->buffer) free (outbound->buffer);
+        if (outbound->sending) free (outbound->sending);
+
+        free (outbound);
+    }
+
+}
+
+// creates an outbound queue whose bytes are sent with the cerver's io_uring
+SocketOutbound *socket_outbound_create_uring (
+    struct _CerverUring *uring,
+    const size_t low_watermark, const size_t high_watermark,
+    OutboundPolicy policy
+) {
+
+    SocketOutbound *outbound = socket_outbound_create (low_watermark, high_watermark, policy);
+    if (outbound) outbound->uring = uring;
+
+    return outbound;
+
+}
+
+// the kernel might still be reading from the sending buffer,
+// so if there is a send in flight, the queue is deleted when it completes
+static inline void socket_outbound_release (SocketOutbound *outbound) {
+
+    if (outbound && !outbound->in_flight) socket_outbound_delete (outbound);
+
+}
+
+// sets the socket's outbound queue, if it already had one, it is deleted
+void socket_set_outbound (Socket *socket, SocketOutbound *outbound) {
+
+    if (socket) {
+        pthread_mutex_lock (socket->write_mutex);
+
+        if (outbound) outbound->socket = socket;
+
+        socket_outbound_release (socket->outbound);
+        __atomic_store_n (&socket->outbound, outbound, __ATOMIC_RELEASE);
+
+        pthread_mutex_unlock (socket->write_mutex);
+    }
+
+}
+
+// copies the iovec buffers at the end of the queue
+// returns 0 on success, 1 on error
+static u8 socket_outbound_push (
+    SocketOutbound *outbound,
+    const struct iovec *iov, int iovcnt, const size_t size
+) {
+
+    u8 retval = 0;
+
+    if ((outbound->buffer_size - outbound->end) < size) {
+        // first move the queued bytes to the start of the buffer
+        if (outbound->start) {
+            memmove (outbound->buffer, outbound->buffer + outbound->start, outbound->end - outbound->start);
+            outbound->end -= outbound->start;
+            outbound->start = 0;
+        }
+
+        if ((outbound->buffer_size - outbound->end) < size) {
+            size_t new_size = outbound->buffer_size ? outbound->buffer_size : SOCKET_OUTBOUND_BUFFER_SIZE;
+            while ((new_size - outbound->end) < size) new_size *= 2;
+
+            char *buffer = (char *) realloc (outbound->buffer, new_size);
+            if (buffer) {
+                outbound->buffer = buffer;
+                outbound->buffer_size = new_size;
+            }
+
+            else {
+                retval = 1;
+            }
+        }
+    }
+
+    if (!retval) {
+        for (int i = 0; i < iovcnt; i++) {
+            if (iov[i].iov_len) {
+                memcpy (outbound->buffer + outbound->end, iov[i].iov_base, iov[i].iov_len);
+                outbound->end += iov[i].iov_len;
+            }
+        }
+    }
+
+    return retval;
+
+}
+
+// the bytes that are queued or in flight
+static inline size_t socket_outbound_size (const SocketOutbound *outbound) {
+
+    return (outbound->end - outbound->start)
+        + (outbound->in_flight ? (outbound->sending_end - outbound->sending_start) : 0);
+
+}
+
+// discards the queued bytes & shuts down the socket,
+// so the cerver drops its connection as soon as it fails to read from it
+static void socket_outbound_shutdown (Socket *socket) {
+
+    socket->outbound->start = 0;
+    socket->outbound->end = 0;
+
+    (void) shutdown (socket->sock_fd, SHUT_RDWR);
+
+}
+
+// applies the outbound policy if the queue reached its high watermark
+// returns 0 on success, 1 if the socket was shut down
+static u8 socket_outbound_check (Socket *socket) {
+
+    u8 retval = 0;
+
+    SocketOutbound *outbound = socket->outbound;
+    if (socket_outbound_size (outbound) >= outbound->high_watermark) {
+        switch (outbound->policy) {
+            case OUTBOUND_POLICY_PAUSE: {
+                __atomic_store_n (&outbound->paused, true, __ATOMIC_RELEASE);
+            } break;
+
+            case OUTBOUND_POLICY_DROP: {
+                #ifdef CONNECTION_DEBUG
+                cerver_log (
+                    LOG_TYPE_WARNING, LOG_TYPE_CONNECTION,
+                    "Sock fd <%d> outbound queue reached %ld bytes, dropping its connection...",
+                    socket->sock_fd, socket_outbound_size (outbound)
+                );
+                #endif
+
+                socket_outbound_shutdown (socket);
+                retval = 1;
+            } break;
+        }
+    }
+
+    return retval;
+
+}
+
+// sends the bytes of the sending buffer with the cerver's io_uring
+// if the send can't be queued, the socket is shut down
+static u8 socket_outbound_uring_send_pending (Socket *socket) {
+
+    SocketOutbound *outbound = socket->outbound;
+
+    u8 retval = cerver_uring_send (
+        outbound->uring, socket->sock_fd,
+        outbound->sending + outbound->sending_start,
+        outbound->sending_end - outbound->sending_start,
+        outbound
+    );
+
+    if (!retval) {
+        outbound->in_flight = true;
+    }
+
+    else {
+        outbound->sending_start = 0;
+        outbound->sending_end = 0;
+
+        socket_outbound_shutdown (socket);
+    }
+
+    return retval;
+
+}
+
+// swaps the queued bytes into the sending buffer & sends them with the cerver's io_uring,
+// the socket's write mutex must be locked & there can't be a send in flight
+// returns 0 on success, 1 on error
+static u8 socket_outbound_uring_send (Socket *socket) {
+
+    u8 retval = 0;
+
+    SocketOutbound *outbound = socket->outbound;
+    if (outbound->start < outbound->end) {
+        char *buffer = outbound->sending;
+        size_t buffer_size = outbound->sending_size;
+
+        outbound->sending = outbound->buffer;
+        outbound->sending_size = outbound->buffer_size;
+        outbound->sending_start = outbound->start;
+        outbound->sending_end = outbound->end;
+
+        outbound->buffer = buffer;
+        outbound->buffer_size = buffer_size;
+        outbound->start = 0;
+        outbound->end = 0;
+
+        retval = socket_outbound_uring_send_pending (socket);
+    }
+
+    return retval;
+
+}
+
+// sends the iovec buffers without blocking, what can't be sent right away is added
+// to the socket's outbound queue & if it reaches its high watermark, the outbound policy is applied
+static u8 socket_outbound_send (
+    Socket *socket,
+    struct iovec *iov, int iovcnt, int flags,
+    const size_t size, size_t *total_sent, u32 *n_sends
+) {
+
+    u8 retval = 0;
+
+    SocketOutbound *outbound = socket->outbound;
+
+    // nothing is sent directly while there are queued bytes to keep them in order,
+    // & never if they are sent with the cerver's io_uring
+    size_t sent = 0;
+    if (!outbound->uring && (outbound->start == outbound->end)) {
+        retval = socket_sock_send_iov (
+            socket, iov, iovcnt,
+            flags | MSG_DONTWAIT | MSG_NOSIGNAL, false, &sent, n_sends
+        );
+    }
+
+    // the buffers that were sent have been set to a zero length
+    if (!retval && (sent < size)) {
+        retval = socket_outbound_push (outbound, iov, iovcnt, size - sent);
+        if (!retval && outbound->uring && !outbound->in_flight)
+            retval = socket_outbound_uring_send (socket);
+
+        if (!retval) retval = socket_outbound_check (socket);
+    }
+
+    if (total_sent) *total_sent = retval ? sent : size;
+
+    return retval;
+
+}
+
+// sends the iovec buffers using the socket's outbound queue if it has one
+static u8 socket_send_iov_actual (
+    Socket *socket,
+    struct iovec *iov, int iovcnt, int flags,
+    const size_t size, size_t *total_sent, u32 *n_sends
+) {
+
+    return socket->outbound ?
+        socket_outbound_send (socket, iov, iovcnt, flags, size, total_sent, n_sends) :
+        socket_sock_send_iov (socket, iov, iovcnt, flags, true, total_sent, n_sends);
+
+}
+
+// sends the coalesced bytes & empties the cork buffer
+// returns 0 on success, 1 on error
+static u8 socket_cork_flush (Socket *socket) {
+
+    u8 retval = 0;
+
+    if (socket->cork_size) {
+        struct iovec iov = { .iov_base = socket->cork_buffer, .iov_len = socket->cork_size };
+        retval = socket_send_iov_actual (socket, &iov, 1, 0, socket->cork_size, NULL, NULL);
+
+        socket->cork_size = 0;
+    }
+
+    return retval;
+
+}
+
+// copies the iovec buffers into the cork buffer, if they don't fit,
+// the coalesced bytes are sent first, & if they are bigger than the buffer, they are sent directly
+static u8 socket_cork_send (
+    Socket *socket,
+    struct iovec *iov, int iovcnt, int flags,
+    const size_t size, size_t *total_sent
+) {
+
+    u8 retval = 0;
+
+    if ((socket->cork_size + size) > SOCKET_CORK_BUFFER_SIZE) {
+        retval = socket_cork_flush (socket);
+    }
+
+    if (!retval) {
+        if (size > SOCKET_CORK_BUFFER_SIZE) {
+            retval = socket_send_iov_actual (socket, iov, iovcnt, flags, size, total_sent, NULL);
+        }
+
+        else {
+            if (!socket->cork_buffer) {
+                socket->cork_buffer = (char *) malloc (SOCKET_CORK_BUFFER_SIZE);
+                socket->cork_buffer_size = SOCKET_CORK_BUFFER_SIZE;
+            }
+
+            if (socket->cork_buffer) {
+                for (int i = 0; i < iovcnt; i++) {
+                    if (iov[i].iov_len) {
+                        memcpy (socket->cork_buffer + socket->cork_size, iov[i].iov_base, iov[i].iov_len);
+                        socket->cork_size += iov[i].iov_len;
+                    }
+                }
+
+                if (total_sent) *total_sent = size;
+            }
+
+            else {
+                retval = 1;
+            }
+        }
+    }
+
+    return retval;
+
+}
+
+// sends the iovec buffers to the socket, if it is corked, they are copied into its cork buffer,
+// if it has an outbound queue, they are sent without blocking & what can't be sent right away
+// is queued, otherwise the socket is waited until everything has been sent
+// the socket's write mutex must be locked by the caller
+// returns 0 on success, 1 on error
+u8 socket_send_iov (
+    Socket *socket,
+    struct iovec *iov, int iovcnt, int flags,
+    size_t *total_sent
+) {
+
+    size_t size = 0;
+    for (int i = 0; i < iovcnt; i++) size += iov[i].iov_len;
+
+    return socket->corked ?
+        socket_cork_send (socket, iov, iovcnt, flags, size, total_sent) :
+        socket_send_iov_actual (socket, iov, iovcnt, flags, size, total_sent, NULL);
+
+}
+
+// works like socket_send_iov () but the buffers are sent with MSG_ZEROCOPY if it is possible,
+// release (hold) is called once the kernel is done with them, which might be after this returns,
+// if release is NULL, this waits for the kernel to complete the send before returning
+// the socket's write mutex must be locked by the caller
+// returns 0 on success, 1 on error
+u8 socket_send_iov_zero_copy (
+    Socket *socket,
+    struct iovec *iov, int iovcnt, int flags,
+    void *hold, Action release,
+    size_t *total_sent
+) {
+
+    u8 retval = 1;
+
+    size_t size = 0;
+    for (int i = 0; i < iovcnt; i++) size += iov[i].iov_len;
+
+    u32 n_sends = 0;
+    #ifdef CERVER_ZERO_COPY_SUPPORTED
+    if (socket_zero_copy_use (socket, size)) {
+        retval = socket_send_iov_actual (socket, iov, iovcnt, flags | MSG_ZEROCOPY, size, total_sent, &n_sends);
+    }
+
+    else
+    #endif
+    {
+        retval = socket_send_iov (socket, iov, iovcnt, flags, total_sent);
+    }
+
+    if (n_sends) {
+        if (!socket_zero_copy_push (socket, n_sends, hold, release)) {
+            // the caller keeps its buffers, so they can only be returned once the kernel is done
+            if (!release) {
+                while (socket->zero_copy_pending && socket_zero_copy_wait (socket, false));
+            }
+        }
+
+        // we can't keep track of the sends, so the next ones are copied & the buffers are only
+        // released once the kernel has completed every send, if we give up waiting, they are leaked,
+        // as the kernel might still be sending from their pages
+        else {
+            socket->zero_copy_copied = true;
+
+            while (
+                (socket->zero_copy_n_completed != socket->zero_copy_next_id)
+                && socket_zero_copy_wait (socket, false)
+            );
+
+            if (socket->zero_copy_n_completed == socket->zero_copy_next_id) {
+                if (release) release (hold);
+            }
+
+            else {
+                cerver_log (
+                    LOG_TYPE_ERROR, LOG_TYPE_CONNECTION,
+                    "Sock fd <%d> zero copy sends were not completed - leaking their buffers!",
+                    socket->sock_fd
+                );
+            }
+        }
+    }
+
+    // the buffers were copied by the kernel or in the socket's queues
+    else if (release) {
+        release (hold);
+    }
+
+    if (socket->zero_copy_pending) (void) socket_zero_copy_reap (socket);
+
+    return retval;
+
+}
+
+// sends as much of the socket's outbound queue as possible without blocking
+// resumed is set to true if the reads were paused & the queue drained to its low watermark
+// returns 0 on success, 1 on error
+u8 socket_outbound_flush (Socket *socket, bool *resumed) {
+
+    u8 retval = 1;
+
+    if (socket) {
+        pthread_mutex_lock (socket->write_mutex);
+
+        SocketOutbound *outbound = socket->outbound;
+        if (outbound) {
+            retval = 0;
+            if (outbound->start < outbound->end) {
+                struct iovec iov = {
+                    .iov_base = outbound->buffer + outbound->start,
+                    .iov_len = outbound->end - outbound->start
+                };
+
+                size_t sent = 0;
+                retval = socket_sock_send_iov (
+                    socket, &iov, 1,
+                    MSG_DONTWAIT | MSG_NOSIGNAL, false, &sent, NULL
+                );
+
+                if (!retval) {
+                    outbound->start += sent;
+                    if (outbound->start == outbound->end) {
+                        outbound->start = 0;
+                        outbound->end = 0;
+                    }
+
+                    if (outbound->paused && ((outbound->end - outbound->start) <= outbound->low_watermark)) {
+                        __atomic_store_n (&outbound->paused, false, __ATOMIC_RELEASE);
+                        if (resumed) *resumed = true;
+                    }
+                }
+
+                else {
+                    socket_outbound_shutdown (socket);
+                }
+            }
+        }
+
+        pthread_mutex_unlock (socket->write_mutex);
+    }
+
+    return retval;
+
+}
+
+// returns true if the socket's reads are paused until its outbound queue drains
+bool socket_outbound_paused (const Socket *socket) {
+
+    SocketOutbound *outbound = __atomic_load_n (&socket->outbound, __ATOMIC_ACQUIRE);
+
+    return outbound ? __atomic_load_n (&outbound->paused, __ATOMIC_ACQUIRE) : false;
+
+}
+
+// handles the completion of an io_uring send of the outbound queue with the send's result,
+// the next queued bytes are sent right away, if the queue is no longer used by its socket, it is deleted
+// resumed is set to true if the reads were paused & the queue drained to its low watermark
+// returns 0 on success, 1 on error or if the queue was deleted
+u8 socket_outbound_sent (SocketOutbound *outbound, const int res, bool *resumed) {
+
+    u8 retval = 1;
+
+    if (outbound) {
+        // the socket is kept in the cerver's sockets pool, so it is still valid
+        Socket *socket = outbound->socket;
+        bool released = false;
+
+        pthread_mutex_lock (socket->write_mutex);
+
+        outbound->in_flight = false;
+
+        if (socket->outbound == outbound) {
+            if (res > 0) {
+                outbound->sending_start += (size_t) res;
+
+                if (outbound->sending_start < outbound->sending_end) {
+                    retval = socket_outbound_uring_send_pending (socket);
+                }
+
+                else {
+                    outbound->sending_start = 0;
+                    outbound->sending_end = 0;
+
+                    retval = socket_outbound_uring_send (socket);
+                }
+
+                if (outbound->paused && (socket_outbound_size (outbound) <= outbound->low_watermark)) {
+                    __atomic_store_n (&outbound->paused, false, __ATOMIC_RELEASE);
+                    if (resumed) *resumed = true;
+                }
+            }
+
+            else {
+                outbound->sending_start = 0;
+                outbound->sending_end = 0;
+
+                socket_outbound_shutdown (socket);
+            }
+        }
+
+        // the socket was reset while the send was in flight
+        else {
+            released = true;
+        }
+
+        pthread_mutex_unlock (socket->write_mutex);
+
+        if (released) socket_outbound_delete (outbound);
+    }
+
+    return retval;
+
+}
+
+// starts coalescing what is sent to the socket, it will be sent with a single call
+// when socket_uncork () is called the same n of times
+void socket_cork (Socket *socket) {
+
+    if (socket) {
+        pthread_mutex_lock (socket->write_mutex);
+
+        socket->corked += 1;
+
+        pthread_mutex_unlock (socket->write_mutex);
+    }
+
+}
+
+// ends a socket_cork () call & sends the coalesced bytes if it was the last one
+// returns 0 on success, 1 on error
+u8 socket_uncork (Socket *socket) {
+
+    u8 retval = 1;
+
+    if (socket) {
+        pthread_mutex_lock (socket->write_mutex);
+
+        if (socket->corked) {
+            socket->corked -= 1;
+            retval = socket->corked ? 0 : socket_cork_flush (socket);
+        }
+
+        pthread_mutex_unlock (socket->write_mutex);
+    }
+
+    return retval;
+
+}
+
+// discards the socket's pending bytes & its outbound queue
+// used when its connection has ended & the socket is going to be reused
+void socket_send_reset (Socket *socket) {
+
+    if (socket) {
+        pthread_mutex_lock (socket->write_mutex);
+
+        socket_outbound_release (socket->outbound);
+        __atomic_store_n (&socket->outbound, NULL, __ATOMIC_RELEASE);
+
+        socket->cork_size = 0;
+
+        socket_zero_copy_release_all (socket);
+        socket->zero_copy_threshold = 0;
+        socket->zero_copy_copied = false;
+
+        socket->header_version = PACKET_HEADER_VERSION_V1;
+        socket->header_checksum = false;
+
+        socket->compressor = NULL;
+        socket->compression_threshold = 0;
+
+        // the buffers that were queued for the ended connection are discarded
+        thpool_serial_cancel (__atomic_load_n (&socket->dispatch, __ATOMIC_ACQUIRE));
+
+        pthread_mutex_unlock (socket->write_mutex);
+    }
+
+}
+
+// gets the serial executor that handles the socket's received buffers in order,
+// it is created by the first call & it is kept until socket_dispatch_reset () is called
+// returns NULL on error
+ThpoolSerial *socket_dispatch_get (Socket *socket) {
+
+    ThpoolSerial *dispatch = NULL;
+
+    if (socket) {
+        // only the thread that receives from the socket queues its buffers
+        dispatch = __atomic_load_n (&socket->dispatch, __ATOMIC_ACQUIRE);
+        if (!dispatch) {
+            dispatch = thpool_serial_new ();
+            __atomic_store_n (&socket->dispatch, dispatch, __ATOMIC_RELEASE);
+        }
+    }
+
+    return dispatch;
+
+}
+
+// releases the socket's serial executor, so the next connection that uses the socket
+// does not wait for nor shares the cancelled jobs of the one before
+void socket_dispatch_reset (Socket *socket) {
+
+    if (socket) {
+        thpool_serial_delete (__atomic_exchange_n (&socket->dispatch, NULL, __ATOMIC_ACQ_REL));
+    }
+
+}
+
+#pragma endregion
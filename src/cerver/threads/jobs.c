@@ -1,11 +1,14 @@
 #include <stdlib.h>
+#include <limits.h>
 
-#include "cerver/collections/dlist.h"
+#include <time.h>
+#include <unistd.h>
+#include <linux/futex.h>
+#include <sys/syscall.h>
 
-#include "cerver/threads/jobs.h"
-#include "cerver/threads/bsem.h"
+#include "cerver/types/types.h"
 
-void job_queue_clear (JobQueue *job_queue);
+#include "cerver/threads/jobs.h"
 
 Job *job_new (void) {
 
@@ -38,19 +41,42 @@ Job *job_create (void (*method) (void *args), void *args) {
 
 }
 
+static inline void job_queue_futex_wait (
+	volatile unsigned int *word, unsigned int value, const struct timespec *timeout
+) {
+
+	(void) syscall (SYS_futex, word, FUTEX_WAIT_PRIVATE, value, timeout, NULL, 0);
+
+}
+
+static inline void job_queue_futex_wake (volatile unsigned int *word, int n_threads) {
+
+	(void) syscall (SYS_futex, word, FUTEX_WAKE_PRIVATE, n_threads, NULL, NULL, 0);
+
+}
+
 JobQueue *job_queue_new (void) {
 
-	JobQueue *job_queue = (JobQueue *) malloc (sizeof (JobQueue));
-	if (job_queue) {
-		// job_queue->front = NULL;
-		// job_queue->rear = NULL;
+	JobQueue *job_queue = NULL;
+	if (!posix_memalign ((void **) &job_queue, JOB_QUEUE_CACHE_LINE, sizeof (JobQueue))) {
+		job_queue->push_pos = 0;
+		job_queue->pull_pos = 0;
+
+		job_queue->capacity = 0;
+		job_queue->mask = 0;
+		job_queue->slots = NULL;
 
-		// job_queue->size = 0;
+		job_queue->signal = 0;
+		job_queue->n_waiters = 0;
 
-		job_queue->queue = NULL;
+		job_queue->woken = 0;
 
-		job_queue->rwmutex = NULL;
-		job_queue->has_jobs = NULL;
+		job_queue->not_full = 0;
+		job_queue->n_producers_waiting = 0;
+	}
+
+	else {
+		job_queue = NULL;
 	}
 
 	return job_queue;
@@ -62,70 +88,114 @@ void job_queue_delete (void *job_queue_ptr) {
 	if (job_queue_ptr) {
 		JobQueue *job_queue = (JobQueue *) job_queue_ptr;
 
-		pthread_mutex_lock (job_queue->rwmutex);
-
-		// job_queue_clear (job_queue);
-		dlist_delete (job_queue->queue);
-
-		pthread_mutex_unlock (job_queue->rwmutex);
-		pthread_mutex_destroy (job_queue->rwmutex);
-		free (job_queue->rwmutex);
-
-		bsem_delete (job_queue->has_jobs);
+		if (job_queue->slots) free (job_queue->slots);
 
 		free (job_queue);
 	}
 
 }
 
+// creates a job queue with the default capacity
 JobQueue *job_queue_create (void) {
 
+	return job_queue_create_with_capacity (JOB_QUEUE_DEFAULT_CAPACITY);
+
+}
+
+// creates a job queue that can hold up to capacity jobs
+// the capacity is rounded up to the next power of 2
+JobQueue *job_queue_create_with_capacity (size_t capacity) {
+
 	JobQueue *job_queue = job_queue_new ();
 	if (job_queue) {
-		job_queue->queue = dlist_init (job_delete, NULL);
-
-		job_queue->rwmutex = (pthread_mutex_t *) malloc (sizeof (pthread_mutex_t));
-		pthread_mutex_init (job_queue->rwmutex, NULL);
+		job_queue->capacity = 2;
+		while (job_queue->capacity < capacity) job_queue->capacity <<= 1;
+		job_queue->mask = job_queue->capacity - 1;
+
+		job_queue->slots = (JobQueueSlot *) calloc (job_queue->capacity, sizeof (JobQueueSlot));
+		if (job_queue->slots) {
+			for (size_t i = 0; i < job_queue->capacity; i++) {
+				job_queue->slots[i].sequence = i;
+			}
+		}
 
-		job_queue->has_jobs = bsem_new ();
-		bsem_init (job_queue->has_jobs, 0);
+		else {
+			job_queue_delete (job_queue);
+			job_queue = NULL;
+		}
 	}
 
 	return job_queue;
 
 }
 
+// returns true if there are jobs ready to be pulled from the queue
+bool job_queue_has_jobs (JobQueue *job_queue) {
+
+	bool retval = false;
+
+	if (job_queue) {
+		size_t pos = __atomic_load_n (&job_queue->pull_pos, __ATOMIC_SEQ_CST);
+		JobQueueSlot *slot = &job_queue->slots[pos & job_queue->mask];
+
+		retval = (__atomic_load_n (&slot->sequence, __ATOMIC_SEQ_CST) == (pos + 1));
+	}
+
+	return retval;
+
+}
+
 // add a new job to the queue
-// returns 0 on success, 1 on error
-int job_queue_push (JobQueue *job_queue, Job *job) {
+// wakes up one consumer if any is waiting
+// returns 0 on success, 1 on error or if the queue is full
+int job_queue_push (
+	JobQueue *job_queue, void (*method) (void *args), void *args
+) {
 
 	int retval = 1;
 
-	if (job_queue && job) {
-		pthread_mutex_lock (job_queue->rwmutex);
+	if (job_queue) {
+		JobQueueSlot *slot = NULL;
+		size_t pos = __atomic_load_n (&job_queue->push_pos, __ATOMIC_RELAXED);
+
+		bool done = false;
+		while (!done) {
+			slot = &job_queue->slots[pos & job_queue->mask];
+			size_t sequence = __atomic_load_n (&slot->sequence, __ATOMIC_ACQUIRE);
+			long diff = (long) sequence - (long) pos;
+
+			// the slot is free, try to claim it
+			if (!diff) {
+				if (__atomic_compare_exchange_n (
+					&job_queue->push_pos, &pos, pos + 1,
+					true, __ATOMIC_RELAXED, __ATOMIC_RELAXED
+				)) {
+					done = true;
+					retval = 0;
+				}
+			}
+
+			// the slot still has the job from a full lap ago
+			else if (diff < 0) {
+				done = true;
+			}
+
+			// another producer took the slot
+			else {
+				pos = __atomic_load_n (&job_queue->push_pos, __ATOMIC_RELAXED);
+			}
+		}
 
-		// job->prev = NULL;
-		// switch (job_queue->size) {
-		// 	case 0:
-		// 		job_queue->front = job;
-		// 		job_queue->rear = job;
-		// 		break;
-
-		// 	default:
-		// 		job->prev = job_queue->rear;
-		// 		job_queue->rear = job;
-		// 		break;
-		// }
-
-		retval = dlist_insert_after (
-			job_queue->queue,
-			dlist_end (job_queue->queue),
-			job
-		);
-
-		bsem_post (job_queue->has_jobs);
-
-		pthread_mutex_unlock (job_queue->rwmutex);
+		if (!retval) {
+			slot->method = method;
+			slot->args = args;
+			__atomic_store_n (&slot->sequence, pos + 1, __ATOMIC_SEQ_CST);
+
+			if (__atomic_load_n (&job_queue->n_waiters, __ATOMIC_SEQ_CST)) {
+				(void) __atomic_add_fetch (&job_queue->signal, 1, __ATOMIC_SEQ_CST);
+				job_queue_futex_wake (&job_queue->signal, 1);
+			}
+		}
 	}
 
 	return retval;
@@ -133,42 +203,140 @@ int job_queue_push (JobQueue *job_queue, Job *job) {
 }
 
 // get the job at the start of the queue
-Job *job_queue_pull (JobQueue *job_queue) {
+// returns 0 if a job was copied into job, 1 if the queue was empty
+u8 job_queue_pull (JobQueue *job_queue, Job *job) {
+
+	u8 retval = 1;
+
+	if (job_queue && job) {
+		JobQueueSlot *slot = NULL;
+		size_t pos = __atomic_load_n (&job_queue->pull_pos, __ATOMIC_RELAXED);
+
+		bool done = false;
+		while (!done) {
+			slot = &job_queue->slots[pos & job_queue->mask];
+			size_t sequence = __atomic_load_n (&slot->sequence, __ATOMIC_ACQUIRE);
+			long diff = (long) sequence - (long) (pos + 1);
+
+			// the slot has a job, try to claim it
+			if (!diff) {
+				if (__atomic_compare_exchange_n (
+					&job_queue->pull_pos, &pos, pos + 1,
+					true, __ATOMIC_RELAXED, __ATOMIC_RELAXED
+				)) {
+					done = true;
+					retval = 0;
+				}
+			}
+
+			// the queue is empty
+			else if (diff < 0) {
+				done = true;
+			}
+
+			// another consumer took the job
+			else {
+				pos = __atomic_load_n (&job_queue->pull_pos, __ATOMIC_RELAXED);
+			}
+		}
+
+		if (!retval) {
+			job->method = slot->method;
+			job->args = slot->args;
+
+			// the slot is free again for the producers of the next lap
+			__atomic_store_n (&slot->sequence, pos + job_queue->mask + 1, __ATOMIC_SEQ_CST);
+
+			if (__atomic_load_n (&job_queue->n_producers_waiting, __ATOMIC_SEQ_CST)) {
+				(void) __atomic_add_fetch (&job_queue->not_full, 1, __ATOMIC_SEQ_CST);
+				job_queue_futex_wake (&job_queue->not_full, 1);
+			}
+		}
+	}
+
+	return retval;
+
+}
+
+// blocks until there are jobs in the queue or job_queue_wake_all () is called,
+// even if it was called before this method
+// it can return without any job, so the caller must check again
+void job_queue_wait (JobQueue *job_queue) {
+
+	if (job_queue) {
+		unsigned int signal = __atomic_load_n (&job_queue->signal, __ATOMIC_SEQ_CST);
+
+		(void) __atomic_add_fetch (&job_queue->n_waiters, 1, __ATOMIC_SEQ_CST);
+
+		// a producer that pushes after this check will see the waiter & change the signal
+		if (
+			!__atomic_exchange_n (&job_queue->woken, 0, __ATOMIC_SEQ_CST)
+			&& !job_queue_has_jobs (job_queue)
+		) {
+			job_queue_futex_wait (&job_queue->signal, signal, NULL);
+		}
+
+		(void) __atomic_sub_fetch (&job_queue->n_waiters, 1, __ATOMIC_SEQ_CST);
+	}
+
+}
+
+// returns true if the slot for the next push still has the job from a full lap ago
+static bool job_queue_is_full (JobQueue *job_queue) {
+
+	size_t pos = __atomic_load_n (&job_queue->push_pos, __ATOMIC_SEQ_CST);
+	JobQueueSlot *slot = &job_queue->slots[pos & job_queue->mask];
+
+	return ((long) __atomic_load_n (&slot->sequence, __ATOMIC_SEQ_CST) - (long) pos) < 0;
+
+}
 
-	Job *retval = NULL;
+// blocks until a job is pulled from a full queue, until job_queue_wake_all () is called
+// or until the timeout (in ms) expires, it returns right away if the queue is not full
+// it can return while the queue is still full, so the caller must try to push again
+void job_queue_wait_not_full (JobQueue *job_queue, const u32 timeout) {
 
 	if (job_queue) {
-		pthread_mutex_lock (job_queue->rwmutex);
+		unsigned int not_full = __atomic_load_n (&job_queue->not_full, __ATOMIC_SEQ_CST);
 
-		switch (job_queue->queue->size) {
-			case 0: break;
+		(void) __atomic_add_fetch (&job_queue->n_producers_waiting, 1, __ATOMIC_SEQ_CST);
 
-			case 1:
-				// remove at the start of the list
-				retval = (Job *) dlist_remove_element (job_queue->queue, NULL);
-				break;
+		// a consumer that pulls after this check will see the waiter & change the word
+		if (job_queue_is_full (job_queue)) {
+			struct timespec timespec = {
+				.tv_sec = timeout / 1000,
+				.tv_nsec = (timeout % 1000) * 1000000
+			};
 
-			default:
-				// remove at the start of the list
-				retval = (Job *) dlist_remove_element (job_queue->queue, NULL);
-				bsem_post (job_queue->has_jobs);
-				break;
+			job_queue_futex_wait (&job_queue->not_full, not_full, &timespec);
 		}
 
-		pthread_mutex_unlock (job_queue->rwmutex);
+		(void) __atomic_sub_fetch (&job_queue->n_producers_waiting, 1, __ATOMIC_SEQ_CST);
 	}
 
-	return retval;
+}
+
+// wakes up every thread that is waiting on the queue
+// including the producers that are waiting for it to have room
+void job_queue_wake_all (JobQueue *job_queue) {
+
+	if (job_queue) {
+		__atomic_store_n (&job_queue->woken, 1, __ATOMIC_SEQ_CST);
+		(void) __atomic_add_fetch (&job_queue->signal, 1, __ATOMIC_SEQ_CST);
+		job_queue_futex_wake (&job_queue->signal, INT_MAX);
+
+		(void) __atomic_add_fetch (&job_queue->not_full, 1, __ATOMIC_SEQ_CST);
+		job_queue_futex_wake (&job_queue->not_full, INT_MAX);
+	}
 
 }
 
-// clears the job queue -> destroys all jobs
+// clears the job queue -> discards all jobs
 void job_queue_clear (JobQueue *job_queue) {
 
 	if (job_queue) {
-		dlist_reset (job_queue->queue);
-
-		bsem_reset (job_queue->has_jobs);
+		Job job = { 0 };
+		while (!job_queue_pull (job_queue, &job)) {}
 	}
 
-}
\ No newline at end of file
+}
@@ -4,20 +4,349 @@
 
 #include <time.h>
 #include <unistd.h>
+#include <sched.h>
 // #include <errno.h>
 
 // #define _POSIX_C_SOURCE 200809L
 #include <pthread.h>
-#if defined(__linux__)
-#include <sys/prctl.h>
-#endif
 
 #include "cerver/threads/thpool.h"
-#include "cerver/threads/bsem.h"
 #include "cerver/threads/jobs.h"
+#include "cerver/threads/thread.h"
 
 static void *thread_do (void *thread_ptr);
 
+#pragma region deque
+
+// a chase-lev deque of jobs
+// only the owner thread pushes & pops at the bottom, any other thread can steal from the top
+
+struct _ThpoolDequeArray {
+
+	long size;
+	struct _ThpoolDequeArray *prev;
+	Job *buffer[];
+
+};
+
+typedef struct _ThpoolDequeArray ThpoolDequeArray;
+
+struct _ThpoolDeque {
+
+	volatile long top;
+	volatile long bottom;
+
+	ThpoolDequeArray *array;
+
+};
+
+typedef struct _ThpoolDeque ThpoolDeque;
+
+static ThpoolDequeArray *thpool_deque_array_new (long size) {
+
+	ThpoolDequeArray *array = (ThpoolDequeArray *) malloc (
+		sizeof (ThpoolDequeArray) + (size * sizeof (Job *))
+	);
+
+	if (array) {
+		array->size = size;
+		array->prev = NULL;
+	}
+
+	return array;
+
+}
+
+// deletes the array & the smaller ones that it replaced
+static void thpool_deque_array_delete (ThpoolDequeArray *array) {
+
+	while (array) {
+		ThpoolDequeArray *prev = array->prev;
+		free (array);
+		array = prev;
+	}
+
+}
+
+static inline Job *thpool_deque_array_get (ThpoolDequeArray *array, long idx) {
+
+	return __atomic_load_n (&array->buffer[idx & (array->size - 1)], __ATOMIC_RELAXED);
+
+}
+
+static inline void thpool_deque_array_put (ThpoolDequeArray *array, long idx, Job *job) {
+
+	__atomic_store_n (&array->buffer[idx & (array->size - 1)], job, __ATOMIC_RELAXED);
+
+}
+
+static ThpoolDeque *thpool_deque_create (void) {
+
+	ThpoolDeque *deque = (ThpoolDeque *) malloc (sizeof (ThpoolDeque));
+	if (deque) {
+		deque->top = 0;
+		deque->bottom = 0;
+
+		deque->array = thpool_deque_array_new (THPOOL_DEQUE_INITIAL_SIZE);
+		if (!deque->array) {
+			free (deque);
+			deque = NULL;
+		}
+	}
+
+	return deque;
+
+}
+
+// deletes the deque & the jobs that are still in it
+static void thpool_deque_delete (ThpoolDeque *deque) {
+
+	if (deque) {
+		for (long i = deque->top; i < deque->bottom; i++) {
+			job_delete (thpool_deque_array_get (deque->array, i));
+		}
+
+		thpool_deque_array_delete (deque->array);
+
+		free (deque);
+	}
+
+}
+
+// doubles the array size, the old one is kept until the deque is deleted
+// as a thief may still be reading from it
+static ThpoolDequeArray *thpool_deque_grow (
+	ThpoolDeque *deque, ThpoolDequeArray *array, long top, long bottom
+) {
+
+	ThpoolDequeArray *bigger = thpool_deque_array_new (array->size * 2);
+	if (bigger) {
+		for (long i = top; i < bottom; i++) {
+			thpool_deque_array_put (bigger, i, thpool_deque_array_get (array, i));
+		}
+
+		bigger->prev = array;
+		__atomic_store_n (&deque->array, bigger, __ATOMIC_RELEASE);
+	}
+
+	return bigger;
+
+}
+
+// pushes a job at the bottom, only called by the owner
+// returns 0 on success, 1 on error
+static unsigned int thpool_deque_push (ThpoolDeque *deque, Job *job) {
+
+	unsigned int retval = 1;
+
+	long bottom = __atomic_load_n (&deque->bottom, __ATOMIC_RELAXED);
+	long top = __atomic_load_n (&deque->top, __ATOMIC_ACQUIRE);
+	ThpoolDequeArray *array = __atomic_load_n (&deque->array, __ATOMIC_RELAXED);
+
+	if ((bottom - top) > (array->size - 1)) {
+		array = thpool_deque_grow (deque, array, top, bottom);
+	}
+
+	if (array) {
+		thpool_deque_array_put (array, bottom, job);
+		__atomic_store_n (&deque->bottom, bottom + 1, __ATOMIC_RELEASE);
+
+		retval = 0;
+	}
+
+	return retval;
+
+}
+
+// pops the last pushed job, only called by the owner
+static Job *thpool_deque_pop (ThpoolDeque *deque) {
+
+	Job *job = NULL;
+
+	long bottom = __atomic_load_n (&deque->bottom, __ATOMIC_RELAXED) - 1;
+	ThpoolDequeArray *array = __atomic_load_n (&deque->array, __ATOMIC_RELAXED);
+	__atomic_store_n (&deque->bottom, bottom, __ATOMIC_RELAXED);
+	__atomic_thread_fence (__ATOMIC_SEQ_CST);
+	long top = __atomic_load_n (&deque->top, __ATOMIC_RELAXED);
+
+	if (top <= bottom) {
+		job = thpool_deque_array_get (array, bottom);
+
+		// the last job, race against the thieves
+		if (top == bottom) {
+			if (!__atomic_compare_exchange_n (
+				&deque->top, &top, top + 1,
+				false, __ATOMIC_SEQ_CST, __ATOMIC_RELAXED
+			)) {
+				job = NULL;
+			}
+
+			__atomic_store_n (&deque->bottom, bottom + 1, __ATOMIC_RELAXED);
+		}
+	}
+
+	else {
+		__atomic_store_n (&deque->bottom, bottom + 1, __ATOMIC_RELAXED);
+	}
+
+	return job;
+
+}
+
+// steals the oldest job, can be called by any thread
+// returns NULL if the deque is empty or if another thread took the job first
+static Job *thpool_deque_steal (ThpoolDeque *deque) {
+
+	Job *job = NULL;
+
+	long top = __atomic_load_n (&deque->top, __ATOMIC_ACQUIRE);
+	__atomic_thread_fence (__ATOMIC_SEQ_CST);
+	long bottom = __atomic_load_n (&deque->bottom, __ATOMIC_ACQUIRE);
+
+	if (top < bottom) {
+		ThpoolDequeArray *array = __atomic_load_n (&deque->array, __ATOMIC_ACQUIRE);
+		job = thpool_deque_array_get (array, top);
+
+		if (!__atomic_compare_exchange_n (
+			&deque->top, &top, top + 1,
+			false, __ATOMIC_SEQ_CST, __ATOMIC_RELAXED
+		)) {
+			job = NULL;
+		}
+	}
+
+	return job;
+
+}
+
+static inline bool thpool_deque_is_empty (ThpoolDeque *deque) {
+
+	return __atomic_load_n (&deque->top, __ATOMIC_ACQUIRE)
+		>= __atomic_load_n (&deque->bottom, __ATOMIC_ACQUIRE);
+
+}
+
+#pragma endregion
+
+#pragma region queue
+
+// the global queue for the jobs that are added from outside the thpool
+// a ring buffer that grows as needed
+
+struct _ThpoolQueue {
+
+	pthread_mutex_t mutex;
+
+	Job **jobs;
+	size_t capacity;
+	size_t head;
+	volatile size_t size;
+
+};
+
+typedef struct _ThpoolQueue ThpoolQueue;
+
+static ThpoolQueue *thpool_queue_create (void) {
+
+	ThpoolQueue *queue = (ThpoolQueue *) malloc (sizeof (ThpoolQueue));
+	if (queue) {
+		pthread_mutex_init (&queue->mutex, NULL);
+
+		queue->capacity = THPOOL_DEQUE_INITIAL_SIZE;
+		queue->jobs = (Job **) calloc (queue->capacity, sizeof (Job *));
+		queue->head = 0;
+		queue->size = 0;
+
+		if (!queue->jobs) {
+			pthread_mutex_destroy (&queue->mutex);
+			free (queue);
+			queue = NULL;
+		}
+	}
+
+	return queue;
+
+}
+
+// deletes the queue & the jobs that are still in it
+static void thpool_queue_delete (ThpoolQueue *queue) {
+
+	if (queue) {
+		for (size_t i = 0; i < queue->size; i++) {
+			job_delete (queue->jobs[(queue->head + i) % queue->capacity]);
+		}
+
+		free (queue->jobs);
+
+		pthread_mutex_destroy (&queue->mutex);
+
+		free (queue);
+	}
+
+}
+
+// returns 0 on success, 1 on error
+static unsigned int thpool_queue_push (ThpoolQueue *queue, Job *job) {
+
+	unsigned int retval = 1;
+
+	pthread_mutex_lock (&queue->mutex);
+
+	if (queue->size == queue->capacity) {
+		size_t capacity = queue->capacity * 2;
+		Job **jobs = (Job **) calloc (capacity, sizeof (Job *));
+		if (jobs) {
+			for (size_t i = 0; i < queue->size; i++) {
+				jobs[i] = queue->jobs[(queue->head + i) % queue->capacity];
+			}
+
+			free (queue->jobs);
+			queue->jobs = jobs;
+			queue->capacity = capacity;
+			queue->head = 0;
+		}
+	}
+
+	if (queue->size < queue->capacity) {
+		queue->jobs[(queue->head + queue->size) % queue->capacity] = job;
+		__atomic_store_n (&queue->size, queue->size + 1, __ATOMIC_RELEASE);
+
+		retval = 0;
+	}
+
+	pthread_mutex_unlock (&queue->mutex);
+
+	return retval;
+
+}
+
+// takes up to max jobs from the front of the queue
+// returns how many jobs were taken
+static size_t thpool_queue_pull (ThpoolQueue *queue, Job **jobs, size_t max) {
+
+	size_t count = 0;
+
+	// avoid the lock when there is nothing to take
+	if (__atomic_load_n (&queue->size, __ATOMIC_ACQUIRE)) {
+		pthread_mutex_lock (&queue->mutex);
+
+		count = (queue->size < max) ? queue->size : max;
+		for (size_t i = 0; i < count; i++) {
+			jobs[i] = queue->jobs[queue->head];
+			queue->head = (queue->head + 1) % queue->capacity;
+		}
+
+		__atomic_store_n (&queue->size, queue->size - count, __ATOMIC_RELEASE);
+
+		pthread_mutex_unlock (&queue->mutex);
+	}
+
+	return count;
+
+}
+
+#pragma endregion
+
 #pragma region thread
 
 struct _PoolThread {
@@ -26,10 +355,18 @@ struct _PoolThread {
 	pthread_t thread_id;
 	Thpool *thpool;
 
+	ThpoolDeque *deque;
+
+	// state for picking the victims to steal from
+	unsigned int seed;
+
 };
 
 typedef struct _PoolThread PoolThread;
 
+// the pool thread that is running in the current thread, if any
+static __thread PoolThread *current_pool_thread = NULL;
+
 static PoolThread *pool_thread_new (void) {
 
 	PoolThread *thread = (PoolThread *) malloc (sizeof (PoolThread));
@@ -37,6 +374,10 @@ static PoolThread *pool_thread_new (void) {
 		thread->id = -1;
 		thread->thread_id = 0;
 		thread->thpool = NULL;
+
+		thread->deque = NULL;
+
+		thread->seed = 0;
 	}
 
 	return thread;
@@ -45,7 +386,13 @@ static PoolThread *pool_thread_new (void) {
 
 static void pool_thread_delete (void *thread_ptr) {
 
-	if (thread_ptr) free (thread_ptr);
+	if (thread_ptr) {
+		PoolThread *thread = (PoolThread *) thread_ptr;
+
+		thpool_deque_delete (thread->deque);
+
+		free (thread_ptr);
+	}
 
 }
 
@@ -55,6 +402,10 @@ static PoolThread *pool_thread_create (int id, Thpool *thpool) {
 	if (thread) {
 		thread->id = id;
 		thread->thpool = thpool;
+
+		thread->deque = thpool_deque_create ();
+
+		thread->seed = ((unsigned int) id + 1) * 2654435761U;
 	}
 
 	return thread;
@@ -77,6 +428,19 @@ static unsigned int pool_thread_init (PoolThread *thread) {
 
 }
 
+// xorshift, good enough to spread the steals
+static inline unsigned int pool_thread_random (PoolThread *thread) {
+
+	unsigned int x = thread->seed;
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	thread->seed = x;
+
+	return x;
+
+}
+
 #pragma endregion
 
 #pragma region thpool
@@ -93,11 +457,17 @@ static Thpool *thpool_new (void) {
 		thpool->keep_alive = false;
 		thpool->num_threads_alive = 0;
 		thpool->num_threads_working = 0;
+		thpool->num_threads_sleeping = 0;
+
+		thpool->num_jobs_queued = 0;
 
 		thpool->mutex = NULL;
 		thpool->threads_all_idle = NULL;
+		thpool->has_jobs = NULL;
+
+		thpool->queue = NULL;
 
-		thpool->job_queue = NULL;
+		(void) memset (&thpool->affinity, 0, sizeof (ThreadAffinity));
 	}
 
 	return thpool;
@@ -119,13 +489,22 @@ static void thpool_delete (void *thpool_ptr) {
 			free (thpool->threads);
 		}
 
-		pthread_mutex_destroy (thpool->mutex);
-		free (thpool->mutex);
+		if (thpool->mutex) {
+			pthread_mutex_destroy (thpool->mutex);
+			free (thpool->mutex);
+		}
+
+		if (thpool->threads_all_idle) {
+			pthread_cond_destroy (thpool->threads_all_idle);
+			free (thpool->threads_all_idle);
+		}
 
-		pthread_cond_destroy (thpool->threads_all_idle);
-		free (thpool->threads_all_idle);
+		if (thpool->has_jobs) {
+			pthread_cond_destroy (thpool->has_jobs);
+			free (thpool->has_jobs);
+		}
 
-		job_queue_delete (thpool->job_queue);
+		thpool_queue_delete (thpool->queue);
 
 		free (thpool_ptr);
 	}
@@ -136,54 +515,178 @@ static void thpool_delete (void *thpool_ptr) {
 
 #pragma region internal
 
+// wakes up one sleeping thread, if any, after a job has been added
+static void thpool_wake_one (Thpool *thpool) {
+
+	if (__atomic_load_n (&thpool->num_threads_sleeping, __ATOMIC_SEQ_CST)) {
+		pthread_mutex_lock (thpool->mutex);
+		pthread_cond_signal (thpool->has_jobs);
+		pthread_mutex_unlock (thpool->mutex);
+	}
+
+}
+
+// runs the job & updates the thpool's counters
+static void thpool_thread_execute (Thpool *thpool, Job *job) {
+
+	// mark the thread as working before the job stops counting as queued
+	// so thpool_wait () never sees both counters at 0 while the job is pending
+	(void) __atomic_add_fetch (&thpool->num_threads_working, 1, __ATOMIC_SEQ_CST);
+	(void) __atomic_sub_fetch (&thpool->num_jobs_queued, 1, __ATOMIC_SEQ_CST);
+
+	if (job->method)
+		job->method (job->args);
+
+	job_delete (job);
+
+	if (
+		!__atomic_sub_fetch (&thpool->num_threads_working, 1, __ATOMIC_SEQ_CST)
+		&& (__atomic_load_n (&thpool->num_jobs_queued, __ATOMIC_SEQ_CST) <= 0)
+	) {
+		pthread_mutex_lock (thpool->mutex);
+		pthread_cond_broadcast (thpool->threads_all_idle);
+		pthread_mutex_unlock (thpool->mutex);
+	}
+
+}
+
+// takes a batch of jobs from the global queue, the first one is returned
+// & the rest are pushed to the thread's deque so other threads can steal them,
+// they are pushed from the last one as the thread pops its newest job first
+static Job *thpool_thread_take_from_queue (PoolThread *thread) {
+
+	Thpool *thpool = thread->thpool;
+
+	Job *jobs[THPOOL_QUEUE_BATCH_MAX];
+	size_t max = (__atomic_load_n (&thpool->queue->size, __ATOMIC_RELAXED) / thpool->n_threads) + 1;
+	if (max > THPOOL_QUEUE_BATCH_MAX) max = THPOOL_QUEUE_BATCH_MAX;
+
+	Job *job = NULL;
+	size_t count = thpool_queue_pull (thpool->queue, jobs, max);
+	if (count) {
+		job = jobs[0];
+
+		for (size_t i = count - 1; i > 0; i--) {
+			// no memory to grow the deque, run it now
+			if (thpool_deque_push (thread->deque, jobs[i])) thpool_thread_execute (thpool, jobs[i]);
+		}
+
+		if (count > 1) thpool_wake_one (thpool);
+	}
+
+	return job;
+
+}
+
+// tries to steal a job from the other threads, starting from a random one
+static Job *thpool_thread_steal (PoolThread *thread) {
+
+	Thpool *thpool = thread->thpool;
+
+	Job *job = NULL;
+	unsigned int start = pool_thread_random (thread) % thpool->n_threads;
+	for (unsigned int i = 0; !job && (i < thpool->n_threads); i++) {
+		PoolThread *victim = thpool->threads[(start + i) % thpool->n_threads];
+		if ((victim != thread) && !thpool_deque_is_empty (victim->deque)) {
+			job = thpool_deque_steal (victim->deque);
+		}
+	}
+
+	return job;
+
+}
+
+// gets the next job for the thread to execute
+// first from its own deque, then from the global queue & then from the others
+static Job *thpool_thread_get_job (PoolThread *thread) {
+
+	Job *job = thpool_deque_pop (thread->deque);
+	if (!job) job = thpool_thread_take_from_queue (thread);
+	if (!job) job = thpool_thread_steal (thread);
+
+	return job;
+
+}
+
+// sleeps until there are jobs to take or the thpool is being destroyed
+static void thpool_thread_sleep (Thpool *thpool) {
+
+	pthread_mutex_lock (thpool->mutex);
+
+	(void) __atomic_add_fetch (&thpool->num_threads_sleeping, 1, __ATOMIC_SEQ_CST);
+
+	while (thpool->keep_alive && (__atomic_load_n (&thpool->num_jobs_queued, __ATOMIC_SEQ_CST) <= 0)) {
+		pthread_cond_wait (thpool->has_jobs, thpool->mutex);
+	}
+
+	(void) __atomic_sub_fetch (&thpool->num_threads_sleeping, 1, __ATOMIC_SEQ_CST);
+
+	pthread_mutex_unlock (thpool->mutex);
+
+}
+
 static void *thread_do (void *thread_ptr) {
 
 	if (thread_ptr) {
 		PoolThread *thread = (PoolThread *) thread_ptr;
 		Thpool *thpool = thread->thpool;
 
+		current_pool_thread = thread;
+
 		// set name
 		if (thpool->name) {
 			char thread_name[64] = { 0 };
 			snprintf (thread_name, 64, "thpool-%s-%d", thpool->name, thread->id);
 			printf ("%s\n", thread_name);
-			prctl (PR_SET_NAME, thread_name);
+			(void) thread_set_name (thread_name);
+		}
+
+		(void) thread_set_affinity (&thpool->affinity);
+
+		// replace the deque with one that comes from this thread's node,
+		// no other thread touches it until every thread is alive
+		if (thpool->affinity.numa_local) {
+			ThpoolDeque *deque = thpool_deque_create ();
+			if (deque) {
+				thpool_deque_delete (thread->deque);
+				thread->deque = deque;
+			}
 		}
 
 		// mark thread as alive
 		pthread_mutex_lock (thpool->mutex);
-		thpool->num_threads_alive += 1;
+		(void) __atomic_add_fetch (&thpool->num_threads_alive, 1, __ATOMIC_RELEASE);
 		pthread_mutex_unlock (thpool->mutex);
 
-		while (thpool->keep_alive) {
-			bsem_wait (thpool->job_queue->has_jobs);
-			if (thpool->keep_alive) {
-				pthread_mutex_lock (thpool->mutex);
-				thpool->num_threads_working += 1;
-				pthread_mutex_unlock (thpool->mutex);
-
-				// get job to execute
-				Job *job = job_queue_pull (thpool->job_queue);
-				if (job) {
-					if (job->method)
-						job->method (job->args);
-
-					job_delete (job);
-				}
-
-				pthread_mutex_lock (thpool->mutex);
+		// wait for every deque to be ready before trying to steal from them
+		while (__atomic_load_n (&thpool->num_threads_alive, __ATOMIC_ACQUIRE) < thpool->n_threads) {
+			sched_yield ();
+		}
 
-				thpool->num_threads_working -= 1;
+		unsigned int spins = 0;
+		while (__atomic_load_n (&thpool->keep_alive, __ATOMIC_ACQUIRE)) {
+			Job *job = thpool_thread_get_job (thread);
+			if (job) {
+				thpool_thread_execute (thpool, job);
+				spins = 0;
+			}
 
-				if (!thpool->num_threads_working)
-					pthread_cond_signal (thpool->threads_all_idle);
+			else if (spins < THPOOL_IDLE_SPINS) {
+				spins += 1;
+				sched_yield ();
+			}
 
-				pthread_mutex_unlock (thpool->mutex);
+			else {
+				thpool_thread_sleep (thpool);
+				spins = 0;
 			}
 		}
 
+		current_pool_thread = NULL;
+
+		// the thpool can be deleted as soon as the mutex is released
 		pthread_mutex_lock (thpool->mutex);
-		thpool->num_threads_alive -= 1;
+		(void) __atomic_sub_fetch (&thpool->num_threads_alive, 1, __ATOMIC_RELEASE);
 		pthread_mutex_unlock (thpool->mutex);
 	}
 
@@ -201,15 +704,17 @@ Thpool *thpool_create (unsigned int n_threads) {
 	Thpool *thpool = thpool_new ();
 	if (thpool) {
 		thpool->n_threads = n_threads;
-		thpool->threads = (PoolThread **) calloc (thpool->n_threads, sizeof (PoolThread));
-		if (thpool->threads) {
+		thpool->threads = (PoolThread **) calloc (thpool->n_threads, sizeof (PoolThread *));
+		thpool->queue = thpool_queue_create ();
+		if (thpool->threads && thpool->queue) {
 			thpool->mutex = (pthread_mutex_t *) malloc (sizeof (pthread_mutex_t));
 			pthread_mutex_init (thpool->mutex, NULL);
 
 			thpool->threads_all_idle = (pthread_cond_t *) malloc (sizeof (pthread_cond_t));
 			pthread_cond_init (thpool->threads_all_idle, NULL);
 
-			thpool->job_queue = job_queue_create ();
+			thpool->has_jobs = (pthread_cond_t *) malloc (sizeof (pthread_cond_t));
+			pthread_cond_init (thpool->has_jobs, NULL);
 		}
 
 		else {
@@ -231,17 +736,25 @@ unsigned int thpool_init (Thpool *thpool) {
 	unsigned int retval = 1;
 
 	if (thpool) {
-		// initialize threads
-		thpool->keep_alive = true;
+		// every deque must exist before any thread tries to steal from it
+		bool created = true;
 		for (unsigned int i = 0; i < thpool->n_threads; i++) {
 			thpool->threads[i] = pool_thread_create (i, thpool);
-			pool_thread_init (thpool->threads[i]);
+			if (!thpool->threads[i] || !thpool->threads[i]->deque) created = false;
 		}
 
-		// wait for threads to initialize
-		while (thpool->num_threads_alive != thpool->n_threads) {}
+		if (created) {
+			// initialize threads
+			thpool->keep_alive = true;
+			for (unsigned int i = 0; i < thpool->n_threads; i++) {
+				pool_thread_init (thpool->threads[i]);
+			}
 
-		retval = 0;
+			// wait for threads to initialize
+			while (__atomic_load_n (&thpool->num_threads_alive, __ATOMIC_ACQUIRE) != thpool->n_threads) {}
+
+			retval = 0;
+		}
 	}
 
 	return retval;
@@ -264,15 +777,24 @@ void thpool_set_name (Thpool *thpool, const char *name) {
 
 }
 
+// sets where the thpool's threads run & where their memory comes from
+// if numa_local is set, each thread allocates its own deque after it has been placed
+// must be called before thpool_init ()
+void thpool_set_affinity (Thpool *thpool, const ThreadAffinity *affinity) {
+
+	if (thpool && affinity) {
+		thpool->affinity = *affinity;
+	}
+
+}
+
 // gets the current number of threads that are alive (running) in the thpool
 unsigned int thpool_get_num_threads_alive (Thpool *thpool) {
 
 	unsigned int retval = 0;
 
 	if (thpool) {
-		pthread_mutex_lock (thpool->mutex);
-		retval = thpool->num_threads_alive;
-		pthread_mutex_unlock (thpool->mutex);
+		retval = __atomic_load_n (&thpool->num_threads_alive, __ATOMIC_ACQUIRE);
 	}
 
 	return retval;
@@ -285,9 +807,7 @@ unsigned int thpool_get_num_threads_working (Thpool *thpool) {
 	unsigned int retval = 0;
 
 	if (thpool) {
-		pthread_mutex_lock (thpool->mutex);
-		retval = thpool->num_threads_working;
-		pthread_mutex_unlock (thpool->mutex);
+		retval = __atomic_load_n (&thpool->num_threads_working, __ATOMIC_ACQUIRE);
 	}
 
 	return retval;
@@ -300,11 +820,7 @@ bool thpool_is_empty (Thpool *thpool) {
 	bool retval = false;
 
 	if (thpool) {
-		pthread_mutex_lock (thpool->mutex);
-
-		retval = (thpool->num_threads_working == 0);
-
-		pthread_mutex_unlock (thpool->mutex);
+		retval = (__atomic_load_n (&thpool->num_threads_working, __ATOMIC_ACQUIRE) == 0);
 	}
 
 	return retval;
@@ -317,26 +833,45 @@ bool thpool_is_full (Thpool *thpool) {
 	bool retval = false;
 
 	if (thpool) {
-		pthread_mutex_lock (thpool->mutex);
-
-		retval = (thpool->num_threads_working == thpool->num_threads_alive);
-
-		pthread_mutex_unlock (thpool->mutex);
+		retval = (
+			__atomic_load_n (&thpool->num_threads_working, __ATOMIC_ACQUIRE)
+			== __atomic_load_n (&thpool->num_threads_alive, __ATOMIC_ACQUIRE)
+		);
 	}
 
 	return retval;
 
 }
 
-// adds a work to the thpool's job queue
-// it will be executed once it is the next in line and a thread is free
+// adds a work to the thpool
+// if it is called from one of the thpool's threads, the job goes to the thread's own deque,
+// else it goes to the global queue, it will be executed once a thread is free
 int thpool_add_work (Thpool *thpool, void (*work) (void *), void *args) {
 
 	int retval = 1;
 
 	if (thpool && work) {
 		Job *job = job_create (work, args);
-		retval = job_queue_push (thpool->job_queue, job);
+		if (job) {
+			PoolThread *thread = current_pool_thread;
+			if (thread && (thread->thpool == thpool)) {
+				retval = thpool_deque_push (thread->deque, job);
+			}
+
+			else {
+				retval = thpool_queue_push (thpool->queue, job);
+			}
+
+			if (!retval) {
+				// counted after the push, so a thread that wakes up can always find it
+				(void) __atomic_add_fetch (&thpool->num_jobs_queued, 1, __ATOMIC_SEQ_CST);
+				thpool_wake_one (thpool);
+			}
+
+			else {
+				job_delete (job);
+			}
+		}
 	}
 
 	return retval;
@@ -349,7 +884,10 @@ void thpool_wait (Thpool *thpool) {
 	if (thpool) {
 		pthread_mutex_lock (thpool->mutex);
 
-		while (thpool->job_queue->queue->size || thpool->num_threads_working) {
+		while (
+			(__atomic_load_n (&thpool->num_jobs_queued, __ATOMIC_SEQ_CST) > 0)
+			|| __atomic_load_n (&thpool->num_threads_working, __ATOMIC_SEQ_CST)
+		) {
 			pthread_cond_wait (thpool->threads_all_idle, thpool->mutex);
 		}
 
@@ -358,33 +896,184 @@ void thpool_wait (Thpool *thpool) {
 
 }
 
+struct _ThpoolSerialJob {
+
+	void (*method) (void *args);
+	void (*discard) (void *args);
+	void *args;
+
+	struct _ThpoolSerialJob *next;
+
+};
+
+typedef struct _ThpoolSerialJob ThpoolSerialJob;
+
+// creates a new serial executor with a single reference
+ThpoolSerial *thpool_serial_new (void) {
+
+	ThpoolSerial *serial = (ThpoolSerial *) malloc (sizeof (ThpoolSerial));
+	if (serial) {
+		serial->jobs = NULL;
+		serial->pending = 0;
+
+		serial->ref_count = 1;
+
+		serial->cancelled = false;
+	}
+
+	return serial;
+
+}
+
+// removes a reference from the serial executor,
+// it is deleted once its last reference is gone & none of its jobs is running
+void thpool_serial_delete (void *serial_ptr) {
+
+	if (serial_ptr) {
+		ThpoolSerial *serial = (ThpoolSerial *) serial_ptr;
+
+		// the thpool job that runs the executor holds a reference until it is done,
+		// so there are no jobs left by the time the last one is gone
+		if (!__atomic_sub_fetch (&serial->ref_count, 1, __ATOMIC_ACQ_REL)) {
+			free (serial);
+		}
+	}
+
+}
+
+// the jobs that have not started yet & any job that is added later are discarded
+void thpool_serial_cancel (ThpoolSerial *serial) {
+
+	if (serial) __atomic_store_n (&serial->cancelled, true, __ATOMIC_RELEASE);
+
+}
+
+// runs the serial executor's jobs until there are no more pending ones
+static void thpool_serial_run (void *serial_ptr) {
+
+	ThpoolSerial *serial = (ThpoolSerial *) serial_ptr;
+
+	bool done = false;
+	while (!done) {
+		ThpoolSerialJob *job = __atomic_exchange_n (&serial->jobs, NULL, __ATOMIC_ACQUIRE);
+
+		// the jobs were taken the last one first
+		ThpoolSerialJob *ordered = NULL;
+		while (job) {
+			ThpoolSerialJob *next = job->next;
+			job->next = ordered;
+			ordered = job;
+			job = next;
+		}
+
+		unsigned int count = 0;
+		while (ordered) {
+			ThpoolSerialJob *next = ordered->next;
+
+			// a job may cancel the ones that were added after it
+			if (!__atomic_load_n (&serial->cancelled, __ATOMIC_ACQUIRE)) ordered->method (ordered->args);
+			else if (ordered->discard) ordered->discard (ordered->args);
+
+			free (ordered);
+
+			ordered = next;
+			count += 1;
+		}
+
+		// a job that was counted may not have been linked yet, so the loop takes it next
+		if (count) {
+			done = !__atomic_sub_fetch (&serial->pending, count, __ATOMIC_ACQ_REL);
+		}
+
+		else {
+			sched_yield ();
+		}
+	}
+
+	// the reference that was taken when the run was scheduled
+	thpool_serial_delete (serial);
+
+}
+
+// adds a work to the serial executor, it will run in the thpool after the works that were added before
+// if the executor is cancelled before it runs, discard (if any) is called with its args instead
+// returns 0 on success, 1 on error
+int thpool_add_serial_work (
+	Thpool *thpool, ThpoolSerial *serial,
+	void (*work) (void *), void (*discard) (void *), void *args
+) {
+
+	int retval = 1;
+
+	if (thpool && serial && work) {
+		ThpoolSerialJob *job = (ThpoolSerialJob *) malloc (sizeof (ThpoolSerialJob));
+		if (job) {
+			job->method = work;
+			job->discard = discard;
+			job->args = args;
+
+			// counted before it is linked, so the running thread can't finish without it
+			bool schedule = !__atomic_fetch_add (&serial->pending, 1, __ATOMIC_ACQ_REL);
+
+			// the run keeps the executor alive even if its owner releases it in one of the jobs
+			if (schedule) __atomic_add_fetch (&serial->ref_count, 1, __ATOMIC_RELAXED);
+
+			job->next = __atomic_load_n (&serial->jobs, __ATOMIC_RELAXED);
+			while (!__atomic_compare_exchange_n (
+				&serial->jobs, &job->next, job,
+				true, __ATOMIC_RELEASE, __ATOMIC_RELAXED
+			)) {}
+
+			if (schedule) {
+				// the jobs can't be left behind, so they run in the calling thread
+				if (thpool_add_work (thpool, thpool_serial_run, serial)) {
+					thpool_serial_run (serial);
+				}
+			}
+
+			retval = 0;
+		}
+	}
+
+	return retval;
+
+}
+
 // destroys the thpool and deletes all of its data
 void thpool_destroy (Thpool *thpool) {
 
 	if (thpool) {
 		// end each thread's infinite loop
-		thpool->keep_alive = false;
+		__atomic_store_n (&thpool->keep_alive, false, __ATOMIC_RELEASE);
 
 		// give one second to kill idle threads
 		double timeout = 1.0;
 		time_t start, end;
 		double tpassed = 0.0;
 		time (&start);
-		while ((tpassed < timeout) && thpool->num_threads_alive){
-			bsem_post_all (thpool->job_queue->has_jobs);
+		while ((tpassed < timeout) && thpool_get_num_threads_alive (thpool)){
+			pthread_mutex_lock (thpool->mutex);
+			pthread_cond_broadcast (thpool->has_jobs);
+			pthread_mutex_unlock (thpool->mutex);
 			time (&end);
 			tpassed = difftime (end,start);
 		}
 
 		// poll remaining threads
-		while (thpool->num_threads_alive){
-			bsem_post_all (thpool->job_queue->has_jobs);
+		while (thpool_get_num_threads_alive (thpool)){
+			pthread_mutex_lock (thpool->mutex);
+			pthread_cond_broadcast (thpool->has_jobs);
+			pthread_mutex_unlock (thpool->mutex);
 			sleep (1);
 		}
 
+		// wait for the last thread to release the mutex
+		pthread_mutex_lock (thpool->mutex);
+		pthread_mutex_unlock (thpool->mutex);
+
 		thpool_delete (thpool);
 	}
 
 }
 
-#pragma endregion
\ No newline at end of file
+#pragma endregion
@@ -3,8 +3,14 @@
 
 #include <errno.h>
 
+#include <string.h>
+#include <unistd.h>
+
 #include <pthread.h>
+#include <sched.h>
 #include <sys/prctl.h>
+#include <sys/syscall.h>
+#include <linux/mempolicy.h>
 
 #include "cerver/types/types.h"
 
@@ -50,6 +56,157 @@ int thread_set_name (const char *name) {
 
 #pragma endregion
 
+#pragma region affinity
+
+// removes every cpu from the set
+void thread_cpu_set_zero (ThreadCpuSet *cpus) {
+
+	if (cpus) (void) memset (cpus, 0, sizeof (ThreadCpuSet));
+
+}
+
+// adds the cpu to the set
+void thread_cpu_set_add (ThreadCpuSet *cpus, unsigned int cpu) {
+
+	if (cpus && (cpu < THREAD_CPU_SET_MAX_CPUS)) {
+		cpus->bits[cpu / 64] |= ((u64) 1 << (cpu % 64));
+	}
+
+}
+
+// returns true if the cpu is in the set
+bool thread_cpu_set_has (const ThreadCpuSet *cpus, unsigned int cpu) {
+
+	bool retval = false;
+
+	if (cpus && (cpu < THREAD_CPU_SET_MAX_CPUS)) {
+		retval = (cpus->bits[cpu / 64] >> (cpu % 64)) & 1;
+	}
+
+	return retval;
+
+}
+
+// returns the number of cpus in the set
+unsigned int thread_cpu_set_count (const ThreadCpuSet *cpus) {
+
+	unsigned int count = 0;
+
+	if (cpus) {
+		for (unsigned int i = 0; i < (THREAD_CPU_SET_MAX_CPUS / 64); i++) {
+			count += (unsigned int) __builtin_popcountll (cpus->bits[i]);
+		}
+	}
+
+	return count;
+
+}
+
+// parses a cpu list like "0-7,16-23" into the set, as the ones used by the kernel & taskset
+// returns 0 on success, 1 on error
+u8 thread_cpu_set_parse (ThreadCpuSet *cpus, const char *list) {
+
+	u8 retval = 1;
+
+	if (cpus && list) {
+		thread_cpu_set_zero (cpus);
+
+		const char *ptr = list;
+		char *end = NULL;
+
+		bool valid = true;
+		while (valid && *ptr && (*ptr != '\n')) {
+			unsigned long first = strtoul (ptr, &end, 10);
+			unsigned long last = first;
+			valid = (end != ptr);
+
+			if (valid && (*end == '-')) {
+				ptr = end + 1;
+				last = strtoul (ptr, &end, 10);
+				valid = (end != ptr) && (last >= first);
+			}
+
+			if (valid) {
+				valid = (last < THREAD_CPU_SET_MAX_CPUS);
+				for (unsigned long cpu = first; valid && (cpu <= last); cpu++) {
+					thread_cpu_set_add (cpus, (unsigned int) cpu);
+				}
+
+				ptr = end;
+				if (*ptr == ',') ptr++;
+			}
+		}
+
+		if (valid) retval = 0;
+	}
+
+	return retval;
+
+}
+
+// sets the cpus of the numa node from /sys/devices/system/node
+// returns 0 on success, 1 on error
+u8 thread_cpu_set_numa_node (ThreadCpuSet *cpus, unsigned int node) {
+
+	u8 retval = 1;
+
+	if (cpus) {
+		char path[128] = { 0 };
+		(void) snprintf (path, 128, "/sys/devices/system/node/node%u/cpulist", node);
+
+		FILE *file = fopen (path, "r");
+		if (file) {
+			char list[1024] = { 0 };
+			if (fgets (list, 1024, file)) {
+				retval = thread_cpu_set_parse (cpus, list);
+			}
+
+			(void) fclose (file);
+		}
+	}
+
+	return retval;
+
+}
+
+// applies the affinity to the calling thread
+// returns 0 on success, 1 on error
+u8 thread_set_affinity (const ThreadAffinity *affinity) {
+
+	u8 retval = 1;
+
+	if (affinity) {
+		retval = 0;
+
+		if (thread_cpu_set_count (&affinity->cpus)) {
+			cpu_set_t cpus;
+			CPU_ZERO (&cpus);
+			for (unsigned int cpu = 0; (cpu < THREAD_CPU_SET_MAX_CPUS) && (cpu < CPU_SETSIZE); cpu++) {
+				if (thread_cpu_set_has (&affinity->cpus, cpu)) CPU_SET (cpu, &cpus);
+			}
+
+			if (pthread_setaffinity_np (pthread_self (), sizeof (cpu_set_t), &cpus)) {
+				cerver_log_error ("thread_set_affinity () - Failed to set the thread's cpus!");
+				retval = 1;
+			}
+		}
+
+		// the default policy already prefers the local node,
+		// but the process may have been started with another one, like numactl --interleave
+		if (affinity->numa_local) {
+			if (syscall (SYS_set_mempolicy, MPOL_LOCAL, NULL, 0)) {
+				cerver_log_error ("thread_set_affinity () - Failed to set the thread's memory policy!");
+				retval = 1;
+			}
+		}
+	}
+
+	return retval;
+
+}
+
+#pragma endregion
+
 #pragma region mutex
 
 // allocates & initializes a new mutex that should be deleted after use
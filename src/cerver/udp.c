@@ -0,0 +1,543 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+
+#include <unistd.h>
+#include <pthread.h>
+#include <poll.h>
+
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <netinet/in.h>
+
+#include "cerver/types/types.h"
+
+#include "cerver/collections/htab.h"
+
+#include "cerver/cerver.h"
+#include "cerver/client.h"
+#include "cerver/network.h"
+#include "cerver/udp.h"
+
+#include "cerver/threads/thread.h"
+
+#include "cerver/utils/log.h"
+
+#pragma region address
+
+// fills the key for the peer's address
+void cerver_udp_address_get (
+	const struct sockaddr_storage *address, CerverUdpAddress *key
+) {
+
+	memset (key, 0, sizeof (CerverUdpAddress));
+
+	key->family = (u16) address->ss_family;
+	switch (address->ss_family) {
+		case AF_INET: {
+			const struct sockaddr_in *addr = (const struct sockaddr_in *) address;
+			key->port = addr->sin_port;
+			memcpy (key->addr, &addr->sin_addr, sizeof (struct in_addr));
+		} break;
+
+		case AF_INET6: {
+			const struct sockaddr_in6 *addr = (const struct sockaddr_in6 *) address;
+			key->port = addr->sin6_port;
+			memcpy (key->addr, &addr->sin6_addr, sizeof (struct in6_addr));
+		} break;
+
+		default: break;
+	}
+
+}
+
+// returns the actual length of the address
+socklen_t cerver_udp_address_len (const struct sockaddr_storage *address) {
+
+	return (address->ss_family == AF_INET6) ?
+		sizeof (struct sockaddr_in6) : sizeof (struct sockaddr_in);
+
+}
+
+// fnv-1a over the whole key, as the generic hash only sums its bytes
+// & most of the peers share the same address bytes
+static size_t cerver_udp_address_hash (const void *key, size_t key_size, size_t table_size) {
+
+	const u8 *k = (const u8 *) key;
+
+	u64 hash = 14695981039346656037ULL;
+	for (size_t i = 0; i < key_size; i++) {
+		hash ^= k[i];
+		hash *= 1099511628211ULL;
+	}
+
+	return (size_t) (hash % table_size);
+
+}
+
+#pragma endregion
+
+#pragma region main
+
+static CerverUdp *cerver_udp_new (void) {
+
+	CerverUdp *udp = (CerverUdp *) malloc (sizeof (CerverUdp));
+	if (udp) {
+		memset (udp, 0, sizeof (CerverUdp));
+
+		udp->sock = -1;
+	}
+
+	return udp;
+
+}
+
+void cerver_udp_delete (void *udp_ptr) {
+
+	if (udp_ptr) {
+		CerverUdp *udp = (CerverUdp *) udp_ptr;
+
+		htab_destroy (udp->clients_map);
+
+		if (udp->recv_buffer) free (udp->recv_buffer);
+		if (udp->send_buffer) free (udp->send_buffer);
+
+		pthread_mutex_delete (udp->send_mutex);
+
+		free (udp);
+	}
+
+}
+
+// checks if the socket accepts segmented sends
+static bool cerver_udp_gso_init (const i32 sock) {
+
+	bool retval = false;
+
+	#ifdef CERVER_UDP_GSO_SUPPORTED
+	// the segment size is set in every send, this only checks for support
+	int segment = 0;
+	retval = !setsockopt (sock, IPPROTO_UDP, UDP_SEGMENT, &segment, sizeof (int));
+	#else
+	(void) sock;
+	#endif
+
+	return retval;
+
+}
+
+static void cerver_udp_recv_init (CerverUdp *udp) {
+
+	for (unsigned int idx = 0; idx < CERVER_UDP_BATCH_SIZE; idx++) {
+		udp->recv_iovs[idx].iov_base = udp->recv_buffer + (idx * udp->max_datagram_size);
+		udp->recv_iovs[idx].iov_len = udp->max_datagram_size;
+
+		udp->recv_msgs[idx].msg_hdr.msg_name = &udp->recv_addresses[idx];
+		udp->recv_msgs[idx].msg_hdr.msg_namelen = sizeof (struct sockaddr_storage);
+		udp->recv_msgs[idx].msg_hdr.msg_iov = &udp->recv_iovs[idx];
+		udp->recv_msgs[idx].msg_hdr.msg_iovlen = 1;
+		udp->recv_msgs[idx].msg_hdr.msg_control = NULL;
+		udp->recv_msgs[idx].msg_hdr.msg_controllen = 0;
+		udp->recv_msgs[idx].msg_hdr.msg_flags = 0;
+		udp->recv_msgs[idx].msg_len = 0;
+	}
+
+}
+
+// sets up the udp structures for the cerver's socket
+// returns NULL on error
+CerverUdp *cerver_udp_create (Cerver *cerver) {
+
+	CerverUdp *udp = cerver_udp_new ();
+	if (udp) {
+		udp->cerver = cerver;
+		udp->sock = cerver->sock;
+		udp->gso = cerver_udp_gso_init (cerver->sock);
+
+		udp->clients_map = htab_create (CERVER_UDP_CLIENTS_MAP_SIZE, cerver_udp_address_hash, NULL);
+
+		// a datagram is never split between reads, so each slot must fit the biggest one
+		udp->max_datagram_size = MAX_UDP_PACKET_SIZE;
+		udp->recv_buffer = (char *) malloc (CERVER_UDP_BATCH_SIZE * udp->max_datagram_size);
+
+		udp->send_mutex = pthread_mutex_new ();
+		udp->send_buffer = (char *) malloc (CERVER_UDP_SEND_BUFFER_SIZE);
+
+		if (udp->clients_map && udp->recv_buffer && udp->send_mutex && udp->send_buffer) {
+			cerver_udp_recv_init (udp);
+
+			#ifdef CERVER_DEBUG
+			cerver_log (
+				LOG_TYPE_DEBUG, LOG_TYPE_CERVER,
+				"Cerver %s udp socket - gso is %s",
+				cerver->info->name->str, udp->gso ? "enabled" : "NOT available"
+			);
+			#endif
+		}
+
+		else {
+			cerver_log_error (
+				"Failed to create cerver %s udp structures!",
+				cerver->info->name->str
+			);
+
+			cerver_udp_delete (udp);
+			udp = NULL;
+		}
+	}
+
+	return udp;
+
+}
+
+#pragma endregion
+
+#pragma region clients
+
+// gets the client that is mapped to the peer's address
+// returns NULL if the address is unknown
+Client *cerver_udp_client_get (
+	CerverUdp *udp, const struct sockaddr_storage *address
+) {
+
+	CerverUdpAddress key = { 0 };
+	cerver_udp_address_get (address, &key);
+
+	return (Client *) htab_get (udp->clients_map, &key, sizeof (CerverUdpAddress));
+
+}
+
+// maps the peer's address to the client
+// returns 0 on success, 1 on error
+u8 cerver_udp_client_register (
+	CerverUdp *udp, Client *client, const struct sockaddr_storage *address
+) {
+
+	CerverUdpAddress key = { 0 };
+	cerver_udp_address_get (address, &key);
+
+	return (u8) htab_insert (
+		udp->clients_map,
+		&key, sizeof (CerverUdpAddress),
+		client, sizeof (Client)
+	);
+
+}
+
+// removes the peer's address from the clients map
+// returns 0 on success, 1 on error
+u8 cerver_udp_client_unregister (
+	CerverUdp *udp, const struct sockaddr_storage *address
+) {
+
+	CerverUdpAddress key = { 0 };
+	cerver_udp_address_get (address, &key);
+
+	return htab_remove (udp->clients_map, &key, sizeof (CerverUdpAddress)) ? 0 : 1;
+
+}
+
+// gets up to max_clients clients that have not been active since the threshold time
+// returns the n of clients that were placed in the clients array
+size_t cerver_udp_clients_get_idle (
+	CerverUdp *udp, const time_t threshold,
+	Client **clients, const size_t max_clients
+) {
+
+	size_t n_clients = 0;
+
+	pthread_mutex_lock (udp->clients_map->mutex);
+
+	HtabNode *node = NULL;
+	for (size_t idx = 0; (idx < udp->clients_map->size) && (n_clients < max_clients); idx++) {
+		node = udp->clients_map->table[idx]->start;
+		while (node && (n_clients < max_clients)) {
+			if (((Client *) node->val)->last_activity < threshold) {
+				clients[n_clients] = (Client *) node->val;
+				n_clients += 1;
+			}
+
+			node = node->next;
+		}
+	}
+
+	pthread_mutex_unlock (udp->clients_map->mutex);
+
+	return n_clients;
+
+}
+
+#pragma endregion
+
+#pragma region send
+
+// the n of pending datagrams starting at start that can be sent as a single segmented send
+// every segment must have the same size & go to the same peer, only the last one can be smaller
+static unsigned int cerver_udp_gso_run (
+	const CerverUdp *udp, const unsigned int start, size_t *run_size
+) {
+
+	const CerverUdpPending *first = &udp->pending[start];
+
+	unsigned int n = 1;
+	size_t size = first->size;
+	if (udp->gso && (first->size <= CERVER_UDP_MAX_SEGMENT_SIZE)) {
+		const CerverUdpPending *next = NULL;
+		while (
+			((start + n) < udp->n_pending)
+			&& (n < CERVER_UDP_MAX_SEGMENTS)
+		) {
+			next = &udp->pending[start + n];
+
+			if (
+				(next->size > first->size)
+				|| ((size + next->size) > MAX_UDP_PACKET_SIZE)
+				|| (next->address_len != first->address_len)
+				|| memcmp (&next->address, &first->address, first->address_len)
+			) break;
+
+			size += next->size;
+			n += 1;
+
+			// a smaller segment ends the run
+			if (next->size < first->size) break;
+		}
+	}
+
+	*run_size = size;
+
+	return n;
+
+}
+
+// sends the pending datagrams with as few sendmmsg () calls as possible
+// returns 0 on success, 1 if any datagram failed to be sent
+static u8 cerver_udp_flush (CerverUdp *udp) {
+
+	u8 errors = 0;
+
+	struct mmsghdr msgs[CERVER_UDP_BATCH_SIZE];
+	struct iovec iovs[CERVER_UDP_BATCH_SIZE];
+	unsigned int firsts[CERVER_UDP_BATCH_SIZE];
+
+	#ifdef CERVER_UDP_GSO_SUPPORTED
+	char control[CERVER_UDP_BATCH_SIZE][CMSG_SPACE (sizeof (u16))];
+	#endif
+
+	unsigned int n_msgs = 0;
+	unsigned int idx = 0;
+	unsigned int n = 0;
+	size_t run_size = 0;
+	while (idx < udp->n_pending) {
+		n = cerver_udp_gso_run (udp, idx, &run_size);
+
+		firsts[n_msgs] = idx;
+
+		iovs[n_msgs].iov_base = udp->send_buffer + udp->pending[idx].offset;
+		iovs[n_msgs].iov_len = run_size;
+
+		memset (&msgs[n_msgs], 0, sizeof (struct mmsghdr));
+		msgs[n_msgs].msg_hdr.msg_name = &udp->pending[idx].address;
+		msgs[n_msgs].msg_hdr.msg_namelen = udp->pending[idx].address_len;
+		msgs[n_msgs].msg_hdr.msg_iov = &iovs[n_msgs];
+		msgs[n_msgs].msg_hdr.msg_iovlen = 1;
+
+		#ifdef CERVER_UDP_GSO_SUPPORTED
+		if (n > 1) {
+			msgs[n_msgs].msg_hdr.msg_control = control[n_msgs];
+			msgs[n_msgs].msg_hdr.msg_controllen = CMSG_SPACE (sizeof (u16));
+
+			struct cmsghdr *cmsg = CMSG_FIRSTHDR (&msgs[n_msgs].msg_hdr);
+			cmsg->cmsg_level = IPPROTO_UDP;
+			cmsg->cmsg_type = UDP_SEGMENT;
+			cmsg->cmsg_len = CMSG_LEN (sizeof (u16));
+
+			u16 segment_size = (u16) udp->pending[idx].size;
+			memcpy (CMSG_DATA (cmsg), &segment_size, sizeof (u16));
+		}
+		#endif
+
+		n_msgs += 1;
+		idx += n;
+	}
+
+	unsigned int sent = 0;
+	int rc = 0;
+	while (sent < n_msgs) {
+		rc = sendmmsg (udp->sock, &msgs[sent], n_msgs - sent, 0);
+		if (rc > 0) {
+			sent += (unsigned int) rc;
+			continue;
+		}
+
+		if (sock_can_retry (udp->sock, POLLOUT)) continue;
+
+		// the device may not support segmentation offload,
+		// so the pending datagrams are sent again one by one
+		if (
+			udp->gso && (msgs[sent].msg_hdr.msg_controllen > 0)
+			&& ((errno == EIO) || (errno == EINVAL))
+		) {
+			cerver_log_warning (
+				"Cerver %s udp socket - gso has failed, it will be disabled",
+				udp->cerver->info->name->str
+			);
+
+			udp->gso = false;
+
+			unsigned int first = firsts[sent];
+			memmove (udp->pending, &udp->pending[first], (udp->n_pending - first) * sizeof (CerverUdpPending));
+			udp->n_pending -= first;
+
+			return errors | cerver_udp_flush (udp);
+		}
+
+		#ifdef CERVER_DEBUG
+		perror ("cerver_udp_flush () - sendmmsg () has failed");
+		#endif
+
+		// drop the datagram that failed & keep sending the others
+		errors = 1;
+		sent += 1;
+	}
+
+	udp->send_buffer_used = 0;
+	udp->n_pending = 0;
+
+	return errors;
+
+}
+
+static u8 cerver_udp_send_actual (
+	CerverUdp *udp, const struct sockaddr_storage *address,
+	const struct iovec *iov, int iovcnt,
+	size_t *total_sent
+) {
+
+	u8 retval = 1;
+
+	struct msghdr msg = { 0 };
+	msg.msg_name = (void *) address;
+	msg.msg_namelen = cerver_udp_address_len (address);
+	msg.msg_iov = (struct iovec *) iov;
+	msg.msg_iovlen = (size_t) iovcnt;
+
+	ssize_t sent = 0;
+	do {
+		sent = sendmsg (udp->sock, &msg, 0);
+	} while ((sent < 0) && sock_can_retry (udp->sock, POLLOUT));
+
+	if (sent >= 0) {
+		*total_sent = (size_t) sent;
+		retval = 0;
+	}
+
+	return retval;
+
+}
+
+// copies the datagram into the send buffer
+static void cerver_udp_push (
+	CerverUdp *udp, const struct sockaddr_storage *address,
+	const struct iovec *iov, int iovcnt, size_t size
+) {
+
+	CerverUdpPending *pending = &udp->pending[udp->n_pending];
+
+	pending->address_len = cerver_udp_address_len (address);
+	memcpy (&pending->address, address, pending->address_len);
+	pending->offset = udp->send_buffer_used;
+	pending->size = size;
+
+	for (int idx = 0; idx < iovcnt; idx++) {
+		memcpy (udp->send_buffer + udp->send_buffer_used, iov[idx].iov_base, iov[idx].iov_len);
+		udp->send_buffer_used += iov[idx].iov_len;
+	}
+
+	udp->n_pending += 1;
+
+}
+
+// sends the iovec buffers as a single datagram to the address
+// if the udp is corked, the datagram is copied & sent with the other pending ones
+// returns 0 on success, 1 on error
+u8 cerver_udp_send (
+	CerverUdp *udp, const struct sockaddr_storage *address,
+	const struct iovec *iov, int iovcnt,
+	size_t *total_sent
+) {
+
+	u8 retval = 1;
+
+	if (udp && address && iov) {
+		size_t size = 0;
+		for (int idx = 0; idx < iovcnt; idx++) size += iov[idx].iov_len;
+
+		size_t sent = 0;
+		if (size <= MAX_UDP_PACKET_SIZE) {
+			pthread_mutex_lock (udp->send_mutex);
+
+			if (udp->corked) {
+				if (
+					(udp->n_pending == CERVER_UDP_BATCH_SIZE)
+					|| ((udp->send_buffer_used + size) > CERVER_UDP_SEND_BUFFER_SIZE)
+				) {
+					(void) cerver_udp_flush (udp);
+				}
+
+				cerver_udp_push (udp, address, iov, iovcnt, size);
+
+				sent = size;
+				retval = 0;
+			}
+
+			else {
+				retval = cerver_udp_send_actual (udp, address, iov, iovcnt, &sent);
+			}
+
+			pthread_mutex_unlock (udp->send_mutex);
+		}
+
+		if (total_sent) *total_sent = sent;
+	}
+
+	return retval;
+
+}
+
+// starts keeping the datagrams that are sent to be sent together with sendmmsg ()
+// nested calls are allowed, they are sent after the last cerver_udp_uncork ()
+void cerver_udp_cork (CerverUdp *udp) {
+
+	if (udp) {
+		pthread_mutex_lock (udp->send_mutex);
+		udp->corked += 1;
+		pthread_mutex_unlock (udp->send_mutex);
+	}
+
+}
+
+// sends every pending datagram with as few sendmmsg () calls as possible
+// returns 0 on success, 1 if any datagram failed to be sent
+u8 cerver_udp_uncork (CerverUdp *udp) {
+
+	u8 retval = 1;
+
+	if (udp) {
+		pthread_mutex_lock (udp->send_mutex);
+
+		retval = 0;
+		if (udp->corked) {
+			udp->corked -= 1;
+			if (!udp->corked && udp->n_pending) retval = cerver_udp_flush (udp);
+		}
+
+		pthread_mutex_unlock (udp->send_mutex);
+	}
+
+	return retval;
+
+}
+
+#pragma endregion
@@ -0,0 +1,886 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdbool.h>
+
+#include <errno.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+
+#include "cerver/types/types.h"
+
+#include "cerver/uring.h"
+
+#include "cerver/threads/thread.h"
+
+#include "cerver/utils/log.h"
+
+#ifdef CERVER_URING_SUPPORTED
+
+#define CERVER_URING_PROBE_ENTRIES			4			// n of sqes of the ring used to probe for support
+#define CERVER_URING_DEFAULT_SENDS			64			// initial n of slots for the sends data
+
+// the ops that the cerver uses, multishot recv can't be probed
+// so it is still required at compile time in the headers
+static const u8 cerver_uring_required_ops[] = {
+	IORING_OP_ACCEPT, IORING_OP_RECV, IORING_OP_SEND, IORING_OP_ASYNC_CANCEL
+};
+
+// at most this fraction of the provided buffers can be held outside the ring
+#define CERVER_URING_HELD_BUFFERS_DIV			2
+
+struct _CerverUring {
+
+	int ring_fd;
+
+	// submission queue
+	void *sq_ptr;
+	size_t sq_ptr_size;
+	unsigned int *sq_head;
+	unsigned int *sq_tail;
+	unsigned int *sq_mask;
+	unsigned int *sq_array;
+	struct io_uring_sqe *sqes;
+	size_t sqes_size;
+	unsigned int sq_entries;
+	unsigned int sq_pending;            // sqes that have been queued but not submitted
+
+	// completion queue
+	void *cq_ptr;
+	size_t cq_ptr_size;
+	unsigned int *cq_head;
+	unsigned int *cq_tail;
+	unsigned int *cq_mask;
+	struct io_uring_cqe *cqes;
+
+	// provided buffers ring
+	struct io_uring_buf_ring *buf_ring;
+	size_t buf_ring_size;
+	char *buffers;
+	unsigned int n_buffers;
+	size_t buffer_size;
+	unsigned int n_held;                // buffers that are referenced outside the ring
+
+	// held buffers are released from any thread
+	pthread_mutex_t *buf_lock;
+
+	// the data of the sends that have not been completed, indexed by their slot
+	void **sends;
+	u32 *free_sends;
+	u32 n_sends;
+	u32 n_free_sends;
+
+	// the thread that waits for the completions
+	pthread_t waiter;
+	bool has_waiter;
+
+	// sqes can be queued from other threads, like when registering
+	// an authenticated connection, so we need to serialize them
+	pthread_mutex_t *sq_lock;
+
+	// the provided buffers are kept until the ring & every held buffer release them
+	unsigned int ref_count;
+
+	u32 generation;                     // last one given to a connection
+
+};
+
+static int cerver_uring_setup (unsigned int entries, struct io_uring_params *params) {
+
+	return (int) syscall (__NR_io_uring_setup, entries, params);
+
+}
+
+static int cerver_uring_enter (
+	int ring_fd, unsigned int to_submit, unsigned int min_complete,
+	unsigned int flags, void *arg, size_t arg_size
+) {
+
+	return (int) syscall (__NR_io_uring_enter, ring_fd, to_submit, min_complete, flags, arg, arg_size);
+
+}
+
+static int cerver_uring_register (int ring_fd, unsigned int opcode, void *arg, unsigned int n_args) {
+
+	return (int) syscall (__NR_io_uring_register, ring_fd, opcode, arg, n_args);
+
+}
+
+// we need to map both queues at once & to be able to wait with a timeout
+static inline bool cerver_uring_features_supported (const struct io_uring_params *params) {
+
+	return (params->features & IORING_FEAT_SINGLE_MMAP) && (params->features & IORING_FEAT_EXT_ARG);
+
+}
+
+// asks the kernel which ops the ring supports
+// returns true if all the required ops are supported
+static bool cerver_uring_probe_ops (const int ring_fd) {
+
+	bool retval = false;
+
+	size_t probe_size = sizeof (struct io_uring_probe) + (IORING_OP_LAST * sizeof (struct io_uring_probe_op));
+	struct io_uring_probe *probe = (struct io_uring_probe *) calloc (1, probe_size);
+	if (probe) {
+		if (!cerver_uring_register (ring_fd, IORING_REGISTER_PROBE, probe, IORING_OP_LAST)) {
+			retval = true;
+
+			u8 op = 0;
+			for (size_t i = 0; i < sizeof (cerver_uring_required_ops); i++) {
+				op = cerver_uring_required_ops[i];
+				if ((op > probe->last_op) || !(probe->ops[op].flags & IO_URING_OP_SUPPORTED)) {
+					retval = false;
+					break;
+				}
+			}
+		}
+
+		free (probe);
+	}
+
+	return retval;
+
+}
+
+// registers & unregisters a provided buffers ring of a single entry
+// returns true if the kernel supports provided buffers rings
+static bool cerver_uring_probe_buffers (const int ring_fd) {
+
+	bool retval = false;
+
+	size_t ring_size = sizeof (struct io_uring_buf);
+	void *ring = mmap (
+		NULL, ring_size,
+		PROT_READ | PROT_WRITE, MAP_ANONYMOUS | MAP_PRIVATE,
+		-1, 0
+	);
+
+	if (ring != MAP_FAILED) {
+		struct io_uring_buf_reg reg = { 0 };
+		reg.ring_addr = (u64) (uintptr_t) ring;
+		reg.ring_entries = 1;
+		reg.bgid = CERVER_URING_BUFFER_GROUP;
+
+		if (!cerver_uring_register (ring_fd, IORING_REGISTER_PBUF_RING, &reg, 1)) {
+			(void) cerver_uring_register (ring_fd, IORING_UNREGISTER_PBUF_RING, &reg, 1);
+
+			retval = true;
+		}
+
+		munmap (ring, ring_size);
+	}
+
+	return retval;
+
+}
+
+// returns true if the running kernel supports all the io_uring features that we need,
+// a small ring is set up to probe for the ops & for the provided buffers ring registration
+bool cerver_uring_is_supported (void) {
+
+	bool retval = false;
+
+	struct io_uring_params params = { 0 };
+	int ring_fd = cerver_uring_setup (CERVER_URING_PROBE_ENTRIES, &params);
+	if (ring_fd > -1) {
+		retval = cerver_uring_features_supported (&params)
+			&& cerver_uring_probe_ops (ring_fd)
+			&& cerver_uring_probe_buffers (ring_fd);
+
+		close (ring_fd);
+	}
+
+	return retval;
+
+}
+
+static CerverUring *cerver_uring_new (void) {
+
+	CerverUring *uring = (CerverUring *) malloc (sizeof (CerverUring));
+	if (uring) {
+		memset (uring, 0, sizeof (CerverUring));
+
+		uring->ring_fd = -1;
+
+		uring->sq_ptr = MAP_FAILED;
+		uring->cq_ptr = MAP_FAILED;
+		uring->sqes = MAP_FAILED;
+		uring->buf_ring = MAP_FAILED;
+
+		uring->buf_lock = NULL;
+
+		uring->sends = NULL;
+		uring->free_sends = NULL;
+
+		uring->has_waiter = false;
+
+		uring->sq_lock = NULL;
+
+		uring->ref_count = 1;
+
+		uring->generation = 0;
+	}
+
+	return uring;
+
+}
+
+// removes a reference from the ring, the provided buffers are freed with the last one
+static void cerver_uring_unref (CerverUring *uring) {
+
+	if (!__atomic_sub_fetch (&uring->ref_count, 1, __ATOMIC_ACQ_REL)) {
+		if (uring->buf_ring != MAP_FAILED) munmap (uring->buf_ring, uring->buf_ring_size);
+		if (uring->buffers) free (uring->buffers);
+
+		pthread_mutex_delete (uring->buf_lock);
+
+		free (uring);
+	}
+
+}
+
+// closes the ring, the provided buffers are kept until the ones that are being held are released
+void cerver_uring_delete (void *uring_ptr) {
+
+	if (uring_ptr) {
+		CerverUring *uring = (CerverUring *) uring_ptr;
+
+		if (uring->sqes != MAP_FAILED) munmap (uring->sqes, uring->sqes_size);
+		if ((uring->cq_ptr != MAP_FAILED) && (uring->cq_ptr != uring->sq_ptr))
+			munmap (uring->cq_ptr, uring->cq_ptr_size);
+
+		if (uring->sq_ptr != MAP_FAILED) munmap (uring->sq_ptr, uring->sq_ptr_size);
+
+		if (uring->ring_fd > -1) close (uring->ring_fd);
+
+		pthread_mutex_delete (uring->sq_lock);
+		uring->sq_lock = NULL;
+
+		if (uring->sends) free (uring->sends);
+		if (uring->free_sends) free (uring->free_sends);
+
+		cerver_uring_unref (uring);
+	}
+
+}
+
+// maps the submission & completion queues to our memory
+static u8 cerver_uring_create_map (CerverUring *uring, struct io_uring_params *params) {
+
+	u8 retval = 1;
+
+	uring->sq_ptr_size = params->sq_off.array + params->sq_entries * sizeof (unsigned int);
+	uring->cq_ptr_size = params->cq_off.cqes + params->cq_entries * sizeof (struct io_uring_cqe);
+
+	// both queues can be mapped with a single call
+	if (uring->cq_ptr_size > uring->sq_ptr_size) uring->sq_ptr_size = uring->cq_ptr_size;
+	uring->cq_ptr_size = uring->sq_ptr_size;
+
+	uring->sq_ptr = mmap (
+		NULL, uring->sq_ptr_size,
+		PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+		uring->ring_fd, IORING_OFF_SQ_RING
+	);
+
+	if (uring->sq_ptr != MAP_FAILED) {
+		uring->cq_ptr = uring->sq_ptr;
+
+		uring->sqes_size = params->sq_entries * sizeof (struct io_uring_sqe);
+		uring->sqes = (struct io_uring_sqe *) mmap (
+			NULL, uring->sqes_size,
+			PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+			uring->ring_fd, IORING_OFF_SQES
+		);
+
+		if (uring->sqes != MAP_FAILED) {
+			char *sq = (char *) uring->sq_ptr;
+			uring->sq_head = (unsigned int *) (sq + params->sq_off.head);
+			uring->sq_tail = (unsigned int *) (sq + params->sq_off.tail);
+			uring->sq_mask = (unsigned int *) (sq + params->sq_off.ring_mask);
+			uring->sq_array = (unsigned int *) (sq + params->sq_off.array);
+			uring->sq_entries = params->sq_entries;
+
+			char *cq = (char *) uring->cq_ptr;
+			uring->cq_head = (unsigned int *) (cq + params->cq_off.head);
+			uring->cq_tail = (unsigned int *) (cq + params->cq_off.tail);
+			uring->cq_mask = (unsigned int *) (cq + params->cq_off.ring_mask);
+			uring->cqes = (struct io_uring_cqe *) (cq + params->cq_off.cqes);
+
+			retval = 0;
+		}
+	}
+
+	return retval;
+
+}
+
+// adds the buffer at the end of the provided buffers ring, the buf lock must be held
+static void cerver_uring_buffer_recycle_internal (CerverUring *uring, const u16 buffer_id) {
+
+	unsigned short tail = uring->buf_ring->tail;
+	struct io_uring_buf *buf = &uring->buf_ring->bufs[tail & (uring->n_buffers - 1)];
+	buf->addr = (u64) (uintptr_t) (uring->buffers + (buffer_id * uring->buffer_size));
+	buf->len = (u32) uring->buffer_size;
+	buf->bid = buffer_id;
+
+	__atomic_store_n (&uring->buf_ring->tail, (unsigned short) (tail + 1), __ATOMIC_RELEASE);
+
+}
+
+// allocates the receive buffers and registers them as the provided buffers ring
+static u8 cerver_uring_create_buffers (CerverUring *uring, const unsigned int n_buffers, const size_t buffer_size) {
+
+	u8 retval = 1;
+
+	uring->n_buffers = n_buffers;
+	uring->buffer_size = buffer_size;
+
+	uring->buf_ring_size = n_buffers * sizeof (struct io_uring_buf);
+	uring->buf_ring = (struct io_uring_buf_ring *) mmap (
+		NULL, uring->buf_ring_size,
+		PROT_READ | PROT_WRITE, MAP_ANONYMOUS | MAP_PRIVATE,
+		-1, 0
+	);
+
+	if (uring->buf_ring != MAP_FAILED) {
+		uring->buf_lock = pthread_mutex_new ();
+		uring->buffers = (char *) malloc (n_buffers * buffer_size);
+		if (uring->buf_lock && uring->buffers) {
+			struct io_uring_buf_reg reg = { 0 };
+			reg.ring_addr = (u64) (uintptr_t) uring->buf_ring;
+			reg.ring_entries = n_buffers;
+			reg.bgid = CERVER_URING_BUFFER_GROUP;
+
+			if (!cerver_uring_register (uring->ring_fd, IORING_REGISTER_PBUF_RING, &reg, 1)) {
+				uring->buf_ring->tail = 0;
+				for (unsigned int i = 0; i < n_buffers; i++)
+					cerver_uring_buffer_recycle_internal (uring, (u16) i);
+
+				retval = 0;
+			}
+		}
+	}
+
+	return retval;
+
+}
+
+// sets up a new ring with a provided buffers ring of n_buffers, each one of buffer_size bytes
+// returns NULL if io_uring is not supported or if we failed to set it up
+CerverUring *cerver_uring_create (
+	const unsigned int entries,
+	const unsigned int n_buffers, const size_t buffer_size
+) {
+
+	CerverUring *uring = NULL;
+
+	if (cerver_uring_is_supported () && n_buffers && !(n_buffers & (n_buffers - 1))) {
+		uring = cerver_uring_new ();
+		if (uring) {
+			u8 errors = 1;
+
+			struct io_uring_params params = { 0 };
+			uring->ring_fd = cerver_uring_setup (entries, &params);
+			if (uring->ring_fd > -1) {
+				if (cerver_uring_features_supported (&params)) {
+					if (!cerver_uring_create_map (uring, &params)) {
+						if (!cerver_uring_create_buffers (uring, n_buffers, buffer_size)) {
+							uring->sq_lock = pthread_mutex_new ();
+
+							errors = 0;
+						}
+					}
+				}
+			}
+
+			if (errors) {
+				cerver_uring_delete (uring);
+				uring = NULL;
+			}
+		}
+	}
+
+	return uring;
+
+}
+
+// gets the next free sqe, the sq lock must be held
+// returns NULL if the submission queue is full
+static struct io_uring_sqe *cerver_uring_get_sqe (CerverUring *uring) {
+
+	struct io_uring_sqe *sqe = NULL;
+
+	unsigned int head = __atomic_load_n (uring->sq_head, __ATOMIC_ACQUIRE);
+	unsigned int tail = *uring->sq_tail;
+	if ((tail - head) < uring->sq_entries) {
+		unsigned int idx = tail & *uring->sq_mask;
+		sqe = &uring->sqes[idx];
+		memset (sqe, 0, sizeof (struct io_uring_sqe));
+
+		uring->sq_array[idx] = idx;
+		__atomic_store_n (uring->sq_tail, tail + 1, __ATOMIC_RELEASE);
+		uring->sq_pending += 1;
+	}
+
+	return sqe;
+
+}
+
+// submits the pending sqes, the sq lock must be held
+static u8 cerver_uring_submit_internal (CerverUring *uring) {
+
+	u8 retval = 0;
+
+	while (uring->sq_pending) {
+		int submitted = cerver_uring_enter (uring->ring_fd, uring->sq_pending, 0, 0, NULL, 0);
+		if (submitted > 0) uring->sq_pending -= (unsigned int) submitted;
+
+		else if ((submitted < 0) && (errno == EINTR)) continue;
+
+		else {
+			retval = 1;
+			break;
+		}
+	}
+
+	return retval;
+
+}
+
+// gets an sqe, if the queue is full, submit what we have to make some room
+static struct io_uring_sqe *cerver_uring_get_sqe_or_submit (CerverUring *uring) {
+
+	struct io_uring_sqe *sqe = cerver_uring_get_sqe (uring);
+	if (!sqe) {
+		if (!cerver_uring_submit_internal (uring))
+			sqe = cerver_uring_get_sqe (uring);
+	}
+
+	return sqe;
+
+}
+
+// arms a multishot accept in the listening socket
+// returns 0 on success, 1 on error
+u8 cerver_uring_accept (CerverUring *uring, const i32 sock_fd) {
+
+	u8 retval = 1;
+
+	if (uring) {
+		pthread_mutex_lock (uring->sq_lock);
+
+		struct io_uring_sqe *sqe = cerver_uring_get_sqe_or_submit (uring);
+		if (sqe) {
+			sqe->opcode = IORING_OP_ACCEPT;
+			sqe->fd = sock_fd;
+			sqe->ioprio = IORING_ACCEPT_MULTISHOT;
+			sqe->accept_flags = SOCK_NONBLOCK | SOCK_CLOEXEC;
+			sqe->user_data = cerver_uring_user_data (CERVER_URING_OP_ACCEPT, 0, sock_fd);
+
+			retval = 0;
+		}
+
+		pthread_mutex_unlock (uring->sq_lock);
+	}
+
+	return retval;
+
+}
+
+// returns a new generation to tag the requests of a connection with,
+// 0 is skipped as it is used by the requests that don't belong to one
+u32 cerver_uring_generation_next (CerverUring *uring) {
+
+	u32 generation = 0;
+
+	if (uring) {
+		do {
+			generation = __atomic_add_fetch (&uring->generation, 1, __ATOMIC_RELAXED) & CERVER_URING_GENERATION_MASK;
+		} while (!generation);
+	}
+
+	return generation;
+
+}
+
+// arms a multishot recv that will pick buffers from the ring provided buffers
+// returns 0 on success, 1 on error
+u8 cerver_uring_recv (CerverUring *uring, const i32 sock_fd, const u32 generation) {
+
+	u8 retval = 1;
+
+	if (uring) {
+		pthread_mutex_lock (uring->sq_lock);
+
+		struct io_uring_sqe *sqe = cerver_uring_get_sqe_or_submit (uring);
+		if (sqe) {
+			sqe->opcode = IORING_OP_RECV;
+			sqe->fd = sock_fd;
+			sqe->ioprio = IORING_RECV_MULTISHOT;
+			sqe->flags = IOSQE_BUFFER_SELECT;
+			sqe->buf_group = CERVER_URING_BUFFER_GROUP;
+			sqe->user_data = cerver_uring_user_data (CERVER_URING_OP_RECV, generation, sock_fd);
+
+			retval = 0;
+		}
+
+		pthread_mutex_unlock (uring->sq_lock);
+	}
+
+	return retval;
+
+}
+
+// cancels the multishot recv of the sock fd, any other request is kept
+// returns 0 on success, 1 on error
+u8 cerver_uring_cancel_recv (CerverUring *uring, const i32 sock_fd, const u32 generation) {
+
+	u8 retval = 1;
+
+	if (uring) {
+		pthread_mutex_lock (uring->sq_lock);
+
+		struct io_uring_sqe *sqe = cerver_uring_get_sqe_or_submit (uring);
+		if (sqe) {
+			sqe->opcode = IORING_OP_ASYNC_CANCEL;
+			sqe->addr = cerver_uring_user_data (CERVER_URING_OP_RECV, generation, sock_fd);
+			sqe->user_data = cerver_uring_user_data (CERVER_URING_OP_CANCEL, generation, sock_fd);
+
+			retval = 0;
+		}
+
+		pthread_mutex_unlock (uring->sq_lock);
+	}
+
+	return retval;
+
+}
+
+// gets a free slot to keep the send's data until it is completed, the sq lock must be held
+// returns 0 on success, 1 on error
+static u8 cerver_uring_send_slot_get (CerverUring *uring, void *data, u32 *slot) {
+
+	u8 retval = 1;
+
+	if (!uring->n_free_sends) {
+		u32 n_sends = uring->n_sends ? uring->n_sends * 2 : CERVER_URING_DEFAULT_SENDS;
+
+		void **sends = (void **) realloc (uring->sends, n_sends * sizeof (void *));
+		if (sends) uring->sends = sends;
+
+		u32 *free_sends = (u32 *) realloc (uring->free_sends, n_sends * sizeof (u32));
+		if (free_sends) uring->free_sends = free_sends;
+
+		if (sends && free_sends) {
+			for (u32 i = uring->n_sends; i < n_sends; i++)
+				uring->free_sends[uring->n_free_sends++] = i;
+
+			uring->n_sends = n_sends;
+		}
+	}
+
+	if (uring->n_free_sends) {
+		*slot = uring->free_sends[--uring->n_free_sends];
+		uring->sends[*slot] = data;
+
+		retval = 0;
+	}
+
+	return retval;
+
+}
+
+// queues a send of the buffer to the sock fd, data is returned with its completion,
+// sends that are queued from the thread that waits for the completions are submitted
+// all at once with the next wait, any other one is submitted right away
+// returns 0 on success, 1 on error
+u8 cerver_uring_send (
+	CerverUring *uring, const i32 sock_fd,
+	const char *buffer, const size_t size,
+	void *data
+) {
+
+	u8 retval = 1;
+
+	if (uring && buffer) {
+		pthread_mutex_lock (uring->sq_lock);
+
+		u32 slot = 0;
+		if (!cerver_uring_send_slot_get (uring, data, &slot)) {
+			struct io_uring_sqe *sqe = cerver_uring_get_sqe_or_submit (uring);
+			if (sqe) {
+				sqe->opcode = IORING_OP_SEND;
+				sqe->fd = sock_fd;
+				sqe->addr = (u64) (uintptr_t) buffer;
+				// bigger sends are completed partially & the rest is queued again
+				sqe->len = (size > INT32_MAX) ? INT32_MAX : (u32) size;
+				sqe->msg_flags = MSG_NOSIGNAL;
+				sqe->user_data = cerver_uring_user_data (CERVER_URING_OP_SEND, 0, slot);
+
+				// if it fails, the sqe is still submitted with the next wait
+				if (!(uring->has_waiter && pthread_equal (uring->waiter, pthread_self ())))
+					(void) cerver_uring_submit_internal (uring);
+
+				retval = 0;
+			}
+
+			else {
+				uring->free_sends[uring->n_free_sends++] = slot;
+			}
+		}
+
+		pthread_mutex_unlock (uring->sq_lock);
+	}
+
+	return retval;
+
+}
+
+// cancels any pending request for the sock fd
+// returns 0 on success, 1 on error
+u8 cerver_uring_cancel (CerverUring *uring, const i32 sock_fd) {
+
+	u8 retval = 1;
+
+	if (uring) {
+		pthread_mutex_lock (uring->sq_lock);
+
+		struct io_uring_sqe *sqe = cerver_uring_get_sqe_or_submit (uring);
+		if (sqe) {
+			sqe->opcode = IORING_OP_ASYNC_CANCEL;
+			sqe->fd = sock_fd;
+			sqe->cancel_flags = IORING_ASYNC_CANCEL_FD | IORING_ASYNC_CANCEL_ALL;
+			sqe->user_data = cerver_uring_user_data (CERVER_URING_OP_CANCEL, 0, sock_fd);
+
+			// the request must reach the kernel before the sock fd gets closed
+			retval = cerver_uring_submit_internal (uring);
+		}
+
+		pthread_mutex_unlock (uring->sq_lock);
+	}
+
+	return retval;
+
+}
+
+// submits all the queued requests to the kernel in a single call
+// returns 0 on success, 1 on error
+u8 cerver_uring_submit (CerverUring *uring) {
+
+	u8 retval = 1;
+
+	if (uring) {
+		pthread_mutex_lock (uring->sq_lock);
+		retval = cerver_uring_submit_internal (uring);
+		pthread_mutex_unlock (uring->sq_lock);
+	}
+
+	return retval;
+
+}
+
+// submits any queued request and waits for at least one completion or until the timeout (in ms)
+// then copies up to max_completions into the completions array
+// returns the number of completions, -1 on error
+int cerver_uring_wait (
+	CerverUring *uring,
+	CerverUringCompletion *completions, const unsigned int max_completions,
+	const u32 timeout
+) {
+
+	int retval = -1;
+
+	if (uring && completions) {
+		pthread_mutex_lock (uring->sq_lock);
+
+		// the sends that are queued from this thread are left for the next wait
+		uring->waiter = pthread_self ();
+		uring->has_waiter = true;
+
+		u8 errors = cerver_uring_submit_internal (uring);
+
+		pthread_mutex_unlock (uring->sq_lock);
+
+		if (!errors) {
+			unsigned int head = *uring->cq_head;
+			if (head == __atomic_load_n (uring->cq_tail, __ATOMIC_ACQUIRE)) {
+				struct __kernel_timespec ts = { 0 };
+				ts.tv_sec = timeout / 1000;
+				ts.tv_nsec = (timeout % 1000) * 1000000;
+
+				struct io_uring_getevents_arg arg = { 0 };
+				arg.ts = (u64) (uintptr_t) &ts;
+
+				if (cerver_uring_enter (
+					uring->ring_fd, 0, 1,
+					IORING_ENTER_GETEVENTS | IORING_ENTER_EXT_ARG,
+					&arg, sizeof (struct io_uring_getevents_arg)
+				) < 0) {
+					if ((errno != ETIME) && (errno != EINTR)) return -1;
+				}
+			}
+
+			unsigned int tail = __atomic_load_n (uring->cq_tail, __ATOMIC_ACQUIRE);
+			unsigned int count = 0;
+			struct io_uring_cqe *cqe = NULL;
+			CerverUringCompletion *completion = NULL;
+			u32 slot = 0;
+
+			// the slots of the completed sends are freed
+			pthread_mutex_lock (uring->sq_lock);
+
+			while ((head != tail) && (count < max_completions)) {
+				cqe = &uring->cqes[head & *uring->cq_mask];
+				completion = &completions[count];
+
+				completion->op = cerver_uring_user_data_op (cqe->user_data);
+				completion->generation = cerver_uring_user_data_generation (cqe->user_data);
+				completion->sock_fd = cerver_uring_user_data_fd (cqe->user_data);
+				completion->res = cqe->res;
+				completion->more = (cqe->flags & IORING_CQE_F_MORE);
+				completion->has_buffer = (cqe->flags & IORING_CQE_F_BUFFER);
+				completion->buffer_id = (u16) (cqe->flags >> IORING_CQE_BUFFER_SHIFT);
+				completion->data = NULL;
+
+				if (completion->op == CERVER_URING_OP_SEND) {
+					slot = (u32) completion->sock_fd;
+					completion->sock_fd = -1;
+					if (slot < uring->n_sends) {
+						completion->data = uring->sends[slot];
+						uring->free_sends[uring->n_free_sends++] = slot;
+					}
+				}
+
+				head++;
+				count++;
+			}
+
+			pthread_mutex_unlock (uring->sq_lock);
+
+			// mark all of them as seen at once
+			__atomic_store_n (uring->cq_head, head, __ATOMIC_RELEASE);
+
+			retval = (int) count;
+		}
+	}
+
+	return retval;
+
+}
+
+// gets the data that was placed by the kernel in a provided buffer
+char *cerver_uring_buffer_get (CerverUring *uring, const u16 buffer_id) {
+
+	return (uring && (buffer_id < uring->n_buffers)) ?
+		uring->buffers + (buffer_id * uring->buffer_size) : NULL;
+
+}
+
+// returns the provided buffer back to the kernel so it can be used again
+void cerver_uring_buffer_recycle (CerverUring *uring, const u16 buffer_id) {
+
+	if (uring && (buffer_id < uring->n_buffers)) {
+		pthread_mutex_lock (uring->buf_lock);
+		cerver_uring_buffer_recycle_internal (uring, buffer_id);
+		pthread_mutex_unlock (uring->buf_lock);
+	}
+
+}
+
+// takes the provided buffer out of the ring until cerver_uring_buffer_release () is called,
+// so its data can be referenced without copying it
+// returns NULL if too many buffers are already being held, so the kernel never runs out of them
+char *cerver_uring_buffer_hold (CerverUring *uring, const u16 buffer_id) {
+
+	char *buffer = NULL;
+
+	if (uring && (buffer_id < uring->n_buffers)) {
+		pthread_mutex_lock (uring->buf_lock);
+
+		if (uring->n_held < (uring->n_buffers / CERVER_URING_HELD_BUFFERS_DIV)) {
+			uring->n_held += 1;
+			__atomic_add_fetch (&uring->ref_count, 1, __ATOMIC_RELAXED);
+
+			buffer = uring->buffers + (buffer_id * uring->buffer_size);
+		}
+
+		pthread_mutex_unlock (uring->buf_lock);
+	}
+
+	return buffer;
+
+}
+
+// returns a buffer taken with cerver_uring_buffer_hold () back to the kernel,
+// it can be called from any thread & even after the ring has been deleted
+void cerver_uring_buffer_release (void *uring_ptr, char *buffer) {
+
+	if (uring_ptr && buffer) {
+		CerverUring *uring = (CerverUring *) uring_ptr;
+
+		pthread_mutex_lock (uring->buf_lock);
+
+		cerver_uring_buffer_recycle_internal (
+			uring, (u16) ((size_t) (buffer - uring->buffers) / uring->buffer_size)
+		);
+
+		uring->n_held -= 1;
+
+		pthread_mutex_unlock (uring->buf_lock);
+
+		cerver_uring_unref (uring);
+	}
+
+}
+
+#else
+
+// io_uring is not available with the current headers, so everything reports an error
+// and the cerver will fall back to use epoll ()
+
+bool cerver_uring_is_supported (void) { return false; }
+
+CerverUring *cerver_uring_create (
+	const unsigned int entries,
+	const unsigned int n_buffers, const size_t buffer_size
+) { return NULL; }
+
+void cerver_uring_delete (void *uring_ptr) {}
+
+u8 cerver_uring_accept (CerverUring *uring, const i32 sock_fd) { return 1; }
+
+u32 cerver_uring_generation_next (CerverUring *uring) { return 0; }
+
+u8 cerver_uring_recv (CerverUring *uring, const i32 sock_fd, const u32 generation) { return 1; }
+
+u8 cerver_uring_cancel_recv (CerverUring *uring, const i32 sock_fd, const u32 generation) { return 1; }
+
+u8 cerver_uring_send (
+	CerverUring *uring, const i32 sock_fd,
+	const char *buffer, const size_t size,
+	void *data
+) { return 1; }
+
+u8 cerver_uring_cancel (CerverUring *uring, const i32 sock_fd) { return 1; }
+
+u8 cerver_uring_submit (CerverUring *uring) { return 1; }
+
+int cerver_uring_wait (
+	CerverUring *uring,
+	CerverUringCompletion *completions, const unsigned int max_completions,
+	const u32 timeout
+) { return -1; }
+
+char *cerver_uring_buffer_get (CerverUring *uring, const u16 buffer_id) { return NULL; }
+
+void cerver_uring_buffer_recycle (CerverUring *uring, const u16 buffer_id) {}
+
+char *cerver_uring_buffer_hold (CerverUring *uring, const u16 buffer_id) { return NULL; }
+
+void cerver_uring_buffer_release (void *uring_ptr, char *buffer) {}
+
+#endif
\ No newline at end of file
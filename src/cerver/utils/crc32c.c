@@ -0,0 +1,292 @@
+// based on Mark Adler's crc32c.c
+// https://stackoverflow.com/a/17646775
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+#include <pthread.h>
+
+#if defined(__x86_64__)
+#include <nmmintrin.h>
+#define CRC32C_X86
+#endif
+
+#include "cerver/utils/crc32c.h"
+
+#define CRC32C_POLY				0x82f63b78		// reversed castagnoli polynomial
+
+// the hardware version checks three blocks at the same time to hide
+// the crc32 instruction latency & then combines their crcs
+#define CRC32C_LONG				8192
+#define CRC32C_SHORT			256
+
+static pthread_once_t crc32c_once = PTHREAD_ONCE_INIT;
+
+static bool crc32c_sse42 = false;
+
+// slicing by 8 tables for the software version
+static uint32_t crc32c_table[8][256];
+
+// operators that apply CRC32C_LONG & CRC32C_SHORT zeros to a crc
+static uint32_t crc32c_long[4][256];
+static uint32_t crc32c_short[4][256];
+
+#pragma region zeros
+
+// multiplies a matrix by a vector over GF(2)
+static uint32_t gf2_matrix_times (const uint32_t *mat, uint32_t vec) {
+
+	uint32_t sum = 0;
+	while (vec) {
+		if (vec & 1) sum ^= *mat;
+		vec >>= 1;
+		mat++;
+	}
+
+	return sum;
+
+}
+
+static void gf2_matrix_square (uint32_t *square, const uint32_t *mat) {
+
+	for (unsigned int n = 0; n < 32; n++)
+		square[n] = gf2_matrix_times (mat, mat[n]);
+
+}
+
+// builds the operator that applies len zero bytes to a crc
+// len must be a power of two
+static void crc32c_zeros_op (uint32_t *even, size_t len) {
+
+	uint32_t odd[32];
+
+	// the operator for one zero bit
+	odd[0] = CRC32C_POLY;
+	uint32_t row = 1;
+	for (unsigned int n = 1; n < 32; n++) {
+		odd[n] = row;
+		row <<= 1;
+	}
+
+	gf2_matrix_square (even, odd);		// two zero bits
+	gf2_matrix_square (odd, even);		// four zero bits
+
+	// the first square puts the operator for one zero byte in even,
+	// the next one puts the operator for two zero bytes in odd, and so on
+	bool done = false;
+	while (len && !done) {
+		gf2_matrix_square (even, odd);
+		len >>= 1;
+
+		if (len) {
+			gf2_matrix_square (odd, even);
+			len >>= 1;
+
+			if (!len) memcpy (even, odd, sizeof (odd));
+		}
+
+		else {
+			done = true;
+		}
+	}
+
+}
+
+// builds the tables that apply the zeros operator a byte at a time
+static void crc32c_zeros (uint32_t zeros[4][256], size_t len) {
+
+	uint32_t op[32];
+	crc32c_zeros_op (op, len);
+
+	for (uint32_t n = 0; n < 256; n++) {
+		zeros[0][n] = gf2_matrix_times (op, n);
+		zeros[1][n] = gf2_matrix_times (op, n << 8);
+		zeros[2][n] = gf2_matrix_times (op, n << 16);
+		zeros[3][n] = gf2_matrix_times (op, n << 24);
+	}
+
+}
+
+static inline uint32_t crc32c_shift (uint32_t zeros[4][256], uint32_t crc) {
+
+	return zeros[0][crc & 0xff] ^ zeros[1][(crc >> 8) & 0xff]
+		^ zeros[2][(crc >> 16) & 0xff] ^ zeros[3][crc >> 24];
+
+}
+
+#pragma endregion
+
+#pragma region init
+
+static void crc32c_init (void) {
+
+	for (uint32_t n = 0; n < 256; n++) {
+		uint32_t crc = n;
+		for (unsigned int k = 0; k < 8; k++)
+			crc = (crc & 1) ? (crc >> 1) ^ CRC32C_POLY : crc >> 1;
+
+		crc32c_table[0][n] = crc;
+	}
+
+	for (uint32_t n = 0; n < 256; n++) {
+		uint32_t crc = crc32c_table[0][n];
+		for (unsigned int k = 1; k < 8; k++) {
+			crc = crc32c_table[0][crc & 0xff] ^ (crc >> 8);
+			crc32c_table[k][n] = crc;
+		}
+	}
+
+	#ifdef CRC32C_X86
+	crc32c_sse42 = __builtin_cpu_supports ("sse4.2");
+	#endif
+
+	if (crc32c_sse42) {
+		crc32c_zeros (crc32c_long, CRC32C_LONG);
+		crc32c_zeros (crc32c_short, CRC32C_SHORT);
+	}
+
+}
+
+#pragma endregion
+
+#pragma region calc
+
+static uint32_t crc32c_software (uint32_t crc, const unsigned char *next, size_t len) {
+
+	uint64_t crc0 = crc ^ 0xffffffff;
+
+	while (len && ((uintptr_t) next & 7)) {
+		crc0 = crc32c_table[0][(crc0 ^ *next++) & 0xff] ^ (crc0 >> 8);
+		len--;
+	}
+
+	uint64_t word = 0;
+	while (len >= 8) {
+		memcpy (&word, next, sizeof (uint64_t));
+		crc0 ^= word;
+		crc0 = crc32c_table[7][crc0 & 0xff]
+			^ crc32c_table[6][(crc0 >> 8) & 0xff]
+			^ crc32c_table[5][(crc0 >> 16) & 0xff]
+			^ crc32c_table[4][(crc0 >> 24) & 0xff]
+			^ crc32c_table[3][(crc0 >> 32) & 0xff]
+			^ crc32c_table[2][(crc0 >> 40) & 0xff]
+			^ crc32c_table[1][(crc0 >> 48) & 0xff]
+			^ crc32c_table[0][crc0 >> 56];
+
+		next += 8;
+		len -= 8;
+	}
+
+	while (len) {
+		crc0 = crc32c_table[0][(crc0 ^ *next++) & 0xff] ^ (crc0 >> 8);
+		len--;
+	}
+
+	return (uint32_t) crc0 ^ 0xffffffff;
+
+}
+
+#ifdef CRC32C_X86
+
+// checks three consecutive blocks of block_size bytes at the same time
+// returns the crc of the three of them
+__attribute__ ((target ("sse4.2")))
+static inline uint64_t crc32c_hardware_blocks (
+	uint64_t crc0, const unsigned char *next, size_t block_size,
+	uint32_t zeros[4][256]
+) {
+
+	uint64_t crc1 = 0;
+	uint64_t crc2 = 0;
+	uint64_t word0 = 0, word1 = 0, word2 = 0;
+
+	const unsigned char *end = next + block_size;
+	while (next < end) {
+		memcpy (&word0, next, sizeof (uint64_t));
+		memcpy (&word1, next + block_size, sizeof (uint64_t));
+		memcpy (&word2, next + (block_size * 2), sizeof (uint64_t));
+
+		crc0 = _mm_crc32_u64 (crc0, word0);
+		crc1 = _mm_crc32_u64 (crc1, word1);
+		crc2 = _mm_crc32_u64 (crc2, word2);
+
+		next += 8;
+	}
+
+	crc0 = crc32c_shift (zeros, (uint32_t) crc0) ^ crc1;
+	crc0 = crc32c_shift (zeros, (uint32_t) crc0) ^ crc2;
+
+	return crc0;
+
+}
+
+__attribute__ ((target ("sse4.2")))
+static uint32_t crc32c_sse (uint32_t crc, const unsigned char *next, size_t len) {
+
+	uint64_t crc0 = crc ^ 0xffffffff;
+
+	while (len && ((uintptr_t) next & 7)) {
+		crc0 = _mm_crc32_u8 ((uint32_t) crc0, *next++);
+		len--;
+	}
+
+	while (len >= (CRC32C_LONG * 3)) {
+		crc0 = crc32c_hardware_blocks (crc0, next, CRC32C_LONG, crc32c_long);
+		next += CRC32C_LONG * 3;
+		len -= CRC32C_LONG * 3;
+	}
+
+	while (len >= (CRC32C_SHORT * 3)) {
+		crc0 = crc32c_hardware_blocks (crc0, next, CRC32C_SHORT, crc32c_short);
+		next += CRC32C_SHORT * 3;
+		len -= CRC32C_SHORT * 3;
+	}
+
+	uint64_t word = 0;
+	while (len >= 8) {
+		memcpy (&word, next, sizeof (uint64_t));
+		crc0 = _mm_crc32_u64 (crc0, word);
+		next += 8;
+		len -= 8;
+	}
+
+	while (len) {
+		crc0 = _mm_crc32_u8 ((uint32_t) crc0, *next++);
+		len--;
+	}
+
+	return (uint32_t) crc0 ^ 0xffffffff;
+
+}
+
+#endif
+
+// calculates the crc32c (castagnoli) of the buffer, continuing from crc
+// use 0 as the initial crc, so a buffer can be checked in pieces
+// the sse4.2 crc32 instruction is used when the cpu supports it
+uint32_t crc32c_calc (uint32_t crc, const void *buffer, size_t len) {
+
+	(void) pthread_once (&crc32c_once, crc32c_init);
+
+	#ifdef CRC32C_X86
+	return crc32c_sse42 ?
+		crc32c_sse (crc, (const unsigned char *) buffer, len) :
+		crc32c_software (crc, (const unsigned char *) buffer, len);
+	#else
+	return crc32c_software (crc, (const unsigned char *) buffer, len);
+	#endif
+
+}
+
+// returns true if crc32c_calc () uses the cpu's crc32 instruction
+bool crc32c_hardware (void) {
+
+	(void) pthread_once (&crc32c_once, crc32c_init);
+
+	return crc32c_sse42;
+
+}
+
+#pragma endregion
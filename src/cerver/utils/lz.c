@@ -0,0 +1,256 @@
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+#include "cerver/utils/lz.h"
+
+#define LZ_MIN_MATCH			4
+#define LZ_MAX_OFFSET			65535
+
+#define LZ_HASH_LOG				12
+#define LZ_HASH_SIZE			(1 << LZ_HASH_LOG)
+
+// the last bytes are always literals & no match can start too close to the end,
+// so the match finder can always read 4 bytes ahead
+#define LZ_LAST_LITERALS		5
+#define LZ_MF_LIMIT				12
+
+// every 64 bytes without a match, the match finder skips one byte more
+#define LZ_SKIP_TRIGGER			6
+
+static inline uint32_t lz_read32 (const uint8_t *p) {
+
+	uint32_t value = 0;
+	memcpy (&value, p, sizeof (uint32_t));
+	return value;
+
+}
+
+static inline uint32_t lz_hash (uint32_t sequence) {
+
+	return (sequence * 2654435761U) >> (32 - LZ_HASH_LOG);
+
+}
+
+static inline uint8_t *lz_write_length (uint8_t *op, size_t length) {
+
+	while (length >= 255) {
+		*op++ = 255;
+		length -= 255;
+	}
+
+	*op++ = (uint8_t) length;
+
+	return op;
+
+}
+
+// writes the literals since the anchor & the match that follows them, if any
+// returns NULL if the sequence does not fit in the output
+static uint8_t *lz_write_sequence (
+	uint8_t *op, const uint8_t *oend,
+	const uint8_t *anchor, size_t literals,
+	size_t offset, size_t match_length
+) {
+
+	size_t needed = 1 + literals + (literals / 255) + 1;
+	if (match_length) needed += 2 + (match_length / 255) + 1;
+
+	if (needed <= (size_t) (oend - op)) {
+		uint8_t *token = op++;
+
+		*token = (uint8_t) (((literals >= 15) ? 15 : literals) << 4);
+		if (literals >= 15) op = lz_write_length (op, literals - 15);
+
+		memcpy (op, anchor, literals);
+		op += literals;
+
+		if (match_length) {
+			*op++ = (uint8_t) (offset & 0xff);
+			*op++ = (uint8_t) (offset >> 8);
+
+			size_t length = match_length - LZ_MIN_MATCH;
+			*token |= (uint8_t) ((length >= 15) ? 15 : length);
+			if (length >= 15) op = lz_write_length (op, length - 15);
+		}
+	}
+
+	else {
+		op = NULL;
+	}
+
+	return op;
+
+}
+
+// returns the max size that the compressed input can take
+size_t lz_compress_bound (size_t input_size) {
+
+	return input_size + (input_size / 255) + 16;
+
+}
+
+// compresses the input into the output
+// returns the compressed size, 0 if it did not fit in the output
+size_t lz_compress (
+	const void *input, size_t input_size,
+	void *output, size_t output_capacity
+) {
+
+	const uint8_t *base = (const uint8_t *) input;
+	const uint8_t *ip = base;
+	const uint8_t *anchor = base;
+	const uint8_t *iend = base + input_size;
+
+	uint8_t *op = (uint8_t *) output;
+	const uint8_t *oend = op + output_capacity;
+
+	if (input_size > LZ_MF_LIMIT) {
+		uint32_t table[LZ_HASH_SIZE];
+		memset (table, 0, sizeof (table));
+
+		const uint8_t *mflimit = iend - LZ_MF_LIMIT;
+		const uint8_t *matchlimit = iend - LZ_LAST_LITERALS;
+
+		size_t misses = 0;
+		while (op && (ip < mflimit)) {
+			uint32_t sequence = lz_read32 (ip);
+			uint32_t hash = lz_hash (sequence);
+
+			const uint8_t *ref = base + table[hash];
+			table[hash] = (uint32_t) (ip - base);
+
+			if (
+				(ref < ip) && ((size_t) (ip - ref) <= LZ_MAX_OFFSET)
+				&& (lz_read32 (ref) == sequence)
+			) {
+				const uint8_t *match_end = ip + LZ_MIN_MATCH;
+				const uint8_t *ref_end = ref + LZ_MIN_MATCH;
+				while ((match_end < matchlimit) && (*match_end == *ref_end)) {
+					match_end++;
+					ref_end++;
+				}
+
+				op = lz_write_sequence (
+					op, oend,
+					anchor, (size_t) (ip - anchor),
+					(size_t) (ip - ref), (size_t) (match_end - ip)
+				);
+
+				ip = match_end;
+				anchor = ip;
+				misses = 0;
+			}
+
+			else {
+				ip += 1 + (misses++ >> LZ_SKIP_TRIGGER);
+			}
+		}
+	}
+
+	if (op) op = lz_write_sequence (op, oend, anchor, (size_t) (iend - anchor), 0, 0);
+
+	return op ? (size_t) (op - (uint8_t *) output) : 0;
+
+}
+
+// reads an extended length
+// returns false if the input ends before it
+static inline bool lz_read_length (const uint8_t **ip, const uint8_t *iend, size_t *length) {
+
+	bool valid = true;
+
+	uint8_t byte = 255;
+	while (valid && (byte == 255)) {
+		if (*ip < iend) {
+			byte = *(*ip)++;
+			*length += byte;
+		}
+
+		else {
+			valid = false;
+		}
+	}
+
+	return valid;
+
+}
+
+// decompresses the input into the output, that must be of the original size
+// every length & offset is checked, so it is safe to use with untrusted input
+// returns 0 on success, 1 if the input is corrupted or it does not match the output size
+uint8_t lz_decompress (
+	const void *input, size_t input_size,
+	void *output, size_t output_size
+) {
+
+	const uint8_t *ip = (const uint8_t *) input;
+	const uint8_t *iend = ip + input_size;
+
+	uint8_t *base = (uint8_t *) output;
+	uint8_t *op = base;
+	uint8_t *oend = base + output_size;
+
+	bool valid = (input_size > 0);
+	bool done = false;
+	while (valid && !done) {
+		uint8_t token = *ip++;
+
+		size_t literals = token >> 4;
+		if (literals == 15) valid = lz_read_length (&ip, iend, &literals);
+
+		if (valid && (literals <= (size_t) (iend - ip)) && (literals <= (size_t) (oend - op))) {
+			memcpy (op, ip, literals);
+			op += literals;
+			ip += literals;
+
+			// the last sequence only has literals
+			if (ip == iend) {
+				done = true;
+			}
+
+			else if ((iend - ip) >= 2) {
+				size_t offset = (size_t) ip[0] | ((size_t) ip[1] << 8);
+				ip += 2;
+
+				size_t match_length = token & 15;
+				if (match_length == 15) valid = lz_read_length (&ip, iend, &match_length);
+				match_length += LZ_MIN_MATCH;
+
+				if (
+					valid && offset && (offset <= (size_t) (op - base))
+					&& (match_length <= (size_t) (oend - op))
+					&& (ip < iend)
+				) {
+					// when the match overlaps the bytes that it is producing,
+					// every copy doubles the repeated pattern that the next one can take
+					const uint8_t *ref = op - offset;
+					const uint8_t *match_end = op + match_length;
+					while (op < match_end) {
+						size_t chunk = (size_t) (op - ref);
+						if (chunk > (size_t) (match_end - op)) chunk = (size_t) (match_end - op);
+
+						memcpy (op, ref, chunk);
+						op += chunk;
+					}
+				}
+
+				else {
+					valid = false;
+				}
+			}
+
+			else {
+				valid = false;
+			}
+		}
+
+		else {
+			valid = false;
+		}
+	}
+
+	return (valid && (op == oend)) ? 0 : 1;
+
+}
@@ -0,0 +1,236 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include <time.h>
+#include <unistd.h>
+
+#include <pthread.h>
+
+#include <sys/socket.h>
+
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#include <cerver/version.h>
+#include <cerver/cerver.h>
+#include <cerver/client.h>
+#include <cerver/connection.h>
+#include <cerver/handler.h>
+#include <cerver/packets.h>
+
+#include <cerver/utils/log.h>
+#include <cerver/utils/utils.h>
+
+// drops a connection from one of its packets while the buffers that it sent after it
+// are still queued in its socket's serial executor, none of them should be handled,
+// & the socket that goes back to the pool has to work for the next connection
+
+// the dropped connections keep the port in TIME_WAIT, so each run uses its own
+#define TEST_PORT_BASE			7000
+#define TEST_PORT_RANGE			1000
+
+#define TEST_N_BUFFERS			64
+
+typedef enum TestRequest {
+
+	TEST_REQUEST_DROP		= 1,
+	TEST_REQUEST_QUEUED		= 2,
+	TEST_REQUEST_NEXT		= 3
+
+} TestRequest;
+
+static Cerver *test_cerver = NULL;
+static u16 test_port = TEST_PORT_BASE;
+
+static volatile bool dropped = false;
+static volatile unsigned int n_handled_after_drop = 0;
+static volatile unsigned int n_handled_next = 0;
+
+#pragma region handler
+
+static void test_handler (void *data) {
+
+	Packet *packet = (Packet *) data;
+
+	switch (packet->header->request_type) {
+		case TEST_REQUEST_DROP: {
+			// gives the client the time to queue its other buffers behind this one
+			usleep (200000);
+
+			(void) client_remove_connection_by_sock_fd (
+				packet->cerver, packet->client, packet->connection->socket->sock_fd
+			);
+
+			__atomic_store_n (&dropped, true, __ATOMIC_RELEASE);
+		} break;
+
+		case TEST_REQUEST_QUEUED: {
+			if (__atomic_load_n (&dropped, __ATOMIC_ACQUIRE))
+				__atomic_add_fetch (&n_handled_after_drop, 1, __ATOMIC_RELAXED);
+		} break;
+
+		case TEST_REQUEST_NEXT: {
+			__atomic_add_fetch (&n_handled_next, 1, __ATOMIC_RELAXED);
+		} break;
+
+		default: break;
+	}
+
+}
+
+#pragma endregion
+
+#pragma region client
+
+static int test_client_connect (void) {
+
+	int sock_fd = socket (AF_INET, SOCK_STREAM, 0);
+	if (sock_fd >= 0) {
+		struct sockaddr_in address = { 0 };
+		address.sin_family = AF_INET;
+		address.sin_port = htons (test_port);
+		address.sin_addr.s_addr = inet_addr ("127.0.0.1");
+
+		if (connect (sock_fd, (struct sockaddr *) &address, sizeof (struct sockaddr_in))) {
+			close (sock_fd);
+			sock_fd = -1;
+		}
+	}
+
+	return sock_fd;
+
+}
+
+static u8 test_client_send (int sock_fd, TestRequest request) {
+
+	u8 retval = 1;
+
+	Packet *packet = packet_generate_request (PACKET_TYPE_APP, request, NULL, 0);
+	if (packet) {
+		if (send (sock_fd, packet->packet, packet->packet_size, 0) == (ssize_t) packet->packet_size)
+			retval = 0;
+
+		packet_delete (packet);
+	}
+
+	return retval;
+
+}
+
+// waits until the cerver closes the connection
+static void test_client_wait_closed (int sock_fd) {
+
+	struct timeval timeout = { .tv_sec = 5, .tv_usec = 0 };
+	(void) setsockopt (sock_fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof (struct timeval));
+
+	char buffer[1024];
+	while (recv (sock_fd, buffer, sizeof (buffer), 0) > 0);
+
+}
+
+#pragma endregion
+
+#pragma region main
+
+static void *test_cerver_start (void *args) {
+
+	(void) cerver_start ((Cerver *) args);
+
+	return NULL;
+
+}
+
+static void test_wait (unsigned int ms) {
+
+	struct timespec time = { .tv_sec = ms / 1000, .tv_nsec = (ms % 1000) * 1000000 };
+	(void) nanosleep (&time, NULL);
+
+}
+
+int main (void) {
+
+	int retval = 1;
+
+	cerver_init ();
+
+	cerver_version_print_full ();
+
+	test_port = TEST_PORT_BASE + (getpid () % TEST_PORT_RANGE);
+
+	test_cerver = cerver_create (CERVER_TYPE_CUSTOM, "dispatch-test", test_port, PROTOCOL_TCP, false, 2, 200);
+	if (test_cerver) {
+		cerver_set_handler_type (test_cerver, CERVER_HANDLER_TYPE_EPOLL);
+		cerver_set_receive_buffer_size (test_cerver, 4096);
+		cerver_set_thpool_n_threads (test_cerver, 4);
+		cerver_set_ordered_dispatch (test_cerver, true);
+
+		Handler *app_handler = handler_create (test_handler);
+		handler_set_direct_handle (app_handler, true);
+		cerver_set_app_handlers (test_cerver, app_handler, NULL);
+
+		pthread_t cerver_thread;
+		if (!pthread_create (&cerver_thread, NULL, test_cerver_start, test_cerver)) {
+			test_wait (500);
+
+			int sock_fd = test_client_connect ();
+			if (sock_fd >= 0) {
+				(void) test_client_send (sock_fd, TEST_REQUEST_DROP);
+
+				// every packet is received in its own buffer while the first one is being handled
+				for (unsigned int i = 0; i < TEST_N_BUFFERS; i++) {
+					test_wait (1);
+					(void) test_client_send (sock_fd, TEST_REQUEST_QUEUED);
+				}
+
+				test_client_wait_closed (sock_fd);
+				close (sock_fd);
+			}
+
+			// the socket of the dropped connection is taken from the pool
+			sock_fd = test_client_connect ();
+			if (sock_fd >= 0) {
+				test_wait (100);
+				(void) test_client_send (sock_fd, TEST_REQUEST_NEXT);
+				test_wait (200);
+				close (sock_fd);
+			}
+
+			test_wait (200);
+
+			if (!__atomic_load_n (&dropped, __ATOMIC_ACQUIRE)) {
+				cerver_log_error ("The connection was not dropped!");
+			}
+
+			else if (n_handled_after_drop) {
+				cerver_log_error (
+					"%u queued buffers were handled after their connection was dropped!",
+					n_handled_after_drop
+				);
+			}
+
+			else if (n_handled_next != 1) {
+				cerver_log_error ("The connection that reused the socket was not handled!");
+			}
+
+			else {
+				cerver_log_success ("Queued buffers were discarded with their dropped connection!");
+				retval = 0;
+			}
+
+			// the cerver is stopped before it is deleted, so its handler can return first
+			(void) cerver_shutdown (test_cerver);
+			(void) pthread_join (cerver_thread, NULL);
+		}
+
+		(void) cerver_teardown (test_cerver);
+	}
+
+	cerver_end ();
+
+	return retval;
+
+}
+
+#pragma endregion